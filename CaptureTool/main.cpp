@@ -0,0 +1,296 @@
+﻿// CaptureTool.cpp
+// - ColorWorker 증거 이미지 아카이브(capture_archive) 관리 도구 (OpenCV 불필요)
+// - 아카이브는 세그먼트(seg_NNNNNN.cap) + index.fci. 형식은 Common/capture_archive.h 참고
+//
+// 사용:
+//   CaptureTool list <archiveDir>                          label / 시각 / 크기 / 위치
+//   CaptureTool extract <archiveDir> <label> <out.jpg>     한 장 꺼내기
+//   CaptureTool extract-all <archiveDir> <outDir> [--prefix color_]
+//                                                          전부 <prefix><label>.jpg 로 (기존 폴더 형식)
+//   CaptureTool pack <archiveDir> <jpgDir> [--strip-prefix color_]
+//                                                          기존 color_<label>.jpg 들을 아카이브로 옮겨 담기
+//   CaptureTool rebuild-index <archiveDir>                 세그먼트 스캔으로 index.fci 재생성
+//   CaptureTool stats <archiveDir>                         세그먼트별 개수/용량, 전체 합계
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <filesystem>
+
+#include "../Common/capture_archive.h"
+
+using namespace std;
+
+static void PrintUsage()
+{
+    cerr << "usage:\n"
+        << "  CaptureTool list <archiveDir>\n"
+        << "  CaptureTool extract <archiveDir> <label> <out.jpg>\n"
+        << "  CaptureTool extract-all <archiveDir> <outDir> [--prefix color_]\n"
+        << "  CaptureTool pack <archiveDir> <jpgDir> [--strip-prefix color_]\n"
+        << "  CaptureTool rebuild-index <archiveDir>\n"
+        << "  CaptureTool stats <archiveDir>\n";
+}
+
+static string FormatTimeMs(int64_t ms)
+{
+    time_t t = (time_t)(ms / 1000);
+    tm tmv{};
+#ifdef _WIN32
+    localtime_s(&tmv, &t);
+#else
+    localtime_r(&t, &tmv);
+#endif
+    ostringstream oss;
+    oss << put_time(&tmv, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << (ms % 1000);
+    return oss.str();
+}
+
+static bool WriteBytes(const string& path, const uint8_t* data, size_t len)
+{
+    ofstream ofs(path, ios::binary | ios::trunc);
+    if (!ofs.is_open()) return false;
+    ofs.write((const char*)data, (streamsize)len);
+    return (bool)ofs;
+}
+
+static bool ReadBytes(const string& path, vector<uint8_t>& out)
+{
+    ifstream ifs(path, ios::binary);
+    if (!ifs.is_open()) return false;
+    out.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+    return true;
+}
+
+static bool OpenReader(CaptureArchiveReader& rd, const string& dir)
+{
+    string err;
+    if (!rd.Open(dir, err)) {
+        cerr << "[ERR] " << err << "\n";
+        return false;
+    }
+    return true;
+}
+
+// =====================
+// Commands
+// =====================
+static int CmdList(const string& dir)
+{
+    CaptureArchiveReader rd;
+    if (!OpenReader(rd, dir)) return 1;
+
+    for (const CaptureRef& r : rd.Entries()) {
+        cout << left << setw(24) << r.label << right
+            << "  " << FormatTimeMs(r.timeMs)
+            << "  " << setw(8) << r.length << " B"
+            << "  seg " << r.segId << " @" << r.offset << "\n";
+    }
+    cout << rd.Entries().size() << " entries\n";
+    return 0;
+}
+
+static int CmdExtract(const string& dir, const string& label, const string& outPath)
+{
+    CaptureArchiveReader rd;
+    if (!OpenReader(rd, dir)) return 1;
+
+    const CaptureRef* r = rd.Find(label);
+    if (!r) {
+        cerr << "[ERR] label not found: " << label << "\n";
+        return 1;
+    }
+
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    if (!rd.Read(*r, data, len)) {
+        cerr << "[ERR] cannot read seg " << r->segId << " @" << r->offset << "\n";
+        return 1;
+    }
+    if (!WriteBytes(outPath, data, len)) {
+        cerr << "[ERR] cannot write " << outPath << "\n";
+        return 1;
+    }
+    cout << label << " -> " << outPath << " (" << len << " B)\n";
+    return 0;
+}
+
+static int CmdExtractAll(const string& dir, const string& outDir, const string& prefix)
+{
+    CaptureArchiveReader rd;
+    if (!OpenReader(rd, dir)) return 1;
+
+    error_code ec;
+    filesystem::create_directories(outDir, ec);
+
+    // 같은 label 이 여러 번이면 마지막 것만 (Find 와 같은 규칙)
+    size_t written = 0, failed = 0;
+    for (const CaptureRef& r : rd.Entries()) {
+        if (rd.Find(r.label) != &r) continue;
+
+        const uint8_t* data = nullptr;
+        size_t len = 0;
+        string path = (filesystem::path(outDir) / (prefix + r.label + ".jpg")).string();
+        if (rd.Read(r, data, len) && WriteBytes(path, data, len)) written++;
+        else {
+            cerr << "[ERR] " << r.label << " -> " << path << "\n";
+            failed++;
+        }
+    }
+    cout << "extracted " << written << " files to " << outDir;
+    if (failed) cout << " (" << failed << " failed)";
+    cout << "\n";
+    return failed ? 1 : 0;
+}
+
+static int CmdPack(const string& dir, const string& jpgDir, const string& stripPrefix)
+{
+    if (!filesystem::is_directory(jpgDir)) {
+        cerr << "[ERR] not a directory: " << jpgDir << "\n";
+        return 1;
+    }
+
+    // 파일 수정 시각 순으로 넣는다 (아카이브 안의 순서 = 촬영 순서)
+    vector<pair<filesystem::file_time_type, filesystem::path>> files;
+    for (const auto& e : filesystem::directory_iterator(jpgDir)) {
+        if (!e.is_regular_file()) continue;
+        string ext = e.path().extension().string();
+        transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+        if (ext != ".jpg" && ext != ".jpeg") continue;
+        string stem = e.path().stem().string();
+        if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".tmp") == 0) continue; // 쓰다 만 파일
+        files.push_back({ e.last_write_time(), e.path() });
+    }
+    sort(files.begin(), files.end());
+
+    CaptureArchiveOptions opt;
+    opt.dir = dir;
+    CaptureArchiveWriter wr(opt);
+    string err;
+    if (!wr.Open(err)) {
+        cerr << "[ERR] " << err << "\n";
+        return 1;
+    }
+
+    size_t packed = 0;
+    uint64_t bytes = 0;
+    for (const auto& f : files) {
+        string label = f.second.stem().string();
+        if (!stripPrefix.empty() && label.compare(0, stripPrefix.size(), stripPrefix) == 0)
+            label = label.substr(stripPrefix.size());
+
+        vector<uint8_t> data;
+        if (!ReadBytes(f.second.string(), data)) {
+            cerr << "[ERR] cannot read " << f.second.string() << "\n";
+            continue;
+        }
+
+        // file_time_type -> system_clock (C++17 에는 clock_cast 가 없음)
+        auto sys = chrono::time_point_cast<chrono::milliseconds>(
+            f.first - filesystem::file_time_type::clock::now() + chrono::system_clock::now());
+        if (!wr.Append(label, data.data(), data.size(), sys.time_since_epoch().count())) {
+            cerr << "[ERR] append failed: " << label << "\n";
+            continue;
+        }
+        packed++;
+        bytes += data.size();
+    }
+    wr.Close();
+
+    cout << "packed " << packed << "/" << files.size() << " files (" << bytes << " B) into " << dir << "\n";
+    cout << "(원본 jpg 는 지우지 않음)\n";
+    return packed == files.size() ? 0 : 1;
+}
+
+static int CmdRebuildIndex(const string& dir)
+{
+    string err;
+    size_t n = 0;
+    if (!CaptureArchiveReader::RebuildIndex(dir, err, &n)) {
+        cerr << "[ERR] " << err << "\n";
+        return 1;
+    }
+    cout << "index rebuilt: " << n << " entries\n";
+    return 0;
+}
+
+static int CmdStats(const string& dir)
+{
+    CaptureArchiveReader rd;
+    if (!OpenReader(rd, dir)) return 1;
+
+    struct SegStat { size_t count = 0; uint64_t bytes = 0; int64_t t0 = 0, t1 = 0; };
+    map<uint32_t, SegStat> segs;
+    for (uint32_t id : rd.Segments()) segs[id];
+
+    map<string, size_t> labels;
+    uint64_t total = 0;
+    for (const CaptureRef& r : rd.Entries()) {
+        SegStat& s = segs[r.segId];
+        if (s.count == 0 || r.timeMs < s.t0) s.t0 = r.timeMs;
+        if (s.count == 0 || r.timeMs > s.t1) s.t1 = r.timeMs;
+        s.count++;
+        s.bytes += r.length;
+        total += r.length;
+        labels[r.label]++;
+    }
+
+    for (const auto& kv : segs) {
+        error_code ec;
+        uint64_t fileBytes = filesystem::file_size(CaptureSegmentPath(dir, kv.first), ec);
+        cout << "seg " << setw(6) << setfill('0') << kv.first << setfill(' ')
+            << "  images=" << setw(6) << kv.second.count
+            << "  data=" << setw(10) << kv.second.bytes
+            << "  file=" << setw(10) << (ec ? 0 : fileBytes);
+        if (kv.second.count)
+            cout << "  " << FormatTimeMs(kv.second.t0) << " ~ " << FormatTimeMs(kv.second.t1);
+        cout << "\n";
+    }
+
+    size_t dup = rd.Entries().size() - labels.size();
+    cout << "total: " << rd.Entries().size() << " images, " << labels.size() << " labels";
+    if (dup) cout << " (" << dup << " overwritten)";
+    cout << ", " << total << " B";
+    if (!rd.Entries().empty()) cout << ", avg " << (total / rd.Entries().size()) << " B";
+    cout << "\n";
+    return 0;
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        PrintUsage();
+        return 2;
+    }
+
+    string cmd = argv[1];
+    string dir = argv[2];
+
+    // 옵션 (--prefix / --strip-prefix)
+    auto opt = [&](const char* name, const string& def) {
+        for (int i = 3; i + 1 < argc; i++)
+            if (string(argv[i]) == name) return string(argv[i + 1]);
+        return def;
+    };
+
+    if (cmd == "list") return CmdList(dir);
+    if (cmd == "extract" && argc >= 5) return CmdExtract(dir, argv[3], argv[4]);
+    if (cmd == "extract-all" && argc >= 4) return CmdExtractAll(dir, argv[3], opt("--prefix", "color_"));
+    if (cmd == "pack" && argc >= 4) return CmdPack(dir, argv[3], opt("--strip-prefix", "color_"));
+    if (cmd == "rebuild-index") return CmdRebuildIndex(dir);
+    if (cmd == "stats") return CmdStats(dir);
+
+    PrintUsage();
+    return 2;
+}
@@ -0,0 +1,416 @@
+﻿// ColorBench.cpp
+// - 색상 판별(ClassifyColorROI) 정확도 / 처리량 회귀 벤치마크
+// - 라벨 붙은 캡처(color_<r|g|b|n>N.jpg, 접두사 = 정답) 전체를 메모리에 올려 두고
+//   워커와 같은 함수로 판별한다 (jpg 디코드 시간은 빼고 판별만 잰다)
+// - 모든 코어에 이미지를 나눠서 --repeat 번 돌림 -> images/s (전체 벽시계 기준), 이미지당 ms 분포
+// - 보고: 클래스별 혼동 행렬 / precision / recall, 1등-2등 마진 분포, 가장 나쁜 이미지들
+//   마진 = (1등 색 - 2등 색) / 분모 (분모 = ROI 픽셀, object 모드는 물체 픽셀)
+//   정답 마진 = (정답색 - 다른 색 최대) / 분모 (NONE 은 -(최다 색) / 분모) -> 음수/작을수록 위험
+// - --json 으로 결과 저장 (cv::FileStorage JSON). --baseline 에 이전 결과를 주면 차이를 보여주고
+//   정확도가 떨어지면 종료 코드 1 (처리량은 PC 상태에 따라 흔들려서 --max-slowdown 을 줄 때만 검사)
+//
+// 사용:
+//   ColorBench <captureDir> [<captureDir> ...] [--config color_config.yaml] [--mode mask,hist,...|all]
+//              [--threads N] [--repeat N] [--worst N] [--json out.json] [--baseline old.json] [--max-slowdown PCT]
+//     --config : 없으면 ColorWorker 기본값 (ColorWorker 처럼 파일의 키만 덮어씀)
+//     --mode   : mask / hist / mask_ref / object, 쉼표로 여러 개, all = 전부 (기본: 설정 파일의 classify_mode)
+
+#include <opencv2/opencv.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+#include "../Common/color_classify.h"
+#include "../Common/color_config.h"
+#include "../Common/color_corpus.h"
+
+using namespace std;
+using namespace cv;
+
+// 1등-2등 마진 히스토그램 구간 (비율, 위쪽 경계)
+static const double MARGIN_BINS[] = { 0.005, 0.01, 0.02, 0.05, 0.1, 0.2 };
+static const int MARGIN_BIN_N = sizeof(MARGIN_BINS) / sizeof(MARGIN_BINS[0]) + 1;
+
+// =====================
+// 실행
+// =====================
+struct ImageResult {
+    int pred = TRUTH_NONE;
+    int pix[3] = {};
+    double denom = 0.0;
+    double margin = 0.0;      // 1등 - 2등
+    double truthMargin = 0.0; // 정답 기준 (음수 = 틀림 쪽)
+    double ms = 0.0;          // 판별 1회 (보고는 --repeat 중 최소)
+};
+
+struct ModeReport {
+    string mode;
+    int threads = 0;
+    int repeat = 0;
+    double wallSec = 0.0;
+    double imagesPerSec = 0.0;
+    double msP50 = 0.0, msP99 = 0.0, msMax = 0.0;
+    int correct = 0;
+    int total = 0;
+    int confusion[4][4] = {};
+    double marginPct[4][4] = {}; // 클래스별 (p1, p5, p50, min) 1등-2등 마진, 정답 클래스 기준
+    int marginHist[MARGIN_BIN_N] = {};
+    vector<ImageResult> images;
+};
+
+static double Percentile(vector<double> v, double p)
+{
+    if (v.empty()) return 0.0;
+    sort(v.begin(), v.end());
+    size_t k = (size_t)min((double)v.size() - 1, floor(p * (v.size() - 1) + 0.5));
+    return v[k];
+}
+
+static void ClassifyOne(const CorpusImage& im, const ColorTables& tb, ImageResult& r)
+{
+    ObjectColorInfo obj;
+    int rp = 0, gp = 0, bp = 0;
+    int64 t0 = getTickCount();
+    string color = (tb.cfg.classifyMode == CLASSIFY_OBJECT)
+        ? ClassifyColorObject(im.bgr, tb, rp, gp, bp, &obj)
+        : ClassifyColorROI(im.bgr, tb, rp, gp, bp);
+    double ms = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+
+    r.ms = ms;
+    r.pred = TruthFromColor(color);
+    r.pix[0] = rp; r.pix[1] = gp; r.pix[2] = bp;
+    r.denom = obj.found ? (double)obj.area : (double)im.bgr.rows * im.bgr.cols;
+}
+
+static void FillMargins(int truth, ImageResult& r)
+{
+    if (r.denom <= 0) return;
+    int top[3] = { r.pix[0], r.pix[1], r.pix[2] };
+    sort(top, top + 3);
+    r.margin = (top[2] - top[1]) / r.denom;
+    if (truth == TRUTH_NONE) r.truthMargin = -top[2] / r.denom;
+    else r.truthMargin = (r.pix[truth] - max(r.pix[(truth + 1) % 3], r.pix[(truth + 2) % 3])) / r.denom;
+}
+
+static ModeReport RunMode(const vector<CorpusImage>& corpus, const ColorConfig& base, int mode, int threads, int repeat)
+{
+    ColorConfig cfg = base;
+    cfg.classifyMode = mode;
+    shared_ptr<const ColorTables> tb = BuildColorTables(cfg, 0);
+
+    ModeReport rep;
+    rep.mode = ClassifyModeName(mode);
+    rep.threads = threads;
+    rep.repeat = repeat;
+    rep.images.assign(corpus.size(), ImageResult());
+
+    // 워밍업 1회 (첫 호출의 할당 / 캐시 미스를 빼려고)
+    ImageResult warm;
+    ClassifyOne(corpus[0], *tb, warm);
+
+    // job j = 이미지 j % N 의 (j / N) 번째 반복. 결과는 반복마다 같아서 첫 반복 것만 남기고,
+    // 시간은 job 별로 따로 적어 뒀다가 이미지별 최소값으로 (슬롯이 겹치지 않아 잠금 없음)
+    const size_t jobs = corpus.size() * (size_t)repeat;
+    vector<double> jobMs(jobs, 0.0);
+    atomic<size_t> next{ 0 };
+    auto t0 = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            for (size_t j = next++; j < jobs; j = next++) {
+                size_t i = j % corpus.size();
+                ImageResult r;
+                ClassifyOne(corpus[i], *tb, r);
+                jobMs[j] = r.ms;
+                if (j < corpus.size()) rep.images[i] = r;
+            }
+        });
+    }
+    for (thread& t : pool) t.join();
+    rep.wallSec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    rep.imagesPerSec = rep.wallSec > 0 ? jobs / rep.wallSec : 0.0;
+
+    vector<double> ms;
+    vector<double> margins[4];
+    for (size_t i = 0; i < corpus.size(); i++) {
+        ImageResult& r = rep.images[i];
+        int truth = corpus[i].truth;
+        for (size_t j = i; j < jobs; j += corpus.size()) r.ms = min(r.ms, jobMs[j]);
+        FillMargins(truth, r);
+        ms.push_back(r.ms);
+        rep.confusion[truth][r.pred]++;
+        rep.total++;
+        rep.correct += (r.pred == truth);
+        margins[truth].push_back(r.margin);
+
+        int bin = 0;
+        while (bin < MARGIN_BIN_N - 1 && r.margin >= MARGIN_BINS[bin]) bin++;
+        rep.marginHist[bin]++;
+    }
+    rep.msP50 = Percentile(ms, 0.50);
+    rep.msP99 = Percentile(ms, 0.99);
+    rep.msMax = ms.empty() ? 0.0 : *max_element(ms.begin(), ms.end());
+    for (int c = 0; c < 4; c++) {
+        rep.marginPct[c][0] = Percentile(margins[c], 0.01);
+        rep.marginPct[c][1] = Percentile(margins[c], 0.05);
+        rep.marginPct[c][2] = Percentile(margins[c], 0.50);
+        rep.marginPct[c][3] = margins[c].empty() ? 0.0 : *min_element(margins[c].begin(), margins[c].end());
+    }
+    return rep;
+}
+
+// 틀린 것 먼저, 그 다음 정답 마진이 작은 순
+static vector<size_t> WorstImages(const vector<CorpusImage>& corpus, const ModeReport& rep, int n)
+{
+    vector<size_t> idx(corpus.size());
+    for (size_t i = 0; i < idx.size(); i++) idx[i] = i;
+    sort(idx.begin(), idx.end(), [&](size_t a, size_t b) {
+        bool wa = rep.images[a].pred != corpus[a].truth, wb = rep.images[b].pred != corpus[b].truth;
+        if (wa != wb) return wa;
+        return rep.images[a].truthMargin < rep.images[b].truthMargin;
+    });
+    if ((int)idx.size() > n) idx.resize(n);
+    return idx;
+}
+
+// =====================
+// 보고 / 저장
+// =====================
+static void PrintReport(const vector<CorpusImage>& corpus, const ModeReport& rep, int worstN)
+{
+    cout << "\n[" << rep.mode << "] " << rep.total << " images x" << rep.repeat << ", " << rep.threads << " threads: "
+        << fixed << setprecision(1) << rep.imagesPerSec << " images/s  (per image p50 "
+        << setprecision(3) << rep.msP50 << " ms, p99 " << rep.msP99 << " ms, max " << rep.msMax << " ms)\n";
+    cout << "  accuracy " << rep.correct << "/" << rep.total << " ("
+        << setprecision(2) << (rep.total ? 100.0 * rep.correct / rep.total : 0.0) << "%)\n";
+
+    cout << "  truth\\pred    RED  GREEN   BLUE   NONE   recall  prec\n";
+    for (int t = 0; t < 4; t++) {
+        int rowN = 0, colN = 0;
+        for (int k = 0; k < 4; k++) { rowN += rep.confusion[t][k]; colN += rep.confusion[k][t]; }
+        cout << "  " << left << setw(10) << TRUTH_NAMES[t] << right;
+        for (int p = 0; p < 4; p++) cout << setw(7) << rep.confusion[t][p];
+        cout << setprecision(3) << setw(9) << (rowN ? (double)rep.confusion[t][t] / rowN : 0.0)
+            << setw(6) << (colN ? (double)rep.confusion[t][t] / colN : 0.0) << "\n";
+    }
+
+    cout << "  margin (1st-2nd) by truth     min      p1      p5     p50\n";
+    for (int t = 0; t < 4; t++) {
+        cout << "  " << left << setw(26) << TRUTH_NAMES[t] << right << setprecision(4);
+        cout << setw(8) << rep.marginPct[t][3];
+        for (int k = 0; k < 3; k++) cout << setw(8) << rep.marginPct[t][k];
+        cout << "\n";
+    }
+    cout << "  margin histogram:";
+    for (int b = 0; b < MARGIN_BIN_N; b++) {
+        if (b < MARGIN_BIN_N - 1) cout << " <" << MARGIN_BINS[b];
+        else cout << " >=" << MARGIN_BINS[b - 1];
+        cout << ":" << rep.marginHist[b];
+    }
+    cout << "\n";
+
+    cout << "  worst:\n";
+    for (size_t i : WorstImages(corpus, rep, worstN)) {
+        const ImageResult& r = rep.images[i];
+        cout << "    " << (r.pred == corpus[i].truth ? "  " : "X ") << corpus[i].name
+            << " truth=" << TRUTH_NAMES[corpus[i].truth] << " pred=" << TRUTH_NAMES[r.pred]
+            << " R/G/B=" << r.pix[0] << "/" << r.pix[1] << "/" << r.pix[2]
+            << " margin=" << setprecision(4) << r.truthMargin << "\n";
+    }
+}
+
+static bool SaveJson(const string& path, const vector<CorpusImage>& corpus, const vector<ModeReport>& reps, int worstN)
+{
+    FileStorage fs(path, FileStorage::WRITE | FileStorage::FORMAT_JSON);
+    if (!fs.isOpened()) return false;
+
+    int perClass[4] = {};
+    for (const CorpusImage& im : corpus) perClass[im.truth]++;
+    fs << "images" << (int)corpus.size();
+    fs << "class_counts" << "{";
+    for (int c = 0; c < 4; c++) fs << TRUTH_NAMES[c] << perClass[c];
+    fs << "}";
+
+    fs << "runs" << "[";
+    for (const ModeReport& r : reps) {
+        fs << "{";
+        fs << "mode" << r.mode << "threads" << r.threads << "repeat" << r.repeat;
+        fs << "images_per_sec" << r.imagesPerSec << "ms_p50" << r.msP50 << "ms_p99" << r.msP99 << "ms_max" << r.msMax;
+        fs << "correct" << r.correct << "total" << r.total << "accuracy" << (r.total ? (double)r.correct / r.total : 0.0);
+
+        fs << "confusion" << "{"; // truth -> {pred: n}
+        for (int t = 0; t < 4; t++) {
+            fs << TRUTH_NAMES[t] << "{";
+            for (int p = 0; p < 4; p++) fs << TRUTH_NAMES[p] << r.confusion[t][p];
+            fs << "}";
+        }
+        fs << "}";
+
+        fs << "margin" << "{";
+        for (int t = 0; t < 4; t++) {
+            fs << TRUTH_NAMES[t] << "{" << "min" << r.marginPct[t][3] << "p1" << r.marginPct[t][0]
+                << "p5" << r.marginPct[t][1] << "p50" << r.marginPct[t][2] << "}";
+        }
+        fs << "}";
+
+        fs << "margin_hist" << "[";
+        for (int b = 0; b < MARGIN_BIN_N; b++) {
+            fs << "{" << "lt" << (b < MARGIN_BIN_N - 1 ? MARGIN_BINS[b] : 1.0) << "n" << r.marginHist[b] << "}";
+        }
+        fs << "]";
+
+        fs << "worst" << "[";
+        for (size_t i : WorstImages(corpus, r, worstN)) {
+            const ImageResult& ir = r.images[i];
+            fs << "{" << "file" << corpus[i].path << "truth" << TRUTH_NAMES[corpus[i].truth] << "pred" << TRUTH_NAMES[ir.pred]
+                << "r" << ir.pix[0] << "g" << ir.pix[1] << "b" << ir.pix[2] << "margin" << ir.truthMargin << "}";
+        }
+        fs << "]";
+        fs << "}";
+    }
+    fs << "]";
+    fs.release();
+    return true;
+}
+
+// 이전 결과와 모드별 비교. 정확도가 떨어졌거나 (maxSlowdownPct > 0 이고) 그만큼 느려지면 false
+static bool CompareBaseline(const string& path, const vector<ModeReport>& reps, double maxSlowdownPct)
+{
+    FileStorage fs(path, FileStorage::READ);
+    if (!fs.isOpened()) {
+        cerr << "[BENCH] cannot read baseline " << path << "\n";
+        return false;
+    }
+
+    bool ok = true;
+    cout << "\n[BASELINE] " << path << "\n";
+    FileNode runs = fs["runs"];
+    for (const ModeReport& r : reps) {
+        FileNode old;
+        for (size_t k = 0; k < runs.size(); k++) {
+            if ((string)runs[(int)k]["mode"] == r.mode) { old = runs[(int)k]; break; }
+        }
+        if (old.empty()) {
+            cout << "  " << r.mode << ": not in baseline\n";
+            continue;
+        }
+        int oldCorrect = (int)old["correct"], oldTotal = (int)old["total"];
+        double oldIps = (double)old["images_per_sec"];
+        double speed = oldIps > 0 ? 100.0 * (r.imagesPerSec - oldIps) / oldIps : 0.0;
+
+        cout << "  " << left << setw(9) << r.mode << right << " correct " << oldCorrect << "/" << oldTotal
+            << " -> " << r.correct << "/" << r.total
+            << "  images/s " << fixed << setprecision(1) << oldIps << " -> " << r.imagesPerSec
+            << " (" << showpos << speed << noshowpos << "%)";
+
+        if (oldTotal == r.total && r.correct < oldCorrect) { cout << "  ACCURACY REGRESSION"; ok = false; }
+        if (maxSlowdownPct > 0 && speed < -maxSlowdownPct) { cout << "  SLOWDOWN"; ok = false; }
+        if (oldTotal != r.total) cout << "  (corpus size differs)";
+        cout << "\n";
+    }
+    return ok;
+}
+
+static bool ParseModes(const string& list, int configMode, vector<int>& out)
+{
+    if (list.empty()) { out.push_back(configMode); return true; }
+    if (list == "all") { out = { CLASSIFY_MASK, CLASSIFY_MASK_REF, CLASSIFY_HIST, CLASSIFY_OBJECT }; return true; }
+
+    stringstream ss(list);
+    string name;
+    while (getline(ss, name, ',')) {
+        int found = -1;
+        for (int m : { CLASSIFY_MASK, CLASSIFY_HIST, CLASSIFY_MASK_REF, CLASSIFY_OBJECT })
+            if (name == ClassifyModeName(m)) found = m;
+        if (found < 0) {
+            cerr << "[BENCH] unknown mode: " << name << "\n";
+            return false;
+        }
+        out.push_back(found);
+    }
+    return !out.empty();
+}
+
+static void PrintUsage()
+{
+    cerr << "usage:\n"
+        << "  ColorBench <captureDir> [<captureDir> ...] [--config color_config.yaml] [--mode mask,hist,mask_ref,object|all]\n"
+        << "             [--threads N] [--repeat N] [--worst N] [--json out.json] [--baseline old.json] [--max-slowdown PCT]\n";
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv)
+{
+    vector<string> dirs;
+    string configPath, modeList, jsonPath, baselinePath;
+    int threads = (int)max(1u, thread::hardware_concurrency());
+    int repeat = 5;
+    int worstN = 10;
+    double maxSlowdown = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        auto next = [&]() { return (i + 1 < argc) ? string(argv[++i]) : string(); };
+        if (a == "--config") configPath = next();
+        else if (a == "--mode") modeList = next();
+        else if (a == "--threads") threads = max(1, atoi(next().c_str()));
+        else if (a == "--repeat") repeat = max(1, atoi(next().c_str()));
+        else if (a == "--worst") worstN = max(0, atoi(next().c_str()));
+        else if (a == "--json") jsonPath = next();
+        else if (a == "--baseline") baselinePath = next();
+        else if (a == "--max-slowdown") maxSlowdown = atof(next().c_str());
+        else if (a.compare(0, 2, "--") == 0) { PrintUsage(); return 2; }
+        else dirs.push_back(a);
+    }
+    if (dirs.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    ColorConfig cfg = DefaultColorWorkerConfig();
+    if (!configPath.empty()) {
+        string err;
+        if (!LoadColorConfig(configPath, cfg, err)) {
+            cerr << "[BENCH] " << configPath << ": " << err << "\n";
+            return 1;
+        }
+    }
+    vector<int> modes;
+    if (!ParseModes(modeList, cfg.classifyMode, modes)) return 2;
+
+    auto t0 = chrono::steady_clock::now();
+    vector<CorpusImage> corpus;
+    if (!LoadColorCorpus(dirs, threads, corpus, "[BENCH]")) {
+        cerr << "[BENCH] no color_*.jpg found\n";
+        return 1;
+    }
+    cout << "[BENCH] " << corpus.size() << " images loaded in "
+        << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - t0).count() << " ms\n";
+
+    vector<ModeReport> reps;
+    for (int m : modes) {
+        reps.push_back(RunMode(corpus, cfg, m, threads, repeat));
+        PrintReport(corpus, reps.back(), worstN);
+    }
+
+    if (!jsonPath.empty()) {
+        if (!SaveJson(jsonPath, corpus, reps, worstN)) {
+            cerr << "[BENCH] cannot write " << jsonPath << "\n";
+            return 1;
+        }
+        cout << "\n[BENCH] saved " << jsonPath << "\n";
+    }
+
+    if (!baselinePath.empty() && !CompareBaseline(baselinePath, reps, maxSlowdown)) return 1;
+    return 0;
+}
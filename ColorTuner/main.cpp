@@ -0,0 +1,471 @@
+﻿// ColorTuner.cpp
+// - 라벨 붙은 캡처(color_<r|g|b|n>N.jpg, 접두사 = 정답)로 색상 판별 임계값을 자동 탐색해서
+//   워커가 읽는 color_config.yaml 형식(SaveColorConfig)으로 저장
+// - 코퍼스는 처음에 한 번만 디코드 + HSV 변환(+ mask 모드와 같은 3x3 blur) 해서 메모리에 둔다
+// - 탐색 변수: 클래스별 H 하한/상한 (빨강은 R1 상한, R2 하한), S/V 하한, morph_size
+//   (S/V 상한은 255 고정, 기존 설정들도 모두 255)
+//   min_color_pixels / min_color_ratio 는 후보마다 개수 분포에서 바로 고른다
+//   (정답 수 최대, 같으면 맞는 쪽/틀리는 쪽 값 사이 간격이 가장 넓은 곳의 가운데)
+// - 탐색: 패턴 탐색(좌표별 ±step 이웃을 한 번에 전부 평가 -> 가장 좋은 쪽으로 이동,
+//   나아지지 않으면 step 절반). 이웃 평가를 모든 코어에 나눠서 병렬로
+// - 점수: 정답 수 우선, 같으면 평균 마진 (색: (정답색 - 다른 색 최대) / ROI, NONE: -(최다 색) / ROI)
+// - mask / mask_ref 모드는 BuildPackedRGB + CountPackedBits 로 워커와 같은 값을 빠르게,
+//   hist 모드는 ClassifyColorHist 를 그대로 (느림). object 모드는 지원 안 함
+//
+// 사용:
+//   ColorTuner <captureDir> [<captureDir> ...] [--base color_config.yaml] [--out color_config.tuned.yaml]
+//              [--holdout N] [--threads N] [--max-rounds N]
+//     --base     : 시작점 (없으면 ColorWorker 기본값). 판별 모드/측정 임계값 등 나머지 키는 그대로 저장
+//     --holdout N: 클래스별로 N 번째마다 한 장씩 탐색에서 빼고 따로 정확도 보고 (과적합 확인)
+
+#include <opencv2/opencv.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+#include "../Common/color_classify.h"
+#include "../Common/color_config.h"
+#include "../Common/color_corpus.h"
+#include "../Common/packed_morph.h"
+
+using namespace std;
+using namespace cv;
+
+// =====================
+// 코퍼스 (Common/color_corpus) + mask 모드 전처리 / holdout 표시
+// =====================
+static bool LoadCorpus(const vector<string>& dirs, int holdoutEvery, int threads, vector<CorpusImage>& out)
+{
+    bool ok = LoadColorCorpus(dirs, threads, out, "[TUNE]", [](CorpusImage& im) {
+        cvtColor(im.bgr, im.hsv, COLOR_BGR2HSV);
+        GaussianBlur(im.hsv, im.hsv, Size(3, 3), 0);
+    });
+
+    // 클래스별로 holdoutEvery 번째마다 검증용
+    if (holdoutEvery > 1) {
+        int seen[4] = {};
+        for (CorpusImage& im : out) im.holdout = (++seen[im.truth] % holdoutEvery) == 0;
+    }
+    return ok;
+}
+
+// =====================
+// 탐색 변수 <-> ColorConfig
+// =====================
+enum Param {
+    P_R1_HU = 0, P_R2_HL, P_R_SL, P_R_VL,
+    P_G_HL, P_G_HU, P_G_SL, P_G_VL,
+    P_B_HL, P_B_HU, P_B_SL, P_B_VL,
+    P_MORPH,
+    P_COUNT
+};
+
+static const char* PARAM_NAMES[P_COUNT] = {
+    "R1.H.hi", "R2.H.lo", "R.S.lo", "R.V.lo",
+    "G.H.lo", "G.H.hi", "G.S.lo", "G.V.lo",
+    "B.H.lo", "B.H.hi", "B.S.lo", "B.V.lo",
+    "morph",
+};
+
+struct ParamSpace {
+    int lo, hi;  // 허용 범위
+    int step0;   // 처음 step (단계마다 절반, 최소 minStep)
+    int minStep;
+};
+
+static const ParamSpace SPACE[P_COUNT] = {
+    { 0, 40, 4, 1 },    { 140, 179, 4, 1 }, { 0, 250, 16, 2 }, { 0, 250, 16, 2 },
+    { 20, 100, 4, 1 },  { 20, 110, 4, 1 },  { 0, 250, 16, 2 }, { 0, 250, 16, 2 },
+    { 70, 150, 4, 1 },  { 70, 160, 4, 1 },  { 0, 250, 16, 2 }, { 0, 250, 16, 2 },
+    { 1, 11, 2, 2 },
+};
+
+typedef array<int, P_COUNT> ParamVec;
+
+static ParamVec ParamsFromConfig(const ColorConfig& c)
+{
+    const ColorThresholds& t = c.th;
+    ParamVec v;
+    v[P_R1_HU] = (int)t.R1.U[0]; v[P_R2_HL] = (int)t.R2.L[0];
+    v[P_R_SL] = (int)min(t.R1.L[1], t.R2.L[1]); v[P_R_VL] = (int)min(t.R1.L[2], t.R2.L[2]);
+    v[P_G_HL] = (int)t.G.L[0]; v[P_G_HU] = (int)t.G.U[0]; v[P_G_SL] = (int)t.G.L[1]; v[P_G_VL] = (int)t.G.L[2];
+    v[P_B_HL] = (int)t.B.L[0]; v[P_B_HU] = (int)t.B.U[0]; v[P_B_SL] = (int)t.B.L[1]; v[P_B_VL] = (int)t.B.L[2];
+    v[P_MORPH] = c.morphSize | 1;
+    for (int i = 0; i < P_COUNT; i++) v[i] = max(SPACE[i].lo, min(SPACE[i].hi, v[i]));
+    return v;
+}
+
+static ColorConfig ConfigFromParams(const ColorConfig& base, const ParamVec& v)
+{
+    ColorConfig c = base;
+    c.th.R1 = { Scalar(0, v[P_R_SL], v[P_R_VL]), Scalar(v[P_R1_HU], 255, 255) };
+    c.th.R2 = { Scalar(v[P_R2_HL], v[P_R_SL], v[P_R_VL]), Scalar(179, 255, 255) };
+    c.th.G = { Scalar(v[P_G_HL], v[P_G_SL], v[P_G_VL]), Scalar(v[P_G_HU], 255, 255) };
+    c.th.B = { Scalar(v[P_B_HL], v[P_B_SL], v[P_B_VL]), Scalar(v[P_B_HU], 255, 255) };
+    c.morphSize = v[P_MORPH];
+    return c;
+}
+
+static bool ParamsValid(const ParamVec& v)
+{
+    for (int i = 0; i < P_COUNT; i++)
+        if (v[i] < SPACE[i].lo || v[i] > SPACE[i].hi) return false;
+    return v[P_G_HL] <= v[P_G_HU] && v[P_B_HL] <= v[P_B_HU] && (v[P_MORPH] & 1);
+}
+
+// =====================
+// 평가
+// =====================
+struct ImageCounts {
+    int pix[3] = {};
+    double total = 0.0;
+};
+
+struct EvalResult {
+    ParamVec params{};
+    int minPixels = 0;
+    double minRatio = 0.0;
+    int correct = 0;      // 탐색용(holdout 제외) 정답 수
+    int trainN = 0;
+    double margin = 0.0;  // 평균 마진 (탐색용, ImageMargin)
+    vector<ImageCounts> counts; // 이미지별 (전체 코퍼스)
+};
+
+static bool Better(const EvalResult& a, const EvalResult& b)
+{
+    if (a.correct != b.correct) return a.correct > b.correct;
+    return a.margin > b.margin + 1e-9;
+}
+
+// 이미지 하나의 R/G/B 개수 (판별 모드와 같은 값)
+static void CountImage(const CorpusImage& im, const ColorTables& tb, Mat& packed, ImageCounts& out)
+{
+    out.total = (double)im.bgr.rows * im.bgr.cols;
+    if (tb.cfg.classifyMode == CLASSIFY_HIST) {
+        ClassifyColorHist(im.bgr, tb, out.pix[0], out.pix[1], out.pix[2]);
+        return;
+    }
+    BuildPackedRGB(im.hsv, packed, tb);
+    CountPackedBits(packed, 3, out.pix);
+}
+
+// DecideColor 와 같은 "엄격한 1등" (없으면 -1)
+static int StrictWinner(const ImageCounts& c)
+{
+    const int* p = c.pix;
+    if (p[0] > 0 && p[0] > p[1] && p[0] > p[2]) return 0;
+    if (p[1] > 0 && p[1] > p[0] && p[1] > p[2]) return 1;
+    if (p[2] > 0 && p[2] > p[0] && p[2] > p[1]) return 2;
+    return -1;
+}
+
+/*
+    PickCut:
+    - 값 v 가 cut 이상이면 "색 인정". second = 인정되어야 정답이면 true
+    - 맞는 개수가 최대인 cut 중에서 양옆 값 간격이 가장 넓은 곳의 가운데를 고른다
+*/
+static double PickCut(vector<pair<double, bool>> vals, double lo, double hi)
+{
+    sort(vals.begin(), vals.end());
+    int nWant = 0;
+    for (auto& v : vals) nWant += v.second;
+
+    // cut 을 k 번째 값 바로 아래에 두면: 0..k-1 은 거부, k.. 는 인정
+    int bestCorrect = -1;
+    double bestCut = lo, bestGap = -1.0;
+    int rejectedOk = 0;        // 거부됐고 거부가 정답
+    int acceptedWant = nWant;  // 인정됐고 인정이 정답
+    for (size_t k = 0; k <= vals.size(); k++) {
+        if (k > 0) {
+            if (vals[k - 1].second) acceptedWant--;
+            else rejectedOk++;
+        }
+        // 같은 값 사이에는 cut 을 둘 수 없음
+        if (k > 0 && k < vals.size() && vals[k].first == vals[k - 1].first) continue;
+
+        double below = (k == 0) ? lo : vals[k - 1].first;
+        double above = (k == vals.size()) ? hi : vals[k].first;
+        int correct = rejectedOk + acceptedWant;
+        double gap = above - below;
+        if (correct > bestCorrect || (correct == bestCorrect && gap > bestGap)) {
+            bestCorrect = correct;
+            bestGap = gap;
+            bestCut = 0.5 * (below + above);
+        }
+    }
+    return bestCut;
+}
+
+// 색 이미지: (정답색 - 다른 색 최대) / ROI, NONE 이미지: -(가장 많은 색) / ROI
+// (NONE 쪽을 빼면 범위를 무작정 넓히는 쪽이 항상 이김)
+static double ImageMargin(const ImageCounts& c, int truth)
+{
+    if (c.total <= 0) return 0.0;
+    if (truth == TRUTH_NONE) return -max(c.pix[0], max(c.pix[1], c.pix[2])) / c.total;
+    int other = max(c.pix[(truth + 1) % 3], c.pix[(truth + 2) % 3]);
+    return (c.pix[truth] - other) / c.total;
+}
+
+// counts -> min_color_ratio, min_color_pixels 선택 + 정답 수 / 마진
+static void ScoreCounts(const vector<CorpusImage>& corpus, const ColorConfig& base, EvalResult& r)
+{
+    // 기준에 따라 결과가 바뀌는 이미지만: 1등 색이 있고, 그 색이 정답이거나 정답이 NONE
+    // (1등 없음 = 항상 NONE, 다른 색이 1등 = 항상 틀림)
+    struct Cand { double ratio; int pix; bool want; };
+    vector<Cand> cs;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (corpus[i].holdout) continue;
+        const ImageCounts& c = r.counts[i];
+        int w = StrictWinner(c);
+        int truth = corpus[i].truth;
+        if (w < 0 || (truth != TRUTH_NONE && w != truth)) continue;
+        cs.push_back({ c.pix[w] / c.total, c.pix[w], truth != TRUTH_NONE });
+    }
+
+    // 비율 기준 (개수 기준은 시작값으로 고정) -> 고른 비율 기준에서 개수 기준
+    vector<pair<double, bool>> vals;
+    for (const Cand& c : cs)
+        if (c.pix >= base.minColorPixels) vals.push_back({ c.ratio, c.want });
+    r.minRatio = PickCut(vals, 0.0, 1.0);
+
+    vals.clear();
+    double maxTotal = 1.0;
+    for (const CorpusImage& im : corpus) maxTotal = max(maxTotal, (double)im.bgr.rows * im.bgr.cols);
+    for (const Cand& c : cs)
+        if (c.ratio >= r.minRatio) vals.push_back({ (double)c.pix, c.want });
+    r.minPixels = max(1, (int)ceil(PickCut(vals, 1.0, maxTotal)));
+
+    // 최종 정답 수 / 마진은 워커와 같은 DecideColor 로
+    ColorConfig rule = base;
+    rule.minColorRatio = r.minRatio;
+    rule.minColorPixels = r.minPixels;
+    r.correct = 0;
+    r.trainN = 0;
+    double marginSum = 0.0;
+    int marginN = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (corpus[i].holdout) continue;
+        const ImageCounts& c = r.counts[i];
+        r.trainN++;
+        if (TruthFromColor(DecideColor(c.pix[0], c.pix[1], c.pix[2], c.total, rule)) == corpus[i].truth) r.correct++;
+        marginSum += ImageMargin(c, corpus[i].truth);
+        marginN++;
+    }
+    r.margin = marginN ? marginSum / marginN : 0.0;
+}
+
+/*
+    Evaluator:
+    - 후보 여러 개를 스레드들이 나눠서 평가 (후보 하나 = 코퍼스 전체)
+    - 스레드마다 packed 버퍼 하나
+*/
+static void EvaluateAll(const vector<CorpusImage>& corpus, const ColorConfig& base, int threads,
+    vector<EvalResult>& cands, atomic<uint64_t>& evaluated)
+{
+    atomic<size_t> next{ 0 };
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            Mat packed;
+            for (size_t i = next++; i < cands.size(); i = next++) {
+                EvalResult& r = cands[i];
+                shared_ptr<const ColorTables> tb = BuildColorTables(ConfigFromParams(base, r.params), 0);
+                r.counts.assign(corpus.size(), ImageCounts());
+                for (size_t k = 0; k < corpus.size(); k++) CountImage(corpus[k], *tb, packed, r.counts[k]);
+                ScoreCounts(corpus, base, r);
+                evaluated++;
+            }
+        });
+    }
+    for (thread& t : pool) t.join();
+}
+
+// =====================
+// 보고
+// =====================
+static void PrintResult(const char* title, const vector<CorpusImage>& corpus, const ColorConfig& cfg,
+    const vector<ImageCounts>& counts)
+{
+    int confusion[4][4] = {};
+    int trainOk = 0, trainN = 0, holdOk = 0, holdN = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const ImageCounts& c = counts[i];
+        int pred = TruthFromColor(DecideColor(c.pix[0], c.pix[1], c.pix[2], c.total, cfg));
+        confusion[corpus[i].truth][pred]++;
+        bool ok = pred == corpus[i].truth;
+        if (corpus[i].holdout) { holdN++; holdOk += ok; }
+        else { trainN++; trainOk += ok; }
+    }
+
+    cout << "\n[" << title << "] accuracy " << trainOk << "/" << trainN << " ("
+        << fixed << setprecision(1) << (trainN ? 100.0 * trainOk / trainN : 0.0) << "%)";
+    if (holdN) cout << "  holdout " << holdOk << "/" << holdN << " (" << (100.0 * holdOk / holdN) << "%)";
+    cout << "  min_pixels=" << cfg.minColorPixels << " min_ratio=" << setprecision(4) << cfg.minColorRatio
+        << " morph=" << cfg.morphSize << "\n";
+
+    cout << "  truth\\pred    RED  GREEN   BLUE   NONE\n";
+    for (int t = 0; t < 4; t++) {
+        cout << "  " << left << setw(10) << TRUTH_NAMES[t] << right;
+        for (int p = 0; p < 4; p++) cout << setw(7) << confusion[t][p];
+        cout << "\n";
+    }
+}
+
+static void PrintThresholds(const ColorConfig& c)
+{
+    auto range = [](const char* name, const HsvRange& r) {
+        cout << "  " << name << " L=(" << (int)r.L[0] << "," << (int)r.L[1] << "," << (int)r.L[2] << ")"
+            << " U=(" << (int)r.U[0] << "," << (int)r.U[1] << "," << (int)r.U[2] << ")\n";
+    };
+    range("R1", c.th.R1);
+    range("R2", c.th.R2);
+    range("G ", c.th.G);
+    range("B ", c.th.B);
+}
+
+static void PrintUsage()
+{
+    cerr << "usage:\n"
+        << "  ColorTuner <captureDir> [<captureDir> ...] [--base color_config.yaml] [--out color_config.tuned.yaml]\n"
+        << "             [--holdout N] [--threads N] [--max-rounds N]\n";
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv)
+{
+    vector<string> dirs;
+    string basePath, outPath = "color_config.tuned.yaml";
+    int holdout = 0;
+    int threads = (int)max(1u, thread::hardware_concurrency());
+    int maxRounds = 200;
+
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        auto next = [&]() { return (i + 1 < argc) ? string(argv[++i]) : string(); };
+        if (a == "--base") basePath = next();
+        else if (a == "--out") outPath = next();
+        else if (a == "--holdout") holdout = atoi(next().c_str());
+        else if (a == "--threads") threads = max(1, atoi(next().c_str()));
+        else if (a == "--max-rounds") maxRounds = max(1, atoi(next().c_str()));
+        else if (a.compare(0, 2, "--") == 0) { PrintUsage(); return 2; }
+        else dirs.push_back(a);
+    }
+    if (dirs.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    ColorConfig base = DefaultColorWorkerConfig();
+    if (!basePath.empty()) {
+        string err;
+        if (!LoadColorConfig(basePath, base, err)) {
+            cerr << "[TUNE] " << basePath << ": " << err << "\n";
+            return 1;
+        }
+    }
+    if (base.classifyMode == CLASSIFY_OBJECT) {
+        cerr << "[TUNE] classify_mode=object is not supported (uses measure thresholds / object_min_ratio)\n";
+        return 1;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    vector<CorpusImage> corpus;
+    if (!LoadCorpus(dirs, holdout, threads, corpus)) {
+        cerr << "[TUNE] no color_*.jpg found\n";
+        return 1;
+    }
+    int perClass[4] = {}, held = 0;
+    for (const CorpusImage& im : corpus) { perClass[im.truth]++; held += im.holdout; }
+    cout << "[TUNE] " << corpus.size() << " images (R/G/B/N=" << perClass[0] << "/" << perClass[1] << "/"
+        << perClass[2] << "/" << perClass[3] << ", holdout " << held << ") loaded in "
+        << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - t0).count() << " ms, "
+        << threads << " threads, mode " << ClassifyModeName(base.classifyMode) << "\n";
+
+    atomic<uint64_t> evaluated{ 0 };
+
+    // 시작점 (시작 설정의 min_pixels/ratio 그대로) 보고용
+    vector<EvalResult> cur(1);
+    cur[0].params = ParamsFromConfig(base);
+    EvaluateAll(corpus, base, threads, cur, evaluated);
+    EvalResult best = cur[0];
+    PrintResult("BASE", corpus, base, best.counts);
+
+    // 패턴 탐색
+    auto tSearch = chrono::steady_clock::now();
+    int level = 0; // step = step0 >> level
+    int round = 0;
+    while (round < maxRounds) {
+        vector<EvalResult> cands;
+        bool anyStep = false;
+        for (int p = 0; p < P_COUNT; p++) {
+            int step = max(SPACE[p].minStep, SPACE[p].step0 >> level);
+            if ((SPACE[p].step0 >> level) >= SPACE[p].minStep) anyStep = true;
+            for (int dir : { -1, 1 }) {
+                EvalResult c;
+                c.params = best.params;
+                c.params[p] += dir * step;
+                if (ParamsValid(c.params)) cands.push_back(std::move(c));
+            }
+        }
+        if (!anyStep) break;
+        round++;
+
+        EvaluateAll(corpus, base, threads, cands, evaluated);
+
+        const EvalResult* top = &best;
+        for (const EvalResult& c : cands)
+            if (Better(c, *top)) top = &c;
+
+        if (top != &best) {
+            best = *top;
+            cout << "[TUNE] round " << setw(3) << round << " step/" << (1 << level)
+                << "  correct " << best.correct << "/" << best.trainN
+                << "  margin " << fixed << setprecision(4) << best.margin << "\n";
+        }
+        else {
+            level++;
+        }
+    }
+    double searchSec = chrono::duration<double>(chrono::steady_clock::now() - tSearch).count();
+
+    ColorConfig tuned = ConfigFromParams(base, best.params);
+    tuned.minColorPixels = best.minPixels;
+    tuned.minColorRatio = best.minRatio;
+
+    cout << "\n[TUNE] " << evaluated.load() << " candidates in " << fixed << setprecision(1) << searchSec << " s ("
+        << (searchSec > 0 ? evaluated.load() / searchSec : 0.0) << "/s), " << round << " rounds\n";
+    PrintResult("TUNED", corpus, tuned, best.counts);
+    PrintThresholds(tuned);
+
+    // 바뀐 값
+    ParamVec b0 = ParamsFromConfig(base);
+    for (int p = 0; p < P_COUNT; p++)
+        if (b0[p] != best.params[p]) cout << "  " << PARAM_NAMES[p] << ": " << b0[p] << " -> " << best.params[p] << "\n";
+
+    // 가장 아슬아슬하게 맞은 / 틀린 이미지
+    vector<pair<double, size_t>> worst;
+    for (size_t i = 0; i < corpus.size(); i++) worst.push_back({ ImageMargin(best.counts[i], corpus[i].truth), i });
+    sort(worst.begin(), worst.end());
+    cout << "  lowest margin:";
+    for (size_t k = 0; k < worst.size() && k < 5; k++)
+        cout << " " << corpus[worst[k].second].name << "(" << setprecision(4) << worst[k].first << ")";
+    cout << "\n";
+
+    if (!SaveColorConfig(outPath, tuned)) {
+        cerr << "[TUNE] cannot write " << outPath << "\n";
+        return 1;
+    }
+    cout << "[TUNE] saved " << outPath << " (copy to color_config.yaml to apply; workers reload on change)\n";
+    return 0;
+}
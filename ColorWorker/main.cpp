@@ -11,9 +11,18 @@
 #include <chrono>
 #include <thread>
 #include <cstdlib>
+#include <algorithm>
+#include <cmath>
 
 #include <modbus/modbus.h>
 
+#include "../Common/async_jpeg_writer.h"
+#include "../Common/capture_archive.h"
+#include "../Common/color_classify.h"
+#include "../Common/color_config.h"
+#include "../Common/measure_archive.h"
+#include "../Common/spc_stats.h"
+
 using namespace cv;
 using namespace std;
 
@@ -45,6 +54,13 @@ static bool USE_DSHOW = true;
 static int  CAM_W = 1280;
 static int  CAM_H = 720;
 
+// 캡처 형식
+// - CAPTURE_BGR : OpenCV 가 BGR 로 변환한 프레임 -> ROI 를 다시 HSV 로 (기존)
+// - CAPTURE_YUYV / CAPTURE_NV12 : 카메라 YUV 버퍼 그대로 받아 U/V LUT 로 판별 (BGR/HSV 변환 없음)
+//   증거 이미지는 ROI 만 인코더 스레드에서 BGR 로 변환. 백엔드가 raw 를 안 주면 자동으로 BGR 경로
+enum CaptureFormat { CAPTURE_BGR = 0, CAPTURE_YUYV = 1, CAPTURE_NV12 = 2 };
+static const CaptureFormat CAPTURE_FORMAT = CAPTURE_BGR;
+
 // Project paths (✅ JSON은 하나만)
 static const string CAPTURE_DIR = "./Colorcaptures";
 static const string TOTAL_JSON = "./total.json";
@@ -56,9 +72,36 @@ static const Rect ROI_FIXED(475, 50, 345, 1000);
 static double MIN_CONTOUR_AREA = 2000.0;
 static int ROI_PAD = 10;
 
-// Color decision tuning
-static int MIN_COLOR_PIXELS = 100;
-static double MIN_COLOR_RATIO = 0.01;
+// 증거 이미지 저장 (백그라운드 인코더, 트리거 -> 펄스 경로에서 제외)
+static const int  JPEG_WORKERS = 1;
+static const int  JPEG_QUEUE_MAX = 8;          // 대기 가능한 이미지 수
+static const JpegBackpressure JPEG_POLICY = JPEG_DEGRADE; // 밀리면 JPEG_DROP: 버림 / JPEG_DEGRADE: 품질 낮춤
+static const int  JPEG_QUALITY = 92;
+static const int  JPEG_DEGRADED_QUALITY = 70;  // 큐가 절반 이상 찼을 때
+
+// 증거 이미지 저장 위치
+// - CAPTURE_FILES  : CAPTURE_DIR/color_<label>.jpg (박스당 파일 1개, WPF 가 바로 읽음)
+// - CAPTURE_ARCHIVE: CAPTURE_ARCHIVE_DIR 세그먼트에 이어 붙임 + index.fci
+//                    total.json image = "archive:<dir>#<label>" (CaptureTool extract 로 꺼냄)
+enum CaptureStore { CAPTURE_FILES = 0, CAPTURE_ARCHIVE = 1 };
+static const CaptureStore CAPTURE_STORE = CAPTURE_FILES;
+static const string CAPTURE_ARCHIVE_DIR = "./Colorcaptures/archive";
+static const uint64_t CAPTURE_SEGMENT_MB = 256;
+static const int CAPTURE_SEGMENT_SECONDS = 3600;
+
+// Color decision tuning -> color_config.yaml (실행 중 수정하면 다음 트리거부터 반영)
+static const string COLOR_CONFIG = "./color_config.yaml";
+
+// 판별 이력 (열 단위 세그먼트 + WAL, HistoryTool 로 조회/내보내기). total.json 은 그대로 유지
+// 폴더당 writer 하나라서 VisionWorker(./history/vision) 와 나눔. HistoryTool 에 ./history 를 주면 둘 다 조회
+static const string HISTORY_DIR = "./history/color";
+static const int HISTORY_KEEP_SEGMENTS = 24 * 90; // 1시간 구간 x 90일
+
+// 온라인 통계 (색 구성/분당 개수/트리거->결과 ms/판별 색 픽셀 수): 10초마다 바뀐 게 있으면 spc_color.json
+// 창/키 입력이 없으므로 spc.request 파일을 만들면 바로 내보내고 콘솔에 요약 (파일은 지움)
+static const string SPC_JSON = "./spc_color.json"; // VisionWorker 는 spc_vision.json (같은 폴더에서 돌아도 안 겹침)
+static const string SPC_REQUEST = "./spc.request";
+static const int SPC_PUBLISH_EVERY_MS = 10000;
 
 // =====================
 // File helpers
@@ -261,58 +304,21 @@ static string MakeLabel(const string& color, int count)
     return string(1, prefix) + to_string(count);
 }
 
-// =====================
-// HSV thresholds
-// =====================
-struct HsvRange { Scalar L; Scalar U; };
-
-struct ColorThresholds {
-    HsvRange R1{ Scalar(0,   60,  40), Scalar(12,  255, 255) };
-    HsvRange R2{ Scalar(168, 60,  40), Scalar(179, 255, 255) };
-    HsvRange G{ Scalar(30,  40,  40), Scalar(95,  255, 255) };
-    HsvRange B{ Scalar(85,  40,  40), Scalar(140, 255, 255) };
-};
-
-static void BuildMasksRGB(const Mat& hsv, Mat& maskR, Mat& maskG, Mat& maskB,
-    const ColorThresholds& th)
-{
-    Mat rA, rB;
-    inRange(hsv, th.R1.L, th.R1.U, rA);
-    inRange(hsv, th.R2.L, th.R2.U, rB);
-    maskR = rA | rB;
-
-    inRange(hsv, th.G.L, th.G.U, maskG);
-    inRange(hsv, th.B.L, th.B.U, maskB);
-
-    Mat k = getStructuringElement(MORPH_RECT, Size(5, 5));
-    morphologyEx(maskR, maskR, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskR, maskR, MORPH_CLOSE, k, Point(-1, -1), 2);
-    morphologyEx(maskG, maskG, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskG, maskG, MORPH_CLOSE, k, Point(-1, -1), 2);
-    morphologyEx(maskB, maskB, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskB, maskB, MORPH_CLOSE, k, Point(-1, -1), 2);
-}
-
-static int CountMaskPixels(const Mat& mask) {
-    return countNonZero(mask);
-}
-
 // =====================
 // Image save (✅ B안: color_<label>.jpg)
+// - 경로는 트리거 처리 중에 바로 정하고 (total.json 기록용)
+// - 덧그리기 + 인코딩 + 저장은 AsyncJpegWriter 워커에서
 // =====================
-static string SaveColorCroppedJpg_ByLabel(
-    const Mat& roiBgr,
-    const string& label,
-    const string& color)
+static string ColorCapturePath(const string& label)
 {
-    std::error_code ec;
-    filesystem::create_directories(CAPTURE_DIR, ec);
-
     ostringstream fn;
     fn << "color_" << label << ".jpg";
     filesystem::path outPath = filesystem::path(CAPTURE_DIR) / fn.str();
+    return outPath.generic_string();
+}
 
-    Mat canvas = roiBgr.clone();
+static void DrawColorLabelOverlay(Mat& canvas, const string& label, const string& color)
+{
     int baseLine = 0;
 
     string t1 = "Label: " + label;
@@ -333,48 +339,35 @@ static string SaveColorCroppedJpg_ByLabel(
         FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 0, 0), 1);
     putText(canvas, t2, Point(13, 45 + s2.height),
         FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 0, 0), 1);
-
-    vector<int> params = { IMWRITE_JPEG_QUALITY, 92 };
-    if (!imwrite(outPath.string(), canvas, params)) return "";
-
-    return outPath.generic_string();
 }
 
-// =====================
-// Color classification (ROI에서만)
-// =====================
-static string ClassifyColorROI(const Mat& roiBgr, const ColorThresholds& th,
-    int& outRpix, int& outGpix, int& outBpix)
+// cvtCode >= 0: roiImg 가 YUV (CopyYuvRoi) -> 워커에서 BGR 로 바꾼 뒤 덧그림
+static string SubmitColorCapture(AsyncJpegWriter& jpg, Mat roiImg, const string& label, const string& color, int cvtCode = -1)
 {
-    Mat hsv;
-    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
-    GaussianBlur(hsv, hsv, Size(3, 3), 0);
-
-    Mat maskR, maskG, maskB;
-    BuildMasksRGB(hsv, maskR, maskG, maskB, th);
-
-    int rPix = CountMaskPixels(maskR);
-    int gPix = CountMaskPixels(maskG);
-    int bPix = CountMaskPixels(maskB);
-
-    outRpix = rPix;
-    outGpix = gPix;
-    outBpix = bPix;
-
-    int bestPix = 0;
-    string color = "NONE";
-
-    if (rPix > bestPix && rPix > gPix && rPix > bPix) { bestPix = rPix; color = "RED"; }
-    else if (gPix > bestPix && gPix > rPix && gPix > bPix) { bestPix = gPix; color = "GREEN"; }
-    else if (bPix > bestPix && bPix > rPix && bPix > gPix) { bestPix = bPix; color = "BLUE"; }
-
-    int roiPixels = roiBgr.rows * roiBgr.cols;
-    double ratio = (roiPixels > 0) ? (double)bestPix / (double)roiPixels : 0.0;
-
-    if (bestPix < MIN_COLOR_PIXELS || ratio < MIN_COLOR_RATIO)
-        return "NONE";
-
-    return color;
+    auto decorate = [label, color, cvtCode](Mat& canvas) {
+        if (cvtCode >= 0) {
+            Mat bgr;
+            cvtColor(canvas, bgr, cvtCode);
+            canvas = bgr;
+        }
+        DrawColorLabelOverlay(canvas, label, color);
+    };
+
+    string path;
+    bool queued;
+    if (CAPTURE_STORE == CAPTURE_ARCHIVE) {
+        path = MakeCaptureUri(CAPTURE_ARCHIVE_DIR, label);
+        queued = jpg.SubmitArchive(roiImg, label, decorate);
+    }
+    else {
+        path = ColorCapturePath(label);
+        queued = jpg.Submit(roiImg, path, decorate);
+    }
+    if (!queued) {
+        cerr << "[IMG] queue full (" << jpg.Capacity() << ") -> dropped " << path << "\n";
+        return "";
+    }
+    return path;
 }
 
 // =====================
@@ -450,11 +443,246 @@ static void MarkDisconnected(modbus_t*& ctx, long long& nextReconnectMs)
     nextReconnectMs = NowMillis() + NextReconnectDelayMs();
 }
 
+// =====================
+// --compare <dir> : mask_ref / mask / hist / object 판별 비교 (파일명 color_<r|g|b|n>N.jpg 의 접두사 = 정답)
+// =====================
+static string ColorFromCaptureName(const string& fileName)
+{
+    const string pre = "color_";
+    if (fileName.compare(0, pre.size(), pre) != 0 || fileName.size() <= pre.size()) return "";
+    switch (fileName[pre.size()]) {
+    case 'r': return "RED";
+    case 'g': return "GREEN";
+    case 'b': return "BLUE";
+    case 'n': return "NONE";
+    default: return "";
+    }
+}
+
+static int RunCompare(const string& dir)
+{
+    ColorConfig cfg = DefaultColorWorkerConfig();
+    string err;
+    if (filesystem::exists(COLOR_CONFIG) && !LoadColorConfig(COLOR_CONFIG, cfg, err))
+        cerr << "[COMPARE] " << COLOR_CONFIG << " ignored: " << err << "\n";
+
+    struct ModeStat {
+        string name;
+        shared_ptr<const ColorTables> tb;
+        int correct = 0;
+        int agree = 0;  // mask_ref 결과와 같은 개수
+        int exact = 0;  // mask_ref 와 R/G/B 픽셀 수까지 같은 개수
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        double pixSum = 0.0;    // 판별 1회에 쓴 픽셀 수 합 (분모)
+        double marginSum = 0.0; // 맞춘 색의 (1등 - 2등) / 분모 합
+        int marginN = 0;
+    };
+
+    vector<ModeStat> modes;
+    for (int mode : { CLASSIFY_MASK_REF, CLASSIFY_MASK }) {
+        ColorConfig c = cfg;
+        c.classifyMode = mode;
+        modes.push_back({ ClassifyModeName(mode), BuildColorTables(c, 0) });
+    }
+    for (int step : { 1, 2, 4 }) {
+        ColorConfig c = cfg;
+        c.classifyMode = CLASSIFY_HIST;
+        c.histStep = step;
+        modes.push_back({ "hist/" + to_string(step), BuildColorTables(c, 0) });
+    }
+    {
+        ColorConfig c = cfg;
+        c.classifyMode = CLASSIFY_OBJECT;
+        modes.push_back({ ClassifyModeName(CLASSIFY_OBJECT), BuildColorTables(c, 0) });
+    }
+
+    vector<filesystem::path> files;
+    std::error_code ec;
+    for (const auto& e : filesystem::directory_iterator(dir, ec)) {
+        if (!e.is_regular_file()) continue;
+        string fn = e.path().filename().string();
+        if (e.path().extension() != ".jpg" || ColorFromCaptureName(fn).empty()) continue;
+        files.push_back(e.path());
+    }
+    sort(files.begin(), files.end());
+
+    if (files.empty()) {
+        cerr << "[COMPARE] no color_*.jpg in " << dir << "\n";
+        return -1;
+    }
+
+    cout << "[COMPARE] " << files.size() << " images in " << dir << "\n";
+
+    const double freq = getTickFrequency();
+    int used = 0;
+    for (const auto& path : files) {
+        Mat img = imread(path.string(), IMREAD_COLOR);
+        if (img.empty()) continue;
+        used++;
+
+        string truth = ColorFromCaptureName(path.filename().string());
+        string maskColor;
+        int refPix[3] = { -1, -1, -1 };
+        ostringstream line;
+        bool diff = false;
+
+        for (ModeStat& m : modes) {
+            int rp = 0, gp = 0, bp = 0;
+            ObjectColorInfo obj;
+            int64 t0 = getTickCount();
+            string color = (m.tb->cfg.classifyMode == CLASSIFY_OBJECT)
+                ? ClassifyColorObject(img, *m.tb, rp, gp, bp, &obj)
+                : ClassifyColorROI(img, *m.tb, rp, gp, bp);
+            double ms = (getTickCount() - t0) * 1000.0 / freq;
+
+            double denom = obj.found ? (double)obj.area : (double)img.rows * img.cols;
+            m.totalMs += ms;
+            m.maxMs = max(m.maxMs, ms);
+            m.pixSum += denom;
+            if (color == truth) {
+                m.correct++;
+                if (truth != "NONE" && denom > 0) {
+                    int top[3] = { rp, gp, bp };
+                    sort(top, top + 3);
+                    m.marginSum += (double)(top[2] - top[1]) / denom;
+                    m.marginN++;
+                }
+            }
+            if (maskColor.empty()) {
+                maskColor = color;
+                refPix[0] = rp; refPix[1] = gp; refPix[2] = bp;
+            }
+            if (color == maskColor) m.agree++;
+            else diff = true;
+            if (rp == refPix[0] && gp == refPix[1] && bp == refPix[2]) m.exact++;
+
+            line << " " << m.name << "=" << color << "(" << rp << "/" << gp << "/" << bp << ")";
+        }
+
+        if (diff || maskColor != truth)
+            cout << "  " << path.filename().string() << " truth=" << truth << line.str() << "\n";
+    }
+
+    cout << "\n[COMPARE] mode      correct              agree     exact     avg ms   max ms   px/dec  margin\n";
+    for (const ModeStat& m : modes) {
+        cout << "  " << left << setw(9) << m.name << right
+            << setw(4) << m.correct << "/" << left << setw(4) << used << right
+            << " (" << fixed << setprecision(1) << setw(5) << (used ? 100.0 * m.correct / used : 0.0) << "%)"
+            << setw(5) << m.agree << "/" << left << setw(4) << used << right
+            << setw(5) << m.exact << "/" << left << setw(4) << used << right
+            << setprecision(3) << setw(9) << (used ? m.totalMs / used : 0.0)
+            << setw(9) << m.maxMs
+            << setprecision(0) << setw(9) << (used ? m.pixSum / used : 0.0)
+            << setprecision(3) << setw(8) << (m.marginN ? m.marginSum / m.marginN : 0.0) << "\n";
+    }
+    return 0;
+}
+
+// =====================
+// --yuv-replay <file> <W> <H> [yuyv|nv12] : raw YUV 녹화 파일로 YUV 판별 vs HSV 판별 대조
+// - 같은 프레임을 BGR 로 변환 -> (1) HSV inRange 개수 (모폴로지 없음, YUV 판별과 같아야 함)
+//                             (2) 현재 classify_mode 판별 (결정이 같은지)
+// - 파일 = 같은 크기 프레임이 연달아 (ffmpeg -f rawvideo -pix_fmt yuyv422|nv12, 카메라에서 바로: ffmpeg -f dshow -i video="<카메라>" -f rawvideo -pix_fmt yuyv422 out.yuv)
+// =====================
+static int RunYuvReplay(const string& path, int w, int h, YuvLayout layout)
+{
+    ColorConfig cfg = DefaultColorWorkerConfig();
+    string err;
+    if (filesystem::exists(COLOR_CONFIG) && !LoadColorConfig(COLOR_CONFIG, cfg, err))
+        cerr << "[YUV] " << COLOR_CONFIG << " ignored: " << err << "\n";
+    auto tb = BuildColorTables(cfg, 0, true);
+
+    ifstream ifs(path, ios::binary);
+    if (!ifs.is_open() || w <= 0 || h <= 0 || (w & 1) || (h & 1)) {
+        cerr << "[YUV] cannot open " << path << " (" << w << "x" << h << ")\n";
+        return -1;
+    }
+
+    const size_t frameBytes = (layout == YUV_YUYV) ? (size_t)w * h * 2 : (size_t)w * h * 3 / 2;
+    Mat raw(1, (int)frameBytes, CV_8UC1);
+    const ColorThresholds& th = tb->cfg.th;
+    const double freq = getTickFrequency();
+
+    cout << "[YUV] " << path << " " << w << "x" << h << " " << (layout == YUV_YUYV ? "yuyv" : "nv12")
+        << " mode=" << ClassifyModeName(cfg.classifyMode) << " split(U,V)=" << tb->uvYMask.size() << "\n";
+
+    int frames = 0, exact = 0, agree = 0;
+    double yuvMs = 0.0, bgrMs = 0.0;
+    while (ifs.read((char*)raw.data, (streamsize)frameBytes)) {
+        YuvFrame f;
+        if (!WrapYuvFrame(raw, layout, w, h, f)) break;
+        Rect roi = AlignYuvRoi(f, ROI_FIXED);
+        if (roi.width <= 0 || roi.height <= 0) {
+            cerr << "[YUV] ROI outside frame\n";
+            return -1;
+        }
+        frames++;
+
+        int yr = 0, yg = 0, yb = 0;
+        int64 t0 = getTickCount();
+        string yuvColor = ClassifyColorYuv(f, roi, *tb, yr, yg, yb);
+        int64 t1 = getTickCount();
+
+        // 기존 경로: ROI 를 BGR 로 (카메라/드라이버 변환 대신) -> classify_mode 판별
+        Mat packed, roiBgr;
+        CopyYuvRoi(f, roi, packed);
+        int64 t2 = getTickCount();
+        cvtColor(packed, roiBgr, YuvToBgrCode(layout));
+        int br = 0, bg = 0, bb = 0;
+        string bgrColor = ClassifyColorROI(roiBgr, *tb, br, bg, bb);
+        int64 t3 = getTickCount();
+
+        yuvMs += (t1 - t0) * 1000.0 / freq;
+        bgrMs += (t3 - t2) * 1000.0 / freq;
+
+        // 기준 개수: HSV inRange 그대로 (R = R1 | R2)
+        Mat hsv, r1, r2, mg, mb;
+        cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+        inRange(hsv, th.R1.L, th.R1.U, r1);
+        inRange(hsv, th.R2.L, th.R2.U, r2);
+        inRange(hsv, th.G.L, th.G.U, mg);
+        inRange(hsv, th.B.L, th.B.U, mb);
+        int hr = countNonZero(r1 | r2), hg = countNonZero(mg), hb = countNonZero(mb);
+
+        bool same = (yr == hr && yg == hg && yb == hb);
+        if (same) exact++;
+        if (yuvColor == bgrColor) agree++;
+        if (!same || yuvColor != bgrColor) {
+            cout << "  frame " << frames - 1
+                << " yuv=" << yuvColor << "(" << yr << "/" << yg << "/" << yb << ")"
+                << " inRange=(" << hr << "/" << hg << "/" << hb << ")"
+                << " " << ClassifyModeName(cfg.classifyMode) << "=" << bgrColor << "(" << br << "/" << bg << "/" << bb << ")\n";
+        }
+    }
+
+    if (frames == 0) {
+        cerr << "[YUV] no complete frame in " << path << "\n";
+        return -1;
+    }
+    cout << fixed << setprecision(3);
+    cout << "[YUV] frames=" << frames << " exact(inRange)=" << exact << "/" << frames
+        << " agree(" << ClassifyModeName(cfg.classifyMode) << ")=" << agree << "/" << frames << "\n";
+    cout << "[YUV] yuv " << yuvMs / frames << " ms/frame, cvtColor+" << ClassifyModeName(cfg.classifyMode) << " "
+        << bgrMs / frames << " ms/frame\n";
+    return (exact == frames) ? 0 : 1;
+}
+
 // =====================
 // MAIN
 // =====================
-int main()
+int main(int argc, char** argv)
 {
+    // 오프라인 비교 모드: ColorWorker --compare [dir]
+    if (argc >= 2 && string(argv[1]) == "--compare")
+        return RunCompare(argc >= 3 ? argv[2] : CAPTURE_DIR);
+
+    // raw YUV 대조: ColorWorker --yuv-replay <file> <W> <H> [yuyv|nv12]
+    if (argc >= 5 && string(argv[1]) == "--yuv-replay") {
+        YuvLayout layout = (argc >= 6 && string(argv[5]) == "nv12") ? YUV_NV12 : YUV_YUYV;
+        return RunYuvReplay(argv[2], atoi(argv[3]), atoi(argv[4]), layout);
+    }
+
     cout << "[CWD] " << filesystem::current_path().string() << "\n";
     cout << "[MODE] RGB Detection + Modbus TCP (libmodbus)\n";
     cout << "[MODBUS] " << PLC_IP << ":" << PLC_PORT
@@ -465,7 +693,11 @@ int main()
         << " N=" << COIL_NONE
         << " (pulse=" << PULSE_MS << "ms)\n";
     cout << "[JSON] " << TOTAL_JSON << " (single file)\n";
-    cout << "[IMG]  " << CAPTURE_DIR << "/color_<label>.jpg\n";
+    if (CAPTURE_STORE == CAPTURE_ARCHIVE)
+        cout << "[IMG]  archive " << CAPTURE_ARCHIVE_DIR << " (segment " << CAPTURE_SEGMENT_MB << "MB/"
+        << CAPTURE_SEGMENT_SECONDS << "s)\n";
+    else
+        cout << "[IMG]  " << CAPTURE_DIR << "/color_<label>.jpg\n";
     cout << "[ROI]  fixed=(" << ROI_FIXED.x << "," << ROI_FIXED.y << ","
         << ROI_FIXED.width << "," << ROI_FIXED.height << ")\n\n";
 
@@ -482,7 +714,17 @@ int main()
         cerr << "[FATAL] total.json still not found after creation attempt.\n";
         return -1;
     }
-    cout << "[JSON] Ready: " << TOTAL_JSON << "\n\n";
+    cout << "[JSON] Ready: " << TOTAL_JSON << "\n";
+
+    MeasureArchiveOptions histOpt;
+    histOpt.dir = HISTORY_DIR;
+    histOpt.maxSegments = HISTORY_KEEP_SEGMENTS;
+    MeasureArchiveWriter history(histOpt);
+    {
+        string err;
+        if (history.Open(err)) cout << "[HIST] " << HISTORY_DIR << " (pending " << history.PendingRows() << " rows)\n\n";
+        else cerr << "[HIST] disabled: " << err << "\n\n";
+    }
 
     VideoCapture cap;
     if (USE_DSHOW) cap.open(DEVICE_INDEX, CAP_DSHOW);
@@ -493,10 +735,19 @@ int main()
         return -1;
     }
 
+    if (CAPTURE_FORMAT == CAPTURE_YUYV) cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('Y', 'U', 'Y', '2'));
+    if (CAPTURE_FORMAT == CAPTURE_NV12) cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('N', 'V', '1', '2'));
     cap.set(CAP_PROP_FRAME_WIDTH, CAM_W);
     cap.set(CAP_PROP_FRAME_HEIGHT, CAM_H);
+    if (CAPTURE_FORMAT != CAPTURE_BGR) cap.set(CAP_PROP_CONVERT_RGB, 0);
     cout << "[CAMERA] Opened (device " << DEVICE_INDEX << ")\n";
 
+    // YUV 버퍼 해석용 실제 해상도
+    const int camW = (int)cap.get(CAP_PROP_FRAME_WIDTH);
+    const int camH = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
+    const YuvLayout yuvLayout = (CAPTURE_FORMAT == CAPTURE_NV12) ? YUV_NV12 : YUV_YUYV;
+    bool yuvReported = false;
+
     modbus_t* ctx = ConnectModbus(PLC_IP, PLC_PORT);
     long long nextReconnectMs = 0;
 
@@ -512,7 +763,27 @@ int main()
         WriteCoil(ctx, COIL_NONE, false);
     }
 
-    ColorThresholds th;
+    ColorConfigWatcher colorCfg(COLOR_CONFIG, DefaultColorWorkerConfig(), CAPTURE_FORMAT != CAPTURE_BGR);
+    colorCfg.Start();
+
+    CaptureArchiveOptions archiveOpt;
+    archiveOpt.dir = CAPTURE_ARCHIVE_DIR;
+    archiveOpt.maxSegmentBytes = CAPTURE_SEGMENT_MB << 20;
+    archiveOpt.maxSegmentSeconds = CAPTURE_SEGMENT_SECONDS;
+    CaptureArchiveWriter archive(archiveOpt);
+    if (CAPTURE_STORE == CAPTURE_ARCHIVE) {
+        string err;
+        if (!archive.Open(err)) {
+            cerr << "[FATAL] capture archive: " << err << "\n";
+            return -1;
+        }
+    }
+
+    AsyncJpegWriter jpg(JPEG_WORKERS, JPEG_QUEUE_MAX, JPEG_POLICY, JPEG_QUALITY, JPEG_DEGRADED_QUALITY,
+        CAPTURE_STORE == CAPTURE_ARCHIVE ? &archive : nullptr);
+    cout << "[IMG]  encoder workers=" << JPEG_WORKERS << " queue=" << JPEG_QUEUE_MAX
+        << " policy=" << (JPEG_POLICY == JPEG_DROP ? "drop" : "degrade")
+        << " q=" << JPEG_QUALITY << "/" << JPEG_DEGRADED_QUALITY << "\n";
 
     bool prevStart = false;
     bool busyWaitStartLow = false;
@@ -525,17 +796,49 @@ int main()
     int lastRPix = 0, lastGPix = 0, lastBPix = 0;
     long long lastTrigMs = 0;
 
+    SpcEngine spc;
+    long long nextSpcMs = NowMillis() + SPC_PUBLISH_EVERY_MS;
+    long long nextSpcRequestCheckMs = 0;
+    uint64_t spcPublished = 0;
+    cout << "[SPC] " << SPC_JSON << " (every " << SPC_PUBLISH_EVERY_MS / 1000 << "s, or create " << SPC_REQUEST << ")\n";
+
     cout << "[READY] Waiting for trigger...\n\n";
 
     while (true) {
+        // 통계 내보내기 (오프라인이어도)
+        {
+            long long nowMs = NowMillis();
+            bool requested = false;
+            if (nowMs >= nextSpcRequestCheckMs) {
+                error_code ec;
+                requested = filesystem::exists(SPC_REQUEST, ec);
+                if (requested) filesystem::remove(SPC_REQUEST, ec);
+                nextSpcRequestCheckMs = nowMs + 1000;
+            }
+            if (requested || (nowMs >= nextSpcMs && spc.Version() != spcPublished)) {
+                spcPublished = spc.Version();
+                if (!spc.WriteJson(SPC_JSON, nowMs)) cerr << "[SPC] write failed: " << SPC_JSON << "\n";
+                if (requested) cout << "[SPC] " << spc.Summary(nowMs) << "\n";
+            }
+            if (nowMs >= nextSpcMs) nextSpcMs = nowMs + SPC_PUBLISH_EVERY_MS;
+        }
+
         Mat frame;
         if (!cap.read(frame) || frame.empty()) {
             this_thread::sleep_for(chrono::milliseconds(10));
             continue;
         }
 
+        // YUV 캡처면 버퍼를 그대로 해석 (실패하면 BGR 프레임으로 보고 기존 경로)
+        YuvFrame yuv;
+        bool isYuv = (CAPTURE_FORMAT != CAPTURE_BGR) && WrapYuvFrame(frame, yuvLayout, camW, camH, yuv);
+        if (CAPTURE_FORMAT != CAPTURE_BGR && !yuvReported) {
+            cout << "[CAMERA] " << (isYuv ? "raw YUV -> U/V LUT classify" : "raw YUV not delivered -> BGR path") << "\n";
+            yuvReported = true;
+        }
+
         // 고정 ROI를 화면 크기에 맞춰 클램프
-        Rect roi = ROI_FIXED & Rect(0, 0, frame.cols, frame.rows);
+        Rect roi = isYuv ? AlignYuvRoi(yuv, ROI_FIXED) : (ROI_FIXED & Rect(0, 0, frame.cols, frame.rows));
 
         // OFFLINE: 재접속 시도
         if (!ctx) {
@@ -592,12 +895,24 @@ int main()
             string imgPath = "";
 
             if (roi.width > 0 && roi.height > 0) {
-                Mat roiBgr = frame(roi).clone();
-                color = ClassifyColorROI(roiBgr, th, rPix, gPix, bPix);
+                auto tb = colorCfg.Current();
+                if (isYuv) {
+                    color = ClassifyColorYuv(yuv, roi, *tb, rPix, gPix, bPix);
+
+                    Mat roiYuv;
+                    CopyYuvRoi(yuv, roi, roiYuv);
+                    count = GetNextCountFromTotalJson(TOTAL_JSON, color);
+                    label = MakeLabel(color, count);
+                    imgPath = SubmitColorCapture(jpg, roiYuv, label, color, YuvToBgrCode(yuvLayout));
+                }
+                else {
+                    Mat roiBgr = frame(roi).clone();
+                    color = ClassifyColorROI(roiBgr, *tb, rPix, gPix, bPix);
 
-                count = GetNextCountFromTotalJson(TOTAL_JSON, color);
-                label = MakeLabel(color, count);
-                imgPath = SaveColorCroppedJpg_ByLabel(roiBgr, label, color);
+                    count = GetNextCountFromTotalJson(TOTAL_JSON, color);
+                    label = MakeLabel(color, count);
+                    imgPath = SubmitColorCapture(jpg, roiBgr, label, color);
+                }
 
                 // 시각화 제거: ROI_CROP 표시 부분 삭제
             }
@@ -622,11 +937,29 @@ int main()
                 rec << "  }";
                 AppendJsonArray(TOTAL_JSON, rec.str());
             }
+            {
+                MeasureRecord h;
+                h.tsMs = NowMillis();
+                h.label = label;
+                h.color = MeasureColorFromName(color);
+                h.ms = (double)(h.tsMs - lastTrigMs); // 트리거 -> 결과
+                h.pixR = rPix; h.pixG = gPix; h.pixB = bPix;
+                history.Append(h);
+
+                double pix = NAN; // 판별된 색의 픽셀 수 (조명/위치 변화 추적, NONE 은 없음)
+                if (color == "RED") pix = rPix;
+                else if (color == "GREEN") pix = gPix;
+                else if (color == "BLUE") pix = bPix;
+                spc.Add(h.tsMs, { "ALL", "color:" + color }, { { "ms", h.ms }, { "pix", pix } });
+            }
 
+            AsyncJpegStats js = jpg.Stats();
             cout << "[RESULT] label=" << label
                 << " | color=" << color
                 << " | count=" << count
-                << " | image=" << imgPath << "\n";
+                << " | image=" << imgPath
+                << " | jpgQ=" << js.depth << "/" << jpg.Capacity()
+                << " (max " << js.maxDepth << ", drop " << js.dropped << ", degraded " << js.degraded << ")\n";
 
             // PLC로 결과 전송 (원본 그대로)
             if (!SendColorPulse(ctx, color)) {
@@ -660,6 +993,10 @@ int main()
         ctx = nullptr;
     }
 
+    jpg.Stop();
+    history.Close();
+    spc.WriteJson(SPC_JSON, NowMillis());
+    colorCfg.Stop();
     cap.release();
     return 0;
 }
@@ -0,0 +1,159 @@
+﻿#include "async_jpeg_writer.h"
+#include "capture_archive.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+using namespace cv;
+using namespace std;
+
+AsyncJpegWriter::AsyncJpegWriter(int workers, size_t capacity, JpegBackpressure policy, int quality, int degradedQuality,
+    CaptureArchiveWriter* archive)
+    : capacity_(capacity > 0 ? capacity : 1), policy_(policy), quality_(quality), degradedQuality_(degradedQuality),
+    archive_(archive)
+{
+    if (workers < 1) workers = 1;
+    for (int i = 0; i < workers; i++) workers_.emplace_back(&AsyncJpegWriter::Run, this);
+}
+
+AsyncJpegWriter::~AsyncJpegWriter()
+{
+    Stop();
+}
+
+bool AsyncJpegWriter::Submit(Mat image, const string& path, Decorate decorate)
+{
+    Job job;
+    job.image = image;
+    job.path = path;
+    job.decorate = std::move(decorate);
+    return Enqueue(std::move(job));
+}
+
+bool AsyncJpegWriter::SubmitArchive(Mat image, const string& label, Decorate decorate)
+{
+    if (!archive_) return false;
+
+    Job job;
+    job.image = image;
+    job.path = label;
+    job.decorate = std::move(decorate);
+    job.toArchive = true;
+    // 기록 시각은 인코딩이 끝난 때가 아니라 제출한 때
+    job.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    return Enqueue(std::move(job));
+}
+
+bool AsyncJpegWriter::Enqueue(Job job)
+{
+    job.quality = quality_;
+
+    {
+        lock_guard<mutex> lk(mtx_);
+        stats_.submitted++;
+
+        if (stop_ || q_.size() >= capacity_) {
+            stats_.dropped++;
+            return false;
+        }
+
+        if (policy_ == JPEG_DEGRADE && q_.size() * 2 >= capacity_) {
+            job.quality = degradedQuality_;
+            stats_.degraded++;
+        }
+
+        q_.push_back(std::move(job));
+        stats_.depth = q_.size();
+        if (stats_.depth > stats_.maxDepth) stats_.maxDepth = stats_.depth;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void AsyncJpegWriter::Stop()
+{
+    {
+        lock_guard<mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (thread& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+    workers_.clear();
+}
+
+size_t AsyncJpegWriter::Depth() const
+{
+    lock_guard<mutex> lk(mtx_);
+    return q_.size();
+}
+
+AsyncJpegStats AsyncJpegWriter::Stats() const
+{
+    lock_guard<mutex> lk(mtx_);
+    AsyncJpegStats s = stats_;
+    s.depth = q_.size();
+    return s;
+}
+
+void AsyncJpegWriter::Run()
+{
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lk(mtx_);
+            cv_.wait(lk, [&] { return stop_ || !q_.empty(); });
+            if (q_.empty()) return; // stop_ && 다 비움
+            job = std::move(q_.front());
+            q_.pop_front();
+            stats_.depth = q_.size();
+        }
+
+        if (job.decorate) job.decorate(job.image);
+
+        bool ok = job.toArchive ? WriteArchive(job) : WriteFile(job);
+
+        lock_guard<mutex> lk(mtx_);
+        if (ok) stats_.written++;
+        else stats_.failed++;
+    }
+}
+
+bool AsyncJpegWriter::WriteArchive(const Job& job)
+{
+    vector<uchar> buf;
+    vector<int> params = { IMWRITE_JPEG_QUALITY, job.quality };
+    try {
+        if (!imencode(".jpg", job.image, buf, params)) return false;
+    }
+    catch (const cv::Exception&) {
+        return false;
+    }
+    return archive_->Append(job.path, buf.data(), buf.size(), job.timeMs);
+}
+
+bool AsyncJpegWriter::WriteFile(const Job& job)
+{
+    std::error_code ec;
+    filesystem::path outPath(job.path);
+    if (outPath.has_parent_path()) filesystem::create_directories(outPath.parent_path(), ec);
+
+    // imwrite 는 확장자로 포맷을 고르므로 tmp 도 .jpg 로 끝나게
+    string tmp = job.path + ".tmp.jpg";
+    vector<int> params = { IMWRITE_JPEG_QUALITY, job.quality };
+    bool ok = false;
+    try {
+        ok = imwrite(tmp, job.image, params);
+    }
+    catch (const cv::Exception&) {
+        ok = false;
+    }
+    if (ok) {
+        ::remove(job.path.c_str());
+        ok = (::rename(tmp.c_str(), job.path.c_str()) == 0);
+    }
+    if (!ok) ::remove(tmp.c_str());
+    return ok;
+}
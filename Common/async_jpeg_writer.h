@@ -0,0 +1,89 @@
+﻿#pragma once
+
+// async_jpeg_writer.h
+// - 증거 이미지(JPEG) 인코딩/저장을 백그라운드 워커에서 처리 (트리거 -> 펄스 경로에서 제외)
+// - 큐는 용량 고정. 가득 차면 새 작업은 버림(DROP),
+//   DEGRADE 면 절반 이상 찼을 때부터 낮은 품질로 인코딩해서 따라잡고, 가득 차면 버림
+// - 파일은 <path>.tmp.jpg 로 쓴 뒤 rename -> 읽는 쪽은 완성된 파일만 본다
+// - SubmitArchive: 파일 대신 CaptureArchiveWriter 세그먼트에 이어 붙임 (label 로 찾음)
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CaptureArchiveWriter;
+
+enum JpegBackpressure {
+    JPEG_DROP = 0,
+    JPEG_DEGRADE = 1,
+};
+
+struct AsyncJpegStats {
+    uint64_t submitted = 0;
+    uint64_t written = 0;
+    uint64_t dropped = 0;  // 큐 가득 -> 저장 안 함
+    uint64_t degraded = 0; // 낮은 품질로 저장
+    uint64_t failed = 0;   // imwrite/rename 실패
+    size_t depth = 0;      // 현재 대기 중
+    size_t maxDepth = 0;   // 최대 대기 수
+};
+
+class AsyncJpegWriter {
+public:
+    // 이미지 위에 덧그리기 (워커 스레드에서 호출)
+    using Decorate = std::function<void(cv::Mat&)>;
+
+    // archive: SubmitArchive 용 (없으면 nullptr). writer 보다 오래 살아 있어야 함
+    AsyncJpegWriter(int workers, size_t capacity, JpegBackpressure policy, int quality, int degradedQuality,
+        CaptureArchiveWriter* archive = nullptr);
+    ~AsyncJpegWriter();
+
+    // image 는 소유권을 넘겨받는다 (호출 후 건드리지 말 것). 큐 가득이면 false (버림)
+    bool Submit(cv::Mat image, const std::string& path, Decorate decorate = nullptr);
+
+    // 파일 대신 아카이브에 저장 (archive 가 없으면 false). 큐/품질 정책은 Submit 과 같음
+    bool SubmitArchive(cv::Mat image, const std::string& label, Decorate decorate = nullptr);
+
+    // 남은 작업을 모두 쓰고 종료
+    void Stop();
+
+    size_t Depth() const;
+    size_t Capacity() const { return capacity_; }
+    AsyncJpegStats Stats() const;
+
+private:
+    struct Job {
+        cv::Mat image;
+        std::string path; // toArchive 면 label
+        Decorate decorate;
+        int quality = 92;
+        bool toArchive = false;
+        int64_t timeMs = 0;
+    };
+
+    bool Enqueue(Job job);
+    bool WriteFile(const Job& job);
+    bool WriteArchive(const Job& job);
+    void Run();
+
+    const size_t capacity_;
+    const JpegBackpressure policy_;
+    const int quality_;
+    const int degradedQuality_;
+    CaptureArchiveWriter* archive_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> q_;
+    bool stop_ = false;
+    AsyncJpegStats stats_;
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,555 @@
+﻿#include "capture_archive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char SEG_MAGIC[8] = { 'F', 'A', 'S', 'C', 'A', 'P', 'S', '1' };
+static const char IDX_MAGIC[8] = { 'F', 'A', 'S', 'C', 'A', 'P', 'I', '1' };
+static const uint32_t REC_MAGIC = 0x31434552; // "REC1"
+static const size_t SEG_HEADER = 16;
+static const size_t REC_HEADER = 4 + 4 + 8 + 2;
+
+static int64_t NowMs()
+{
+    using namespace chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+// 고정 크기 값 <-> 바이트 (x86/ARM 모두 리틀 엔디언)
+template <class T>
+static void PutRaw(vector<uint8_t>& b, T v)
+{
+    size_t n = b.size();
+    b.resize(n + sizeof(T));
+    memcpy(b.data() + n, &v, sizeof(T));
+}
+
+template <class T>
+static T GetRaw(const uint8_t* p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+string CaptureSegmentPath(const string& dir, uint32_t segId)
+{
+    ostringstream fn;
+    fn << "seg_" << setw(6) << setfill('0') << segId << ".cap";
+    return (filesystem::path(dir) / fn.str()).string();
+}
+
+string CaptureIndexPath(const string& dir)
+{
+    return (filesystem::path(dir) / "index.fci").string();
+}
+
+string MakeCaptureUri(const string& dir, const string& label)
+{
+    return "archive:" + dir + "#" + label;
+}
+
+bool ParseCaptureUri(const string& uri, string& dir, string& label)
+{
+    const string pre = "archive:";
+    if (uri.compare(0, pre.size(), pre) != 0) return false;
+    size_t hash = uri.rfind('#');
+    if (hash == string::npos || hash < pre.size()) return false;
+    dir = uri.substr(pre.size(), hash - pre.size());
+    label = uri.substr(hash + 1);
+    return !dir.empty() && !label.empty();
+}
+
+// seg_NNNNNN.cap -> NNNNNN (아니면 0)
+static uint32_t SegIdFromName(const string& name)
+{
+    if (name.size() != 14 || name.compare(0, 4, "seg_") != 0 || name.compare(10, 4, ".cap") != 0) return 0;
+    uint32_t id = 0;
+    for (int i = 4; i < 10; i++) {
+        if (name[i] < '0' || name[i] > '9') return 0;
+        id = id * 10 + (uint32_t)(name[i] - '0');
+    }
+    return id;
+}
+
+static vector<uint32_t> ListSegments(const string& dir)
+{
+    vector<uint32_t> ids;
+    error_code ec;
+    for (const auto& e : filesystem::directory_iterator(dir, ec)) {
+        uint32_t id = SegIdFromName(e.path().filename().string());
+        if (id > 0) ids.push_back(id);
+    }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// 64비트 파일 위치 (세그먼트 크기 제한이 2GB 를 넘을 수 있음)
+static int64_t FileTell(FILE* f)
+{
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return (int64_t)ftello(f);
+#endif
+}
+
+// 쓰다 만 꼬리를 잘라내고 쓰기 위치를 size 로 되돌림
+static bool RollbackFile(FILE* f, const string& path, uint64_t size)
+{
+    fflush(f);
+    error_code ec;
+    filesystem::resize_file(path, size, ec);
+    if (ec) return false;
+#ifdef _WIN32
+    return _fseeki64(f, (int64_t)size, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)size, SEEK_SET) == 0;
+#endif
+}
+
+static void PutIndexEntry(vector<uint8_t>& b, const CaptureRef& r)
+{
+    PutRaw<uint32_t>(b, r.segId);
+    PutRaw<uint64_t>(b, r.offset);
+    PutRaw<uint32_t>(b, r.length);
+    PutRaw<int64_t>(b, r.timeMs);
+    PutRaw<uint8_t>(b, (uint8_t)r.label.size());
+    b.insert(b.end(), r.label.begin(), r.label.end());
+}
+
+static const size_t IDX_FIXED = 4 + 8 + 4 + 8 + 1; // PutIndexEntry 고정부 (+ label)
+
+// index 앞에서부터 온전한 엔트리까지의 바이트 수 (머리가 깨졌으면 0)
+// 엔트리에는 길이 틀이 없어서 죽다가 잘린 엔트리 뒤에 이어 쓴 엔트리는 어긋나게 읽힌다
+// -> 엔트리마다 가리키는 세그먼트 레코드 머리(REC1, 길이, label)까지 맞는지 확인하고 처음 틀린 곳에서 멈춤
+//    세그먼트 번호는 쓰는 순서대로 늘어나고, 지워진 세그먼트(수동 정리)는 번호 범위만 확인
+static uint64_t ValidIndexBytes(const string& dir, const uint8_t* p, size_t size, uint32_t maxSegId)
+{
+    if (size < sizeof(IDX_MAGIC) || memcmp(p, IDX_MAGIC, sizeof(IDX_MAGIC)) != 0) return 0;
+    size_t pos = sizeof(IDX_MAGIC);
+    uint32_t prevSeg = 0;
+    uint32_t mappedId = 0;
+    bool mappedOk = false;
+    MappedFile seg;
+    while (size - pos >= IDX_FIXED) {
+        const uint8_t* e = p + pos;
+        uint32_t segId = GetRaw<uint32_t>(e);
+        uint64_t offset = GetRaw<uint64_t>(e + 4);
+        uint32_t length = GetRaw<uint32_t>(e + 12);
+        size_t labelLen = e[24];
+        if (size - pos < IDX_FIXED + labelLen) break;
+        if (labelLen == 0 || segId < max<uint32_t>(1, prevSeg) || segId > maxSegId) break;
+
+        if (segId != mappedId) {
+            mappedId = segId;
+            mappedOk = seg.Open(CaptureSegmentPath(dir, segId));
+        }
+        if (mappedOk) {
+            uint64_t head = REC_HEADER + labelLen;
+            if (offset < SEG_HEADER + head || offset + length > seg.Size()) break;
+            const uint8_t* r = seg.Data() + (offset - head);
+            if (GetRaw<uint32_t>(r) != REC_MAGIC || GetRaw<uint32_t>(r + 4) != length
+                || GetRaw<uint16_t>(r + 16) != labelLen || memcmp(r + REC_HEADER, e + IDX_FIXED, labelLen) != 0)
+                break;
+        }
+        prevSeg = segId;
+        pos += IDX_FIXED + labelLen;
+    }
+    return pos;
+}
+
+// =====================
+// Writer
+// =====================
+CaptureArchiveWriter::CaptureArchiveWriter(const CaptureArchiveOptions& opt)
+    : opt_(opt)
+{
+}
+
+CaptureArchiveWriter::~CaptureArchiveWriter()
+{
+    Close();
+}
+
+bool CaptureArchiveWriter::Open(string& err)
+{
+    lock_guard<mutex> lk(mtx_);
+
+    error_code ec;
+    filesystem::create_directories(opt_.dir, ec);
+
+    string idxPath = CaptureIndexPath(opt_.dir);
+    vector<uint32_t> ids = ListSegments(opt_.dir);
+
+    // 지난 실행이 index 엔트리를 쓰다 죽었으면 잘린 꼬리를 잘라냄 (머리부터 깨졌으면 세그먼트로 다시 만듦)
+    bool fresh = !filesystem::exists(idxPath) || filesystem::file_size(idxPath, ec) == 0;
+    if (!fresh) {
+        uint64_t size = 0, valid = 0;
+        {
+            MappedFile mf; // resize 전에 닫아야 함 (Windows 는 매핑된 파일을 자를 수 없음)
+            if (mf.Open(idxPath)) {
+                size = mf.Size();
+                valid = ValidIndexBytes(opt_.dir, mf.Data(), mf.Size(), ids.empty() ? 0 : ids.back());
+            }
+        }
+        if (valid == 0) {
+            if (!CaptureArchiveReader::RebuildIndex(opt_.dir, err)) return false;
+        }
+        else if (valid < size) {
+            filesystem::resize_file(idxPath, valid, ec);
+            if (ec) {
+                err = "cannot truncate " + idxPath;
+                return false;
+            }
+        }
+    }
+
+    idx_ = fopen(idxPath.c_str(), "ab");
+    if (!idx_) {
+        err = "cannot open " + idxPath;
+        return false;
+    }
+    if (fresh) {
+        fwrite(IDX_MAGIC, 1, sizeof(IDX_MAGIC), idx_);
+        fflush(idx_);
+    }
+    idxBytes_ = filesystem::file_size(idxPath, ec);
+    if (ec) idxBytes_ = 0;
+
+    // 이전 실행의 세그먼트는 건드리지 않고 다음 번호로 시작
+    uint32_t next = ids.empty() ? 1 : ids.back() + 1;
+    if (!OpenSegment(next, NowMs())) {
+        err = "cannot create " + CaptureSegmentPath(opt_.dir, next);
+        fclose(idx_);
+        idx_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void CaptureArchiveWriter::Close()
+{
+    lock_guard<mutex> lk(mtx_);
+    if (seg_) { fclose(seg_); seg_ = nullptr; }
+    if (idx_) { fclose(idx_); idx_ = nullptr; }
+}
+
+bool CaptureArchiveWriter::OpenSegment(uint32_t segId, int64_t nowMs)
+{
+    if (seg_) fclose(seg_);
+    seg_ = fopen(CaptureSegmentPath(opt_.dir, segId).c_str(), "wb");
+    if (!seg_) return false;
+
+    vector<uint8_t> h(SEG_MAGIC, SEG_MAGIC + sizeof(SEG_MAGIC));
+    PutRaw<uint32_t>(h, segId);
+    PutRaw<uint32_t>(h, 0);
+    fwrite(h.data(), 1, h.size(), seg_);
+    fflush(seg_);
+
+    segId_ = segId;
+    segBytes_ = h.size();
+    segOpenMs_ = nowMs;
+    return true;
+}
+
+bool CaptureArchiveWriter::NeedRotate(size_t recordBytes, int64_t nowMs) const
+{
+    if (segBytes_ <= SEG_HEADER) return false; // 빈 세그먼트에는 크기와 상관없이 1개는 넣는다
+    if (segBytes_ + recordBytes > opt_.maxSegmentBytes) return true;
+    if (opt_.maxSegmentSeconds > 0 && nowMs - segOpenMs_ >= (int64_t)opt_.maxSegmentSeconds * 1000) return true;
+    return false;
+}
+
+bool CaptureArchiveWriter::Append(const string& label, const uint8_t* data, size_t len, int64_t timeMs, CaptureRef* out)
+{
+    if (label.empty() || label.size() > 255 || len > 0xFFFFFFFFu) return false;
+
+    vector<uint8_t> rec;
+    rec.reserve(REC_HEADER + label.size());
+    PutRaw<uint32_t>(rec, REC_MAGIC);
+    PutRaw<uint32_t>(rec, (uint32_t)len);
+    PutRaw<int64_t>(rec, timeMs);
+    PutRaw<uint16_t>(rec, (uint16_t)label.size());
+    rec.insert(rec.end(), label.begin(), label.end());
+
+    lock_guard<mutex> lk(mtx_);
+    if (!seg_ || !idx_) return false;
+
+    int64_t nowMs = NowMs();
+    if (NeedRotate(rec.size() + len, nowMs) && !OpenSegment(segId_ + 1, nowMs)) return false;
+
+    CaptureRef ref;
+    ref.segId = segId_;
+    ref.offset = segBytes_ + rec.size();
+    ref.length = (uint32_t)len;
+    ref.timeMs = timeMs;
+    ref.label = label;
+
+    // 레코드를 먼저 내려쓰고 index 를 쓴다 -> index 에 있는 것은 항상 읽을 수 있음
+    // 일부만 써졌으면 segBytes_ 위치로 잘라냄 (남겨 두면 이후 offset 이 전부 어긋남), 못 자르면 새 세그먼트
+    string segPath = CaptureSegmentPath(opt_.dir, segId_);
+    auto rollbackSeg = [&]() {
+        if (!RollbackFile(seg_, segPath, segBytes_)) OpenSegment(segId_ + 1, nowMs);
+    };
+    bool ok = fwrite(rec.data(), 1, rec.size(), seg_) == rec.size();
+    ok = ok && (len == 0 || fwrite(data, 1, len, seg_) == len);
+    ok = ok && fflush(seg_) == 0;
+    int64_t pos = ok ? FileTell(seg_) : -1;
+    if (pos != (int64_t)(ref.offset + len)) {
+        rollbackSeg();
+        return false;
+    }
+
+    vector<uint8_t> ent;
+    PutIndexEntry(ent, ref);
+    if (fwrite(ent.data(), 1, ent.size(), idx_) != ent.size() || fflush(idx_) != 0) {
+        // index 도 잘린 엔트리를 남기지 않음 (append 모드라 자르기만 하면 됨)
+        RollbackFile(idx_, CaptureIndexPath(opt_.dir), idxBytes_);
+        rollbackSeg();
+        return false;
+    }
+    segBytes_ = (uint64_t)pos;
+    idxBytes_ += ent.size();
+
+    if (out) *out = ref;
+    return true;
+}
+
+// =====================
+// MappedFile
+// =====================
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const string& path)
+{
+    Close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz) || sz.QuadPart == 0) { CloseHandle(f); return false; }
+
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) { CloseHandle(f); return false; }
+
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p) { CloseHandle(m); CloseHandle(f); return false; }
+
+    file_ = f;
+    mapping_ = m;
+    data_ = (const uint8_t*)p;
+    size_ = (size_t)sz.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle((HANDLE)mapping_);
+    if (file_) CloseHandle((HANDLE)file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+#else
+bool MappedFile::Open(const string& path)
+{
+    Close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { ::close(fd); return false; }
+
+    fd_ = fd;
+    data_ = (const uint8_t*)p;
+    size_ = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data_) munmap((void*)data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+}
+#endif
+
+// =====================
+// Reader
+// =====================
+bool CaptureArchiveReader::LoadIndex(const string& path, vector<CaptureRef>& out)
+{
+    MappedFile mf;
+    if (!mf.Open(path)) return false;
+    const uint8_t* p = mf.Data();
+    const uint8_t* end = p + mf.Size();
+    if (mf.Size() < sizeof(IDX_MAGIC) || memcmp(p, IDX_MAGIC, sizeof(IDX_MAGIC)) != 0) return false;
+    p += sizeof(IDX_MAGIC);
+
+    const size_t fixed = IDX_FIXED;
+    while ((size_t)(end - p) >= fixed) {
+        CaptureRef r;
+        r.segId = GetRaw<uint32_t>(p);
+        r.offset = GetRaw<uint64_t>(p + 4);
+        r.length = GetRaw<uint32_t>(p + 12);
+        r.timeMs = GetRaw<int64_t>(p + 16);
+        size_t labelLen = p[24];
+        if ((size_t)(end - p) < fixed + labelLen) break; // 쓰다 끊긴 마지막 엔트리
+        r.label.assign((const char*)p + fixed, labelLen);
+        p += fixed + labelLen;
+        out.push_back(std::move(r));
+    }
+    return true;
+}
+
+bool CaptureArchiveReader::ScanSegments(const string& dir, vector<CaptureRef>& out, string& err)
+{
+    for (uint32_t id : ListSegments(dir)) {
+        MappedFile mf;
+        string path = CaptureSegmentPath(dir, id);
+        if (!mf.Open(path)) continue; // 빈 세그먼트
+        const uint8_t* base = mf.Data();
+        size_t size = mf.Size();
+        if (size < SEG_HEADER || memcmp(base, SEG_MAGIC, sizeof(SEG_MAGIC)) != 0) {
+            err = "bad segment header: " + path;
+            return false;
+        }
+
+        size_t pos = SEG_HEADER;
+        while (size - pos >= REC_HEADER) {
+            const uint8_t* p = base + pos;
+            if (GetRaw<uint32_t>(p) != REC_MAGIC) break;
+            uint32_t len = GetRaw<uint32_t>(p + 4);
+            int64_t t = GetRaw<int64_t>(p + 8);
+            uint16_t labelLen = GetRaw<uint16_t>(p + 16);
+            if (size - pos < REC_HEADER + (size_t)labelLen + len) break; // 잘린 레코드
+
+            CaptureRef r;
+            r.segId = id;
+            r.offset = pos + REC_HEADER + labelLen;
+            r.length = len;
+            r.timeMs = t;
+            r.label.assign((const char*)p + REC_HEADER, labelLen);
+            out.push_back(std::move(r));
+            pos += REC_HEADER + labelLen + len;
+        }
+    }
+    return true;
+}
+
+bool CaptureArchiveReader::Open(const string& dir, string& err)
+{
+    dir_ = dir;
+    entries_.clear();
+    byLabel_.clear();
+    maps_.clear();
+    retired_.clear();
+
+    if (!filesystem::is_directory(dir)) {
+        err = "not a directory: " + dir;
+        return false;
+    }
+
+    if (!LoadIndex(CaptureIndexPath(dir), entries_)) {
+        entries_.clear();
+        if (!ScanSegments(dir, entries_, err)) return false;
+    }
+
+    for (size_t i = 0; i < entries_.size(); i++) byLabel_[entries_[i].label] = i;
+    return true;
+}
+
+const CaptureRef* CaptureArchiveReader::Find(const string& label) const
+{
+    auto it = byLabel_.find(label);
+    return (it == byLabel_.end()) ? nullptr : &entries_[it->second];
+}
+
+bool CaptureArchiveReader::Read(const CaptureRef& ref, const uint8_t*& data, size_t& len)
+{
+    unique_ptr<MappedFile>& mf = maps_[ref.segId];
+    // 쓰는 중인 세그먼트는 매핑 이후에 자랐을 수 있음 -> 다시 매핑
+    // 이전 매핑은 이미 돌려준 포인터가 가리키므로 reader 가 닫힐 때까지 보관
+    if (!mf || ref.offset + ref.length > mf->Size()) {
+        if (mf) retired_.push_back(std::move(mf));
+        mf.reset(new MappedFile());
+        if (!mf->Open(CaptureSegmentPath(dir_, ref.segId))) {
+            mf.reset();
+            return false;
+        }
+    }
+    if (ref.offset + ref.length > mf->Size()) return false;
+
+    data = mf->Data() + ref.offset;
+    len = ref.length;
+    return true;
+}
+
+vector<uint32_t> CaptureArchiveReader::Segments() const
+{
+    return ListSegments(dir_);
+}
+
+bool CaptureArchiveReader::RebuildIndex(const string& dir, string& err, size_t* outCount)
+{
+    vector<CaptureRef> refs;
+    if (!ScanSegments(dir, refs, err)) return false;
+
+    vector<uint8_t> b(IDX_MAGIC, IDX_MAGIC + sizeof(IDX_MAGIC));
+    for (const CaptureRef& r : refs) PutIndexEntry(b, r);
+
+    string path = CaptureIndexPath(dir);
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        err = "cannot write " + tmp;
+        return false;
+    }
+    bool ok = fwrite(b.data(), 1, b.size(), f) == b.size();
+    ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        ::remove(path.c_str());
+        ok = ::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+        ::remove(tmp.c_str());
+        err = "cannot replace " + path;
+        return false;
+    }
+    if (outCount) *outCount = refs.size();
+    return true;
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+
+// capture_archive.h
+// - 증거 이미지(인코딩된 JPEG 바이트)를 세그먼트 파일에 이어 붙여 저장 (박스당 파일 1개 대신)
+// - index.fci: label -> (segment, offset, length, time) 고정 형식 엔트리를 append
+// - 세그먼트는 크기 또는 시간 기준으로 교체 (seg_000001.cap, seg_000002.cap ...)
+// - 읽기: 세그먼트를 메모리 매핑해서 복사 없이 바이트 포인터를 돌려줌
+// - 세그먼트 레코드는 스스로 길이/label 을 가지므로 index 가 깨져도 스캔으로 복구 가능
+//
+// 형식 (리틀 엔디언)
+//   segment: "FASCAPS1" u32 segId u32 0 | record*
+//   record : u32 'REC1' u32 dataLen i64 timeMs u16 labelLen label[labelLen] data[dataLen]
+//   index  : "FASCAPI1" | entry*
+//   entry  : u32 segId u64 offset(data 시작) u32 length i64 timeMs u8 labelLen label[labelLen]
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CaptureRef {
+    uint32_t segId = 0;
+    uint64_t offset = 0; // 세그먼트 안의 데이터 시작 위치
+    uint32_t length = 0;
+    int64_t timeMs = 0;  // system_clock ms
+    std::string label;
+};
+
+struct CaptureArchiveOptions {
+    std::string dir;
+    uint64_t maxSegmentBytes = 256ull << 20; // 256MB 넘으면 새 세그먼트
+    int maxSegmentSeconds = 3600;            // 1시간 지나면 새 세그먼트 (0 = 시간 기준 없음)
+};
+
+std::string CaptureSegmentPath(const std::string& dir, uint32_t segId);
+std::string CaptureIndexPath(const std::string& dir);
+
+// "archive:<dir>#<label>" (total.json 의 image 값으로 기록)
+std::string MakeCaptureUri(const std::string& dir, const std::string& label);
+bool ParseCaptureUri(const std::string& uri, std::string& dir, std::string& label);
+
+class CaptureArchiveWriter {
+public:
+    explicit CaptureArchiveWriter(const CaptureArchiveOptions& opt);
+    ~CaptureArchiveWriter();
+
+    // 기존 세그먼트 뒤 번호로 새 세그먼트를 열고 index 를 이어 쓴다
+    // index 꼬리에 쓰다 만 엔트리가 있으면 마지막 온전한 엔트리까지 잘라냄 (머리가 깨졌으면 세그먼트로 다시 만듦)
+    bool Open(std::string& err);
+    void Close();
+
+    // 스레드 안전. 레코드 -> index 순서로 flush
+    bool Append(const std::string& label, const uint8_t* data, size_t len, int64_t timeMs, CaptureRef* out = nullptr);
+
+    const std::string& Dir() const { return opt_.dir; }
+
+private:
+    bool OpenSegment(uint32_t segId, int64_t nowMs);
+    bool NeedRotate(size_t recordBytes, int64_t nowMs) const;
+
+    CaptureArchiveOptions opt_;
+    std::mutex mtx_;
+    FILE* seg_ = nullptr;
+    FILE* idx_ = nullptr;
+    uint32_t segId_ = 0;
+    uint64_t segBytes_ = 0; // 세그먼트에 온전히 써진 크기 (= 다음 레코드 위치)
+    uint64_t idxBytes_ = 0;
+    int64_t segOpenMs_ = 0;
+};
+
+// 읽기 전용 메모리 매핑 (Windows: CreateFileMapping, 그 외: mmap)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+class CaptureArchiveReader {
+public:
+    // index 를 읽는다. index 가 없으면 세그먼트를 스캔해서 만든다
+    bool Open(const std::string& dir, std::string& err);
+
+    const std::vector<CaptureRef>& Entries() const { return entries_; }
+
+    // 같은 label 이 여러 번 있으면 마지막 것
+    const CaptureRef* Find(const std::string& label) const;
+
+    // 매핑된 세그먼트 안의 포인터 (reader 가 살아있는 동안 유효, 복사 없음)
+    // 쓰는 중인 세그먼트가 자라서 다시 매핑해도 이전 매핑은 Open/소멸 전까지 유지
+    bool Read(const CaptureRef& ref, const uint8_t*& data, size_t& len);
+
+    std::vector<uint32_t> Segments() const;
+
+    // 세그먼트 레코드를 스캔해서 index.fci 를 다시 쓴다 (잘린 마지막 레코드는 버림)
+    static bool RebuildIndex(const std::string& dir, std::string& err, size_t* outCount = nullptr);
+
+private:
+    static bool ScanSegments(const std::string& dir, std::vector<CaptureRef>& out, std::string& err);
+    static bool LoadIndex(const std::string& path, std::vector<CaptureRef>& out);
+
+    std::string dir_;
+    std::vector<CaptureRef> entries_;
+    std::unordered_map<std::string, size_t> byLabel_;
+    std::map<uint32_t, std::unique_ptr<MappedFile>> maps_;
+    std::vector<std::unique_ptr<MappedFile>> retired_; // 다시 매핑하기 전 것 (돌려준 포인터 유효 유지)
+};
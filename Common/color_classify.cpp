@@ -0,0 +1,423 @@
+﻿#include "color_classify.h"
+#include "packed_morph.h"
+#include "rle_mask.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+void BuildMasksRGB(const Mat& hsv, Mat& maskR, Mat& maskG, Mat& maskB, const ColorTables& tb)
+{
+    const ColorThresholds& th = tb.cfg.th;
+
+    Mat rA, rB;
+    inRange(hsv, th.R1.L, th.R1.U, rA);
+    inRange(hsv, th.R2.L, th.R2.U, rB);
+    maskR = rA | rB;
+
+    inRange(hsv, th.G.L, th.G.U, maskG);
+    inRange(hsv, th.B.L, th.B.U, maskB);
+
+    const Mat& k = tb.colorKernel;
+    morphologyEx(maskR, maskR, MORPH_OPEN, k, Point(-1, -1), 1);
+    morphologyEx(maskR, maskR, MORPH_CLOSE, k, Point(-1, -1), 2);
+    morphologyEx(maskG, maskG, MORPH_OPEN, k, Point(-1, -1), 1);
+    morphologyEx(maskG, maskG, MORPH_CLOSE, k, Point(-1, -1), 2);
+    morphologyEx(maskB, maskB, MORPH_OPEN, k, Point(-1, -1), 1);
+    morphologyEx(maskB, maskB, MORPH_CLOSE, k, Point(-1, -1), 2);
+}
+
+void BuildPackedRGB(const Mat& hsv, Mat& packed, const ColorTables& tb)
+{
+    CV_Assert(hsv.type() == CV_8UC3);
+
+    // inRange 4개 + (R1|R2) 를 픽셀당 LUT 3번으로
+    packed.create(hsv.rows, hsv.cols, CV_8UC1);
+    for (int y = 0; y < hsv.rows; y++) {
+        const uchar* p = hsv.ptr<uchar>(y);
+        uchar* o = packed.ptr<uchar>(y);
+        for (int x = 0; x < hsv.cols; x++, p += 3) {
+            uint8_t m = tb.lutH[p[0]] & tb.lutS[p[1]] & tb.lutV[p[2]];
+            // R1,R2,G,B (bit0~3) -> R,G,B (bit0~2)
+            o[x] = (uchar)(((m | (m >> 1)) & 1) | ((m >> 1) & 6));
+        }
+    }
+
+    // 평면별 open 1회 + close 2회 를 한 번에
+    PackedOpenRect(packed, packed, tb.cfg.morphSize, 1);
+    PackedCloseRect(packed, packed, tb.cfg.morphSize, 2);
+}
+
+// 가장 많은 색이 나머지보다 엄격히 많고, 개수/비율 기준을 넘어야 인정
+string DecideColor(int rPix, int gPix, int bPix, double totalPixels, const ColorConfig& cfg)
+{
+    int bestPix = 0;
+    string color = "NONE";
+    if (rPix > bestPix && rPix > gPix && rPix > bPix) { bestPix = rPix; color = "RED"; }
+    else if (gPix > bestPix && gPix > rPix && gPix > bPix) { bestPix = gPix; color = "GREEN"; }
+    else if (bPix > bestPix && bPix > rPix && bPix > gPix) { bestPix = bPix; color = "BLUE"; }
+
+    double ratio = (totalPixels > 0) ? (double)bestPix / totalPixels : 0.0;
+
+    if (bestPix < cfg.minColorPixels || ratio < cfg.minColorRatio) return "NONE";
+    return color;
+}
+
+string ClassifyColorROI(const Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix)
+{
+    if (tb.cfg.classifyMode == CLASSIFY_HIST) return ClassifyColorHist(roiBgr, tb, outRpix, outGpix, outBpix);
+    if (tb.cfg.classifyMode == CLASSIFY_MASK_REF) return ClassifyColorMasksRef(roiBgr, tb, outRpix, outGpix, outBpix);
+    if (tb.cfg.classifyMode == CLASSIFY_OBJECT) return ClassifyColorObject(roiBgr, tb, outRpix, outGpix, outBpix);
+    return ClassifyColorMasks(roiBgr, tb, outRpix, outGpix, outBpix);
+}
+
+string ClassifyColorMasks(const Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix)
+{
+    Mat hsv;
+    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+    GaussianBlur(hsv, hsv, Size(3, 3), 0);
+
+    Mat packed;
+    BuildPackedRGB(hsv, packed, tb);
+
+    int counts[3] = {};
+    CountPackedBits(packed, 3, counts);
+    outRpix = counts[0];
+    outGpix = counts[1];
+    outBpix = counts[2];
+
+    return DecideColor(outRpix, outGpix, outBpix, (double)roiBgr.rows * roiBgr.cols, tb.cfg);
+}
+
+string ClassifyColorMasksRef(const Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix)
+{
+    Mat hsv;
+    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+    GaussianBlur(hsv, hsv, Size(3, 3), 0);
+
+    Mat maskR, maskG, maskB;
+    BuildMasksRGB(hsv, maskR, maskG, maskB, tb);
+
+    outRpix = countNonZero(maskR);
+    outGpix = countNonZero(maskG);
+    outBpix = countNonZero(maskB);
+
+    return DecideColor(outRpix, outGpix, outBpix, (double)roiBgr.rows * roiBgr.cols, tb.cfg);
+}
+
+// =====================
+// H-S histogram (hist 모드)
+// =====================
+static const int HIST_H = 180;
+static const int HIST_S = 256;
+static const int SAT_H = HIST_H + 1; // 누적합 표: 0행/0열은 0
+static const int SAT_S = HIST_S + 1;
+
+static inline size_t SatIdx(int band, int h, int s)
+{
+    return ((size_t)band * SAT_H + h) * SAT_S + s;
+}
+
+// [h0,h1] x [s0,s1] 합 (양 끝 포함)
+static inline int RectSum(const vector<int>& sat, int band, int h0, int h1, int s0, int s1)
+{
+    return sat[SatIdx(band, h1 + 1, s1 + 1)] - sat[SatIdx(band, h0, s1 + 1)]
+        - sat[SatIdx(band, h1 + 1, s0)] + sat[SatIdx(band, h0, s0)];
+}
+
+// HSV 상자 하나에 들어가는 픽셀 수 (inRange 와 동일)
+static int BoxMass(const vector<int>& sat, const ColorTables& tb, const Scalar& L, const Scalar& U)
+{
+    int h0 = max(0, (int)L[0]), h1 = min(HIST_H - 1, (int)U[0]);
+    int s0 = max(0, (int)L[1]), s1 = min(HIST_S - 1, (int)U[1]);
+    if (h0 > h1 || s0 > s1) return 0;
+
+    int sum = 0;
+    for (int b = 0; b < (int)tb.vBandRange.size(); b++) {
+        const pair<int, int>& vr = tb.vBandRange[b];
+        if (vr.first < (int)L[2] || vr.second > (int)U[2]) continue;
+        sum += RectSum(sat, b, h0, h1, s0, s1);
+    }
+    return sum;
+}
+
+string ClassifyColorHist(const Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix)
+{
+    outRpix = outGpix = outBpix = 0;
+    if (roiBgr.empty()) return "NONE";
+
+    const int step = max(1, tb.cfg.histStep);
+
+    Mat hsv;
+    if (step == 1) {
+        // mask 모드와 같은 전처리
+        cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+        GaussianBlur(hsv, hsv, Size(3, 3), 0);
+    }
+    else {
+        // 축소는 BGR 에서 면적 평균 (H 는 원형이라 HSV 에서 평균내면 빨강이 깨짐)
+        Mat small;
+        resize(roiBgr, small, Size(max(1, roiBgr.cols / step), max(1, roiBgr.rows / step)), 0, 0, INTER_AREA);
+        cvtColor(small, hsv, COLOR_BGR2HSV);
+    }
+
+    const int bands = (int)tb.vBandRange.size();
+    vector<int> sat((size_t)max(1, bands) * SAT_H * SAT_S, 0);
+
+    // 1) V 구간별 H-S 히스토그램 (1칸씩 밀어서 적재 -> 그대로 누적합)
+    for (int y = 0; y < hsv.rows; y++) {
+        const uchar* p = hsv.ptr<uchar>(y);
+        for (int x = 0; x < hsv.cols; x++, p += 3) {
+            int b = tb.vBand[p[2]];
+            if (b < 0) continue;
+            sat[SatIdx(b, p[0] + 1, p[1] + 1)]++;
+        }
+    }
+
+    // 2) 누적합 표
+    for (int b = 0; b < bands; b++) {
+        for (int h = 1; h < SAT_H; h++) {
+            int rowSum = 0;
+            for (int s = 1; s < SAT_S; s++) {
+                rowSum += sat[SatIdx(b, h, s)];
+                sat[SatIdx(b, h, s)] = sat[SatIdx(b, h - 1, s)] + rowSum;
+            }
+        }
+    }
+
+    // 3) 클래스별 합 (빨강은 R1 u R2 -> 겹치는 부분은 한 번만)
+    const ColorThresholds& th = tb.cfg.th;
+    int r = BoxMass(sat, tb, th.R1.L, th.R1.U) + BoxMass(sat, tb, th.R2.L, th.R2.U);
+    Scalar iL, iU;
+    for (int c = 0; c < 3; c++) {
+        iL[c] = max(th.R1.L[c], th.R2.L[c]);
+        iU[c] = min(th.R1.U[c], th.R2.U[c]);
+    }
+    if (iL[0] <= iU[0] && iL[1] <= iU[1] && iL[2] <= iU[2]) r -= BoxMass(sat, tb, iL, iU);
+
+    int g = BoxMass(sat, tb, th.G.L, th.G.U);
+    int b = BoxMass(sat, tb, th.B.L, th.B.U);
+
+    // 원본 픽셀 단위로 환산 (MIN_COLOR_PIXELS 기준 유지)
+    double sampled = (double)hsv.rows * hsv.cols;
+    double total = (double)roiBgr.rows * roiBgr.cols;
+    double scale = (sampled > 0) ? total / sampled : 0.0;
+
+    outRpix = (int)lround(r * scale);
+    outGpix = (int)lround(g * scale);
+    outBpix = (int)lround(b * scale);
+
+    return DecideColor(outRpix, outGpix, outBpix, total, tb.cfg);
+}
+
+// =====================
+// Object-masked (object 모드)
+// =====================
+string ClassifyColorObject(const Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix,
+    ObjectColorInfo* info)
+{
+    outRpix = outGpix = outBpix = 0;
+    if (info) *info = ObjectColorInfo();
+    if (roiBgr.empty()) return "NONE";
+
+    // 1) HSV 1회 -> 측정 마스크 -> 최대 성분 (VisionWorker 측정과 같은 분할)
+    Mat hsv;
+    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+
+    Mat objMask;
+    BuildMeasureMaskHsv(hsv, tb, objMask);
+
+    thread_local RleLabeler labeler;
+    labeler.Run(objMask);
+    int best = labeler.Largest(tb.cfg.objectMinArea);
+    if (best < 0) return "NONE";
+
+    const ComponentStats& cs = labeler.Components()[best];
+    if (info) {
+        info->found = true;
+        info->bbox = cs.bbox;
+        info->area = (int)cs.area;
+    }
+
+    // 2) 물체 run 위의 픽셀만 색 판별 (bbox 안, 성분 밖 픽셀은 건너뜀)
+    int counts[3] = {};
+    const vector<MaskRun>& runs = labeler.Runs();
+    const vector<int>& runComp = labeler.RunComponents();
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (runComp[i] != best) continue;
+        const MaskRun& r = runs[i];
+        const uchar* p = hsv.ptr<uchar>(r.y) + 3 * r.x0;
+        for (int x = r.x0; x <= r.x1; x++, p += 3) {
+            uint8_t m = tb.lutH[p[0]] & tb.lutS[p[1]] & tb.lutV[p[2]];
+            if (m & 3) counts[0]++;
+            if (m & 4) counts[1]++;
+            if (m & 8) counts[2]++;
+        }
+    }
+
+    outRpix = counts[0];
+    outGpix = counts[1];
+    outBpix = counts[2];
+
+    // 분모 = 물체 픽셀 수
+    ColorConfig rule = tb.cfg;
+    rule.minColorRatio = tb.cfg.objectMinRatio;
+    return DecideColor(outRpix, outGpix, outBpix, (double)cs.area, rule);
+}
+
+void BuildMeasureMask(const Mat& roiBgr, const ColorTables& tb, Mat& outMask)
+{
+    Mat hsv;
+    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
+    BuildMeasureMaskHsv(hsv, tb, outMask);
+}
+
+void BuildMeasureMaskHsv(const Mat& hsv, const ColorTables& tb, Mat& outMask)
+{
+    const ColorThresholds& th = tb.cfg.measureTh;
+
+    Mat maskR1, maskR2, maskG, maskB;
+    inRange(hsv, th.R1.L, th.R1.U, maskR1);
+    inRange(hsv, th.R2.L, th.R2.U, maskR2);
+    inRange(hsv, th.G.L, th.G.U, maskG);
+    inRange(hsv, th.B.L, th.B.U, maskB);
+
+    // 3색 통합
+    Mat mask = maskR1 | maskR2 | maskG | maskB;
+
+    GaussianBlur(mask, outMask, Size(3, 3), 0);
+    threshold(outMask, outMask, 150, 255, THRESH_BINARY);
+
+    morphologyEx(outMask, outMask, MORPH_OPEN, tb.measureKernel, Point(-1, -1), 1);
+    morphologyEx(outMask, outMask, MORPH_CLOSE, tb.measureKernel, Point(-1, -1), 1);
+}
+
+// =====================
+// YUV
+// =====================
+bool WrapYuvFrame(const Mat& raw, YuvLayout layout, int width, int height, YuvFrame& out)
+{
+    if (raw.empty() || width <= 0 || height <= 0 || (width & 1) || (height & 1)) return false;
+
+    out = YuvFrame();
+    out.layout = layout;
+    out.width = width;
+    out.height = height;
+
+    if (layout == YUV_YUYV) {
+        if (raw.type() == CV_8UC2 && raw.rows == height && raw.cols == width) {
+            out.y = raw.data;
+            out.yStride = raw.step;
+            return true;
+        }
+        if (raw.type() == CV_8UC1 && raw.isContinuous() && raw.total() >= (size_t)width * height * 2) {
+            out.y = raw.data;
+            out.yStride = (size_t)width * 2;
+            return true;
+        }
+        return false;
+    }
+
+    if (raw.type() == CV_8UC1 && raw.rows == height * 3 / 2 && raw.cols == width) {
+        out.y = raw.data;
+        out.yStride = raw.step;
+        out.uv = raw.data + raw.step * height;
+        out.uvStride = raw.step;
+        return true;
+    }
+    if (raw.type() == CV_8UC1 && raw.isContinuous() && raw.total() >= (size_t)width * height * 3 / 2) {
+        out.y = raw.data;
+        out.yStride = (size_t)width;
+        out.uv = raw.data + (size_t)width * height;
+        out.uvStride = (size_t)width;
+        return true;
+    }
+    return false;
+}
+
+Rect AlignYuvRoi(const YuvFrame& f, const Rect& roi)
+{
+    Rect r = roi & Rect(0, 0, f.width, f.height);
+    if (r.width <= 0 || r.height <= 0) return Rect();
+
+    int x0 = r.x & ~1, y0 = r.y & ~1;
+    int x1 = min(f.width, (r.x + r.width + 1) & ~1);
+    int y1 = min(f.height, (r.y + r.height + 1) & ~1);
+    return Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+// (U,V) 의 클래스 c 에 Y 두 개 중 몇 개가 들어가는지
+static inline int CountY2(int y0, int y1, const UvYRange& e, const UvYMask* masks, int c)
+{
+    if (e.split) {
+        const uint64_t* b = masks[e.split - 1].bits[c];
+        return (int)((b[y0 >> 6] >> (y0 & 63)) & 1) + (int)((b[y1 >> 6] >> (y1 & 63)) & 1);
+    }
+    return (y0 >= e.lo[c] && y0 <= e.hi[c]) + (y1 >= e.lo[c] && y1 <= e.hi[c]);
+}
+
+string ClassifyColorYuv(const YuvFrame& f, const Rect& roi, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix)
+{
+    outRpix = outGpix = outBpix = 0;
+    Rect r = AlignYuvRoi(f, roi);
+    if (r.width <= 0 || r.height <= 0 || tb.uvRange.size() != 256 * 256) return "NONE";
+
+    const UvYRange* lut = tb.uvRange.data();
+    const UvYMask* masks = tb.uvYMask.data();
+    int cnt[3] = { 0, 0, 0 };
+
+    for (int y = r.y; y < r.y + r.height; y++) {
+        if (f.layout == YUV_YUYV) {
+            const uint8_t* p = f.y + f.yStride * y + (size_t)r.x * 2;
+            for (int x = 0; x < r.width; x += 2, p += 4) {
+                const UvYRange& e = lut[(size_t)p[1] << 8 | p[3]];
+                for (int c = 0; c < 3; c++) cnt[c] += CountY2(p[0], p[2], e, masks, c);
+            }
+        }
+        else {
+            const uint8_t* py = f.y + f.yStride * y + r.x;
+            const uint8_t* puv = f.uv + f.uvStride * (y >> 1) + r.x;
+            for (int x = 0; x < r.width; x += 2, py += 2, puv += 2) {
+                const UvYRange& e = lut[(size_t)puv[0] << 8 | puv[1]];
+                for (int c = 0; c < 3; c++) cnt[c] += CountY2(py[0], py[1], e, masks, c);
+            }
+        }
+    }
+
+    outRpix = cnt[0];
+    outGpix = cnt[1];
+    outBpix = cnt[2];
+    return DecideColor(outRpix, outGpix, outBpix, (double)r.area(), tb.cfg);
+}
+
+void CopyYuvRoi(const YuvFrame& f, const Rect& roi, Mat& packed)
+{
+    Rect r = AlignYuvRoi(f, roi);
+    if (r.width <= 0 || r.height <= 0) {
+        packed.release();
+        return;
+    }
+
+    if (f.layout == YUV_YUYV) {
+        packed.create(r.height, r.width, CV_8UC2);
+        for (int y = 0; y < r.height; y++)
+            memcpy(packed.ptr<uchar>(y), f.y + f.yStride * (r.y + y) + (size_t)r.x * 2, (size_t)r.width * 2);
+        return;
+    }
+
+    // NV12: Y 행 h 개 + UV 행 h/2 개를 한 장에 (COLOR_YUV2BGR_NV12 입력 형식)
+    packed.create(r.height * 3 / 2, r.width, CV_8UC1);
+    for (int y = 0; y < r.height; y++)
+        memcpy(packed.ptr<uchar>(y), f.y + f.yStride * (r.y + y) + r.x, (size_t)r.width);
+    for (int y = 0; y < r.height / 2; y++)
+        memcpy(packed.ptr<uchar>(r.height + y), f.uv + f.uvStride * (r.y / 2 + y) + r.x, (size_t)r.width);
+}
+
+int YuvToBgrCode(YuvLayout layout)
+{
+    return (layout == YUV_YUYV) ? COLOR_YUV2BGR_YUYV : COLOR_YUV2BGR_NV12;
+}
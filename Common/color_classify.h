@@ -0,0 +1,88 @@
+﻿#pragma once
+
+// color_classify.h
+// - 색상 판별 / 측정용 마스크 (ColorWorker, VisionWorker 공용)
+// - 임계값, 구조요소는 ColorTables 스냅샷에서 가져온다 (color_config.h)
+
+#include "color_config.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+
+// HSV -> R/G/B 마스크 (open 1회 + close 2회), 마스크마다 따로
+void BuildMasksRGB(const cv::Mat& hsv, cv::Mat& maskR, cv::Mat& maskG, cv::Mat& maskB, const ColorTables& tb);
+
+// 위와 같은 결과를 비트 평면 1장으로: bit0=R, bit1=G, bit2=B
+void BuildPackedRGB(const cv::Mat& hsv, cv::Mat& packed, const ColorTables& tb);
+
+// R/G/B 픽셀 수 -> 색. 가장 많은 색이 나머지보다 엄격히 많고 minColorPixels / minColorRatio
+// (totalPixels 대비) 를 넘어야 인정, 아니면 "NONE" (모든 판별 모드 공통 규칙)
+std::string DecideColor(int rPix, int gPix, int bPix, double totalPixels, const ColorConfig& cfg);
+
+// ROI 에서 가장 많은 색 -> "RED"/"GREEN"/"BLUE", 기준 미달이면 "NONE"
+// tb.cfg.classifyMode 에 따라 아래 둘 중 하나로 분기
+std::string ClassifyColorROI(const cv::Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix);
+
+// mask 모드: 비트 평면 마스크 + open/close 후 개수
+std::string ClassifyColorMasks(const cv::Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix);
+
+// mask_ref 모드: 클래스별 마스크 3장 (기존 방식, 비교/대조용)
+std::string ClassifyColorMasksRef(const cv::Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix);
+
+// hist 모드: V 구간별 H-S 히스토그램 1회 -> 누적합 표에서 임계 사각형 합
+// (histStep > 1 이면 축소 영상에서 세고, 개수는 원본 픽셀 단위로 환산)
+std::string ClassifyColorHist(const cv::Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix);
+
+// object 모드 부가 정보 (--compare / 로그용)
+struct ObjectColorInfo {
+    bool found = false;  // 물체(면적 objectMinArea 이상) 있음
+    cv::Rect bbox;       // ROI 좌표
+    int area = 0;        // 물체 픽셀 수 = 판별에 쓴 픽셀 수
+};
+
+// object 모드: 측정 마스크(measureTh)로 물체를 한 번 분할 -> 최대 성분의 픽셀만으로 R/G/B 집계
+// (벨트/배경 픽셀이 분모에 안 들어가므로 비율 기준은 objectMinRatio 를 따로 씀)
+std::string ClassifyColorObject(const cv::Mat& roiBgr, const ColorTables& tb, int& outRpix, int& outGpix, int& outBpix,
+    ObjectColorInfo* info = nullptr);
+
+// 측정용 3색 통합 마스크 (blur + threshold + open/close), findContours 입력
+void BuildMeasureMask(const cv::Mat& roiBgr, const ColorTables& tb, cv::Mat& outMask);
+void BuildMeasureMaskHsv(const cv::Mat& hsv, const ColorTables& tb, cv::Mat& outMask);
+
+// =====================
+// YUV 판별 (카메라 YUYV / NV12 버퍼를 BGR/HSV 변환 없이)
+// - (U,V) 1쌍 = 가로 2픽셀 -> tb.uvRange 로 클래스별 Y 구간을 한 번 찾고, 두 Y 만 비교
+// - 모폴로지 없음 (hist 모드와 같은 "임계 안 픽셀 수")
+// =====================
+enum YuvLayout {
+    YUV_YUYV = 0, // Y0 U Y1 V (4:2:2)
+    YUV_NV12 = 1, // Y 평면 + UV 교차 평면 (4:2:0)
+};
+
+struct YuvFrame {
+    YuvLayout layout = YUV_YUYV;
+    int width = 0;
+    int height = 0;
+    const uint8_t* y = nullptr;  // YUYV: 패킹된 버퍼 시작
+    size_t yStride = 0;
+    const uint8_t* uv = nullptr; // NV12 만
+    size_t uvStride = 0;
+};
+
+// VideoCapture 가 준 raw Mat -> YuvFrame (버퍼는 복사하지 않음, raw 가 살아있는 동안 유효)
+// YUYV: CV_8UC2 h x w 또는 연속 CV_8UC1 (w*h*2 바이트)
+// NV12: CV_8UC1 (h*3/2) x w 또는 연속 CV_8UC1 (w*h*3/2 바이트)
+bool WrapYuvFrame(const cv::Mat& raw, YuvLayout layout, int width, int height, YuvFrame& out);
+
+// ROI 를 짝수 좌표/크기로 맞추고 프레임 안으로 자름 (크로마 샘플 경계)
+cv::Rect AlignYuvRoi(const YuvFrame& f, const cv::Rect& roi);
+
+std::string ClassifyColorYuv(const YuvFrame& f, const cv::Rect& roi, const ColorTables& tb,
+    int& outRpix, int& outGpix, int& outBpix);
+
+// ROI 만 YUV 그대로 복사 (증거 이미지용, 변환은 나중에 워커 스레드에서)
+// 결과는 cvtColor(packed, bgr, YuvToBgrCode(layout)) 로 바로 변환 가능한 형태
+void CopyYuvRoi(const YuvFrame& f, const cv::Rect& roi, cv::Mat& packed);
+int YuvToBgrCode(YuvLayout layout);
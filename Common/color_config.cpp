@@ -0,0 +1,486 @@
+﻿#include "color_config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// =====================
+// YAML 읽기/쓰기
+// =====================
+static bool ReadScalar3(const FileNode& n, Scalar& out)
+{
+    if (n.empty()) return true; // 키 없음 -> 기존 값 유지
+    if (!n.isSeq() || n.size() != 3) return false;
+    out = Scalar((double)n[0], (double)n[1], (double)n[2]);
+    return true;
+}
+
+static bool ReadRange(const FileNode& n, HsvRange& r)
+{
+    if (n.empty()) return true;
+    return ReadScalar3(n["L"], r.L) && ReadScalar3(n["U"], r.U);
+}
+
+static bool ReadThresholds(const FileNode& n, ColorThresholds& th)
+{
+    if (n.empty()) return true;
+    return ReadRange(n["R1"], th.R1) && ReadRange(n["R2"], th.R2)
+        && ReadRange(n["G"], th.G) && ReadRange(n["B"], th.B);
+}
+
+static void ReadInt(const FileNode& n, int& v) { if (!n.empty()) v = (int)n; }
+static void ReadString(const FileNode& n, string& v) { if (!n.empty()) v = (string)n; }
+static void ReadDouble(const FileNode& n, double& v) { if (!n.empty()) v = (double)n; }
+
+static bool ValidRange(const HsvRange& r)
+{
+    const double hi[3] = { 179, 255, 255 };
+    for (int c = 0; c < 3; c++) {
+        if (r.L[c] < 0 || r.U[c] > hi[c] || r.L[c] > r.U[c]) return false;
+    }
+    return true;
+}
+
+static bool ValidThresholds(const ColorThresholds& th)
+{
+    return ValidRange(th.R1) && ValidRange(th.R2) && ValidRange(th.G) && ValidRange(th.B);
+}
+
+const char* ClassifyModeName(int mode)
+{
+    switch (mode) {
+    case CLASSIFY_HIST: return "hist";
+    case CLASSIFY_MASK_REF: return "mask_ref";
+    case CLASSIFY_OBJECT: return "object";
+    default: return "mask";
+    }
+}
+
+ColorConfig DefaultColorWorkerConfig()
+{
+    ColorConfig c;
+    c.th.R1 = { Scalar(0,   60,  40), Scalar(12,  255, 255) };
+    c.th.R2 = { Scalar(168, 60,  40), Scalar(179, 255, 255) };
+    c.th.G = { Scalar(30,  40,  40), Scalar(95,  255, 255) };
+    c.th.B = { Scalar(85,  40,  40), Scalar(140, 255, 255) };
+    c.minColorPixels = 100;
+    c.minColorRatio = 0.01;
+    c.morphSize = 5;
+
+    c.measureTh.R1 = { Scalar(0,   60, 60), Scalar(20,  255, 255) };
+    c.measureTh.R2 = { Scalar(160, 60, 60), Scalar(179, 255, 255) };
+    c.measureTh.G = { Scalar(40,  60, 60), Scalar(85,  255, 255) };
+    c.measureTh.B = { Scalar(95,  60, 60), Scalar(125, 255, 255) };
+    return c;
+}
+
+static bool ValidMorph(int k) { return k >= 1 && k <= 31 && (k % 2) == 1; }
+
+bool LoadColorConfig(const string& path, ColorConfig& cfg, string& err)
+{
+    if (!filesystem::exists(path)) {
+        err = "file not found";
+        return false;
+    }
+
+    ColorConfig c = cfg;
+    try {
+        FileStorage fs(path, FileStorage::READ);
+        if (!fs.isOpened()) {
+            err = "open failed";
+            return false;
+        }
+
+        bool ok = ReadThresholds(fs["color_thresholds"], c.th)
+            && ReadThresholds(fs["measure_thresholds"], c.measureTh);
+        if (!ok) {
+            err = "HSV range must be [h, s, v]";
+            return false;
+        }
+
+        ReadInt(fs["min_color_pixels"], c.minColorPixels);
+        ReadDouble(fs["min_color_ratio"], c.minColorRatio);
+        ReadInt(fs["morph_size"], c.morphSize);
+
+        string mode = ClassifyModeName(c.classifyMode);
+        ReadString(fs["classify_mode"], mode);
+        if (mode == "mask") c.classifyMode = CLASSIFY_MASK;
+        else if (mode == "hist") c.classifyMode = CLASSIFY_HIST;
+        else if (mode == "mask_ref") c.classifyMode = CLASSIFY_MASK_REF;
+        else if (mode == "object") c.classifyMode = CLASSIFY_OBJECT;
+        else {
+            err = "classify_mode must be mask|hist|mask_ref|object (got " + mode + ")";
+            return false;
+        }
+        ReadInt(fs["hist_step"], c.histStep);
+        ReadDouble(fs["object_min_area"], c.objectMinArea);
+        ReadDouble(fs["object_min_ratio"], c.objectMinRatio);
+        ReadInt(fs["measure_morph_size"], c.measureMorphSize);
+        ReadDouble(fs["min_box_area"], c.minBoxArea);
+        fs.release();
+    }
+    catch (const cv::Exception& e) {
+        err = string("parse error: ") + e.what();
+        return false;
+    }
+
+    if (!ValidThresholds(c.th) || !ValidThresholds(c.measureTh)) { err = "HSV range out of bounds (H 0~179, S/V 0~255, L<=U)"; return false; }
+    if (!ValidMorph(c.morphSize) || !ValidMorph(c.measureMorphSize)) { err = "morph size must be odd 1~31"; return false; }
+    if (c.minColorPixels < 0 || c.minColorRatio < 0.0 || c.minColorRatio > 1.0) { err = "min_color_pixels/min_color_ratio out of range"; return false; }
+    if (c.minBoxArea < 0.0) { err = "min_box_area < 0"; return false; }
+    if (c.histStep < 1 || c.histStep > 8) { err = "hist_step must be 1~8"; return false; }
+    if (c.objectMinArea < 0.0 || c.objectMinRatio < 0.0 || c.objectMinRatio > 1.0) { err = "object_min_area/object_min_ratio out of range"; return false; }
+
+    cfg = c;
+    return true;
+}
+
+static void WriteRange(FileStorage& fs, const char* name, const HsvRange& r)
+{
+    fs << name << "{:"
+        << "L" << "[:" << (int)r.L[0] << (int)r.L[1] << (int)r.L[2] << "]"
+        << "U" << "[:" << (int)r.U[0] << (int)r.U[1] << (int)r.U[2] << "]"
+        << "}";
+}
+
+static void WriteThresholds(FileStorage& fs, const char* name, const ColorThresholds& th)
+{
+    fs << name << "{";
+    WriteRange(fs, "R1", th.R1);
+    WriteRange(fs, "R2", th.R2);
+    WriteRange(fs, "G", th.G);
+    WriteRange(fs, "B", th.B);
+    fs << "}";
+}
+
+bool SaveColorConfig(const string& path, const ColorConfig& cfg)
+{
+    // FileStorage 는 확장자로 포맷을 정하므로 tmp 도 .yaml 로 끝나게
+    string tmp = path + ".tmp.yaml";
+    try {
+        FileStorage fs(tmp, FileStorage::WRITE);
+        if (!fs.isOpened()) return false;
+
+        WriteThresholds(fs, "color_thresholds", cfg.th);
+        fs << "min_color_pixels" << cfg.minColorPixels;
+        fs << "min_color_ratio" << cfg.minColorRatio;
+        fs << "morph_size" << cfg.morphSize;
+        fs << "classify_mode" << string(ClassifyModeName(cfg.classifyMode));
+        fs << "hist_step" << cfg.histStep;
+        fs << "object_min_area" << cfg.objectMinArea;
+        fs << "object_min_ratio" << cfg.objectMinRatio;
+
+        WriteThresholds(fs, "measure_thresholds", cfg.measureTh);
+        fs << "measure_morph_size" << cfg.measureMorphSize;
+        fs << "min_box_area" << cfg.minBoxArea;
+        fs.release();
+    }
+    catch (const cv::Exception&) {
+        ::remove(tmp.c_str());
+        return false;
+    }
+
+    ::remove(path.c_str());
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void BuildChannelLuts(const ColorThresholds& th, ColorTables& tb)
+{
+    const HsvRange* rs[4] = { &th.R1, &th.R2, &th.G, &th.B };
+    uint8_t* luts[3] = { tb.lutH, tb.lutS, tb.lutV };
+
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) {
+            uint8_t bits = 0;
+            for (int k = 0; k < 4; k++) {
+                if (v >= rs[k]->L[c] && v <= rs[k]->U[c]) bits |= (uint8_t)(1 << k);
+            }
+            luts[c][v] = bits;
+        }
+    }
+}
+
+static void BuildVBands(const ColorThresholds& th, ColorTables& tb)
+{
+    const HsvRange* rs[4] = { &th.R1, &th.R2, &th.G, &th.B };
+
+    // 모든 클래스의 V 경계(L, U+1)로 자르기
+    vector<int> cuts = { 0, 256 };
+    for (const HsvRange* r : rs) {
+        cuts.push_back((int)r->L[2]);
+        cuts.push_back((int)r->U[2] + 1);
+    }
+    sort(cuts.begin(), cuts.end());
+    cuts.erase(unique(cuts.begin(), cuts.end()), cuts.end());
+
+    tb.vBandRange.clear();
+    for (int v = 0; v < 256; v++) tb.vBand[v] = -1;
+
+    for (size_t i = 0; i + 1 < cuts.size(); i++) {
+        int lo = cuts[i], hi = cuts[i + 1] - 1;
+        if (lo > 255) break;
+
+        bool used = false;
+        for (const HsvRange* r : rs) {
+            if (lo >= (int)r->L[2] && hi <= (int)r->U[2]) { used = true; break; }
+        }
+        if (!used) continue;
+
+        int8_t band = (int8_t)tb.vBandRange.size();
+        tb.vBandRange.push_back({ lo, hi });
+        for (int v = lo; v <= hi; v++) tb.vBand[v] = band;
+    }
+}
+
+// OpenCV YUV2BGR (YUYV/NV12 공통, BT.601 limited range) 와 같은 정수 연산
+static const int BT601_CY = 1220542;
+static const int BT601_CUB = 2116026;
+static const int BT601_CUG = -409993;
+static const int BT601_CVG = -852492;
+static const int BT601_CVR = 1673527;
+static const int BT601_SHIFT = 20;
+
+// OpenCV BGR2HSV (8비트, H 0~179) 와 같은 정수 연산
+static const int HSV_SHIFT = 12;
+
+static inline int Sat8(int v) { return v < 0 ? 0 : (v > 255 ? 255 : v); }
+
+static void BuildUvTable(ColorTables& tb)
+{
+    int sdiv[256], hdiv[256];
+    sdiv[0] = hdiv[0] = 0;
+    for (int i = 1; i < 256; i++) {
+        sdiv[i] = (int)lrint((255 << HSV_SHIFT) / (1.0 * i));
+        hdiv[i] = (int)lrint((180 << HSV_SHIFT) / (6.0 * i));
+    }
+
+    tb.uvRange.assign(256 * 256, UvYRange());
+    tb.uvYMask.clear();
+
+    for (int u = 0; u < 256; u++) {
+        for (int v = 0; v < 256; v++) {
+            const int uu = u - 128, vv = v - 128;
+            const int ruv = (1 << (BT601_SHIFT - 1)) + BT601_CVR * vv;
+            const int guv = (1 << (BT601_SHIFT - 1)) + BT601_CVG * vv + BT601_CUG * uu;
+            const int buv = (1 << (BT601_SHIFT - 1)) + BT601_CUB * uu;
+
+            int first[3] = { -1, -1, -1 }, last[3] = { -1, -1, -1 }, hits[3] = { 0, 0, 0 };
+            UvYMask mask = {};
+            for (int yv = 0; yv < 256; yv++) {
+                const int yy = max(0, yv - 16) * BT601_CY;
+                const int r = Sat8((yy + ruv) >> BT601_SHIFT);
+                const int g = Sat8((yy + guv) >> BT601_SHIFT);
+                const int b = Sat8((yy + buv) >> BT601_SHIFT);
+
+                const int vmax = max(b, max(g, r));
+                const int vmin = min(b, min(g, r));
+                const int diff = vmax - vmin;
+                const int s = (diff * sdiv[vmax] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+                int h = (vmax == r) ? (g - b) : ((vmax == g) ? (b - r + 2 * diff) : (r - g + 4 * diff));
+                h = (h * hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+                if (h < 0) h += 180;
+
+                const uint8_t m = tb.lutH[h] & tb.lutS[s] & tb.lutV[vmax];
+                const bool cls[3] = { (m & 3) != 0, (m & 4) != 0, (m & 8) != 0 };
+                for (int c = 0; c < 3; c++) {
+                    if (!cls[c]) continue;
+                    if (first[c] < 0) first[c] = yv;
+                    last[c] = yv;
+                    hits[c]++;
+                    mask.bits[c][yv >> 6] |= 1ull << (yv & 63);
+                }
+            }
+
+            UvYRange& e = tb.uvRange[(size_t)u << 8 | v];
+            e.split = 0;
+            bool split = false;
+            for (int c = 0; c < 3; c++) {
+                if (first[c] < 0) { e.lo[c] = 1; e.hi[c] = 0; continue; }
+                e.lo[c] = (uint8_t)first[c];
+                e.hi[c] = (uint8_t)last[c];
+                if (hits[c] != last[c] - first[c] + 1) split = true;
+            }
+            if (split && tb.uvYMask.size() < 0xFFFF) {
+                tb.uvYMask.push_back(mask);
+                e.split = (uint16_t)tb.uvYMask.size();
+            }
+        }
+    }
+}
+
+shared_ptr<const ColorTables> BuildColorTables(const ColorConfig& cfg, uint64_t version, bool withYuv)
+{
+    auto tb = make_shared<ColorTables>();
+    tb->cfg = cfg;
+    tb->colorKernel = getStructuringElement(MORPH_RECT, Size(cfg.morphSize, cfg.morphSize));
+    tb->measureKernel = getStructuringElement(MORPH_RECT, Size(cfg.measureMorphSize, cfg.measureMorphSize));
+    BuildChannelLuts(cfg.th, *tb);
+    BuildVBands(cfg.th, *tb);
+    if (withYuv) BuildUvTable(*tb);
+    tb->version = version;
+    return tb;
+}
+
+// =====================
+// Watcher
+// =====================
+ColorConfigWatcher::ColorConfigWatcher(const string& path, const ColorConfig& defaults, bool withYuv)
+    : path_(path), defaults_(defaults), withYuv_(withYuv)
+{
+    atomic_store(&cur_, BuildColorTables(defaults_, version_, withYuv_));
+}
+
+ColorConfigWatcher::~ColorConfigWatcher()
+{
+    Stop();
+}
+
+void ColorConfigWatcher::Start()
+{
+    if (!filesystem::exists(path_)) {
+        // 처음 실행: 현재 기본값으로 파일을 만들어 둔다 (튜닝 시작점)
+        if (SaveColorConfig(path_, defaults_)) cout << "[CONFIG] created " << path_ << " (defaults)\n";
+        else cerr << "[CONFIG] cannot create " << path_ << " -> using built-in defaults\n";
+    }
+    Reload("startup");
+
+    stop_ = false;
+    th_ = thread(&ColorConfigWatcher::Run, this);
+}
+
+void ColorConfigWatcher::Stop()
+{
+    stop_ = true;
+    if (th_.joinable()) th_.join();
+}
+
+void ColorConfigWatcher::Reload(const char* why)
+{
+    ColorConfig cfg = defaults_;
+    string err;
+    if (!LoadColorConfig(path_, cfg, err)) {
+        cerr << "[CONFIG] " << path_ << " rejected (" << why << "): " << err
+            << " -> keep v" << Current()->version << "\n";
+        return;
+    }
+
+    // 파생 테이블은 이 스레드에서 만들고, 완성된 것만 교체
+    auto tb = BuildColorTables(cfg, ++version_, withYuv_);
+    atomic_store(&cur_, tb);
+
+    const ColorConfig& c = tb->cfg;
+    cout << "[CONFIG] v" << tb->version << " applied (" << why << ")"
+        << " minPix=" << c.minColorPixels
+        << " minRatio=" << c.minColorRatio
+        << " morph=" << c.morphSize
+        << " mode=" << ClassifyModeName(c.classifyMode)
+        << " histStep=" << c.histStep
+        << " measureMorph=" << c.measureMorphSize
+        << " minBoxArea=" << c.minBoxArea << "\n";
+}
+
+static bool FileStamp(const string& path, filesystem::file_time_type& t, uintmax_t& sz)
+{
+    error_code ec;
+    t = filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    sz = filesystem::file_size(path, ec);
+    return !ec;
+}
+
+void ColorConfigWatcher::Run()
+{
+    // 저장 도중(부분 쓰기) 읽는 것을 피하기 위한 짧은 대기
+    const auto settle = chrono::milliseconds(50);
+
+    filesystem::path p(path_);
+    string dir = p.has_parent_path() ? p.parent_path().string() : string(".");
+    string name = p.filename().string();
+
+    filesystem::file_time_type lastT{};
+    uintmax_t lastSz = 0;
+    FileStamp(path_, lastT, lastSz);
+
+    auto changedOnDisk = [&]() {
+        filesystem::file_time_type t{};
+        uintmax_t sz = 0;
+        if (!FileStamp(path_, t, sz)) return false;
+        if (t == lastT && sz == lastSz) return false;
+        lastT = t;
+        lastSz = sz;
+        return true;
+    };
+
+#if defined(__linux__)
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0) {
+        alignas(inotify_event) char buf[4096];
+        while (!stop_) {
+            pollfd pfd{ fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 200) <= 0) continue;
+
+            bool hit = false;
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0) {
+                for (char* q = buf; q < buf + n;) {
+                    inotify_event* ev = (inotify_event*)q;
+                    if (ev->len > 0 && name == ev->name) hit = true;
+                    q += sizeof(inotify_event) + ev->len;
+                }
+            }
+            if (!hit) continue;
+
+            this_thread::sleep_for(settle);
+            if (changedOnDisk()) Reload("inotify");
+        }
+        close(fd);
+        return;
+    }
+    if (fd >= 0) close(fd);
+    cerr << "[CONFIG] inotify unavailable -> polling\n";
+#elif defined(_WIN32)
+    HANDLE h = FindFirstChangeNotificationA(dir.c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+    if (h != INVALID_HANDLE_VALUE) {
+        while (!stop_) {
+            if (WaitForSingleObject(h, 200) != WAIT_OBJECT_0) continue;
+            FindNextChangeNotification(h);
+
+            this_thread::sleep_for(settle);
+            if (changedOnDisk()) Reload("change");
+        }
+        FindCloseChangeNotification(h);
+        return;
+    }
+    cerr << "[CONFIG] change notification unavailable -> polling\n";
+#endif
+
+    while (!stop_) {
+        this_thread::sleep_for(chrono::milliseconds(500));
+        if (changedOnDisk()) Reload("poll");
+    }
+}
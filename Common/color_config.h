@@ -0,0 +1,134 @@
+﻿#pragma once
+
+// color_config.h
+// - 색상/측정 HSV 임계값을 설정 파일(YAML, cv::FileStorage)에서 읽는다.
+// - 파일이 바뀌면 백그라운드 스레드가 다시 읽고 파생 테이블(구조요소 등)을 새로 만든 뒤
+//   shared_ptr 을 원자적으로 교체한다. 워커는 프레임마다 Current() 로 스냅샷만 가져간다.
+//   (핫패스는 파일 IO/재계산을 절대 기다리지 않음, 다음 프레임부터 적용)
+// - 감시: Linux = inotify, Windows = FindFirstChangeNotification, 그 외 = mtime 폴링
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HsvRange { cv::Scalar L; cv::Scalar U; };
+
+struct ColorThresholds {
+    HsvRange R1;
+    HsvRange R2;
+    HsvRange G;
+    HsvRange B;
+};
+
+// 색상 판별 방식
+enum ClassifyMode {
+    CLASSIFY_MASK = 0,     // R/G/B 비트 평면 1장 + open/close 1회 (CLASSIFY_MASK_REF 와 결과 동일)
+    CLASSIFY_HIST = 1,     // H-S 히스토그램 1회 + 임계 사각형 합 (모폴로지 없음)
+    CLASSIFY_MASK_REF = 2, // 클래스별 마스크 3장 + 각각 open/close + countNonZero (기존 방식)
+    CLASSIFY_OBJECT = 3,   // 물체 분할(측정 마스크 최대 성분) 후 물체 픽셀만 집계
+};
+
+struct ColorConfig {
+    // 색상 판별 (ClassifyColorROI)
+    ColorThresholds th;
+    int minColorPixels = 100;
+    double minColorRatio = 0.01;
+    int morphSize = 5;          // open/close 사각 커널 크기 (mask / mask_ref 모드)
+    int classifyMode = CLASSIFY_MASK;
+    int histStep = 1;           // hist 모드 다운샘플 (1 = 전체 픽셀, 2 = 1/4 ...)
+    double objectMinArea = 2000.0; // object 모드: 물체로 인정할 최소 픽셀 수
+    double objectMinRatio = 0.3;   // object 모드: 최다 색 픽셀 / 물체 픽셀
+
+    // 측정용 분할 (VisionWorker: 3색 통합 마스크 -> 가장 큰 컨투어)
+    ColorThresholds measureTh;
+    int measureMorphSize = 3;
+    double minBoxArea = 2000.0; // px^2
+};
+
+// YUV 판별용: (U,V) 한 쌍에 대해 클래스(R,G,B)별로 조건을 만족하는 Y 구간 (lo > hi = 없음)
+// U,V 가 같으면 Y 가 바뀌어도 R,G,B 가 같은 양만큼 움직이므로 H 는 거의 그대로, V 는 증가, S 는 감소
+// -> 대부분 한 구간. 반올림 때문에 끊기는 (U,V) 만 split 번호로 Y 비트마스크(uvYMask)를 따로 둔다
+struct UvYRange {
+    uint8_t lo[3];
+    uint8_t hi[3];
+    uint16_t split; // 0 = 구간으로 충분, n = uvYMask[n - 1]
+};
+
+struct UvYMask {
+    uint64_t bits[3][4]; // 클래스별 Y 0~255
+};
+
+// 설정으로부터 미리 계산해 두는 값들 (백그라운드에서 생성, 생성 후 읽기 전용)
+struct ColorTables {
+    ColorConfig cfg;
+    cv::Mat colorKernel;   // morphSize x morphSize
+    cv::Mat measureKernel; // measureMorphSize x measureMorphSize
+
+    // mask 모드: 채널 값 -> 그 채널 범위를 만족하는 하위 클래스 비트 (R1,R2,G,B = bit0~3)
+    // lutH[h] & lutS[s] & lutV[v] = inRange 4개 결과를 한 번에
+    uint8_t lutH[256] = {};
+    uint8_t lutS[256] = {};
+    uint8_t lutV[256] = {};
+
+    // hist 모드: 클래스 V 경계로 0~255 를 나눈 구간.
+    // 각 구간은 어떤 클래스의 V 범위에 완전히 포함되거나 완전히 벗어나므로
+    // 구간별 H-S 히스토그램의 사각형 합 = inRange 개수와 정확히 같다.
+    int8_t vBand[256] = {};                      // V -> 구간 번호 (-1 = 어느 클래스에도 없음)
+    std::vector<std::pair<int, int>> vBandRange; // 구간 번호 -> [lo, hi]
+
+    // YUV 모드: index = U << 8 | V. OpenCV YUV2BGR(BT.601 정수 연산) -> BGR2HSV -> inRange 를
+    // Y 0~255 전부에 대해 미리 돌려 둔 결과 (카메라 YUYV/NV12 를 변환 없이 판별)
+    // (BuildColorTables(..., withYuv=true) 일 때만 채움, 비어 있으면 YUV 판별 불가)
+    std::vector<UvYRange> uvRange;
+    std::vector<UvYMask> uvYMask;
+    uint64_t version = 0;  // 교체될 때마다 +1
+};
+
+// "mask" / "hist" / "mask_ref" / "object" (color_config.yaml 의 classify_mode 값)
+const char* ClassifyModeName(int mode);
+
+// ColorWorker 기본 임계값 (color_config.yaml 이 없을 때). ColorTuner / ColorBench 의 시작점도 이것
+// 측정용 범위(measureTh)는 ColorWorker 가 쓰지 않지만 파일을 공유할 수 있도록 VisionWorker 값과 맞춤
+ColorConfig DefaultColorWorkerConfig();
+
+// path 의 키만 덮어쓰기 (없는 키는 cfg 값 유지). 값이 이상하면 false + err
+bool LoadColorConfig(const std::string& path, ColorConfig& cfg, std::string& err);
+
+bool SaveColorConfig(const std::string& path, const ColorConfig& cfg);
+
+// withYuv: uvRange 도 만든다 (Y 0~255 x U,V 전체, 수백 ms -> YUV 캡처를 쓸 때만)
+std::shared_ptr<const ColorTables> BuildColorTables(const ColorConfig& cfg, uint64_t version, bool withYuv = false);
+
+class ColorConfigWatcher {
+public:
+    // defaults: 워커별 기본값 (파일이 없거나 키가 빠졌을 때)
+    // withYuv: 테이블마다 YUV 판별용 uvRange 도 만든다 (BuildColorTables 참고)
+    ColorConfigWatcher(const std::string& path, const ColorConfig& defaults, bool withYuv = false);
+    ~ColorConfigWatcher();
+
+    // 최초 1회 동기 로드 + 감시 스레드 시작
+    void Start();
+    void Stop();
+
+    // 프레임마다 호출: 현재 테이블 스냅샷 (대기 없음)
+    std::shared_ptr<const ColorTables> Current() const { return std::atomic_load(&cur_); }
+
+    const std::string& Path() const { return path_; }
+
+private:
+    void Reload(const char* why);
+    void Run();
+
+    std::string path_;
+    ColorConfig defaults_;
+    bool withYuv_;
+    std::shared_ptr<const ColorTables> cur_;
+    std::atomic<bool> stop_{ false };
+    std::thread th_;
+    uint64_t version_ = 0;
+};
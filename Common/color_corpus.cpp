@@ -0,0 +1,69 @@
+﻿#include "color_corpus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+const char* const TRUTH_NAMES[4] = { "RED", "GREEN", "BLUE", "NONE" };
+
+int TruthFromCaptureName(const string& fileName)
+{
+    const string pre = "color_";
+    if (fileName.compare(0, pre.size(), pre) != 0 || fileName.size() <= pre.size()) return -1;
+    switch (fileName[pre.size()]) {
+    case 'r': return TRUTH_RED;
+    case 'g': return TRUTH_GREEN;
+    case 'b': return TRUTH_BLUE;
+    case 'n': return TRUTH_NONE;
+    default: return -1;
+    }
+}
+
+int TruthFromColor(const string& color)
+{
+    for (int i = 0; i < 4; i++)
+        if (color == TRUTH_NAMES[i]) return i;
+    return TRUTH_NONE;
+}
+
+bool LoadColorCorpus(const vector<string>& dirs, int threads, vector<CorpusImage>& out,
+    const char* logTag, const function<void(CorpusImage&)>& prepare)
+{
+    vector<filesystem::path> files;
+    for (const string& dir : dirs) {
+        error_code ec;
+        for (const auto& e : filesystem::directory_iterator(dir, ec)) {
+            if (!e.is_regular_file() || e.path().extension() != ".jpg") continue;
+            if (TruthFromCaptureName(e.path().filename().string()) < 0) continue;
+            files.push_back(e.path());
+        }
+        if (ec) cerr << logTag << " cannot read " << dir << ": " << ec.message() << "\n";
+    }
+    sort(files.begin(), files.end());
+
+    out.assign(files.size(), CorpusImage());
+    atomic<size_t> next{ 0 };
+    vector<thread> pool;
+    for (int t = 0; t < max(1, threads); t++) {
+        pool.emplace_back([&]() {
+            for (size_t i = next++; i < files.size(); i = next++) {
+                CorpusImage& im = out[i];
+                im.path = files[i].string();
+                im.name = files[i].filename().string();
+                im.truth = TruthFromCaptureName(im.name);
+                im.bgr = cv::imread(im.path, cv::IMREAD_COLOR);
+                if (!im.bgr.empty() && prepare) prepare(im);
+            }
+        });
+    }
+    for (thread& t : pool) t.join();
+
+    size_t before = out.size();
+    out.erase(remove_if(out.begin(), out.end(), [](const CorpusImage& im) { return im.bgr.empty(); }), out.end());
+    if (out.size() != before) cerr << logTag << " " << (before - out.size()) << " images could not be decoded\n";
+    return !out.empty();
+}
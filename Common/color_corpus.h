@@ -0,0 +1,35 @@
+﻿#pragma once
+
+// color_corpus.h
+// - ColorWorker 가 저장한 라벨 캡처 코퍼스 (ColorTuner / ColorBench 공용)
+//   파일 이름 color_<r|g|b|n>N.jpg 의 접두사 글자가 정답 (r=RED, g=GREEN, b=BLUE, n=NONE)
+// - 여러 폴더의 color_*.jpg 를 이름순으로 모아 모든 코어에서 디코드
+//   prepare 를 주면 디코드한 스레드에서 이미지별 전처리까지 (예: ColorTuner 의 HSV 변환)
+// - 디코드 실패한 파일은 빼고 경고만
+
+#include <opencv2/opencv.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+enum CorpusTruth { TRUTH_RED = 0, TRUTH_GREEN = 1, TRUTH_BLUE = 2, TRUTH_NONE = 3 };
+extern const char* const TRUTH_NAMES[4]; // "RED" "GREEN" "BLUE" "NONE" (판별 결과 문자열과 같음)
+
+// 파일 이름 -> 정답 (라벨 캡처가 아니면 -1)
+int TruthFromCaptureName(const std::string& fileName);
+// 판별 결과 문자열 -> 정답 번호 (모르는 값 = TRUTH_NONE)
+int TruthFromColor(const std::string& color);
+
+struct CorpusImage {
+    std::string path;
+    std::string name;        // 파일 이름만
+    int truth = TRUTH_NONE;
+    bool holdout = false;    // 도구가 정함 (ColorTuner --holdout)
+    cv::Mat bgr;
+    cv::Mat hsv;             // prepare 가 채우는 전처리 결과 (ColorTuner)
+};
+
+// logTag: 경고 앞에 붙일 "[TUNE]" 같은 말머리. 한 장도 못 읽으면 false
+bool LoadColorCorpus(const std::vector<std::string>& dirs, int threads, std::vector<CorpusImage>& out,
+    const char* logTag, const std::function<void(CorpusImage&)>& prepare = nullptr);
@@ -0,0 +1,804 @@
+﻿#include "measure_archive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char SEG_MAGIC[8] = { 'F', 'A', 'S', 'M', 'C', 'O', 'L', '1' };
+static const char WAL_MAGIC[8] = { 'F', 'A', 'S', 'M', 'W', 'A', 'L', '1' };
+static const size_t SEG_FIXED = 8 + 4 + 2 + 1 + 1 + 8 + 8 + 6 * 4;
+static const size_t SEG_HEAD_READ = 512; // 머리만 읽을 때 (고정부 + 열 길이 표)
+
+enum Column {
+    COL_TS = 0, COL_LABEL, COL_COLOR, COL_TYPE, COL_X, COL_Y, COL_MS, COL_PIXR, COL_PIXG, COL_PIXB,
+    COL_COUNT
+};
+
+enum RowHas { HAS_X = 1, HAS_Y = 2, HAS_MS = 4 };
+
+static const char* COLOR_NAMES[4] = { "NONE", "RED", "GREEN", "BLUE" };
+static const char* TYPE_NAMES[4] = { "", "TOP", "BASE", "defect" };
+
+const char* MeasureColorName(int color)
+{
+    return (color >= 0 && color < 4) ? COLOR_NAMES[color] : COLOR_NAMES[0];
+}
+
+int MeasureColorFromName(const string& name)
+{
+    for (int i = 0; i < 4; i++)
+        if (name == COLOR_NAMES[i]) return i;
+    return MCOLOR_NONE;
+}
+
+const char* MeasureTypeName(int type)
+{
+    return (type >= 0 && type < 4) ? TYPE_NAMES[type] : TYPE_NAMES[0];
+}
+
+int MeasureTypeFromName(const string& name)
+{
+    for (int i = 1; i < 4; i++)
+        if (name == TYPE_NAMES[i]) return i;
+    return MTYPE_UNKNOWN;
+}
+
+// =====================
+// 바이트 / varint
+// =====================
+// 고정 크기 값 <-> 바이트 (x86/ARM 모두 리틀 엔디언)
+template <class T>
+static void PutRaw(vector<uint8_t>& b, T v)
+{
+    size_t n = b.size();
+    b.resize(n + sizeof(T));
+    memcpy(b.data() + n, &v, sizeof(T));
+}
+
+template <class T>
+static T GetRaw(const uint8_t* p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+static void PutVarint(vector<uint8_t>& b, uint64_t v)
+{
+    while (v >= 0x80) {
+        b.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    b.push_back((uint8_t)v);
+}
+
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return false;
+        uint8_t c = *p++;
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint64_t ZigZag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t UnZigZag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// mm / ms -> 0.001 단위 정수
+static int64_t ToMilli(double v) { return llround(v * 1000.0); }
+
+static int32_t ClampI32(int64_t v)
+{
+    return (int32_t)max<int64_t>(INT32_MIN, min<int64_t>(INT32_MAX, v));
+}
+
+// =====================
+// 열 인코딩 / 디코딩
+// =====================
+static double& FixedField(MeasureRecord& r, int col)
+{
+    return col == COL_X ? r.x : (col == COL_Y ? r.y : r.ms);
+}
+
+static double FixedField(const MeasureRecord& r, int col)
+{
+    return col == COL_X ? r.x : (col == COL_Y ? r.y : r.ms);
+}
+
+static int& PixField(MeasureRecord& r, int col)
+{
+    return col == COL_PIXR ? r.pixR : (col == COL_PIXG ? r.pixG : r.pixB);
+}
+
+static int PixField(const MeasureRecord& r, int col)
+{
+    return col == COL_PIXR ? r.pixR : (col == COL_PIXG ? r.pixG : r.pixB);
+}
+
+static void EncodeColumn(const vector<MeasureRecord>& rows, int col, vector<uint8_t>& b)
+{
+    switch (col) {
+    case COL_TS: {
+        int64_t prev = 0;
+        for (const MeasureRecord& r : rows) { PutVarint(b, ZigZag(r.tsMs - prev)); prev = r.tsMs; }
+        break;
+    }
+    case COL_LABEL: {
+        const string* prev = nullptr;
+        for (const MeasureRecord& r : rows) {
+            size_t len = min<size_t>(r.label.size(), 255);
+            size_t shared = 0;
+            if (prev) {
+                size_t n = min(len, min<size_t>(prev->size(), 255));
+                while (shared < n && r.label[shared] == (*prev)[shared]) shared++;
+            }
+            PutVarint(b, shared);
+            PutVarint(b, len - shared);
+            b.insert(b.end(), r.label.begin() + shared, r.label.begin() + len);
+            prev = &r.label;
+        }
+        break;
+    }
+    case COL_COLOR:
+    case COL_TYPE: {
+        for (size_t i = 0; i < rows.size();) {
+            int v = (col == COL_COLOR) ? rows[i].color : rows[i].type;
+            size_t run = 1;
+            while (i + run < rows.size() && ((col == COL_COLOR) ? rows[i + run].color : rows[i + run].type) == v) run++;
+            b.push_back((uint8_t)v);
+            PutVarint(b, run);
+            i += run;
+        }
+        break;
+    }
+    case COL_X:
+    case COL_Y:
+    case COL_MS: {
+        size_t bm = b.size();
+        b.resize(bm + (rows.size() + 7) / 8, 0);
+        int64_t prev = 0;
+        for (size_t i = 0; i < rows.size(); i++) {
+            double v = FixedField(rows[i], col);
+            if (!isfinite(v)) continue;
+            b[bm + i / 8] |= (uint8_t)(1 << (i % 8));
+            int64_t m = ToMilli(v);
+            PutVarint(b, ZigZag(m - prev));
+            prev = m;
+        }
+        break;
+    }
+    default: {
+        for (const MeasureRecord& r : rows) {
+            int v = PixField(r, col);
+            PutVarint(b, v < 0 ? 0 : (uint64_t)v + 1);
+        }
+        break;
+    }
+    }
+}
+
+static bool DecodeColumn(const uint8_t* p, const uint8_t* end, int col, vector<MeasureRecord>& rows)
+{
+    uint64_t v = 0;
+    switch (col) {
+    case COL_TS: {
+        int64_t prev = 0;
+        for (MeasureRecord& r : rows) {
+            if (!GetVarint(p, end, v)) return false;
+            prev += UnZigZag(v);
+            r.tsMs = prev;
+        }
+        return true;
+    }
+    case COL_LABEL: {
+        const string* prev = nullptr;
+        for (MeasureRecord& r : rows) {
+            uint64_t shared = 0, rest = 0;
+            if (!GetVarint(p, end, shared) || !GetVarint(p, end, rest)) return false;
+            if ((shared > 0 && (!prev || shared > prev->size())) || rest > (uint64_t)(end - p)) return false;
+            r.label.assign(prev ? prev->data() : "", (size_t)shared);
+            r.label.append((const char*)p, (size_t)rest);
+            p += rest;
+            prev = &r.label;
+        }
+        return true;
+    }
+    case COL_COLOR:
+    case COL_TYPE: {
+        size_t i = 0;
+        while (i < rows.size()) {
+            if (p >= end) return false;
+            int val = *p++;
+            if (!GetVarint(p, end, v) || v == 0 || v > rows.size() - i) return false;
+            for (uint64_t k = 0; k < v; k++, i++) {
+                if (col == COL_COLOR) rows[i].color = val;
+                else rows[i].type = val;
+            }
+        }
+        return true;
+    }
+    case COL_X:
+    case COL_Y:
+    case COL_MS: {
+        size_t bmBytes = (rows.size() + 7) / 8;
+        if ((size_t)(end - p) < bmBytes) return false;
+        const uint8_t* bm = p;
+        p += bmBytes;
+        int64_t prev = 0;
+        for (size_t i = 0; i < rows.size(); i++) {
+            double& f = FixedField(rows[i], col);
+            if (!(bm[i / 8] & (1 << (i % 8)))) { f = numeric_limits<double>::quiet_NaN(); continue; }
+            if (!GetVarint(p, end, v)) return false;
+            prev += UnZigZag(v);
+            f = prev / 1000.0;
+        }
+        return true;
+    }
+    default: {
+        for (MeasureRecord& r : rows) {
+            if (!GetVarint(p, end, v)) return false;
+            PixField(r, col) = (v == 0) ? -1 : (int)(v - 1);
+        }
+        return true;
+    }
+    }
+}
+
+// 세그먼트 전체 (머리 + 열)
+static void EncodeSegment(const vector<MeasureRecord>& rows, vector<uint8_t>& out)
+{
+    int64_t tsMin = INT64_MAX, tsMax = INT64_MIN;
+    int64_t mn[3] = { INT32_MAX, INT32_MAX, INT32_MAX }, mx[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+    uint8_t colorMask = 0, typeMask = 0;
+    for (const MeasureRecord& r : rows) {
+        tsMin = min(tsMin, r.tsMs);
+        tsMax = max(tsMax, r.tsMs);
+        colorMask |= (uint8_t)(1 << (r.color & 7));
+        typeMask |= (uint8_t)(1 << (r.type & 7));
+        const double f[3] = { r.x, r.y, r.ms };
+        for (int k = 0; k < 3; k++) {
+            if (!isfinite(f[k])) continue;
+            int64_t m = ToMilli(f[k]);
+            mn[k] = min(mn[k], m);
+            mx[k] = max(mx[k], m);
+        }
+    }
+
+    vector<uint8_t> cols[COL_COUNT];
+    for (int c = 0; c < COL_COUNT; c++) EncodeColumn(rows, c, cols[c]);
+
+    out.assign(SEG_MAGIC, SEG_MAGIC + sizeof(SEG_MAGIC));
+    PutRaw<uint32_t>(out, (uint32_t)rows.size());
+    PutRaw<uint16_t>(out, (uint16_t)COL_COUNT);
+    PutRaw<uint8_t>(out, colorMask);
+    PutRaw<uint8_t>(out, typeMask);
+    PutRaw<int64_t>(out, tsMin);
+    PutRaw<int64_t>(out, tsMax);
+    for (int k = 0; k < 3; k++) {
+        PutRaw<int32_t>(out, ClampI32(mn[k]));
+        PutRaw<int32_t>(out, ClampI32(mx[k]));
+    }
+    for (int c = 0; c < COL_COUNT; c++) PutRaw<uint32_t>(out, (uint32_t)cols[c].size());
+    for (int c = 0; c < COL_COUNT; c++) out.insert(out.end(), cols[c].begin(), cols[c].end());
+}
+
+// 머리 파싱. colOffset[c] = 파일 안에서 열 c 의 시작, colBytes[c] = 길이
+static bool ParseSegmentHeader(const uint8_t* p, size_t size, MeasureSegmentInfo& info,
+    vector<size_t>* colOffset, vector<size_t>* colBytes)
+{
+    if (size < SEG_FIXED || memcmp(p, SEG_MAGIC, sizeof(SEG_MAGIC)) != 0) return false;
+    info.rows = GetRaw<uint32_t>(p + 8);
+    uint16_t colCount = GetRaw<uint16_t>(p + 12);
+    info.colorMask = p[14];
+    info.typeMask = p[15];
+    info.tsMin = GetRaw<int64_t>(p + 16);
+    info.tsMax = GetRaw<int64_t>(p + 24);
+    double* f[6] = { &info.xMin, &info.xMax, &info.yMin, &info.yMax, &info.msMin, &info.msMax };
+    for (int k = 0; k < 6; k++) *f[k] = GetRaw<int32_t>(p + 32 + 4 * k) / 1000.0;
+
+    size_t headerBytes = SEG_FIXED + 4 * (size_t)colCount;
+    if (colCount < COL_COUNT || size < headerBytes) return false;
+    if (colOffset && colBytes) {
+        colOffset->assign(colCount, 0);
+        colBytes->assign(colCount, 0);
+        size_t off = headerBytes;
+        for (int c = 0; c < colCount; c++) {
+            (*colBytes)[c] = GetRaw<uint32_t>(p + SEG_FIXED + 4 * c);
+            (*colOffset)[c] = off;
+            off += (*colBytes)[c];
+        }
+        if (off > size) return false;
+    }
+    return true;
+}
+
+// =====================
+// WAL 행
+// =====================
+static void EncodeRow(const MeasureRecord& r, vector<uint8_t>& b)
+{
+    uint8_t has = (isfinite(r.x) ? HAS_X : 0) | (isfinite(r.y) ? HAS_Y : 0) | (isfinite(r.ms) ? HAS_MS : 0);
+    PutRaw<int64_t>(b, r.tsMs);
+    PutRaw<uint8_t>(b, (uint8_t)r.color);
+    PutRaw<uint8_t>(b, (uint8_t)r.type);
+    PutRaw<uint8_t>(b, has);
+    if (has & HAS_X) PutRaw<double>(b, r.x);
+    if (has & HAS_Y) PutRaw<double>(b, r.y);
+    if (has & HAS_MS) PutRaw<double>(b, r.ms);
+    PutRaw<int32_t>(b, r.pixR);
+    PutRaw<int32_t>(b, r.pixG);
+    PutRaw<int32_t>(b, r.pixB);
+    size_t len = min<size_t>(r.label.size(), 255);
+    PutRaw<uint8_t>(b, (uint8_t)len);
+    b.insert(b.end(), r.label.begin(), r.label.begin() + len);
+}
+
+static bool DecodeRow(const uint8_t* p, size_t len, MeasureRecord& r)
+{
+    const uint8_t* end = p + len;
+    if (len < 8 + 3) return false;
+    r.tsMs = GetRaw<int64_t>(p);
+    r.color = p[8];
+    r.type = p[9];
+    uint8_t has = p[10];
+    p += 11;
+    double* f[3] = { &r.x, &r.y, &r.ms };
+    for (int k = 0; k < 3; k++) {
+        if (!(has & (1 << k))) continue;
+        if (end - p < 8) return false;
+        *f[k] = GetRaw<double>(p);
+        p += 8;
+    }
+    if (end - p < 13) return false;
+    r.pixR = GetRaw<int32_t>(p);
+    r.pixG = GetRaw<int32_t>(p + 4);
+    r.pixB = GetRaw<int32_t>(p + 8);
+    size_t labelLen = p[12];
+    p += 13;
+    if ((size_t)(end - p) < labelLen) return false;
+    r.label.assign((const char*)p, labelLen);
+    return true;
+}
+
+static string WalPath(const string& dir)
+{
+    return (filesystem::path(dir) / "wal.mlog").string();
+}
+
+// 잘린 마지막 행은 버림
+static bool LoadWal(const string& path, vector<MeasureRecord>& out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) buf.insert(buf.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (buf.size() < sizeof(WAL_MAGIC) || memcmp(buf.data(), WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) return false;
+    size_t pos = sizeof(WAL_MAGIC);
+    while (buf.size() - pos >= 2) {
+        uint16_t len = GetRaw<uint16_t>(buf.data() + pos);
+        if (buf.size() - pos - 2 < len) break;
+        MeasureRecord r;
+        if (!DecodeRow(buf.data() + pos + 2, len, r)) break;
+        out.push_back(std::move(r));
+        pos += 2 + (size_t)len;
+    }
+    return true;
+}
+
+// =====================
+// 세그먼트 파일
+// =====================
+// seg_<ms 13자리>[_n].mcol (이름순 = 시간순)
+static string SegmentPath(const string& dir, int64_t firstTs, int n)
+{
+    ostringstream fn;
+    fn << "seg_" << setw(13) << setfill('0') << max<int64_t>(0, firstTs);
+    if (n > 0) fn << "_" << n;
+    fn << ".mcol";
+    return (filesystem::path(dir) / fn.str()).string();
+}
+
+static vector<string> ListSegmentFiles(const string& dir)
+{
+    vector<string> out;
+    error_code ec;
+    for (const auto& e : filesystem::directory_iterator(dir, ec)) {
+        string name = e.path().filename().string();
+        if (name.size() > 9 && name.compare(0, 4, "seg_") == 0 && e.path().extension() == ".mcol")
+            out.push_back(e.path().string());
+    }
+    sort(out.begin(), out.end());
+    return out;
+}
+
+static bool ReadFileBytes(const string& path, vector<uint8_t>& out, size_t maxBytes = SIZE_MAX)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    out.clear();
+    uint8_t chunk[65536];
+    size_t n;
+    while (out.size() < maxBytes && (n = fread(chunk, 1, min(sizeof(chunk), maxBytes - out.size()), f)) > 0)
+        out.insert(out.end(), chunk, chunk + n);
+    fclose(f);
+    return true;
+}
+
+// =====================
+// Writer
+// =====================
+MeasureArchiveWriter::MeasureArchiveWriter(const MeasureArchiveOptions& opt)
+    : opt_(opt)
+{
+    if (opt_.segmentMs <= 0) opt_.segmentMs = 3600 * 1000;
+    if (opt_.maxRows == 0) opt_.maxRows = 1;
+}
+
+MeasureArchiveWriter::~MeasureArchiveWriter()
+{
+    Close();
+}
+
+// writer.lock: 폴더당 writer 하나 (워커가 쓰는 중에 HistoryTool seal/import 가 WAL 을 봉인하지 못하게)
+#ifdef _WIN32
+bool MeasureArchiveWriter::LockDir(string& err)
+{
+    string path = (filesystem::path(opt_.dir) / "writer.lock").string();
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        err = (GetLastError() == ERROR_SHARING_VIOLATION) ? "archive in use by another writer: " + path : "cannot open " + path;
+        return false;
+    }
+    lock_ = h;
+    return true;
+}
+
+void MeasureArchiveWriter::UnlockDir()
+{
+    if (lock_) { CloseHandle((HANDLE)lock_); lock_ = nullptr; }
+}
+#else
+bool MeasureArchiveWriter::LockDir(string& err)
+{
+    string path = (filesystem::path(opt_.dir) / "writer.lock").string();
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        err = "cannot open " + path;
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        err = "archive in use by another writer: " + path;
+        return false;
+    }
+    lock_ = fd;
+    return true;
+}
+
+void MeasureArchiveWriter::UnlockDir()
+{
+    if (lock_ >= 0) { ::close(lock_); lock_ = -1; }
+}
+#endif
+
+bool MeasureArchiveWriter::Open(string& err)
+{
+    lock_guard<mutex> lk(mtx_);
+
+    error_code ec;
+    filesystem::create_directories(opt_.dir, ec);
+    if (wal_) { fclose(wal_); wal_ = nullptr; }
+    UnlockDir();
+    if (!LockDir(err)) return false;
+
+    pending_.clear();
+    string walPath = WalPath(opt_.dir);
+    LoadWal(walPath, pending_);
+
+    // 봉인(rename) 직후 WAL 을 비우기 전에 죽었으면 같은 행이 세그먼트에 이미 있음
+    // (같은 첫 ts 세그먼트가 여럿이면 _n 붙은 것까지 전부 확인)
+    if (!pending_.empty()) {
+        for (int n = 0;; n++) {
+            string path = SegmentPath(opt_.dir, pending_.front().tsMs, n);
+            if (!filesystem::exists(path, ec)) break;
+            vector<uint8_t> head;
+            MeasureSegmentInfo info;
+            if (ReadFileBytes(path, head, SEG_HEAD_READ)
+                && ParseSegmentHeader(head.data(), head.size(), info, nullptr, nullptr)
+                && info.rows == pending_.size() && info.tsMin == pending_.front().tsMs
+                && info.tsMax == pending_.back().tsMs) {
+                pending_.clear();
+                break;
+            }
+        }
+    }
+
+    // 잘린 꼬리(마지막으로 온전한 행 뒤) 를 버리고 읽은 행으로 WAL 을 다시 씀 -> 그 뒤 Append 는 온전한 행 바로 뒤에
+    // (tmp + rename -> 도중에 죽어도 원본 WAL 유지)
+    if (!RewriteWal()) {
+        err = "cannot rewrite " + walPath;
+        UnlockDir();
+        return false;
+    }
+    return true;
+}
+
+void MeasureArchiveWriter::Close()
+{
+    lock_guard<mutex> lk(mtx_);
+    if (wal_) { fclose(wal_); wal_ = nullptr; }
+    UnlockDir();
+}
+
+bool MeasureArchiveWriter::RewriteWal()
+{
+    if (wal_) { fclose(wal_); wal_ = nullptr; }
+
+    vector<uint8_t> b(WAL_MAGIC, WAL_MAGIC + sizeof(WAL_MAGIC));
+    for (const MeasureRecord& r : pending_) {
+        vector<uint8_t> row;
+        EncodeRow(r, row);
+        PutRaw<uint16_t>(b, (uint16_t)row.size());
+        b.insert(b.end(), row.begin(), row.end());
+    }
+
+    string path = WalPath(opt_.dir);
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(b.data(), 1, b.size(), f) == b.size();
+    ok = (fclose(f) == 0) && ok;
+    error_code ec;
+    if (ok) filesystem::rename(tmp, path, ec);
+    if (!ok || ec) {
+        filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    wal_ = fopen(path.c_str(), "ab");
+    walBytes_ = b.size();
+    return wal_ != nullptr;
+}
+
+// 버퍼에 남은 조각까지 버리려고 닫았다가 다시 엶 ("ab" 라 다음 쓰기는 자른 끝에서)
+bool MeasureArchiveWriter::RollbackWal()
+{
+    string path = WalPath(opt_.dir);
+    fclose(wal_);
+    error_code ec;
+    filesystem::resize_file(path, walBytes_, ec);
+    wal_ = fopen(path.c_str(), "ab");
+    return !ec && wal_ != nullptr;
+}
+
+bool MeasureArchiveWriter::Append(const MeasureRecord& r)
+{
+    vector<uint8_t> rec;
+    rec.reserve(64);
+    PutRaw<uint16_t>(rec, 0);
+    EncodeRow(r, rec);
+    uint16_t len = (uint16_t)(rec.size() - 2);
+    memcpy(rec.data(), &len, 2);
+
+    lock_guard<mutex> lk(mtx_);
+    if (!wal_) return false;
+
+    if (!pending_.empty()) {
+        auto bucket = [&](int64_t ts) { return (ts >= 0 ? ts : ts - opt_.segmentMs + 1) / opt_.segmentMs; };
+        if (bucket(r.tsMs) != bucket(pending_.front().tsMs) || pending_.size() >= opt_.maxRows) {
+            if (!SealLocked()) return false;
+        }
+    }
+
+    // 쓰다 만 행을 남기면 LoadWal 이 거기서 멈춰 그 뒤에 붙는 행까지 다음 Open 에서 잃음 -> 잘라내고 실패
+    if (fwrite(rec.data(), 1, rec.size(), wal_) != rec.size() || fflush(wal_) != 0) {
+        if (!RollbackWal()) RewriteWal();
+        return false;
+    }
+    walBytes_ += rec.size();
+    pending_.push_back(r);
+    return true;
+}
+
+bool MeasureArchiveWriter::Seal()
+{
+    lock_guard<mutex> lk(mtx_);
+    return SealLocked();
+}
+
+size_t MeasureArchiveWriter::PendingRows()
+{
+    lock_guard<mutex> lk(mtx_);
+    return pending_.size();
+}
+
+bool MeasureArchiveWriter::SealLocked()
+{
+    if (pending_.empty()) return true;
+
+    vector<uint8_t> seg;
+    EncodeSegment(pending_, seg);
+
+    string path;
+    for (int n = 0; path.empty() || filesystem::exists(path); n++) path = SegmentPath(opt_.dir, pending_.front().tsMs, n);
+
+    // tmp 에 다 쓴 다음 rename -> 반쯤 쓴 세그먼트는 보이지 않음
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(seg.data(), 1, seg.size(), f) == seg.size();
+    ok = (fclose(f) == 0) && ok;
+    error_code ec;
+    if (ok) filesystem::rename(tmp, path, ec);
+    if (!ok || ec) {
+        filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    pending_.clear();
+    if (!RewriteWal()) return false;
+    ApplyRetention();
+    return true;
+}
+
+void MeasureArchiveWriter::ApplyRetention()
+{
+    if (opt_.maxSegments <= 0) return;
+    vector<string> files = ListSegmentFiles(opt_.dir);
+    error_code ec;
+    for (size_t i = 0; i + opt_.maxSegments < files.size(); i++) filesystem::remove(files[i], ec);
+}
+
+// =====================
+// Reader
+// =====================
+static bool HasXCondition(const MeasureQuery& q)
+{
+    return isfinite(q.xLo) || isfinite(q.xHi);
+}
+
+bool MeasureQueryMatches(const MeasureQuery& q, const MeasureRecord& r)
+{
+    if (r.tsMs < q.fromMs || r.tsMs >= q.toMs) return false;
+    if (!(q.colorMask & (1 << (r.color & 7)))) return false;
+    if (!(q.typeMask & (1 << (r.type & 7)))) return false;
+    if (HasXCondition(q)) {
+        if (!isfinite(r.x)) return false;
+        bool inside = r.x >= q.xLo && r.x <= q.xHi;
+        if (inside == q.xOutside) return false;
+    }
+    return true;
+}
+
+// 머리만 보고 맞는 행이 있을 수 있는지
+static bool SegmentMayMatch(const MeasureQuery& q, const MeasureSegmentInfo& s)
+{
+    if (s.rows == 0 || s.tsMax < q.fromMs || s.tsMin >= q.toMs) return false;
+    if (!(s.colorMask & q.colorMask) || !(s.typeMask & q.typeMask)) return false;
+    if (HasXCondition(q)) {
+        if (s.xMin > s.xMax) return false; // x 가 하나도 없음
+        if (q.xOutside) { if (s.xMin >= q.xLo && s.xMax <= q.xHi) return false; }
+        else if (s.xMax < q.xLo || s.xMin > q.xHi) return false;
+    }
+    return true;
+}
+
+bool MeasureArchiveReader::Open(const string& dir, string& err)
+{
+    dir_ = dir;
+    segs_.clear();
+    wal_.clear();
+    if (!filesystem::is_directory(dir)) {
+        err = "not a directory: " + dir;
+        return false;
+    }
+
+    for (const string& path : ListSegmentFiles(dir)) {
+        vector<uint8_t> head;
+        MeasureSegmentInfo info;
+        if (!ReadFileBytes(path, head, SEG_HEAD_READ) || !ParseSegmentHeader(head.data(), head.size(), info, nullptr, nullptr)) {
+            err = "bad segment header: " + path;
+            return false;
+        }
+        error_code ec;
+        info.path = path;
+        info.fileBytes = filesystem::file_size(path, ec);
+        segs_.push_back(info);
+    }
+    stable_sort(segs_.begin(), segs_.end(),
+        [](const MeasureSegmentInfo& a, const MeasureSegmentInfo& b) { return a.tsMin < b.tsMin; });
+
+    LoadWal(WalPath(dir), wal_);
+    return true;
+}
+
+bool MeasureArchiveReader::Scan(const MeasureQuery& q, const function<bool(const MeasureRecord&)>& cb,
+    MeasureScanStats* stats, string& err) const
+{
+    MeasureScanStats st;
+    st.segments = segs_.size();
+    st.walRows = wal_.size();
+
+    // 조건 열 먼저, 맞는 행이 있을 때만 나머지
+    const int filterCols[] = { COL_TS, COL_COLOR, COL_TYPE, COL_X };
+    const int restCols[] = { COL_LABEL, COL_Y, COL_MS, COL_PIXR, COL_PIXG, COL_PIXB };
+    const bool xCond = HasXCondition(q);
+
+    bool stopped = false;
+    vector<uint8_t> buf;
+    vector<MeasureRecord> rows;
+    vector<size_t> colOffset, colBytes;
+    for (const MeasureSegmentInfo& s : segs_) {
+        if (stopped) break;
+        if (!SegmentMayMatch(q, s)) { st.segmentsSkipped++; continue; }
+
+        MeasureSegmentInfo info;
+        if (!ReadFileBytes(s.path, buf) || !ParseSegmentHeader(buf.data(), buf.size(), info, &colOffset, &colBytes)) {
+            err = "cannot read " + s.path;
+            return false;
+        }
+        rows.assign(info.rows, MeasureRecord());
+        auto decode = [&](int c) {
+            const uint8_t* p = buf.data() + colOffset[c];
+            return DecodeColumn(p, p + colBytes[c], c, rows);
+        };
+
+        for (int c : filterCols) {
+            if (c == COL_X && !xCond) continue;
+            if (!decode(c)) { err = "corrupt column in " + s.path; return false; }
+        }
+        st.rowsScanned += rows.size();
+
+        vector<size_t> hit;
+        for (size_t i = 0; i < rows.size(); i++)
+            if (MeasureQueryMatches(q, rows[i])) hit.push_back(i);
+        if (hit.empty()) continue;
+
+        for (int c : restCols)
+            if (!decode(c)) { err = "corrupt column in " + s.path; return false; }
+        if (!xCond && !decode(COL_X)) { err = "corrupt column in " + s.path; return false; }
+        st.segmentsDecoded++;
+
+        for (size_t i : hit) {
+            st.rowsMatched++;
+            if (!cb(rows[i])) { stopped = true; break; }
+        }
+    }
+
+    for (size_t i = 0; i < wal_.size() && !stopped; i++) {
+        st.rowsScanned++;
+        if (!MeasureQueryMatches(q, wal_[i])) continue;
+        st.rowsMatched++;
+        if (!cb(wal_[i])) stopped = true;
+    }
+
+    if (stats) *stats = st;
+    return true;
+}
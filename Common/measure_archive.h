@@ -0,0 +1,165 @@
+﻿#pragma once
+
+// measure_archive.h
+// - 판별/측정 결과 이력을 열(column) 단위 세그먼트 파일로 저장 (total.json / result.json 은 그대로 두고 조회용으로 추가)
+// - 쓰는 중인 구간은 wal.mlog 에 행 단위로 append + flush (죽어도 다음 Open 에서 복구)
+//   -> 시간 구간(기본 1시간) 이 바뀌거나 행 수가 maxRows 에 닿으면 열 단위로 인코딩해서
+//      seg_<첫 행 ms>.mcol 로 봉인하고 WAL 을 비운다
+// - 열 인코딩 (압축)
+//     ts            : 앞 행과의 차이 zigzag varint
+//     label         : 앞 label 과 같은 접두사 길이 + 나머지 (g12 -> g13 = 2바이트 + 1글자)
+//     color / type  : (값, 반복 수) run-length
+//     x / y / ms    : 있음 비트맵 + 0.001 단위 정수의 차이 zigzag varint
+//     pix r/g/b     : varint (값 + 1, 0 = 없음)
+// - 세그먼트 머리에 ts/x/y/ms min/max + color/type 비트 집합 -> 조회는 머리만 읽고 안 맞는 세그먼트는 건너뜀
+//   맞는 세그먼트도 조건 열(ts, color, type, x)을 먼저 풀어서 맞는 행이 없으면 나머지 열은 풀지 않음
+// - 보존: maxSegments 를 넘으면 오래된 세그먼트부터 삭제 (0 = 무제한)
+// - 쓰는 쪽은 폴더당 하나: Open 이 writer.lock 을 배타적으로 잡음 (이미 잡혀 있으면 Open 실패)
+//   OS 잠금이라 프로세스가 죽으면 같이 풀림. 읽기(Reader)는 잠금 없이 언제든
+//   -> 워커마다 폴더를 따로 (ColorWorker ./history/color, VisionWorker ./history/vision)
+// - WAL 에 쓰다 만 행은 남기지 않음: Append 실패면 그 자리에서 잘라내고, Open 은 마지막 온전한 행까지만 남김
+//
+// 형식 (리틀 엔디언)
+//   segment: "FASMCOL1" u32 rows u16 colCount u8 colorMask u8 typeMask i64 tsMin i64 tsMax
+//            i32 xMin xMax yMin yMax msMin msMax (0.001 단위, 값 없으면 min > max) u32 colBytes[colCount] | col*
+//   wal    : "FASMWAL1" | (u16 len, row[len])*   row = i64 ts u8 color u8 type u8 has(x|y|ms)
+//            f64 x y ms (있는 것만) i32 pixR pixG pixB u8 labelLen label
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum MeasureColor {
+    MCOLOR_NONE = 0,
+    MCOLOR_RED = 1,
+    MCOLOR_GREEN = 2,
+    MCOLOR_BLUE = 3,
+};
+
+// VisionWorker DecideTypeByX 결과 ("TOP" / "BASE" / "defect"), ColorWorker 는 UNKNOWN
+enum MeasureType {
+    MTYPE_UNKNOWN = 0,
+    MTYPE_TOP = 1,
+    MTYPE_BASE = 2,
+    MTYPE_DEFECT = 3,
+};
+
+const char* MeasureColorName(int color);
+int MeasureColorFromName(const std::string& name); // 모르는 이름 = MCOLOR_NONE
+const char* MeasureTypeName(int type);
+int MeasureTypeFromName(const std::string& name);  // 모르는 이름 = MTYPE_UNKNOWN
+
+struct MeasureRecord {
+    int64_t tsMs = 0;        // system_clock ms
+    std::string label;       // "g12" (255자 이하)
+    int color = MCOLOR_NONE;
+    int type = MTYPE_UNKNOWN;
+    double x = std::numeric_limits<double>::quiet_NaN();  // mm, NaN = 없음
+    double y = std::numeric_limits<double>::quiet_NaN();
+    double ms = std::numeric_limits<double>::quiet_NaN(); // 처리 시간
+    int pixR = -1, pixG = -1, pixB = -1;                  // -1 = 없음
+};
+
+struct MeasureArchiveOptions {
+    std::string dir;
+    int64_t segmentMs = 3600 * 1000; // 시간 구간 (구간이 바뀌면 봉인)
+    size_t maxRows = 65536;          // 구간 안에서도 이만큼 쌓이면 봉인
+    int maxSegments = 0;             // 보존 개수 (0 = 무제한)
+};
+
+// 세그먼트 머리 (조회 전에 이것만 읽음)
+struct MeasureSegmentInfo {
+    std::string path;
+    uint64_t fileBytes = 0;
+    uint32_t rows = 0;
+    int64_t tsMin = 0, tsMax = 0;
+    double xMin = 0, xMax = 0, yMin = 0, yMax = 0, msMin = 0, msMax = 0; // 값 없으면 min > max
+    uint8_t colorMask = 0; // bit = MeasureColor
+    uint8_t typeMask = 0;  // bit = MeasureType
+};
+
+class MeasureArchiveWriter {
+public:
+    explicit MeasureArchiveWriter(const MeasureArchiveOptions& opt);
+    ~MeasureArchiveWriter();
+
+    // 폴더 생성 + writer.lock + WAL 복구 (지난 실행에서 봉인 못 한 행은 이어서 쌓임)
+    // 다른 writer(워커 등)가 잡고 있으면 false
+    bool Open(std::string& err);
+    void Close(); // WAL 은 남겨 둠 (다음 Open 에서 이어감), 잠금 해제
+
+    // 스레드 안전. WAL 에 한 행 쓰고 flush, 필요하면 그 전에 봉인
+    bool Append(const MeasureRecord& r);
+
+    // 쌓인 행을 지금 세그먼트로 (HistoryTool seal / 종료 전)
+    bool Seal();
+
+    size_t PendingRows();
+    const std::string& Dir() const { return opt_.dir; }
+
+private:
+    bool SealLocked();
+    bool RewriteWal(); // pending_ 만 담은 WAL 을 tmp 에 쓰고 rename
+    bool RollbackWal(); // 쓰다 만 행을 잘라 walBytes_ 로 되돌림
+    void ApplyRetention();
+    bool LockDir(std::string& err);
+    void UnlockDir();
+
+    MeasureArchiveOptions opt_;
+    std::mutex mtx_;
+    FILE* wal_ = nullptr;
+    uint64_t walBytes_ = 0; // 온전한 행까지의 WAL 크기
+#ifdef _WIN32
+    void* lock_ = nullptr;
+#else
+    int lock_ = -1;
+#endif
+    std::vector<MeasureRecord> pending_; // WAL 에 있는 행 (봉인 전)
+};
+
+// 조회 조건 (모두 AND)
+struct MeasureQuery {
+    int64_t fromMs = std::numeric_limits<int64_t>::min(); // 이상
+    int64_t toMs = std::numeric_limits<int64_t>::max();   // 미만
+    uint8_t colorMask = 0xFF;
+    uint8_t typeMask = 0xFF;
+
+    // x 조건: 둘 다 무한대면 없음. xOutside = 구간 밖 (x < xLo 또는 x > xHi), 아니면 구간 안
+    // x 조건이 있으면 x 가 없는 행은 제외
+    double xLo = -std::numeric_limits<double>::infinity();
+    double xHi = std::numeric_limits<double>::infinity();
+    bool xOutside = false;
+};
+
+struct MeasureScanStats {
+    size_t segments = 0;       // 전체 세그먼트
+    size_t segmentsSkipped = 0; // 머리만 보고 건너뜀
+    size_t segmentsDecoded = 0; // 전체 열까지 푼 세그먼트
+    size_t rowsScanned = 0;
+    size_t rowsMatched = 0;
+    size_t walRows = 0;
+};
+
+class MeasureArchiveReader {
+public:
+    // 세그먼트 머리 목록 + WAL 행을 읽는다 (쓰는 중이어도 됨)
+    bool Open(const std::string& dir, std::string& err);
+
+    const std::vector<MeasureSegmentInfo>& Segments() const { return segs_; }
+    const std::vector<MeasureRecord>& WalRows() const { return wal_; }
+
+    // 시간 순서대로 맞는 행마다 cb (false 를 돌려주면 중단)
+    bool Scan(const MeasureQuery& q, const std::function<bool(const MeasureRecord&)>& cb,
+        MeasureScanStats* stats, std::string& err) const;
+
+private:
+    std::string dir_;
+    std::vector<MeasureSegmentInfo> segs_;
+    std::vector<MeasureRecord> wal_;
+};
+
+bool MeasureQueryMatches(const MeasureQuery& q, const MeasureRecord& r);
@@ -0,0 +1,277 @@
+﻿#include "mjpeg_roi_decoder.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <jpeglib.h>
+
+using namespace cv;
+using namespace std;
+
+// =====================
+// libjpeg 에러 -> longjmp (기본 동작은 exit)
+// setjmp 를 부르는 함수 안에는 소멸자가 있는 지역 변수를 두지 않는다
+// =====================
+struct JpegErr {
+    jpeg_error_mgr pub;
+    jmp_buf jb;
+    char msg[JMSG_LENGTH_MAX];
+};
+
+static void JpegErrorExit(j_common_ptr cinfo)
+{
+    JpegErr* e = (JpegErr*)cinfo->err;
+    (*cinfo->err->format_message)(cinfo, e->msg);
+    longjmp(e->jb, 1);
+}
+
+// 경고(잘린 데이터 등)는 stderr 로 찍지 않고 마지막 메시지만 보관
+static void JpegOutputMessage(j_common_ptr cinfo)
+{
+    JpegErr* e = (JpegErr*)cinfo->err;
+    (*cinfo->err->format_message)(cinfo, e->msg);
+}
+
+struct MjpegRoiDecoder::Impl {
+    jpeg_decompress_struct cinfo;
+    JpegErr err;
+    vector<uint8_t> row; // crop 디코드 1줄 버퍼
+    int mcuW = 8, mcuH = 8;
+
+    Impl()
+    {
+        memset(&cinfo, 0, sizeof(cinfo));
+        cinfo.err = jpeg_std_error(&err.pub);
+        err.pub.error_exit = JpegErrorExit;
+        err.pub.output_message = JpegOutputMessage;
+        err.msg[0] = 0;
+        jpeg_create_decompress(&cinfo);
+    }
+
+    ~Impl()
+    {
+        jpeg_destroy_decompress(&cinfo);
+    }
+
+    // 헤더까지 읽고 BGR 출력으로 설정
+    void Begin(const uint8_t* data, size_t len)
+    {
+        err.msg[0] = 0;
+        jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), (unsigned long)len);
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_EXT_BGR;
+        mcuW = cinfo.max_h_samp_factor * DCTSIZE;
+        mcuH = cinfo.max_v_samp_factor * DCTSIZE;
+    }
+};
+
+MjpegRoiDecoder::MjpegRoiDecoder()
+    : impl_(new Impl())
+{
+}
+
+MjpegRoiDecoder::~MjpegRoiDecoder() = default;
+
+bool MjpegRoiDecoder::PeekSize(const uint8_t* data, size_t len, int& width, int& height)
+{
+    Impl& d = *impl_;
+    if (setjmp(d.err.jb)) {
+        jpeg_abort_decompress(&d.cinfo);
+        lastError_ = d.err.msg;
+        return false;
+    }
+    d.Begin(data, len);
+    width = (int)d.cinfo.image_width;
+    height = (int)d.cinfo.image_height;
+    jpeg_abort_decompress(&d.cinfo);
+    return true;
+}
+
+bool MjpegRoiDecoder::DecodeFull(const uint8_t* data, size_t len, Mat& bgr)
+{
+    if (!DecodeFullInto(data, len, bgr)) {
+        stats_.failures++;
+        return false;
+    }
+    stats_.fullDecodes++;
+    stats_.decodedPixels += (uint64_t)bgr.total();
+    stats_.framePixels += (uint64_t)bgr.total();
+    return true;
+}
+
+bool MjpegRoiDecoder::DecodeFullInto(const uint8_t* data, size_t len, Mat& bgr)
+{
+    Impl& d = *impl_;
+    if (setjmp(d.err.jb)) {
+        jpeg_abort_decompress(&d.cinfo);
+        lastError_ = d.err.msg;
+        return false;
+    }
+    d.Begin(data, len);
+    jpeg_start_decompress(&d.cinfo);
+
+    bgr.create((int)d.cinfo.output_height, (int)d.cinfo.output_width, CV_8UC3);
+    while (d.cinfo.output_scanline < d.cinfo.output_height) {
+        JSAMPROW row = bgr.ptr<uchar>((int)d.cinfo.output_scanline);
+        jpeg_read_scanlines(&d.cinfo, &row, 1);
+    }
+    // EOI 까지 읽을 필요 없음 (다음 프레임을 위해 상태만 초기화)
+    jpeg_abort_decompress(&d.cinfo);
+    return true;
+}
+
+bool MjpegRoiDecoder::DecodeCrop(const uint8_t* data, size_t len, Mat& roiBgr)
+{
+    Impl& d = *impl_;
+    if (setjmp(d.err.jb)) {
+        jpeg_abort_decompress(&d.cinfo);
+        lastError_ = d.err.msg;
+        return false;
+    }
+    d.Begin(data, len);
+    if ((int)d.cinfo.image_width != planFrame_.width || (int)d.cinfo.image_height != planFrame_.height) {
+        jpeg_abort_decompress(&d.cinfo);
+        lastError_ = "frame size changed";
+        return false;
+    }
+    jpeg_start_decompress(&d.cinfo);
+
+    // 계획은 이미 MCU 정렬이라 그대로 돌아와야 함 (아니면 계획이 틀린 것 -> 전체 디코드로)
+    JDIMENSION xoff = (JDIMENSION)planDecode_.x;
+    JDIMENSION cw = (JDIMENSION)planDecode_.width;
+    jpeg_crop_scanline(&d.cinfo, &xoff, &cw);
+    if ((int)xoff != planDecode_.x || (int)cw != planDecode_.width) {
+        jpeg_abort_decompress(&d.cinfo);
+        lastError_ = "crop not MCU aligned";
+        return false;
+    }
+
+    if (planDecode_.y > 0) jpeg_skip_scanlines(&d.cinfo, (JDIMENSION)planDecode_.y);
+
+    roiBgr.create(planClip_.height, planClip_.width, CV_8UC3);
+    d.row.resize((size_t)cw * 3);
+    const size_t dx = (size_t)(planClip_.x - planDecode_.x) * 3;
+    const size_t rowBytes = (size_t)planClip_.width * 3;
+    const JDIMENSION yEnd = (JDIMENSION)(planClip_.y + planClip_.height);
+
+    while (d.cinfo.output_scanline < yEnd) {
+        int y = (int)d.cinfo.output_scanline;
+        JSAMPROW row = d.row.data();
+        if (jpeg_read_scanlines(&d.cinfo, &row, 1) != 1) break;
+        if (y >= planClip_.y) memcpy(roiBgr.ptr<uchar>(y - planClip_.y), d.row.data() + dx, rowBytes);
+    }
+    bool complete = d.cinfo.output_scanline >= yEnd;
+
+    // ROI 아래쪽은 디코드하지 않음
+    jpeg_abort_decompress(&d.cinfo);
+    if (!complete) lastError_ = "truncated frame";
+    return complete;
+}
+
+MjpegDecodeKind MjpegRoiDecoder::DecodeRoi(const uint8_t* data, size_t len, const Rect& roi, Mat& roiBgr, Rect* outRoi)
+{
+    if (planned_ && roi == planRoi_) {
+        if (DecodeCrop(data, len, roiBgr)) {
+            stats_.roiDecodes++;
+            stats_.decodedPixels += (uint64_t)planDecode_.area();
+            stats_.framePixels += (uint64_t)planFrame_.area();
+            if (outRoi) *outRoi = planClip_;
+            return MJPEG_DECODE_ROI;
+        }
+        planned_ = false; // 아래에서 전체 디코드 + 재계획
+    }
+
+    if (!DecodeFullInto(data, len, full_)) {
+        stats_.failures++;
+        return MJPEG_DECODE_FAIL;
+    }
+    stats_.fullDecodes++;
+    stats_.decodedPixels += (uint64_t)full_.total();
+    stats_.framePixels += (uint64_t)full_.total();
+
+    Rect clip = roi & Rect(0, 0, full_.cols, full_.rows);
+    if (clip.width <= 0 || clip.height <= 0) {
+        lastError_ = "roi outside frame";
+        return MJPEG_DECODE_FAIL;
+    }
+    full_(clip).copyTo(roiBgr);
+    if (outRoi) *outRoi = clip;
+
+    // 다음 프레임부터 쓸 crop 계획: ROI 를 MCU 1개씩 넓혀서 MCU 경계로 맞춤
+    const int mw = impl_->mcuW, mh = impl_->mcuH;
+    int x0 = max(0, clip.x - mw) / mw * mw;
+    int x1 = min(full_.cols, clip.x + clip.width + mw);
+    int y0 = max(0, clip.y - mh) / mh * mh;
+    int y1 = clip.y + clip.height;
+
+    planned_ = true;
+    planRoi_ = roi;
+    planClip_ = clip;
+    planFrame_ = full_.size();
+    planDecode_ = Rect(x0, y0, x1 - x0, y1 - y0);
+    return MJPEG_DECODE_FULL;
+}
+
+Rect MjpegRoiDecoder::PlannedRect() const
+{
+    return planned_ ? planDecode_ : Rect();
+}
+
+// =====================
+// .mjpeg 스트림 분할
+// =====================
+vector<pair<size_t, size_t>> SplitMjpegStream(const uint8_t* data, size_t len)
+{
+    vector<pair<size_t, size_t>> frames;
+    size_t i = 0;
+
+    while (i + 1 < len) {
+        // SOI 찾기
+        while (i + 1 < len && !(data[i] == 0xFF && data[i + 1] == 0xD8)) i++;
+        if (i + 1 >= len) break;
+
+        size_t start = i;
+        size_t p = i + 2;
+        bool done = false, broken = false;
+
+        while (!done && !broken) {
+            if (p + 1 >= len) { broken = true; break; }
+            if (data[p] != 0xFF) { broken = true; break; }
+            while (p + 1 < len && data[p + 1] == 0xFF) p++; // fill byte
+            if (p + 1 >= len) { broken = true; break; }
+
+            uint8_t m = data[p + 1];
+            if (m == 0xD9) { // EOI
+                frames.push_back({ start, p + 2 - start });
+                i = p + 2;
+                done = true;
+            }
+            else if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) {
+                p += 2;
+            }
+            else {
+                if (p + 3 >= len) { broken = true; break; }
+                size_t segLen = ((size_t)data[p + 2] << 8) | data[p + 3];
+                if (segLen < 2) { broken = true; break; }
+                p += 2 + segLen;
+
+                if (m == 0xDA) {
+                    // 엔트로피 데이터: FF00(스터핑), RSTn 은 데이터의 일부
+                    while (p + 1 < len) {
+                        if (data[p] != 0xFF) { p++; continue; }
+                        uint8_t n = data[p + 1];
+                        if (n == 0x00 || (n >= 0xD0 && n <= 0xD7)) { p += 2; continue; }
+                        if (n == 0xFF) { p++; continue; }
+                        break;
+                    }
+                }
+            }
+        }
+
+        // 깨진 프레임은 건너뛰고 다음 SOI 부터
+        if (broken) i = start + 2;
+    }
+    return frames;
+}
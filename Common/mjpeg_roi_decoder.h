@@ -0,0 +1,82 @@
+﻿#pragma once
+
+// mjpeg_roi_decoder.h
+// - 카메라 MJPEG 패킷(JPEG 1장)을 libjpeg-turbo 로 직접 디코드
+// - ROI 디코드: jpeg_crop_scanline 으로 ROI 를 덮는 MCU 열만, jpeg_skip_scanlines 로 ROI 위쪽 행은
+//   IDCT/색변환 없이 건너뛰고, ROI 아래쪽은 아예 읽지 않음 (1920x1080 중 550x1000 -> 약 1/4)
+// - crop 영역은 ROI 좌우/위로 MCU 1개씩 넓힌다 (크로마 업샘플링이 경계 밖 픽셀을 참조하므로
+//   이렇게 해야 전체 디코드 후 잘라낸 것과 픽셀이 같음)
+// - ROI 나 프레임 크기(헤더)가 바뀐 첫 프레임은 전체 디코드 후 잘라서 돌려주고 crop 계획만 새로 세움.
+//   crop 디코드가 실패한 프레임도 전체 디코드로 한 번 더 시도
+// - 출력은 BGR (JCS_EXT_BGR). Huffman 테이블이 없는 UVC MJPEG 도 libjpeg-turbo 가 기본 테이블로 처리
+//
+// 빌드: libjpeg-turbo 필요 (jpeglib.h, jpeg.lib / libjpeg)
+//   VisionWorker.vcxproj (x64): 환경 변수 LIBJPEG_TURBO_DIR = 설치 폴더 (예: C:\libjpeg-turbo64) -> include, lib\jpeg.lib
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum MjpegDecodeKind {
+    MJPEG_DECODE_FAIL = 0,
+    MJPEG_DECODE_ROI = 1,  // crop 디코드
+    MJPEG_DECODE_FULL = 2, // 전체 디코드 후 잘라냄 (ROI 변경 / crop 실패)
+};
+
+struct MjpegDecodeStats {
+    uint64_t roiDecodes = 0;
+    uint64_t fullDecodes = 0;
+    uint64_t failures = 0;
+    uint64_t decodedPixels = 0; // 실제로 색변환까지 한 픽셀 수
+    uint64_t framePixels = 0;   // 같은 프레임들의 전체 픽셀 수
+};
+
+class MjpegRoiDecoder {
+public:
+    MjpegRoiDecoder();
+    ~MjpegRoiDecoder();
+    MjpegRoiDecoder(const MjpegRoiDecoder&) = delete;
+    MjpegRoiDecoder& operator=(const MjpegRoiDecoder&) = delete;
+
+    // 헤더만 읽어서 프레임 크기
+    bool PeekSize(const uint8_t* data, size_t len, int& width, int& height);
+
+    // 전체 디코드 (BGR)
+    bool DecodeFull(const uint8_t* data, size_t len, cv::Mat& bgr);
+
+    // ROI 만 디코드. roi 는 프레임 안으로 잘라서 outRoi 에 돌려줌. roiBgr = outRoi 크기 BGR
+    MjpegDecodeKind DecodeRoi(const uint8_t* data, size_t len, const cv::Rect& roi, cv::Mat& roiBgr,
+        cv::Rect* outRoi = nullptr);
+
+    // 현재 crop 계획 (실제로 디코드하는 영역, MCU 정렬). 계획 없으면 빈 Rect
+    cv::Rect PlannedRect() const;
+
+    const MjpegDecodeStats& Stats() const { return stats_; }
+    const std::string& LastError() const { return lastError_; }
+
+private:
+    struct Impl;
+
+    bool DecodeFullInto(const uint8_t* data, size_t len, cv::Mat& bgr);
+    bool DecodeCrop(const uint8_t* data, size_t len, cv::Mat& roiBgr);
+
+    std::unique_ptr<Impl> impl_;
+    MjpegDecodeStats stats_;
+    std::string lastError_;
+
+    // crop 계획 (ROI / 프레임 크기가 같을 때만 재사용)
+    bool planned_ = false;
+    cv::Rect planRoi_;   // 요청 ROI (클립 전)
+    cv::Rect planClip_;  // 프레임 안으로 클립한 ROI
+    cv::Size planFrame_;
+    cv::Rect planDecode_; // 디코드 영역 (MCU 정렬 + 여유)
+    cv::Mat full_;        // 전체 디코드 버퍼 재사용
+};
+
+// 연속된 JPEG 들(.mjpeg 녹화 파일)을 프레임 단위로 나눈다: (시작 위치, 길이)
+// SOI~EOI 를 마커 구조로 따라가므로 엔트로피 데이터 안의 0xFF 에 속지 않음
+std::vector<std::pair<size_t, size_t>> SplitMjpegStream(const uint8_t* data, size_t len);
@@ -0,0 +1,113 @@
+﻿#include "packed_morph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// o[x] = o[x] AND/OR p[x], 8픽셀(= 8평면 x 8픽셀 = 64비트)씩 한 워드로
+template <bool IsErode>
+static inline void CombineRow(uchar* o, const uchar* p, int n)
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        uint64_t a, b;
+        memcpy(&a, o + x, 8);
+        memcpy(&b, p + x, 8);
+        a = IsErode ? (a & b) : (a | b);
+        memcpy(o + x, &a, 8);
+    }
+    for (; x < n; x++) o[x] = IsErode ? (uchar)(o[x] & p[x]) : (uchar)(o[x] | p[x]);
+}
+
+// IsErode: AND (영상 밖 = 0xFF), 아니면 OR (영상 밖 = 0)
+template <bool IsErode>
+static void MorphRectOnce(const Mat& src, Mat& dst, int ksize)
+{
+    CV_Assert(src.type() == CV_8UC1);
+
+    const int w = src.cols, h = src.rows;
+    const int a = ksize / 2;
+    const uchar ident = IsErode ? 0xFF : 0x00;
+
+    if (ksize <= 1 || w == 0 || h == 0) {
+        if (dst.data != src.data) src.copyTo(dst);
+        return;
+    }
+
+    // 1) 가로: 양끝에 항등원을 붙인 행에서 로그 단계 (AND/OR 는 겹쳐도 되므로)
+    //    pad[x] = [x, x+span) 구간 결과로 span 을 1,2,4.. 배로 늘리고 (pad[x] op= pad[x+span], 앞에서부터 제자리)
+    //    마지막에 [x, x+span) op [x+k-span, x+k) = [x, x+k) -> 픽셀당 O(log k), 한 번에 한 워드
+    int span = 1;
+    while (span * 2 <= ksize) span *= 2;
+
+    Mat tmp(h, w, CV_8UC1);
+    const int len = w + 2 * a;
+    vector<uchar> pad((size_t)len, ident);
+    for (int y = 0; y < h; y++) {
+        memcpy(pad.data() + a, src.ptr<uchar>(y), (size_t)w);
+        for (int x = 0; x < a; x++) pad[(size_t)x] = pad[(size_t)(a + w + x)] = ident; // 앞 행의 단계 결과 지움
+
+        for (int s = 1; s < span; s *= 2) CombineRow<IsErode>(pad.data(), pad.data() + s, len - s);
+
+        uchar* o = tmp.ptr<uchar>(y);
+        memcpy(o, pad.data(), (size_t)w);
+        if (span < ksize) CombineRow<IsErode>(o, pad.data() + (ksize - span), w);
+    }
+
+    // 2) 세로: 영상 안의 행만 (밖은 항등원이라 생략), 행끼리 워드 단위
+    dst.create(h, w, CV_8UC1);
+    for (int y = 0; y < h; y++) {
+        int y0 = max(0, y - a), y1 = min(h - 1, y + a);
+
+        uchar* o = dst.ptr<uchar>(y);
+        memcpy(o, tmp.ptr<uchar>(y0), (size_t)w);
+        for (int yy = y0 + 1; yy <= y1; yy++) CombineRow<IsErode>(o, tmp.ptr<uchar>(yy), w);
+    }
+}
+
+static int IteratedKernel(int ksize, int iterations)
+{
+    return (ksize - 1) * max(1, iterations) + 1;
+}
+
+void PackedErodeRect(const Mat& src, Mat& dst, int ksize, int iterations)
+{
+    MorphRectOnce<true>(src, dst, IteratedKernel(ksize, iterations));
+}
+
+void PackedDilateRect(const Mat& src, Mat& dst, int ksize, int iterations)
+{
+    MorphRectOnce<false>(src, dst, IteratedKernel(ksize, iterations));
+}
+
+void PackedOpenRect(const Mat& src, Mat& dst, int ksize, int iterations)
+{
+    PackedErodeRect(src, dst, ksize, iterations);
+    PackedDilateRect(dst, dst, ksize, iterations);
+}
+
+void PackedCloseRect(const Mat& src, Mat& dst, int ksize, int iterations)
+{
+    PackedDilateRect(src, dst, ksize, iterations);
+    PackedErodeRect(dst, dst, ksize, iterations);
+}
+
+void CountPackedBits(const Mat& packed, int planes, int* outCounts)
+{
+    CV_Assert(packed.type() == CV_8UC1 && planes >= 1 && planes <= 8);
+
+    int hist[256] = {};
+    for (int y = 0; y < packed.rows; y++) {
+        const uchar* p = packed.ptr<uchar>(y);
+        for (int x = 0; x < packed.cols; x++) hist[p[x]]++;
+    }
+
+    for (int b = 0; b < planes; b++) {
+        int n = 0;
+        for (int v = 0; v < 256; v++) if (v & (1 << b)) n += hist[v];
+        outCounts[b] = n;
+    }
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+// packed_morph.h
+// - 여러 이진 마스크를 한 장의 8U 영상에 비트 평면으로 묶어서 한 번에 모폴로지
+//   (비트별 AND = 평면별 min = erode, 비트별 OR = 평면별 max = dilate)
+// - 사각 커널, 분리형(가로 -> 세로). 8픽셀(64비트) 워드 단위 AND/OR, 가로는 로그 단계(픽셀당 O(log k))
+//   영상 밖은 OpenCV erode/dilate 기본 border 와 같이
+//   "영향 없음"(erode: 1, dilate: 0)으로 취급 -> 평면별 cv::erode/dilate 결과와 비트 단위로 동일
+// - 사각 커널 k 를 n 번 반복 = 크기 (k-1)*n+1 한 번 (OpenCV 도 내부에서 같은 변환)
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+// src: CV_8UC1 (비트 평면), ksize: 홀수. dst 는 src 와 같아도 됨
+void PackedErodeRect(const cv::Mat& src, cv::Mat& dst, int ksize, int iterations = 1);
+void PackedDilateRect(const cv::Mat& src, cv::Mat& dst, int ksize, int iterations = 1);
+
+// morphologyEx(MORPH_OPEN / MORPH_CLOSE) 와 동일
+void PackedOpenRect(const cv::Mat& src, cv::Mat& dst, int ksize, int iterations = 1);
+void PackedCloseRect(const cv::Mat& src, cv::Mat& dst, int ksize, int iterations = 1);
+
+// 값별 히스토그램 1회 -> 비트 평면별 켜진 픽셀 수 (planes <= 8)
+void CountPackedBits(const cv::Mat& packed, int planes, int* outCounts);
@@ -0,0 +1,219 @@
+﻿#include "rle_mask.h"
+
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+int RleLabeler::Find(vector<int>& parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void RleLabeler::Run(const Mat& mask)
+{
+    CV_Assert(mask.empty() || mask.type() == CV_8UC1);
+
+    runs_.clear();
+    parent_.clear();
+    runComp_.clear();
+    comps_.clear();
+    gaps_.clear();
+    gapParent_.clear();
+    gapLeftRun_.clear();
+    runLeftGap_.clear();
+
+    int prevBegin = 0, prevEnd = 0;       // 윗 행 run 구간 [prevBegin, prevEnd)
+    int prevGapBegin = 0, prevGapEnd = 0; // 윗 행 배경 run 구간
+    for (int y = 0; y < mask.rows; y++) {
+        const uchar* p = mask.ptr<uchar>(y);
+        int curBegin = (int)runs_.size();
+        int gapBegin = (int)gaps_.size();
+
+        // 1) 행 -> 배경 run / 전경 run 번갈아
+        int x = 0;
+        while (x < mask.cols) {
+            int g0 = x;
+            while (x < mask.cols && !p[x]) x++;
+            if (x > g0) {
+                MaskRun g;
+                g.y = y;
+                g.x0 = g0;
+                g.x1 = x - 1;
+                gaps_.push_back(g);
+                gapParent_.push_back((int)gapParent_.size());
+                gapLeftRun_.push_back(g0 > 0 ? (int)runs_.size() - 1 : -1);
+            }
+            if (x >= mask.cols) break;
+            int x0 = x;
+            while (x < mask.cols && p[x]) x++;
+
+            MaskRun r;
+            r.y = y;
+            r.x0 = x0;
+            r.x1 = x - 1;
+            runs_.push_back(r);
+            parent_.push_back((int)parent_.size());
+            runLeftGap_.push_back(x0 > 0 ? (int)gaps_.size() - 1 : -1);
+        }
+        int curEnd = (int)runs_.size();
+        int gapEnd = (int)gaps_.size();
+
+        // 2) 윗 행 run 과 8-연결이면 합치기 (두 행 모두 x 순서 -> 투 포인터)
+        int j = prevBegin;
+        for (int i = curBegin; i < curEnd; i++) {
+            const MaskRun& c = runs_[i];
+            while (j < prevEnd && runs_[j].x1 < c.x0 - 1) j++;
+            for (int k = j; k < prevEnd && runs_[k].x0 <= c.x1 + 1; k++) {
+                int a = Find(parent_, i), b = Find(parent_, k);
+                if (a != b) parent_[max(a, b)] = min(a, b);
+            }
+        }
+
+        // 3) 배경 run 은 4-연결 (x 가 겹칠 때만) -> 전경 8-연결과 짝이 맞아 구멍이 대각선으로 새지 않음
+        j = prevGapBegin;
+        for (int i = gapBegin; i < gapEnd; i++) {
+            const MaskRun& c = gaps_[i];
+            while (j < prevGapEnd && gaps_[j].x1 < c.x0) j++;
+            for (int k = j; k < prevGapEnd && gaps_[k].x0 <= c.x1; k++) {
+                int a = Find(gapParent_, i), b = Find(gapParent_, k);
+                if (a != b) gapParent_[max(a, b)] = min(a, b);
+            }
+        }
+
+        prevBegin = curBegin;
+        prevEnd = curEnd;
+        prevGapBegin = gapBegin;
+        prevGapEnd = gapEnd;
+    }
+
+    // 4) run 단위로 통계 누적
+    runComp_.assign(runs_.size(), -1);
+    vector<int> rootComp(runs_.size(), -1);
+    vector<double> sumX, sumY;
+    vector<Point> minPt, maxPt;
+
+    for (int i = 0; i < (int)runs_.size(); i++) {
+        int root = Find(parent_, i);
+        int ci = rootComp[root];
+        if (ci < 0) {
+            ci = (int)comps_.size();
+            rootComp[root] = ci;
+            comps_.push_back(ComponentStats());
+            sumX.push_back(0.0);
+            sumY.push_back(0.0);
+            minPt.push_back(Point(runs_[i].x0, runs_[i].y));
+            maxPt.push_back(Point(runs_[i].x1, runs_[i].y));
+        }
+        runComp_[i] = ci;
+
+        const MaskRun& r = runs_[i];
+        int len = r.x1 - r.x0 + 1;
+        comps_[ci].area += len;
+        sumX[ci] += 0.5 * (double)(r.x0 + r.x1) * len;
+        sumY[ci] += (double)r.y * len;
+
+        minPt[ci].x = min(minPt[ci].x, r.x0);
+        maxPt[ci].x = max(maxPt[ci].x, r.x1);
+        maxPt[ci].y = r.y; // run 은 y 오름차순
+    }
+
+    for (int ci = 0; ci < (int)comps_.size(); ci++) {
+        ComponentStats& cs = comps_[ci];
+        cs.bbox = Rect(minPt[ci], Point(maxPt[ci].x + 1, maxPt[ci].y + 1));
+        cs.centroid = Point2d(sumX[ci] / (double)cs.area, sumY[ci] / (double)cs.area);
+    }
+
+    FillHoles(mask.rows, mask.cols);
+}
+
+// 구멍 포함 면적
+// - 테두리에 닿지 않는 배경 성분 = 구멍. 맨 처음(가장 위, 왼쪽) 배경 run 의 바로 왼쪽 전경 run 이 그 구멍을 둘러싼 성분
+// - 전경 성분의 맨 처음 run 바로 왼쪽 배경 run 이 구멍이면 그 성분은 구멍 속 섬 (둘러싼 성분의 filled 에 포함)
+// - 구멍/섬 면적을 둘러싼 성분들(안쪽 -> 바깥쪽)에 더함
+void RleLabeler::FillHoles(int rows, int cols)
+{
+    int nComp = (int)comps_.size();
+    vector<int> rootHole(gaps_.size(), -1);
+    vector<int> gapHole(gaps_.size(), -1);
+    vector<int64_t> holeArea;
+    vector<int> holeOwner;   // 구멍을 둘러싼 전경 성분
+    vector<char> holeOpen;   // 테두리에 닿음 (= 바깥)
+
+    for (int i = 0; i < (int)gaps_.size(); i++) {
+        int root = Find(gapParent_, i);
+        int h = rootHole[root];
+        if (h < 0) {
+            h = (int)holeArea.size();
+            rootHole[root] = h;
+            holeArea.push_back(0);
+            holeOwner.push_back(gapLeftRun_[i] >= 0 ? runComp_[gapLeftRun_[i]] : -1);
+            holeOpen.push_back(0);
+        }
+        gapHole[i] = h;
+
+        const MaskRun& g = gaps_[i];
+        holeArea[h] += g.x1 - g.x0 + 1;
+        if (g.y == 0 || g.y == rows - 1 || g.x0 == 0 || g.x1 == cols - 1) holeOpen[h] = 1;
+    }
+
+    // 성분 -> 들어 있는 구멍 (없으면 -1)
+    vector<int> compHole(nComp, -1);
+    vector<char> seen(nComp, 0);
+    for (int i = 0; i < (int)runs_.size(); i++) {
+        int ci = runComp_[i];
+        if (seen[ci]) continue;
+        seen[ci] = 1;
+        int g = runLeftGap_[i];
+        if (g >= 0 && !holeOpen[gapHole[g]]) compHole[ci] = gapHole[g];
+    }
+
+    // amount 를 성분 ci 와 그 바깥 성분들에 (중첩 깊이만큼, 고리 방지로 nComp 번까지)
+    auto addUp = [&](int ci, int64_t amount) {
+        for (int step = 0; ci >= 0 && step <= nComp; step++) {
+            comps_[ci].filled += amount;
+            int h = compHole[ci];
+            ci = (h >= 0) ? holeOwner[h] : -1;
+        }
+    };
+    for (int ci = 0; ci < nComp; ci++) addUp(ci, comps_[ci].area);
+    for (int h = 0; h < (int)holeArea.size(); h++)
+        if (!holeOpen[h] && holeOwner[h] >= 0) addUp(holeOwner[h], holeArea[h]);
+}
+
+int RleLabeler::Largest(double minArea) const
+{
+    int best = -1;
+    int64_t bestArea = 0;
+    for (int i = 0; i < (int)comps_.size(); i++) {
+        const ComponentStats& cs = comps_[i];
+        if ((double)cs.filled < minArea) continue;
+        if (cs.filled > bestArea) { bestArea = cs.filled; best = i; }
+    }
+    return best;
+}
+
+void RleLabeler::BoundaryPoints(int comp, vector<Point>& out) const
+{
+    out.clear();
+    if (comp < 0 || comp >= (int)comps_.size()) return;
+
+    for (size_t i = 0; i < runs_.size(); i++) {
+        if (runComp_[i] != comp) continue;
+        const MaskRun& r = runs_[i];
+        out.push_back(Point(r.x0, r.y));
+        if (r.x1 != r.x0) out.push_back(Point(r.x1, r.y));
+    }
+}
+
+RotatedRect RleLabeler::MinAreaRect(int comp) const
+{
+    vector<Point> pts;
+    BoundaryPoints(comp, pts);
+    if (pts.empty()) return RotatedRect();
+    return minAreaRect(pts);
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+// rle_mask.h
+// - 이진 마스크를 행별 run(연속 구간)으로 압축하고, run 단위 union-find 로 8-연결 성분 라벨링
+// - 성분마다 면적(픽셀 수)/bbox/무게중심을 run 에서 바로 계산 (컨투어 추적 없음)
+// - 배경 run(행의 빈 구간)도 4-연결로 묶어서 테두리에 닿지 않는 배경 = 구멍
+//   -> filled = 외곽선 안쪽 전체 (픽셀 + 구멍 + 구멍 속 성분). findContours(RETR_EXTERNAL) + contourArea 처럼
+//      흰 QR 라벨/반사로 뚫린 박스도 면적이 줄지 않음 (contourArea 보다 외곽 둘레의 절반쯤 큼)
+// - 경계점/minAreaRect 는 필요한 성분(보통 최대 성분) 하나에만:
+//   성분의 볼록껍질 = 각 run 양 끝점들의 볼록껍질 -> findContours 외곽선으로 구한 minAreaRect 와 같음
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct MaskRun {
+    int y = 0;
+    int x0 = 0; // 포함
+    int x1 = 0; // 포함
+};
+
+struct ComponentStats {
+    int64_t area = 0;   // 픽셀 수
+    int64_t filled = 0; // 구멍 포함 면적 (외곽선 안쪽 픽셀 수)
+    cv::Rect bbox;
+    cv::Point2d centroid;
+};
+
+class RleLabeler {
+public:
+    // mask: CV_8UC1, 0 이 아닌 픽셀 = 전경
+    void Run(const cv::Mat& mask);
+
+    const std::vector<MaskRun>& Runs() const { return runs_; }
+    const std::vector<ComponentStats>& Components() const { return comps_; }
+    const std::vector<int>& RunComponents() const { return runComp_; } // run -> 성분 번호
+
+    // 구멍 포함 면적(filled) minArea 이상 중 가장 큰 성분 번호 (없으면 -1)
+    int Largest(double minArea) const;
+
+    // 성분의 run 양 끝점 (볼록껍질/minAreaRect 입력용)
+    void BoundaryPoints(int comp, std::vector<cv::Point>& out) const;
+    cv::RotatedRect MinAreaRect(int comp) const;
+
+private:
+    static int Find(std::vector<int>& parent, int i);
+    void FillHoles(int rows, int cols);
+
+    std::vector<MaskRun> runs_;
+    std::vector<int> parent_;   // run -> union-find 부모
+    std::vector<int> runComp_;  // run -> 성분 번호
+    std::vector<ComponentStats> comps_;
+
+    std::vector<MaskRun> gaps_;     // 배경 run
+    std::vector<int> gapParent_;    // 배경 run -> union-find 부모 (4-연결)
+    std::vector<int> gapLeftRun_;   // 배경 run 바로 왼쪽 전경 run (행 시작이면 -1)
+    std::vector<int> runLeftGap_;   // 전경 run 바로 왼쪽 배경 run (x0 == 0 이면 -1)
+};
@@ -0,0 +1,349 @@
+﻿#include "spc_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+enum AlarmBit { AL_EWMA_HIGH = 1, AL_EWMA_LOW = 2, AL_NEAR_LSL = 4, AL_NEAR_USL = 8 };
+
+static const char* AlarmName(int bit)
+{
+    switch (bit) {
+    case AL_EWMA_HIGH: return "EWMA_HIGH";
+    case AL_EWMA_LOW: return "EWMA_LOW";
+    case AL_NEAR_LSL: return "NEAR_LSL";
+    default: return "NEAR_USL";
+    }
+}
+
+// =====================
+// SpcRunning
+// =====================
+void SpcRunning::Add(double v, double lambda)
+{
+    n++;
+    double d = v - mean;
+    mean += d / (double)n;
+    m2 += d * (v - mean);
+    if (n == 1) {
+        minV = maxV = v;
+        ewma = centerFixed ? center : v;
+    }
+    else {
+        mrSum += fabs(v - prev);
+        minV = min(minV, v);
+        maxV = max(maxV, v);
+    }
+    ewma = lambda * v + (1.0 - lambda) * ewma;
+    prev = v;
+}
+
+double SpcRunning::Stddev() const
+{
+    return sqrt(max(0.0, Variance()));
+}
+
+// =====================
+// RateRing (1초 칸 60개)
+// =====================
+void SpcEngine::RateRing::Add(int64_t tsMs)
+{
+    int64_t s = tsMs / 1000;
+    int k = (int)(((s % 60) + 60) % 60);
+    if (sec[k] != s) { sec[k] = s; count[k] = 0; }
+    count[k]++;
+}
+
+double SpcEngine::RateRing::PerMinute(int64_t nowMs) const
+{
+    int64_t now = nowMs / 1000;
+    uint64_t sum = 0;
+    for (int k = 0; k < 60; k++)
+        if (count[k] && sec[k] > now - 60 && sec[k] <= now) sum += count[k];
+    return (double)sum;
+}
+
+// =====================
+// SpcEngine
+// =====================
+SpcEngine::SpcEngine(const SpcOptions& opt)
+    : opt_(opt)
+{
+    opt_.ewmaLambda = min(1.0, max(0.01, opt_.ewmaLambda));
+    opt_.warmup = max(2, opt_.warmup);
+}
+
+void SpcEngine::SetMetric(const string& group, const string& metric, const SpcMetricConfig& cfg)
+{
+    lock_guard<mutex> lk(mtx_);
+    cfg_[make_pair(group, metric)] = cfg;
+}
+
+const SpcMetricConfig* SpcEngine::FindCfg(const string& group, const string& metric) const
+{
+    auto it = cfg_.find(make_pair(group, metric));
+    return (it != cfg_.end()) ? &it->second : nullptr;
+}
+
+// 규격 없거나 n < 2 / σ = 0 이면 NaN
+static double Cpk(const SpcMetricConfig* c, const SpcRunning& s)
+{
+    double sd = s.Stddev();
+    if (!c || !c->hasSpec || s.n < 2 || sd <= 0.0) return NAN;
+    return min(c->usl - s.mean, s.mean - c->lsl) / (3.0 * sd);
+}
+
+uint64_t SpcEngine::Version() const
+{
+    lock_guard<mutex> lk(mtx_);
+    return version_;
+}
+
+// EWMA 통계량의 표준편차 (시작 직후 작은 값 -> 점근값)
+double SpcEngine::EwmaSigma(const SpcRunning& s) const
+{
+    double l = opt_.ewmaLambda;
+    double f = 1.0 - pow(1.0 - l, 2.0 * (double)s.n);
+    return s.ShortSigma() * sqrt(l / (2.0 - l) * f);
+}
+
+void SpcEngine::Add(int64_t tsMs, const vector<string>& groups, const vector<pair<string, double>>& values,
+    vector<SpcAlarm>* outAlarms)
+{
+    lock_guard<mutex> lk(mtx_);
+    version_++;
+    for (const string& gname : groups) {
+        Group& g = groups_[gname];
+        if (g.count == 0) g.firstMs = tsMs;
+        g.count++;
+        g.lastMs = tsMs;
+        g.rate.Add(tsMs);
+
+        for (const auto& kv : values) {
+            if (!isfinite(kv.second)) continue;
+            SpcRunning& s = g.metrics[kv.first];
+            const SpcMetricConfig* c = FindCfg(gname, kv.first);
+            if (s.n == 0 && c && c->hasSpec) {
+                s.center = c->target;
+                s.centerFixed = true;
+            }
+            s.Add(kv.second, opt_.ewmaLambda);
+            if (!s.centerFixed && s.n == (uint64_t)opt_.warmup) {
+                s.center = s.mean;
+                s.centerFixed = true;
+            }
+            if (c && c->alarm) CheckAlarms(tsMs, gname, kv.first, s, outAlarms);
+        }
+    }
+}
+
+void SpcEngine::CheckAlarms(int64_t tsMs, const string& group, const string& metric, SpcRunning& s,
+    vector<SpcAlarm>* outAlarms)
+{
+    if (s.n < (uint64_t)opt_.warmup) return;
+    const SpcMetricConfig& c = *FindCfg(group, metric);
+
+    double sigma = EwmaSigma(s);
+    double ucl = s.center + opt_.ewmaL * sigma;
+    double lcl = s.center - opt_.ewmaL * sigma;
+    double hys = 0.25 * opt_.ewmaL * sigma; // 한계 안쪽으로 이만큼 돌아와야 해제
+
+    // bit, 켜짐 조건, 해제 조건, 비교한 한계
+    struct Rule { int bit; bool on; bool off; double limit; };
+    vector<Rule> rules;
+    if (sigma > 0.0) {
+        rules.push_back({ AL_EWMA_HIGH, s.ewma > ucl, s.ewma < ucl - hys, ucl });
+        rules.push_back({ AL_EWMA_LOW, s.ewma < lcl, s.ewma > lcl + hys, lcl });
+    }
+    if (c.hasSpec && c.guard > 0.0) {
+        double lo = c.lsl + c.guard, hi = c.usl - c.guard;
+        rules.push_back({ AL_NEAR_LSL, s.ewma < lo, s.ewma > lo + 0.5 * c.guard, lo });
+        rules.push_back({ AL_NEAR_USL, s.ewma > hi, s.ewma < hi - 0.5 * c.guard, hi });
+    }
+
+    for (const Rule& r : rules) {
+        bool was = (s.active & r.bit) != 0;
+        bool raise = !was && r.on;
+        bool clear = was && r.off;
+        if (!raise && !clear) continue;
+
+        if (raise) s.active |= (uint8_t)r.bit;
+        else s.active &= (uint8_t)~r.bit;
+
+        SpcAlarm a;
+        a.tsMs = tsMs;
+        a.group = group;
+        a.metric = metric;
+        a.kind = AlarmName(r.bit);
+        a.raised = raise;
+        a.ewma = s.ewma;
+        a.limit = r.limit;
+        events_.push_back(a);
+        while (events_.size() > opt_.maxEvents) events_.pop_front();
+        if (outAlarms) outAlarms->push_back(a);
+    }
+}
+
+string SpcEngine::FormatAlarm(const SpcAlarm& a)
+{
+    ostringstream oss;
+    oss << (a.raised ? "ALARM " : "CLEAR ") << a.kind << " " << a.group << "/" << a.metric
+        << " ewma=" << fixed << setprecision(3) << a.ewma << " limit=" << a.limit;
+    return oss.str();
+}
+
+// =====================
+// 내보내기
+// =====================
+static string JNum(double v, int prec = 4)
+{
+    if (!isfinite(v)) return "null";
+    ostringstream oss;
+    oss << fixed << setprecision(prec) << v;
+    return oss.str();
+}
+
+string SpcEngine::Json(int64_t nowMs) const
+{
+    lock_guard<mutex> lk(mtx_);
+
+    auto all = groups_.find("ALL");
+    double allCount = (all != groups_.end()) ? (double)all->second.count : 0.0;
+
+    ostringstream j;
+    j << "{\n";
+    j << "  \"ts_ms\": " << nowMs << ",\n";
+    j << "  \"ewma_lambda\": " << JNum(opt_.ewmaLambda, 3) << ",\n";
+    j << "  \"groups\": [";
+    bool firstG = true;
+    for (const auto& gkv : groups_) {
+        const Group& g = gkv.second;
+        double spanMin = (g.lastMs - g.firstMs) / 60000.0;
+        j << (firstG ? "\n" : ",\n");
+        firstG = false;
+        j << "    {\n";
+        j << "      \"name\": \"" << gkv.first << "\",\n";
+        j << "      \"count\": " << g.count << ",\n";
+        j << "      \"share\": " << JNum(allCount > 0 ? g.count / allCount : NAN) << ",\n";
+        j << "      \"rate_per_min\": " << JNum(g.rate.PerMinute(nowMs), 1) << ",\n";
+        j << "      \"avg_rate_per_min\": " << JNum(spanMin > 0 ? (g.count - 1) / spanMin : NAN, 2) << ",\n";
+        j << "      \"last_ms\": " << g.lastMs << ",\n";
+        j << "      \"metrics\": {";
+        bool firstM = true;
+        for (const auto& mkv : g.metrics) {
+            const SpcRunning& s = mkv.second;
+            const SpcMetricConfig* c = FindCfg(gkv.first, mkv.first);
+            bool spec = c && c->hasSpec;
+            double sd = s.Stddev();
+            double cp = (spec && s.n > 1 && sd > 0) ? (c->usl - c->lsl) / (6.0 * sd) : NAN;
+            double cpk = Cpk(c, s);
+            j << (firstM ? "\n" : ",\n");
+            firstM = false;
+            j << "        \"" << mkv.first << "\": {"
+                << "\"n\": " << s.n
+                << ", \"mean\": " << JNum(s.mean)
+                << ", \"stddev\": " << JNum(s.n > 1 ? sd : NAN)
+                << ", \"sigma_short\": " << JNum(s.n > 1 ? s.ShortSigma() : NAN)
+                << ", \"min\": " << JNum(s.minV)
+                << ", \"max\": " << JNum(s.maxV)
+                << ", \"ewma\": " << JNum(s.ewma)
+                << ", \"ewma_center\": " << JNum(s.centerFixed ? s.center : NAN);
+            if (spec) {
+                j << ", \"lsl\": " << JNum(c->lsl) << ", \"usl\": " << JNum(c->usl)
+                    << ", \"cp\": " << JNum(cp, 3) << ", \"cpk\": " << JNum(cpk, 3);
+            }
+            j << "}";
+        }
+        j << (firstM ? "}\n" : "\n      }\n");
+        j << "    }";
+    }
+    j << (firstG ? "],\n" : "\n  ],\n");
+
+    // 켜져 있는 알람
+    j << "  \"alarms_active\": [";
+    bool firstA = true;
+    for (const auto& gkv : groups_) {
+        for (const auto& mkv : gkv.second.metrics) {
+            for (int bit : { AL_EWMA_HIGH, AL_EWMA_LOW, AL_NEAR_LSL, AL_NEAR_USL }) {
+                if (!(mkv.second.active & bit)) continue;
+                j << (firstA ? "\n" : ",\n");
+                firstA = false;
+                j << "    {\"group\": \"" << gkv.first << "\", \"metric\": \"" << mkv.first << "\", \"kind\": \""
+                    << AlarmName(bit) << "\", \"ewma\": " << JNum(mkv.second.ewma) << "}";
+            }
+        }
+    }
+    j << (firstA ? "],\n" : "\n  ],\n");
+
+    j << "  \"alarm_events\": [";
+    for (size_t i = 0; i < events_.size(); i++) {
+        const SpcAlarm& a = events_[i];
+        j << (i ? ",\n" : "\n");
+        j << "    {\"ts_ms\": " << a.tsMs << ", \"group\": \"" << a.group << "\", \"metric\": \"" << a.metric
+            << "\", \"kind\": \"" << a.kind << "\", \"raised\": " << (a.raised ? "true" : "false")
+            << ", \"ewma\": " << JNum(a.ewma) << ", \"limit\": " << JNum(a.limit) << "}";
+    }
+    j << (events_.empty() ? "]\n" : "\n  ]\n");
+    j << "}\n";
+    return j.str();
+}
+
+bool SpcEngine::WriteJson(const string& path, int64_t nowMs) const
+{
+    string text = Json(nowMs);
+    string tmp = path + ".tmp";
+    {
+        ofstream ofs(tmp, ios::out | ios::trunc);
+        if (!ofs.is_open()) return false;
+        ofs << text;
+        if (!ofs) return false;
+    }
+    error_code ec;
+    filesystem::rename(tmp, path, ec);
+    if (ec) {
+        // Windows 에서 대상이 열려 있으면 rename 이 실패할 수 있음 -> 지우고 한 번 더
+        filesystem::remove(path, ec);
+        filesystem::rename(tmp, path, ec);
+    }
+    return !ec;
+}
+
+string SpcEngine::Summary(int64_t nowMs) const
+{
+    lock_guard<mutex> lk(mtx_);
+    ostringstream oss;
+    auto all = groups_.find("ALL");
+    if (all == groups_.end()) return "no data";
+
+    const Group& g = all->second;
+    oss << "n=" << g.count << " rate=" << fixed << setprecision(1) << g.rate.PerMinute(nowMs) << "/min";
+    for (const auto& mkv : g.metrics) {
+        const SpcRunning& s = mkv.second;
+        oss << " " << mkv.first << "=" << setprecision(3) << s.mean << "±" << s.Stddev() << " (ewma " << s.ewma << ")";
+    }
+
+    // 규격 있는 계열: "type:TOP|defect/x ewma 59.9 cpk 1.42"
+    for (const auto& ckv : cfg_) {
+        if (!ckv.second.hasSpec) continue;
+        auto gi = groups_.find(ckv.first.first);
+        if (gi == groups_.end()) continue;
+        auto mi = gi->second.metrics.find(ckv.first.second);
+        if (mi == gi->second.metrics.end()) continue;
+        double cpk = Cpk(&ckv.second, mi->second);
+        oss << " | " << ckv.first.first << "/" << ckv.first.second << " ewma " << setprecision(3) << mi->second.ewma;
+        if (isfinite(cpk)) oss << " cpk " << setprecision(2) << cpk;
+    }
+
+    int active = 0;
+    for (const auto& gkv : groups_)
+        for (const auto& mkv : gkv.second.metrics)
+            for (int bit = 1; bit <= 8; bit <<= 1) active += (mkv.second.active & bit) ? 1 : 0;
+    if (active) oss << " ALARMS=" << active;
+    return oss.str();
+}
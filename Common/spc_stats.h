@@ -0,0 +1,123 @@
+﻿#pragma once
+
+// spc_stats.h
+// - 측정값 온라인 공정 통계 (결과 파일을 다시 읽지 않고 측정 1건마다 O(1) 갱신)
+// - 그룹("ALL", "color:BLUE", "type:TOP" ...) x 지표("x", "y", "ms" ...) 마다
+//     Welford 평균/분산, min/max, EWMA, 규격(LSL/USL) 이 있으면 Cp / Cpk
+// - 그룹마다 개수 / 전체 대비 비율(색 구성) / 최근 60초 분당 개수 (1초 칸 60개 링)
+// - 규격/알람은 (그룹, 지표) 마다 따로 설정 (예: x 규격은 "type:TOP|defect" 에만. 규격이 정하는 판정으로
+//   나눈 그룹(type:TOP)에 걸면 분포가 규격에서 잘려 Cpk 가 부풀므로 잘리기 전 모집단에, ALL/color 는 섞여 있어서 통계만)
+// - 드리프트 알람 (alarm = true 로 설정한 (그룹, 지표) 만):
+//     EWMA_HIGH / EWMA_LOW : EWMA 관리 한계 (중심 ± L·σ·sqrt(λ/(2-λ)·(1-(1-λ)^2t))) 이탈
+//                            중심 = 규격 target (없으면 warmup 개수 때의 평균으로 고정)
+//                            σ = 단기 표준편차 (평균 이동 범위 MR/1.128, 느린 드리프트에 덜 부풀려짐)
+//                            warmup 개수 전에는 알람 없음
+//     NEAR_LSL / NEAR_USL  : EWMA 가 규격 한계에서 guard 안쪽으로 들어옴 (예: x 가 57mm 불량 기준 쪽으로)
+//   들어갈 때 한 번 알리고, 한계 안쪽으로 충분히(히스테리시스) 돌아오면 해제
+// - 스레드 안전 (측정 스레드 Add, 다른 스레드 Json/WriteJson)
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SpcMetricConfig {
+    bool hasSpec = false;  // 규격 있음 -> Cp/Cpk, NEAR_* 알람
+    double lsl = 0.0;
+    double usl = 0.0;
+    double target = 0.0;
+    double guard = 0.0;    // NEAR_* : 한계에서 이만큼 안쪽 (0 = 사용 안 함)
+    bool alarm = false;    // 드리프트 알람 검사
+};
+
+struct SpcOptions {
+    double ewmaLambda = 0.2;
+    double ewmaL = 3.0;     // 관리 한계 폭 (σ 배수)
+    int warmup = 20;        // 이 개수 전에는 알람 없음 (σ 추정)
+    size_t maxEvents = 32;  // JSON 에 남길 최근 알람 이벤트 수
+};
+
+struct SpcAlarm {
+    int64_t tsMs = 0;
+    std::string group;
+    std::string metric;
+    std::string kind;  // EWMA_HIGH / EWMA_LOW / NEAR_LSL / NEAR_USL
+    bool raised = true; // false = 해제
+    double ewma = 0.0;
+    double limit = 0.0;
+};
+
+// Welford + EWMA 한 지표
+struct SpcRunning {
+    uint64_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double minV = 0.0;
+    double maxV = 0.0;
+    double ewma = 0.0;
+    double prev = 0.0;     // 이동 범위용 직전 값
+    double mrSum = 0.0;    // |x(t) - x(t-1)| 합
+    double center = 0.0;   // EWMA 관리 중심
+    bool centerFixed = false;
+    uint8_t active = 0;    // 켜진 알람 비트 (SpcEngine 내부)
+
+    void Add(double v, double lambda);
+    double Variance() const { return n > 1 ? m2 / (double)(n - 1) : 0.0; }
+    double Stddev() const;
+    double ShortSigma() const { return n > 1 ? mrSum / (double)(n - 1) / 1.128 : 0.0; }
+};
+
+class SpcEngine {
+public:
+    explicit SpcEngine(const SpcOptions& opt = SpcOptions());
+
+    // (그룹, 지표) 규격/알람 (설정하지 않은 조합은 통계만)
+    void SetMetric(const std::string& group, const std::string& metric, const SpcMetricConfig& cfg);
+
+    // 측정 1건: 속한 그룹들 + 지표 값들 (NaN 은 건너뜀). 새로 켜지거나 꺼진 알람을 outAlarms 에
+    void Add(int64_t tsMs, const std::vector<std::string>& groups,
+        const std::vector<std::pair<std::string, double>>& values, std::vector<SpcAlarm>* outAlarms = nullptr);
+
+    // 현재 통계 JSON (spc_color.json / spc_vision.json)
+    std::string Json(int64_t nowMs) const;
+    // tmp 에 쓰고 rename
+    bool WriteJson(const std::string& path, int64_t nowMs) const;
+
+    // 콘솔 한 줄 (그룹 "ALL" + 규격 있는 (그룹, 지표) 의 Cpk + 켜진 알람 수)
+    std::string Summary(int64_t nowMs) const;
+
+    uint64_t Version() const; // Add 마다 +1 (바뀐 때만 내보내기용)
+
+    static std::string FormatAlarm(const SpcAlarm& a);
+
+private:
+    struct RateRing {
+        int64_t sec[60] = {};
+        uint32_t count[60] = {};
+        void Add(int64_t tsMs);
+        double PerMinute(int64_t nowMs) const;
+    };
+
+    struct Group {
+        uint64_t count = 0;
+        int64_t firstMs = 0;
+        int64_t lastMs = 0;
+        RateRing rate;
+        std::map<std::string, SpcRunning> metrics;
+    };
+
+    void CheckAlarms(int64_t tsMs, const std::string& group, const std::string& metric, SpcRunning& s,
+        std::vector<SpcAlarm>* outAlarms);
+    double EwmaSigma(const SpcRunning& s) const;
+    const SpcMetricConfig* FindCfg(const std::string& group, const std::string& metric) const;
+
+    SpcOptions opt_;
+    mutable std::mutex mtx_;
+    std::map<std::pair<std::string, std::string>, SpcMetricConfig> cfg_; // (그룹, 지표)
+    std::map<std::string, Group> groups_;
+    std::deque<SpcAlarm> events_;
+    uint64_t version_ = 0;
+};
@@ -0,0 +1,207 @@
+﻿#pragma once
+
+// spsc_queue.h
+// - 단일 생산자 / 단일 소비자(SPSC) 고정 용량 링버퍼. 락 없음 (head/tail 원자 변수 2개)
+// - 스레드 단계(stage) 사이 연결용: 생산자 스레드 하나만 Push, 소비자 스레드 하나만 Pop 해야 한다
+// - 가득 찼을 때 정책 (큐마다 하나)
+//     QUEUE_BLOCK  : 자리가 날 때까지 생산자가 기다림 (결과/판정처럼 잃으면 안 되는 것)
+//     QUEUE_DROP   : 새 항목을 버림 (버린 개수 집계)
+//     QUEUE_LATEST : 한 칸 덮어쓰기 (카메라 프레임). 용량과 상관없이 소비자는 항상 가장 최신 것을 받고,
+//                    꺼내기 전에 덮어쓴 오래된 항목은 skipped 로 집계
+//                    3칸 교환(생산자 칸 / 가운데 / 소비자 칸): 가운데 인덱스 + 새것 비트를 exchange 로 맞바꿈
+// - 기다림은 짧게 yield 하다가 100us sleep (프레임 주기 ms 단위라 condvar 없이 충분)
+// - 템플릿이라 헤더만 있음
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum QueuePolicy {
+    QUEUE_BLOCK = 0,
+    QUEUE_DROP = 1,
+    QUEUE_LATEST = 2,
+};
+
+struct QueueStats {
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;  // 가득 차서 버린 새 항목 (DROP)
+    uint64_t skipped = 0;  // 꺼내기 전에 더 새 것으로 밀려난 항목 (LATEST 덮어쓰기 / PopLatest)
+    size_t depth = 0;
+    size_t maxDepth = 0;
+    size_t capacity = 0;
+};
+
+template <typename T>
+class SpscQueue {
+public:
+    // capacity 는 2의 거듭제곱으로 올림 (LATEST 는 무시, 항상 1)
+    SpscQueue(size_t capacity, QueuePolicy policy)
+        : policy_(policy)
+    {
+        if (policy_ == QUEUE_LATEST) {
+            buf_.resize(3);
+            mask_ = 0;
+            return;
+        }
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        buf_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // ---- 생산자 ----
+
+    // 자리 있으면 넣고 true. 가득이면 v 는 그대로 두고 false (LATEST 는 항상 true)
+    bool TryPush(T& v)
+    {
+        if (policy_ == QUEUE_LATEST) {
+            PushLatest(v);
+            return true;
+        }
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t h = head_.load(std::memory_order_acquire);
+        if (t - h > mask_) return false;
+        buf_[t & mask_] = std::move(v);
+        tail_.store(t + 1, std::memory_order_release);
+
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+        size_t d = t + 1 - h;
+        if (d > maxDepth_.load(std::memory_order_relaxed)) maxDepth_.store(d, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 정책대로 넣기. BLOCK 이면 자리가 날 때까지 (stop 이 켜지면 포기하고 false)
+    // DROP 은 가득이면 버리고 false, LATEST 는 덮어쓰고 true
+    bool Push(T v, const std::atomic<bool>& stop)
+    {
+        if (policy_ != QUEUE_BLOCK) {
+            if (TryPush(v)) return true;
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        for (int spin = 0; !TryPush(v); spin++) {
+            if (stop.load(std::memory_order_relaxed)) return false;
+            Backoff(spin);
+        }
+        return true;
+    }
+
+    // ---- 소비자 ----
+
+    bool TryPop(T& out)
+    {
+        if (policy_ == QUEUE_LATEST) {
+            if (!(mid_.load(std::memory_order_relaxed) & LATEST_FRESH)) return false;
+            uint8_t m = mid_.exchange(front_, std::memory_order_acq_rel);
+            front_ = m & LATEST_INDEX;
+            out = std::move(buf_[front_]);
+            buf_[front_] = T();
+            return true;
+        }
+        size_t h = head_.load(std::memory_order_relaxed);
+        size_t t = tail_.load(std::memory_order_acquire);
+        if (h == t) return false;
+        out = std::move(buf_[h & mask_]);
+        buf_[h & mask_] = T(); // Mat 같은 큰 버퍼는 바로 놓아줌
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 하나 올 때까지 최대 timeoutMs 기다림 (stop 이 켜지면 바로 false)
+    bool Pop(T& out, const std::atomic<bool>& stop, int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        for (int spin = 0; !TryPop(out); spin++) {
+            if (stop.load(std::memory_order_relaxed)) return false;
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            Backoff(spin);
+        }
+        return true;
+    }
+
+    // 쌓인 것을 모두 꺼내고 가장 최신 것만 돌려줌 (없으면 Pop 처럼 기다림). LATEST 는 Pop 과 같음
+    bool PopLatest(T& out, const std::atomic<bool>& stop, int timeoutMs)
+    {
+        if (!Pop(out, stop, timeoutMs)) return false;
+        T newer;
+        while (TryPop(newer)) {
+            out = std::move(newer);
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // ---- 아무 스레드 (대략값) ----
+
+    size_t Depth() const
+    {
+        if (policy_ == QUEUE_LATEST) return (mid_.load(std::memory_order_acquire) & LATEST_FRESH) ? 1 : 0;
+        size_t t = tail_.load(std::memory_order_acquire);
+        size_t h = head_.load(std::memory_order_acquire);
+        return t >= h ? t - h : 0;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+    QueuePolicy Policy() const { return policy_; }
+
+    QueueStats Stats() const
+    {
+        QueueStats s;
+        s.pushed = pushed_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.skipped = skipped_.load(std::memory_order_relaxed);
+        s.depth = Depth();
+        s.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+        s.capacity = Capacity();
+        return s;
+    }
+
+private:
+    static const uint8_t LATEST_INDEX = 3;
+    static const uint8_t LATEST_FRESH = 4;
+
+    // 생산자 칸에 쓰고 가운데와 맞바꿈. 가운데에 안 꺼낸 게 있었으면 그건 밀려남 (skipped)
+    void PushLatest(T& v)
+    {
+        buf_[back_] = std::move(v);
+        uint8_t m = mid_.exchange((uint8_t)(back_ | LATEST_FRESH), std::memory_order_acq_rel);
+        back_ = m & LATEST_INDEX;
+        if (m & LATEST_FRESH) {
+            buf_[back_] = T(); // 밀려난 프레임 버퍼는 바로 놓아줌
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+        maxDepth_.store(1, std::memory_order_relaxed);
+    }
+
+    static void Backoff(int spin)
+    {
+        if (spin < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+    const QueuePolicy policy_;
+
+    // 생산자/소비자가 서로 다른 캐시 라인을 쓰게
+    alignas(64) std::atomic<size_t> head_{ 0 }; // 소비자가 다음에 꺼낼 위치
+    alignas(64) std::atomic<size_t> tail_{ 0 }; // 생산자가 다음에 넣을 위치
+
+    // LATEST 3칸: back_ 은 생산자만, front_ 는 소비자만, mid_ = 가운데 칸 인덱스 | 새것 비트
+    std::atomic<uint8_t> mid_{ 1 };
+    uint8_t back_ = 0;
+    uint8_t front_ = 2;
+
+    alignas(64) std::atomic<uint64_t> pushed_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<size_t> maxDepth_{ 0 };
+    std::atomic<uint64_t> skipped_{ 0 };
+};
@@ -0,0 +1,115 @@
+﻿#include "trace_ring.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+static uint32_t ThisThreadTraceId()
+{
+    static atomic<uint32_t> nextTid{ 0 };
+    thread_local uint32_t tid = nextTid.fetch_add(1, memory_order_relaxed) + 1;
+    return tid;
+}
+
+TraceRing::TraceRing(size_t capacity)
+{
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    buf_.resize(cap);
+    mask_ = cap - 1;
+}
+
+int64_t TraceRing::NowUs()
+{
+    using namespace chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void TraceRing::Record(const char* name, uint32_t trigId, int64_t beginUs, int64_t endUs)
+{
+    if (!Enabled()) return;
+
+    uint32_t tid = ThisThreadTraceId();
+
+    lock_guard<mutex> lk(mtx_);
+    TraceSpan& s = buf_[head_ & mask_];
+    s.name = name;
+    s.trigId = trigId;
+    s.tid = tid;
+    s.beginUs = beginUs;
+    s.durUs = (endUs > beginUs) ? (endUs - beginUs) : 0;
+    head_++;
+}
+
+size_t TraceRing::Snapshot(vector<TraceSpan>& out) const
+{
+    out.clear();
+    lock_guard<mutex> lk(mtx_);
+    uint64_t n = (head_ < buf_.size()) ? head_ : buf_.size();
+    out.reserve((size_t)n);
+    for (uint64_t i = head_ - n; i < head_; i++) out.push_back(buf_[i & mask_]);
+    return out.size();
+}
+
+size_t TraceRing::SnapshotTrigger(uint32_t trigId, vector<TraceSpan>& out) const
+{
+    out.clear();
+    lock_guard<mutex> lk(mtx_);
+    uint64_t n = (head_ < buf_.size()) ? head_ : buf_.size();
+    for (uint64_t i = head_ - n; i < head_; i++) {
+        const TraceSpan& s = buf_[i & mask_];
+        if (s.trigId == trigId) out.push_back(s);
+    }
+    return out.size();
+}
+
+bool TraceRing::ExportChromeJson(const string& path) const
+{
+    vector<TraceSpan> spans;
+    Snapshot(spans);
+
+    // - 스레드 트랙: "X"(complete) 이벤트, args.trig 로 트리거 번호 표시
+    // - 트리거 트랙: 같은 trig id 로 묶인 async("b"/"e") 이벤트 -> 박스 1개 = 트랙 1개
+    ostringstream js;
+    js << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const TraceSpan& s : spans) {
+        if (!s.name) continue;
+
+        if (!first) js << ",\n";
+        first = false;
+        js << "{\"name\":\"" << s.name << "\",\"cat\":\"span\",\"ph\":\"X\""
+            << ",\"ts\":" << s.beginUs << ",\"dur\":" << s.durUs
+            << ",\"pid\":1,\"tid\":" << s.tid
+            << ",\"args\":{\"trig\":" << s.trigId << "}}";
+
+        if (s.trigId == 0) continue;
+        js << ",\n{\"name\":\"" << s.name << "\",\"cat\":\"trigger\",\"ph\":\"b\""
+            << ",\"id\":" << s.trigId << ",\"ts\":" << s.beginUs << ",\"pid\":1,\"tid\":" << s.tid << "}";
+        js << ",\n{\"name\":\"" << s.name << "\",\"cat\":\"trigger\",\"ph\":\"e\""
+            << ",\"id\":" << s.trigId << ",\"ts\":" << (s.beginUs + s.durUs) << ",\"pid\":1,\"tid\":" << s.tid << "}";
+    }
+    js << "\n]}\n";
+
+    string tmp = path + ".tmp";
+    {
+        ofstream ofs(tmp, ios::out | ios::trunc);
+        if (!ofs.is_open()) return false;
+        ofs << js.str();
+    }
+    ::remove(path.c_str());
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+TraceRing& GlobalTrace()
+{
+    static TraceRing ring;
+    return ring;
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+// trace_ring.h
+// - 트리거(START 엣지) 단위 구간(span) 기록용 고정 크기 링버퍼
+// - 기록은 사전 할당된 슬롯에 값만 복사 (힙 할당/문자열 생성 없음) -> 상시 ON 가능
+// - 요청 시 Chrome/Perfetto trace JSON(traceEvents)으로 내보내기
+//   (chrome://tracing 또는 https://ui.perfetto.dev 에서 열기)
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceSpan {
+    const char* name = nullptr; // 반드시 정적 문자열(리터럴)만 사용
+    uint32_t trigId = 0;        // 0 = 트리거와 무관한 구간
+    uint32_t tid = 0;           // 기록한 스레드 번호(내부 부여)
+    int64_t beginUs = 0;        // steady_clock 기준 us
+    int64_t durUs = 0;
+};
+
+class TraceRing {
+public:
+    // capacity는 2의 거듭제곱으로 올림
+    explicit TraceRing(size_t capacity = 16384);
+
+    void SetEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+    bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    static int64_t NowUs();
+
+    // 트리거 번호 발급 (1부터 증가)
+    uint32_t NextTriggerId() { return nextTrig_.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    void Record(const char* name, uint32_t trigId, int64_t beginUs, int64_t endUs);
+
+    // 링버퍼에 남아있는 구간을 오래된 순서로 복사
+    size_t Snapshot(std::vector<TraceSpan>& out) const;
+
+    // 특정 트리거의 구간만 복사
+    size_t SnapshotTrigger(uint32_t trigId, std::vector<TraceSpan>& out) const;
+
+    // Chrome trace JSON 저장 (tmp -> rename)
+    bool ExportChromeJson(const std::string& path) const;
+
+private:
+    std::vector<TraceSpan> buf_;
+    size_t mask_ = 0;
+    uint64_t head_ = 0; // 누적 기록 개수 (mtx_ 보호)
+    mutable std::mutex mtx_;
+    std::atomic<bool> enabled_{ true };
+    std::atomic<uint32_t> nextTrig_{ 0 };
+};
+
+// 프로세스 전역 trace 버퍼
+TraceRing& GlobalTrace();
+
+// 스코프 종료 시 자동 기록
+class TraceScope {
+public:
+    TraceScope(const char* name, uint32_t trigId)
+        : name_(name), trigId_(trigId), beginUs_(TraceRing::NowUs()) {}
+    ~TraceScope() { GlobalTrace().Record(name_, trigId_, beginUs_, TraceRing::NowUs()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint32_t trigId_;
+    int64_t beginUs_;
+};
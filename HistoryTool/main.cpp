@@ -0,0 +1,659 @@
+﻿// HistoryTool.cpp
+// - 측정/판별 이력 아카이브(measure_archive) 조회 / 내보내기 / 가져오기 도구 (OpenCV 불필요)
+// - 아카이브는 세그먼트(seg_<ms>.mcol) + wal.mlog. 형식은 Common/measure_archive.h 참고
+//   ColorWorker: ./history/color (색/픽셀 수), VisionWorker: ./history/vision (색/x/y/type)
+//   (폴더당 writer 하나라서 워커마다 따로). stats/query/export 에 ./history 처럼 윗폴더를 주면
+//   그 아래 아카이브 폴더를 모두 읽어 시간 순으로 합침
+//
+// 사용:
+//   HistoryTool stats <archiveDir>                      세그먼트별 행 수 / 용량 / 시간 범위 / min-max
+//   HistoryTool query <archiveDir> [조건] [--format table|csv|json] [--out file] [--limit N]
+//   HistoryTool export <archiveDir> [조건] [--format csv|json] [--out file]
+//                                                       query 와 같고 기본 형식이 csv
+//   HistoryTool import <archiveDir> <file.json> [...]   total.json / result.json / color_history.json 을 옮겨 담기
+//   HistoryTool seal <archiveDir>                       WAL 에 쌓인 행을 지금 세그먼트로 (워커를 멈춘 뒤)
+//   import / seal 은 아카이브 폴더 하나에만. writer.lock 을 잡으므로 워커가 돌고 있는 폴더에는 거부됨
+//   (워커는 1시간 구간이 바뀔 때 스스로 봉인, 조회는 WAL 행까지 포함하므로 seal 없이도 보임)
+//
+// 조건 (모두 AND):
+//   --from "2026-02-05 08:00:00" | <epoch ms>   --to ...      시각 구간 [from, to)
+//   --last 8h | 30m | 2d                                     지금부터 거꾸로
+//   --color BLUE[,RED...]   --type TOP[,BASE,defect]
+//   --x-outside 57,63       x 가 구간 밖 (x 없는 행 제외)   --x-range 57,63  x 가 구간 안
+//
+// 예) 지난 8시간 BLUE 중 x 공차(60±3) 밖:
+//   HistoryTool query ./history/vision --last 8h --color BLUE --x-outside 57,63
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+
+#include "../Common/measure_archive.h"
+
+using namespace std;
+
+static void PrintUsage()
+{
+    cerr << "usage:\n"
+        << "  HistoryTool stats <archiveDir>\n"
+        << "  HistoryTool query <archiveDir> [filters] [--format table|csv|json] [--out file] [--limit N]\n"
+        << "  HistoryTool export <archiveDir> [filters] [--format csv|json] [--out file]\n"
+        << "  HistoryTool import <archiveDir> <file.json> [...]\n"
+        << "  HistoryTool seal <archiveDir>\n"
+        << "filters: --from T --to T --last 8h --color BLUE,RED --type TOP,BASE,defect --x-outside lo,hi --x-range lo,hi\n";
+}
+
+static int64_t NowMs()
+{
+    using namespace chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static string FormatTimeMs(int64_t ms)
+{
+    time_t t = (time_t)(ms / 1000);
+    tm tmv{};
+#ifdef _WIN32
+    localtime_s(&tmv, &t);
+#else
+    localtime_r(&t, &tmv);
+#endif
+    ostringstream oss;
+    oss << put_time(&tmv, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << (ms % 1000);
+    return oss.str();
+}
+
+// "YYYY-MM-DD HH:MM:SS[.mmm]" (로컬 시각, total.json 의 time 형식) 또는 epoch ms
+static bool ParseTimeMs(const string& s, int64_t& out)
+{
+    if (!s.empty() && all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        out = strtoll(s.c_str(), nullptr, 10);
+        return true;
+    }
+    tm tmv{};
+    int msPart = 0;
+    istringstream iss(s);
+    iss >> get_time(&tmv, "%Y-%m-%d %H:%M:%S");
+    if (iss.fail()) return false;
+    if (iss.peek() == '.') {
+        iss.get();
+        string frac;
+        iss >> frac;
+        frac = (frac + "000").substr(0, 3);
+        msPart = atoi(frac.c_str());
+    }
+    tmv.tm_isdst = -1;
+    time_t t = mktime(&tmv);
+    if (t == (time_t)-1) return false;
+    out = (int64_t)t * 1000 + msPart;
+    return true;
+}
+
+// 8h / 30m / 2d / 90s -> ms
+static bool ParseDurationMs(const string& s, int64_t& out)
+{
+    if (s.size() < 2) return false;
+    double v = atof(s.substr(0, s.size() - 1).c_str());
+    switch (s.back()) {
+    case 's': out = (int64_t)(v * 1000); break;
+    case 'm': out = (int64_t)(v * 60 * 1000); break;
+    case 'h': out = (int64_t)(v * 3600 * 1000); break;
+    case 'd': out = (int64_t)(v * 86400 * 1000); break;
+    default: return false;
+    }
+    return v > 0;
+}
+
+static bool ParseRange(const string& s, double& lo, double& hi)
+{
+    size_t comma = s.find(',');
+    if (comma == string::npos) return false;
+    lo = atof(s.substr(0, comma).c_str());
+    hi = atof(s.substr(comma + 1).c_str());
+    return lo <= hi;
+}
+
+// "BLUE,RED" -> 비트 집합 (모르는 이름이면 false)
+static bool ParseNameMask(const string& s, bool isColor, uint8_t& mask)
+{
+    mask = 0;
+    stringstream ss(s);
+    string name;
+    while (getline(ss, name, ',')) {
+        int v = -1;
+        for (int i = 0; i < 4; i++) {
+            const char* n = isColor ? MeasureColorName(i) : MeasureTypeName(i);
+            if (*n && name == n) v = i;
+        }
+        if (v < 0) {
+            cerr << "[ERR] unknown " << (isColor ? "color" : "type") << ": " << name << "\n";
+            return false;
+        }
+        mask |= (uint8_t)(1 << v);
+    }
+    return mask != 0;
+}
+
+// =====================
+// 출력
+// =====================
+static string Num(double v, int prec = 3)
+{
+    if (!isfinite(v)) return "";
+    ostringstream oss;
+    oss << fixed << setprecision(prec) << v;
+    return oss.str();
+}
+
+static string Pix(int v)
+{
+    return v < 0 ? "" : to_string(v);
+}
+
+class RecordPrinter {
+public:
+    RecordPrinter(ostream& os, const string& format) : os_(os), fmt_(format) {}
+
+    void Begin()
+    {
+        if (fmt_ == "csv") os_ << "time,ts_ms,label,color,type,x,y,ms,pix_r,pix_g,pix_b\n";
+        else if (fmt_ == "json") os_ << "[\n";
+        else {
+            os_ << left << setw(24) << "time" << setw(10) << "label" << setw(7) << "color" << setw(8) << "type" << right
+                << setw(9) << "x" << setw(9) << "y" << setw(9) << "ms" << setw(24) << "pix r/g/b" << "\n";
+        }
+    }
+
+    void Row(const MeasureRecord& r)
+    {
+        if (fmt_ == "csv") {
+            os_ << FormatTimeMs(r.tsMs) << "," << r.tsMs << "," << r.label << "," << MeasureColorName(r.color) << ","
+                << MeasureTypeName(r.type) << "," << Num(r.x) << "," << Num(r.y) << "," << Num(r.ms) << ","
+                << Pix(r.pixR) << "," << Pix(r.pixG) << "," << Pix(r.pixB) << "\n";
+        }
+        else if (fmt_ == "json") {
+            // total.json 과 같은 모양 (없는 값은 키를 뺌)
+            if (rows_ > 0) os_ << ",\n";
+            os_ << "  {\n";
+            os_ << "    \"time\": \"" << FormatTimeMs(r.tsMs) << "\",\n";
+            os_ << "    \"ts_ms\": " << r.tsMs << ",\n";
+            os_ << "    \"label\": \"" << r.label << "\",\n";
+            os_ << "    \"color\": \"" << MeasureColorName(r.color) << "\"";
+            if (r.type != MTYPE_UNKNOWN) os_ << ",\n    \"type\": \"" << MeasureTypeName(r.type) << "\"";
+            if (isfinite(r.x)) os_ << ",\n    \"x\": " << Num(r.x);
+            if (isfinite(r.y)) os_ << ",\n    \"y\": " << Num(r.y);
+            if (isfinite(r.ms)) os_ << ",\n    \"ms\": " << Num(r.ms);
+            if (r.pixR >= 0 || r.pixG >= 0 || r.pixB >= 0)
+                os_ << ",\n    \"pix\": {\"r\": " << max(0, r.pixR) << ", \"g\": " << max(0, r.pixG) << ", \"b\": " << max(0, r.pixB) << "}";
+            os_ << "\n  }";
+        }
+        else {
+            os_ << left << setw(24) << FormatTimeMs(r.tsMs) << setw(10) << r.label << setw(7) << MeasureColorName(r.color)
+                << setw(8) << MeasureTypeName(r.type) << right
+                << setw(9) << Num(r.x) << setw(9) << Num(r.y) << setw(9) << Num(r.ms)
+                << setw(24) << (Pix(r.pixR) + "/" + Pix(r.pixG) + "/" + Pix(r.pixB)) << "\n";
+        }
+        rows_++;
+    }
+
+    void End()
+    {
+        if (fmt_ == "json") os_ << (rows_ ? "\n" : "") << "]\n";
+    }
+
+private:
+    ostream& os_;
+    string fmt_;
+    size_t rows_ = 0;
+};
+
+// =====================
+// JSON 가져오기 (워커들이 쓰는 평평한 객체 배열만)
+// - 중첩 객체는 "pix.r" 처럼 점으로 이어서 펼침, 배열 값(roi)은 건너뜀
+// =====================
+typedef map<string, string> JsonFields;
+
+static void SkipWs(const string& s, size_t& i)
+{
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) i++;
+}
+
+static bool ParseJsonString(const string& s, size_t& i, string& out)
+{
+    if (i >= s.size() || s[i] != '"') return false;
+    out.clear();
+    for (i++; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"') { i++; return true; }
+        if (c == '\\' && i + 1 < s.size()) {
+            char e = s[++i];
+            out += (e == 'n') ? '\n' : (e == 't') ? '\t' : e;
+            continue;
+        }
+        out += c;
+    }
+    return false;
+}
+
+static bool ParseJsonValue(const string& s, size_t& i, const string& key, JsonFields& out);
+
+static bool ParseJsonObject(const string& s, size_t& i, const string& prefix, JsonFields& out)
+{
+    if (s[i] != '{') return false;
+    i++;
+    SkipWs(s, i);
+    if (i < s.size() && s[i] == '}') { i++; return true; }
+    while (i < s.size()) {
+        SkipWs(s, i);
+        string key;
+        if (!ParseJsonString(s, i, key)) return false;
+        SkipWs(s, i);
+        if (i >= s.size() || s[i] != ':') return false;
+        i++;
+        SkipWs(s, i);
+        if (!ParseJsonValue(s, i, prefix.empty() ? key : prefix + "." + key, out)) return false;
+        SkipWs(s, i);
+        if (i < s.size() && s[i] == ',') { i++; continue; }
+        if (i < s.size() && s[i] == '}') { i++; return true; }
+        return false;
+    }
+    return false;
+}
+
+static bool ParseJsonValue(const string& s, size_t& i, const string& key, JsonFields& out)
+{
+    if (i >= s.size()) return false;
+    if (s[i] == '"') {
+        string v;
+        if (!ParseJsonString(s, i, v)) return false;
+        out[key] = v;
+        return true;
+    }
+    if (s[i] == '{') return ParseJsonObject(s, i, key, out);
+    if (s[i] == '[') {
+        // 배열 값은 쓰지 않음: 괄호 짝만 맞춰 건너뜀
+        int depth = 0;
+        for (; i < s.size(); i++) {
+            if (s[i] == '"') { string tmp; ParseJsonString(s, i, tmp); i--; continue; }
+            if (s[i] == '[' || s[i] == '{') depth++;
+            else if ((s[i] == ']' || s[i] == '}') && --depth == 0) { i++; return true; }
+        }
+        return false;
+    }
+    size_t b = i;
+    while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ']' && s[i] != ' ' && s[i] != '\n' && s[i] != '\r') i++;
+    out[key] = s.substr(b, i - b);
+    return i > b;
+}
+
+static bool ParseJsonRecords(const string& text, vector<JsonFields>& out, string& err)
+{
+    size_t i = 0;
+    if (text.size() >= 3 && (uint8_t)text[0] == 0xEF && (uint8_t)text[1] == 0xBB && (uint8_t)text[2] == 0xBF) i = 3;
+    SkipWs(text, i);
+    if (i >= text.size() || text[i] != '[') { err = "top level is not an array"; return false; }
+    i++;
+    while (true) {
+        SkipWs(text, i);
+        if (i >= text.size()) { err = "unexpected end"; return false; }
+        if (text[i] == ']') return true;
+        if (text[i] == ',') { i++; continue; }
+        JsonFields f;
+        if (!ParseJsonObject(text, i, "", f)) {
+            err = "parse error near byte " + to_string(i);
+            return false;
+        }
+        out.push_back(std::move(f));
+    }
+}
+
+static double FieldNum(const JsonFields& f, const char* key)
+{
+    auto it = f.find(key);
+    if (it == f.end() || it->second.empty() || it->second == "null") return NAN;
+    return atof(it->second.c_str());
+}
+
+static string FieldStr(const JsonFields& f, const char* key)
+{
+    auto it = f.find(key);
+    return it == f.end() ? string() : it->second;
+}
+
+// total.json(time/label/color/x/y/ms/type), result.json(label/x/y/ms), color_history.json(ts_ms/pix.*)
+static MeasureRecord RecordFromJson(const JsonFields& f, int64_t fallbackTs)
+{
+    MeasureRecord r;
+    int64_t ts = 0;
+    double tsMs = FieldNum(f, "ts_ms");
+    if (isfinite(tsMs)) r.tsMs = (int64_t)tsMs;
+    else if (ParseTimeMs(FieldStr(f, "time"), ts)) r.tsMs = ts;
+    else r.tsMs = fallbackTs;
+
+    r.label = FieldStr(f, "label");
+    r.color = MeasureColorFromName(FieldStr(f, "color"));
+    r.type = MeasureTypeFromName(FieldStr(f, "type"));
+    r.x = FieldNum(f, "x");
+    r.y = FieldNum(f, "y");
+    r.ms = FieldNum(f, "ms");
+    double pr = FieldNum(f, "pix.r"), pg = FieldNum(f, "pix.g"), pb = FieldNum(f, "pix.b");
+    if (isfinite(pr)) r.pixR = (int)pr;
+    if (isfinite(pg)) r.pixG = (int)pg;
+    if (isfinite(pb)) r.pixB = (int)pb;
+    return r;
+}
+
+static bool ReadText(const string& path, string& out)
+{
+    ifstream ifs(path, ios::binary);
+    if (!ifs.is_open()) return false;
+    ostringstream ss;
+    ss << ifs.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// =====================
+// Commands
+// =====================
+static bool IsArchiveDir(const filesystem::path& dir)
+{
+    error_code ec;
+    if (filesystem::exists(dir / "wal.mlog", ec)) return true;
+    for (const auto& e : filesystem::directory_iterator(dir, ec)) {
+        string name = e.path().filename().string();
+        if (name.compare(0, 4, "seg_") == 0 && e.path().extension() == ".mcol") return true;
+    }
+    return false;
+}
+
+// <dir> 이 아카이브면 그것, 그 아래 폴더 중 아카이브인 것들도 (./history -> color, vision)
+static vector<string> ArchiveDirs(const string& dir)
+{
+    vector<string> out;
+    if (IsArchiveDir(dir)) out.push_back(dir);
+    vector<string> subs;
+    error_code ec;
+    for (const auto& e : filesystem::directory_iterator(dir, ec))
+        if (e.is_directory(ec) && IsArchiveDir(e.path())) subs.push_back(e.path().string());
+    sort(subs.begin(), subs.end());
+    out.insert(out.end(), subs.begin(), subs.end());
+    if (out.empty()) out.push_back(dir); // 빈 아카이브 (Reader 가 not a directory 등을 알려 줌)
+    return out;
+}
+
+static bool OpenReaders(vector<MeasureArchiveReader>& rds, vector<string>& dirs, const string& dir)
+{
+    dirs = ArchiveDirs(dir);
+    rds.assign(dirs.size(), MeasureArchiveReader());
+    for (size_t i = 0; i < dirs.size(); i++) {
+        string err;
+        if (!rds[i].Open(dirs[i], err)) {
+            cerr << "[ERR] " << err << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+static string Span(double lo, double hi)
+{
+    if (lo > hi) return "-";
+    return Num(lo) + "~" + Num(hi);
+}
+
+static void PrintStats(const MeasureArchiveReader& rd)
+{
+    uint64_t rows = 0, bytes = 0;
+    for (const MeasureSegmentInfo& s : rd.Segments()) {
+        rows += s.rows;
+        bytes += s.fileBytes;
+        string colors, types;
+        for (int c = 0; c < 4; c++) if (s.colorMask & (1 << c)) colors += string(colors.empty() ? "" : ",") + MeasureColorName(c);
+        for (int t = 1; t < 4; t++) if (s.typeMask & (1 << t)) types += string(types.empty() ? "" : ",") + MeasureTypeName(t);
+
+        cout << filesystem::path(s.path).filename().string()
+            << "  rows=" << setw(6) << s.rows
+            << "  file=" << setw(8) << s.fileBytes
+            << "  " << FormatTimeMs(s.tsMin) << " ~ " << FormatTimeMs(s.tsMax)
+            << "  x=" << Span(s.xMin, s.xMax) << " y=" << Span(s.yMin, s.yMax) << " ms=" << Span(s.msMin, s.msMax)
+            << "  [" << colors << (types.empty() ? "" : " / " + types) << "]\n";
+    }
+    cout << "total: " << rd.Segments().size() << " segments, " << rows << " rows, " << bytes << " B";
+    if (rows) cout << " (" << fixed << setprecision(1) << (double)bytes / rows << " B/row)";
+    cout << ", wal " << rd.WalRows().size() << " rows\n";
+}
+
+static int CmdStats(const string& dir)
+{
+    vector<MeasureArchiveReader> rds;
+    vector<string> dirs;
+    if (!OpenReaders(rds, dirs, dir)) return 1;
+    for (size_t i = 0; i < rds.size(); i++) {
+        if (rds.size() > 1) cout << (i ? "\n" : "") << "== " << dirs[i] << "\n";
+        PrintStats(rds[i]);
+    }
+    return 0;
+}
+
+struct QueryArgs {
+    MeasureQuery q;
+    string format;
+    string outPath;
+    size_t limit = 0; // 0 = 전부
+};
+
+static bool ParseQueryArgs(int argc, char** argv, int first, QueryArgs& a)
+{
+    for (int i = first; i < argc; i++) {
+        string k = argv[i];
+        if (i + 1 >= argc) { cerr << "[ERR] missing value for " << k << "\n"; return false; }
+        string v = argv[++i];
+        int64_t ms = 0;
+        if (k == "--from" || k == "--to") {
+            if (!ParseTimeMs(v, ms)) { cerr << "[ERR] bad time: " << v << "\n"; return false; }
+            (k == "--from" ? a.q.fromMs : a.q.toMs) = ms;
+        }
+        else if (k == "--last") {
+            if (!ParseDurationMs(v, ms)) { cerr << "[ERR] bad duration: " << v << "\n"; return false; }
+            a.q.fromMs = NowMs() - ms;
+        }
+        else if (k == "--color") { if (!ParseNameMask(v, true, a.q.colorMask)) return false; }
+        else if (k == "--type") { if (!ParseNameMask(v, false, a.q.typeMask)) return false; }
+        else if (k == "--x-outside" || k == "--x-range") {
+            if (!ParseRange(v, a.q.xLo, a.q.xHi)) { cerr << "[ERR] bad range: " << v << "\n"; return false; }
+            a.q.xOutside = (k == "--x-outside");
+        }
+        else if (k == "--format") a.format = v;
+        else if (k == "--out") a.outPath = v;
+        else if (k == "--limit") a.limit = (size_t)max(0, atoi(v.c_str()));
+        else { cerr << "[ERR] unknown option: " << k << "\n"; return false; }
+    }
+    if (a.format != "table" && a.format != "csv" && a.format != "json") {
+        cerr << "[ERR] unknown format: " << a.format << "\n";
+        return false;
+    }
+    return true;
+}
+
+static int CmdQuery(const string& dir, QueryArgs& a)
+{
+    vector<MeasureArchiveReader> rds;
+    vector<string> dirs;
+    if (!OpenReaders(rds, dirs, dir)) return 1;
+
+    ofstream ofs;
+    if (!a.outPath.empty()) {
+        ofs.open(a.outPath, ios::out | ios::trunc);
+        if (!ofs.is_open()) {
+            cerr << "[ERR] cannot write " << a.outPath << "\n";
+            return 1;
+        }
+    }
+    ostream& os = a.outPath.empty() ? cout : ofs;
+
+    auto t0 = chrono::steady_clock::now();
+    RecordPrinter pr(os, a.format);
+    pr.Begin();
+    size_t n = 0;
+    MeasureScanStats st;
+    string err;
+    bool ok = true;
+    if (rds.size() == 1) {
+        ok = rds[0].Scan(a.q, [&](const MeasureRecord& r) {
+            pr.Row(r);
+            return a.limit == 0 || ++n < a.limit;
+        }, &st, err);
+    }
+    else {
+        // 아카이브마다 시간 순 -> 모아서 합침 (각각 앞 limit 개면 합친 앞 limit 개도 그 안에 있음)
+        vector<MeasureRecord> rows;
+        for (const MeasureArchiveReader& rd : rds) {
+            MeasureScanStats one;
+            size_t k = 0;
+            ok = ok && rd.Scan(a.q, [&](const MeasureRecord& r) {
+                rows.push_back(r);
+                return a.limit == 0 || ++k < a.limit;
+            }, &one, err);
+            st.segments += one.segments;
+            st.segmentsSkipped += one.segmentsSkipped;
+            st.segmentsDecoded += one.segmentsDecoded;
+            st.rowsScanned += one.rowsScanned;
+            st.rowsMatched += one.rowsMatched;
+            st.walRows += one.walRows;
+        }
+        stable_sort(rows.begin(), rows.end(), [](const MeasureRecord& x, const MeasureRecord& y) { return x.tsMs < y.tsMs; });
+        if (a.limit > 0 && rows.size() > a.limit) rows.resize(a.limit);
+        st.rowsMatched = rows.size();
+        for (const MeasureRecord& r : rows) pr.Row(r);
+    }
+    pr.End();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    if (!ok) {
+        cerr << "[ERR] " << err << "\n";
+        return 1;
+    }
+    // 표 출력이 아니면 데이터와 섞이지 않게 stderr 로
+    ostream& info = (a.format == "table" && a.outPath.empty()) ? cout : cerr;
+    info << "[QUERY] " << st.rowsMatched << " rows matched (scanned " << st.rowsScanned << ", segments "
+        << st.segments << ": " << st.segmentsSkipped << " skipped by header, " << st.segmentsDecoded << " fully decoded, wal "
+        << st.walRows << ") in " << fixed << setprecision(1) << ms << " ms";
+    if (rds.size() > 1) info << " across " << rds.size() << " archives";
+    if (!a.outPath.empty()) info << " -> " << a.outPath;
+    info << "\n";
+    return 0;
+}
+
+// 워커가 같은 폴더를 쓰고 있으면 거부 (워커의 WAL / 메모리 행과 겹치지 않게)
+static bool OpenWriter(MeasureArchiveWriter& w, string& err)
+{
+    if (w.Open(err)) return true;
+    cerr << "[ERR] " << err << "\n";
+    if (err.find("in use") != string::npos)
+        cerr << "      stop the worker first, or import into another folder and query it separately\n";
+    return false;
+}
+
+static int CmdImport(const string& dir, const vector<string>& files)
+{
+    vector<MeasureRecord> recs;
+    for (const string& path : files) {
+        string text, err;
+        vector<JsonFields> objs;
+        if (!ReadText(path, text) || !ParseJsonRecords(text, objs, err)) {
+            cerr << "[ERR] " << path << ": " << (err.empty() ? "cannot read" : err) << "\n";
+            return 1;
+        }
+
+        // 시각이 없는 파일(result.json)은 파일 수정 시각으로
+        error_code ec;
+        auto ft = filesystem::last_write_time(path, ec);
+        int64_t fallback = ec ? NowMs() : chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch() + (ft - filesystem::file_time_type::clock::now())).count();
+
+        size_t noTime = 0;
+        for (const JsonFields& f : objs) {
+            recs.push_back(RecordFromJson(f, fallback));
+            if (!f.count("ts_ms") && !f.count("time")) noTime++;
+        }
+        cout << "[IMPORT] " << path << ": " << objs.size() << " records";
+        if (noTime) cout << " (" << noTime << " without time -> file mtime " << FormatTimeMs(fallback) << ")";
+        cout << "\n";
+    }
+
+    // 시간 순으로 넣어야 구간별 세그먼트가 잘게 쪼개지지 않음
+    stable_sort(recs.begin(), recs.end(), [](const MeasureRecord& a, const MeasureRecord& b) { return a.tsMs < b.tsMs; });
+
+    MeasureArchiveOptions opt;
+    opt.dir = dir;
+    MeasureArchiveWriter w(opt);
+    string err;
+    if (!OpenWriter(w, err)) return 1;
+    for (const MeasureRecord& r : recs) {
+        if (!w.Append(r)) {
+            cerr << "[ERR] append failed (" << r.label << ")\n";
+            return 1;
+        }
+    }
+    if (!w.Seal()) {
+        cerr << "[ERR] seal failed\n";
+        return 1;
+    }
+    cout << "[IMPORT] " << recs.size() << " records -> " << dir << "\n";
+    return 0;
+}
+
+static int CmdSeal(const string& dir)
+{
+    MeasureArchiveOptions opt;
+    opt.dir = dir;
+    MeasureArchiveWriter w(opt);
+    string err;
+    if (!OpenWriter(w, err)) return 1;
+    size_t n = w.PendingRows();
+    if (!w.Seal()) {
+        cerr << "[ERR] seal failed\n";
+        return 1;
+    }
+    cout << "[SEAL] " << n << " rows\n";
+    return 0;
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        PrintUsage();
+        return 2;
+    }
+
+    string cmd = argv[1];
+    string dir = argv[2];
+
+    if (cmd == "stats") return CmdStats(dir);
+    if (cmd == "seal") return CmdSeal(dir);
+    if (cmd == "import" && argc >= 4) return CmdImport(dir, vector<string>(argv + 3, argv + argc));
+    if (cmd == "query" || cmd == "export") {
+        QueryArgs a;
+        a.format = (cmd == "query") ? "table" : "csv";
+        if (!ParseQueryArgs(argc, argv, 3, a)) return 2;
+        return CmdQuery(dir, a);
+    }
+
+    PrintUsage();
+    return 2;
+}
@@ -0,0 +1,547 @@
+﻿// PlcSimulator.cpp
+// - 실 PLC(192.168.0.202:502) 없이 워커 처리량을 측정하기 위한 Modbus TCP 서버 (libmodbus)
+// - 코일맵 (워커와 동일)
+//     ColorWorker : START=100, 결과 GREEN/BLUE/RED/NONE = 101~104
+//     VisionWorker: START=200, 결과 TOP/BASE/NONE       = 201~203
+// - START 코일을 설정한 패턴(고정 간격 / 포아송 / 버스트)으로 올렸다 내리고,
+//   결과 코일 상승 엣지가 deadline 안에 들어오는지 확인한다.
+//   결과는 트리거 순서대로 온다고 보고(워커는 1트리거 1결과), deadline 을 넘긴 트리거도 late 창 동안
+//   기억해 둔다 -> 늦게 온 펄스는 그 트리거 몫(late)으로 세고 다음 트리거를 가로채지 않음
+//   (ramp 구간이 바뀔 때도 이전 구간 트리거가 다 정리될 때까지 기다린 뒤 다음 구간 시작)
+// - 리포트: 분당 처리 트리거 수, 놓친 트리거, 지연시간 백분위(p50/p90/p99/max)
+// - --ramp 로 분당 트리거 수를 단계적으로 올리면서 워커가 버티는 최대 라인 속도를 찾는다.
+//
+// 사용: 워커의 PLC_IP 를 이 PC 주소(예: 127.0.0.1)로 바꾼 뒤 실행
+//   PlcSimulator --line color --rate 30 --duration 120
+//   PlcSimulator --line vision --pattern poisson --rate 40 --deadline 1500
+//   PlcSimulator --line both --ramp 10:120:10 --step 60
+//
+// 빌드: libmodbus 필요 (워커와 동일)
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+
+#include <modbus/modbus.h>
+
+using namespace std;
+
+// =====================
+// DEFAULT CONFIG
+// =====================
+static int    LISTEN_PORT = 502;
+static int    ADDR_OFFSET = 0;          // VisionWorker ADDR_OFFSET 과 맞춤
+
+static string PATTERN = "fixed";        // fixed | poisson | burst
+static double RATE_PER_MIN = 30.0;      // 평균 분당 트리거 수
+static int    BURST_SIZE = 3;           // burst: 한 번에 연속으로 올리는 트리거 수
+static int    BURST_GAP_MS = 400;       // burst: 버스트 내부 간격
+
+static int    START_HOLD_MS = 300;      // START=1 유지 시간 (워커 폴링 주기보다 길게)
+static int    DEADLINE_MS = 3000;       // 이 시간 안에 결과 코일 펄스가 없으면 missed
+static int    LATE_WINDOW_MS = 3000;    // missed 후에도 이만큼 더 기다린 펄스는 그 트리거의 late 로 (다음 트리거에 붙이지 않음)
+static int    DURATION_S = 60;          // 단일 실행 시간
+static int    REPORT_EVERY_MS = 10000;  // 진행 상황 출력 주기
+
+// ramp: from:to:step (분당 트리거 수), 단계별 실행 시간
+static bool   RAMP = false;
+static double RAMP_FROM = 10.0, RAMP_TO = 120.0, RAMP_STEP = 10.0;
+static int    RAMP_STEP_S = 60;
+static double MAX_MISS_RATIO = 0.0;     // 이 비율 이하로 놓쳐야 "유지 가능"으로 판단
+
+static const int MAX_COILS = 512;
+
+// =====================
+// time helpers
+// =====================
+static inline long long NowMicros() {
+    using clock = chrono::steady_clock;
+    return chrono::duration_cast<chrono::microseconds>(clock::now().time_since_epoch()).count();
+}
+
+// =====================
+// 라인(워커) 상태
+// =====================
+struct LineMap {
+    string name;
+    int startCoil = 0;
+    vector<int> resultCoils;
+    vector<string> resultNames;
+};
+
+struct Pending {
+    uint32_t id = 0;
+    long long tStartUs = 0;
+};
+
+struct LineStats {
+    int sent = 0;
+    int acked = 0;
+    int missed = 0;      // deadline 초과
+    int late = 0;        // missed 된 트리거의 결과가 late 창 안에 늦게 들어옴 (missed 에도 포함)
+    int overrun = 0;     // 이전 START가 아직 1이라 올리지 못한 트리거
+    int stray = 0;       // 대기 중/late 창 안의 트리거 없이 들어온 결과 펄스
+    vector<double> latMs;
+    map<string, int> hits;
+};
+
+struct Line {
+    LineMap map;
+    mt19937 rng;
+    long long nextTrigUs = 0;
+    long long startLowAtUs = 0; // 0 = START 내려가 있음
+    int burstLeft = 0;
+    uint32_t nextId = 0;
+    deque<Pending> pending;  // deadline 안의 트리거 (순서대로)
+    deque<Pending> expired;  // deadline 을 넘겼지만 late 창 안의 트리거 (pending 보다 먼저 응답 몫)
+    vector<uint8_t> prevResult;
+    LineStats st;
+};
+
+static LineMap ColorLineMap() {
+    LineMap m;
+    m.name = "color";
+    m.startCoil = 100;
+    m.resultCoils = { 101, 102, 103, 104 };
+    m.resultNames = { "GREEN", "BLUE", "RED", "NONE" };
+    return m;
+}
+
+static LineMap VisionLineMap() {
+    LineMap m;
+    m.name = "vision";
+    m.startCoil = 200;
+    m.resultCoils = { 201, 202, 203 };
+    m.resultNames = { "TOP", "BASE", "NONE" };
+    return m;
+}
+
+static inline int A(int addr) { return addr + ADDR_OFFSET; }
+
+// 다음 트리거까지 간격(us)
+static long long NextIntervalUs(Line& ln, double ratePerMin) {
+    double meanMs = 60000.0 / max(0.001, ratePerMin);
+
+    if (PATTERN == "poisson") {
+        exponential_distribution<double> ex(1.0 / meanMs);
+        return (long long)(ex(ln.rng) * 1000.0);
+    }
+    if (PATTERN == "burst") {
+        // 버스트 주기 = BURST_SIZE * 평균 간격 -> 평균 rate 유지
+        if (ln.burstLeft > 0) {
+            ln.burstLeft--;
+            return (long long)BURST_GAP_MS * 1000;
+        }
+        ln.burstLeft = max(0, BURST_SIZE - 1);
+        double periodMs = meanMs * BURST_SIZE;
+        double restMs = max(0.0, periodMs - (double)(BURST_SIZE - 1) * BURST_GAP_MS);
+        return (long long)(restMs * 1000.0);
+    }
+    return (long long)(meanMs * 1000.0);
+}
+
+// =====================
+// 결과 코일 감시: 상승 엣지 = 워커 응답(ack)
+// =====================
+static void CheckResults(Line& ln, modbus_mapping_t* mb, long long nowUs) {
+    for (size_t i = 0; i < ln.map.resultCoils.size(); i++) {
+        uint8_t cur = mb->tab_bits[A(ln.map.resultCoils[i])];
+        bool rising = (cur && !ln.prevResult[i]);
+        ln.prevResult[i] = cur;
+        if (!rising) continue;
+
+        // 순서상 먼저인 missed 트리거의 늦은 응답 -> 지금 기다리는 트리거 몫이 아님
+        if (!ln.expired.empty()) {
+            ln.expired.pop_front();
+            ln.st.late++;
+            continue;
+        }
+        if (ln.pending.empty()) {
+            ln.st.stray++;
+            continue;
+        }
+
+        Pending p = ln.pending.front();
+        ln.pending.pop_front();
+
+        double lat = (nowUs - p.tStartUs) / 1000.0;
+        ln.st.acked++;
+        ln.st.latMs.push_back(lat);
+        ln.st.hits[ln.map.resultNames[i]]++;
+    }
+}
+
+// =====================
+// START 스케줄링 / deadline 처리
+// =====================
+static void StepLine(Line& ln, modbus_mapping_t* mb, long long nowUs, double ratePerMin) {
+    // START 내리기
+    if (ln.startLowAtUs && nowUs >= ln.startLowAtUs) {
+        mb->tab_bits[A(ln.map.startCoil)] = 0;
+        ln.startLowAtUs = 0;
+    }
+
+    // 트리거 올리기
+    if (nowUs >= ln.nextTrigUs) {
+        if (ln.startLowAtUs) {
+            // 아직 이전 START가 1 -> 이번 박스는 워커가 볼 수 없음
+            ln.st.overrun++;
+        }
+        else {
+            mb->tab_bits[A(ln.map.startCoil)] = 1;
+            ln.startLowAtUs = nowUs + (long long)START_HOLD_MS * 1000;
+
+            Pending p;
+            p.id = ++ln.nextId;
+            p.tStartUs = nowUs;
+            ln.pending.push_back(p);
+            ln.st.sent++;
+        }
+        ln.nextTrigUs = nowUs + NextIntervalUs(ln, ratePerMin);
+    }
+
+    // deadline 초과 -> missed, late 창 동안은 expired 에 남겨 늦은 펄스를 받아냄
+    while (!ln.pending.empty() && nowUs - ln.pending.front().tStartUs > (long long)DEADLINE_MS * 1000) {
+        ln.expired.push_back(ln.pending.front());
+        ln.pending.pop_front();
+        ln.st.missed++;
+    }
+    long long lateEndUs = (long long)(DEADLINE_MS + LATE_WINDOW_MS) * 1000;
+    while (!ln.expired.empty() && nowUs - ln.expired.front().tStartUs > lateEndUs) ln.expired.pop_front();
+}
+
+// =====================
+// 통계 출력
+// =====================
+static double Percentile(vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    sort(v.begin(), v.end());
+    size_t k = (size_t)ceil(p / 100.0 * (double)v.size());
+    if (k == 0) k = 1;
+    if (k > v.size()) k = v.size();
+    return v[k - 1];
+}
+
+static double AchievedPerMin(const LineStats& st, long long elapsedUs) {
+    if (elapsedUs <= 0) return 0.0;
+    return st.acked * 60000000.0 / (double)elapsedUs;
+}
+
+static string SummaryLine(const Line& ln, long long elapsedUs) {
+    const LineStats& st = ln.st;
+    ostringstream ss;
+    ss << "[" << ln.map.name << "] sent=" << st.sent
+        << " acked=" << st.acked
+        << " missed=" << st.missed
+        << " overrun=" << st.overrun
+        << " late=" << st.late
+        << " stray=" << st.stray
+        << " | achieved=" << fixed << setprecision(1) << AchievedPerMin(st, elapsedUs) << "/min"
+        << " | lat p50=" << setprecision(1) << Percentile(st.latMs, 50)
+        << " p90=" << Percentile(st.latMs, 90)
+        << " p99=" << Percentile(st.latMs, 99)
+        << " max=" << Percentile(st.latMs, 100) << "ms";
+    return ss.str();
+}
+
+// =====================
+// Modbus 서버 (select 기반, 여러 워커 동시 접속)
+// =====================
+static void CloseSocket(int fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+struct Server {
+    modbus_t* ctx = nullptr;
+    modbus_mapping_t* mb = nullptr;
+    int listenFd = -1;
+    vector<int> clients;
+};
+
+static bool ServerOpen(Server& sv, int port) {
+    sv.ctx = modbus_new_tcp(nullptr, port); // nullptr = 모든 인터페이스
+    if (!sv.ctx) return false;
+
+    sv.mb = modbus_mapping_new(MAX_COILS, 0, 0, 0);
+    if (!sv.mb) return false;
+
+    sv.listenFd = modbus_tcp_listen(sv.ctx, 4);
+    return sv.listenFd >= 0;
+}
+
+static void ServerClose(Server& sv) {
+    for (int fd : sv.clients) CloseSocket(fd);
+    sv.clients.clear();
+    if (sv.listenFd >= 0) CloseSocket(sv.listenFd);
+    if (sv.mb) modbus_mapping_free(sv.mb);
+    if (sv.ctx) { modbus_close(sv.ctx); modbus_free(sv.ctx); }
+    sv.listenFd = -1;
+    sv.mb = nullptr;
+    sv.ctx = nullptr;
+}
+
+// timeoutUs 동안 요청 처리. 요청마다 결과 코일 엣지 검사
+static void ServerPoll(Server& sv, vector<Line>& lines, long long timeoutUs) {
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(sv.listenFd, &rfds);
+    int maxFd = sv.listenFd;
+    for (int fd : sv.clients) {
+        FD_SET(fd, &rfds);
+        maxFd = max(maxFd, fd);
+    }
+
+    timeval tv{};
+    tv.tv_sec = (long)(timeoutUs / 1000000);
+    tv.tv_usec = (long)(timeoutUs % 1000000);
+
+    int rc = select(maxFd + 1, &rfds, nullptr, nullptr, &tv);
+    if (rc <= 0) return;
+
+    if (FD_ISSET(sv.listenFd, &rfds)) {
+        int fd = (int)accept(sv.listenFd, nullptr, nullptr);
+        if (fd >= 0) {
+            sv.clients.push_back(fd);
+            cout << "[SIM] client connected (fd=" << fd << ", total=" << sv.clients.size() << ")\n";
+        }
+    }
+
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+    for (size_t i = 0; i < sv.clients.size();) {
+        int fd = sv.clients[i];
+        if (!FD_ISSET(fd, &rfds)) { i++; continue; }
+
+        modbus_set_socket(sv.ctx, fd);
+        int n = modbus_receive(sv.ctx, query);
+        if (n > 0) {
+            modbus_reply(sv.ctx, query, n, sv.mb);
+            long long nowUs = NowMicros();
+            for (Line& ln : lines) CheckResults(ln, sv.mb, nowUs);
+            i++;
+        }
+        else if (n == -1) {
+            cout << "[SIM] client closed (fd=" << fd << ")\n";
+            CloseSocket(fd);
+            sv.clients.erase(sv.clients.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+// =====================
+// 1 구간 실행 (고정 rate)
+// =====================
+static long long RunPhase(Server& sv, vector<Line>& lines, double ratePerMin, int durationS, bool progress) {
+    long long t0 = NowMicros();
+    long long tEnd = t0 + (long long)durationS * 1000000;
+    long long nextReport = t0 + (long long)REPORT_EVERY_MS * 1000;
+
+    for (Line& ln : lines) {
+        ln.st = LineStats();
+        ln.pending.clear();
+        ln.expired.clear();
+        ln.burstLeft = 0;
+        ln.nextTrigUs = t0 + 200000; // 첫 트리거는 0.2s 후
+    }
+
+    long long now = t0;
+    while (now < tEnd) {
+        for (Line& ln : lines) StepLine(ln, sv.mb, now, ratePerMin);
+
+        // 다음 이벤트까지 대기 (최대 2ms -> 스케줄 오차 ~2ms)
+        long long wait = 2000;
+        for (const Line& ln : lines) {
+            wait = min(wait, max(0LL, ln.nextTrigUs - now));
+            if (ln.startLowAtUs) wait = min(wait, max(0LL, ln.startLowAtUs - now));
+        }
+        ServerPoll(sv, lines, wait);
+
+        now = NowMicros();
+        if (progress && now >= nextReport) {
+            for (const Line& ln : lines) cout << "[SIM] " << SummaryLine(ln, now - t0) << "\n";
+            nextReport = now + (long long)REPORT_EVERY_MS * 1000;
+        }
+    }
+
+    // START 내리고 이 구간 트리거가 전부 정리될 때까지(응답 / missed 후 late 창 끝) 대기 (트리거는 더 안 올림)
+    // -> 다음 구간(ramp) 첫 트리거가 이 구간의 늦은 펄스를 가로채지 않음
+    long long drainEnd = now + (long long)(DEADLINE_MS + LATE_WINDOW_MS) * 1000;
+    for (Line& ln : lines) ln.nextTrigUs = LLONG_MAX;
+    while (now < drainEnd) {
+        bool anyOpen = false;
+        for (Line& ln : lines) {
+            StepLine(ln, sv.mb, now, ratePerMin);
+            if (!ln.pending.empty() || !ln.expired.empty()) anyOpen = true;
+        }
+        if (!anyOpen) break;
+        ServerPoll(sv, lines, 2000);
+        now = NowMicros();
+    }
+    for (Line& ln : lines) {
+        ln.st.missed += (int)ln.pending.size();
+        ln.pending.clear();
+        ln.expired.clear();
+        sv.mb->tab_bits[A(ln.map.startCoil)] = 0;
+        ln.startLowAtUs = 0;
+    }
+
+    return tEnd - t0;
+}
+
+static void PrintUsage() {
+    cout << "PlcSimulator options\n"
+        << "  --port N              listen port (default 502)\n"
+        << "  --line color|vision|both\n"
+        << "  --addr-offset N       coil address offset (VisionWorker ADDR_OFFSET)\n"
+        << "  --pattern fixed|poisson|burst\n"
+        << "  --rate N              triggers per minute (mean)\n"
+        << "  --burst N GAP_MS      burst size / gap inside burst\n"
+        << "  --hold MS             START=1 hold time\n"
+        << "  --deadline MS         result pulse deadline\n"
+        << "  --late-window MS      after deadline, pulses this long are late (not credited to next trigger)\n"
+        << "  --duration S          single run length\n"
+        << "  --ramp FROM:TO:STEP   sweep rate, --step S per rate\n"
+        << "  --max-miss RATIO      allowed (missed+overrun)/triggers for ramp verdict\n"
+        << "  --seed N\n";
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv) {
+    string lineSel = "color";
+    unsigned seed = 12345;
+
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "--port" && i + 1 < argc) LISTEN_PORT = stoi(argv[++i]);
+        else if (a == "--line" && i + 1 < argc) lineSel = argv[++i];
+        else if (a == "--addr-offset" && i + 1 < argc) ADDR_OFFSET = stoi(argv[++i]);
+        else if (a == "--pattern" && i + 1 < argc) PATTERN = argv[++i];
+        else if (a == "--rate" && i + 1 < argc) RATE_PER_MIN = stod(argv[++i]);
+        else if (a == "--burst" && i + 2 < argc) { BURST_SIZE = stoi(argv[++i]); BURST_GAP_MS = stoi(argv[++i]); }
+        else if (a == "--hold" && i + 1 < argc) START_HOLD_MS = stoi(argv[++i]);
+        else if (a == "--deadline" && i + 1 < argc) DEADLINE_MS = stoi(argv[++i]);
+        else if (a == "--late-window" && i + 1 < argc) LATE_WINDOW_MS = max(0, stoi(argv[++i]));
+        else if (a == "--duration" && i + 1 < argc) DURATION_S = stoi(argv[++i]);
+        else if (a == "--ramp" && i + 1 < argc) {
+            char c1 = 0, c2 = 0;
+            istringstream rs(argv[++i]);
+            rs >> RAMP_FROM >> c1 >> RAMP_TO >> c2 >> RAMP_STEP;
+            RAMP = (c1 == ':' && c2 == ':' && RAMP_STEP > 0.0);
+        }
+        else if (a == "--step" && i + 1 < argc) RAMP_STEP_S = stoi(argv[++i]);
+        else if (a == "--max-miss" && i + 1 < argc) MAX_MISS_RATIO = stod(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)stoul(argv[++i]);
+        else if (a == "--help" || a == "-h") { PrintUsage(); return 0; }
+    }
+
+    if (PATTERN != "fixed" && PATTERN != "poisson" && PATTERN != "burst") {
+        cerr << "Invalid pattern: " << PATTERN << "\n";
+        return 1;
+    }
+
+    vector<Line> lines;
+    if (lineSel == "color" || lineSel == "both") { Line ln; ln.map = ColorLineMap(); lines.push_back(ln); }
+    if (lineSel == "vision" || lineSel == "both") { Line ln; ln.map = VisionLineMap(); lines.push_back(ln); }
+    if (lines.empty()) {
+        cerr << "Invalid line: " << lineSel << "\n";
+        return 1;
+    }
+    for (size_t i = 0; i < lines.size(); i++) {
+        lines[i].rng.seed(seed + (unsigned)i);
+        lines[i].prevResult.assign(lines[i].map.resultCoils.size(), 0);
+    }
+
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+    Server sv;
+    if (!ServerOpen(sv, LISTEN_PORT)) {
+        cerr << "[FATAL] listen failed on port " << LISTEN_PORT << ": " << modbus_strerror(errno) << "\n";
+        ServerClose(sv);
+        return -1;
+    }
+
+    cout << "[SIM] Modbus TCP listening :" << LISTEN_PORT << " (addr offset " << ADDR_OFFSET << ")\n";
+    for (const Line& ln : lines) {
+        cout << "[SIM] line=" << ln.map.name << " START=" << ln.map.startCoil << " results=";
+        for (size_t i = 0; i < ln.map.resultCoils.size(); i++)
+            cout << (i ? "," : "") << ln.map.resultCoils[i] << "(" << ln.map.resultNames[i] << ")";
+        cout << "\n";
+    }
+    cout << "[SIM] pattern=" << PATTERN << " hold=" << START_HOLD_MS << "ms deadline=" << DEADLINE_MS << "ms late-window=" << LATE_WINDOW_MS << "ms\n";
+
+    // 워커 접속 대기 (라인 수만큼)
+    cout << "[SIM] waiting for " << lines.size() << " worker(s)...\n";
+    while (sv.clients.size() < lines.size()) ServerPoll(sv, lines, 100000);
+
+    if (!RAMP) {
+        cout << "[SIM] rate=" << RATE_PER_MIN << "/min duration=" << DURATION_S << "s\n\n";
+        long long elapsed = RunPhase(sv, lines, RATE_PER_MIN, DURATION_S, true);
+
+        cout << "\n[RESULT]\n";
+        for (const Line& ln : lines) {
+            cout << SummaryLine(ln, elapsed) << "\n";
+            for (const auto& h : ln.st.hits) cout << "    " << h.first << "=" << h.second << "\n";
+        }
+    }
+    else {
+        cout << "[SIM] ramp " << RAMP_FROM << " -> " << RAMP_TO << " step " << RAMP_STEP
+            << " (" << RAMP_STEP_S << "s each)\n\n";
+
+        map<string, double> maxOk;
+        for (double rate = RAMP_FROM; rate <= RAMP_TO + 1e-9; rate += RAMP_STEP) {
+            cout << "[RAMP] rate=" << rate << "/min\n";
+            long long elapsed = RunPhase(sv, lines, rate, RAMP_STEP_S, false);
+
+            for (const Line& ln : lines) {
+                int total = ln.st.sent + ln.st.overrun;
+                double missRatio = (total > 0) ? (double)(ln.st.missed + ln.st.overrun) / total : 0.0;
+                bool ok = (missRatio <= MAX_MISS_RATIO);
+                cout << "[RAMP] " << SummaryLine(ln, elapsed) << (ok ? " OK" : " FAIL") << "\n";
+                if (ok) maxOk[ln.map.name] = max(maxOk[ln.map.name], rate);
+            }
+        }
+
+        cout << "\n[RESULT] max sustainable rate (miss ratio <= " << MAX_MISS_RATIO << ")\n";
+        for (const Line& ln : lines) {
+            auto it = maxOk.find(ln.map.name);
+            if (it == maxOk.end()) cout << "  " << ln.map.name << ": below " << RAMP_FROM << "/min\n";
+            else cout << "  " << ln.map.name << ": " << it->second << "/min\n";
+        }
+    }
+
+    ServerClose(sv);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,620 @@
+﻿// QRBench.cpp
+// - QRWorker 디코드 체인(QRWorker/qr_pipeline) 측정용 합성 QR 코퍼스 생성기 + 하니스
+// - QRCodeEncoder 로 "x,y" payload QR 을 만들고, 컨베이어 비슷한 배경(벨트 + 레일 + 잡동사니) 위에
+//   크기/투시(기울기)/회전/모션 블러/노이즈/저대비/반사(glare)/곡면을 조건별로 정해서 합성한다
+// - 하니스는 QRWorker 와 같은 순서로 돈다: CAP(1280x720) → DET(640x360) gray → gate 안 detect
+//   → CAP 좌표로 스케일 → DecodeQuad (워핑 + CLAHE + 샤픈 + detectAndDecode/curved)
+//   (QR_MIN_SIZE_DET / 캐시 / 스케줄러는 거치지 않음: 체인 자체의 인식률을 본다)
+// - 같은 --seed 면 같은 코퍼스. QR 관련 성능 변경은 이 결과를 전후로 비교
+//
+// 사용:
+//   QRBench run [--n 40] [--seed 1] [--cond a,b,...] [--csv out.csv]
+//                                      코퍼스를 메모리에서 만들고 바로 측정
+//   QRBench gen <outDir> [--n 40] [--seed 1] [--cond a,b,...]
+//                                      png + manifest.csv 로 저장 (다른 빌드/PC 와 같은 입력으로 비교)
+//   QRBench eval <corpusDir> [--csv out.csv]
+//                                      저장된 코퍼스 측정
+//   QRBench list                       조건 목록
+//
+// 출력 (조건별):
+//   det%   = gate 안 detect + 코너 검증 통과
+//   ok%    = detect → 디코드 → payload 일치 (실제 파이프라인 결과)
+//   gt%    = 정답 코너로 바로 디코드해서 일치 (detect 를 빼고 디코드 체인만)
+//   wrong  = 디코드는 됐는데 payload 가 다름
+//   total p50/p90/p99 ms = detect + 디코드, dec p50/p99 ms = 디코드만 (detect 성공한 것)
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+#include "../QRWorker/qr_pipeline.h"
+
+using namespace std;
+using namespace cv;
+
+// QRWorker 기본값과 같게 (CAP_*, DET_*, DEFAULT_GATE_*)
+static const int CAP_W = 1280;
+static const int CAP_H = 720;
+static const int DET_W = 640;
+static const int DET_H = 360;
+static const double GATE_LX = 0.02;
+static const double GATE_RX = 0.98;
+
+// =====================
+// 조건
+// =====================
+struct BenchCondition {
+    const char* name;
+    int qrMin, qrMax;     // QR 한 변 (CAP px, 조용한 영역 제외)
+    double tiltDeg;       // 평면 밖 기울기 최대 (투시)
+    double rotDeg;        // 평면 안 회전 최대 (±)
+    int blurPx;           // 가로(컨베이어 방향) 모션 블러 길이
+    double noiseSigma;    // 가우시안 노이즈 (8bit 단위)
+    double contrast;      // 1.0 = 인쇄 그대로, 작을수록 흑백 차가 줄어듦
+    double glare;         // 반사광 세기 (0 ~ 1)
+    double curve;         // 곡면 (원통에 감긴 라벨). 가장자리 각도 = curve * 90도
+};
+
+static const BenchCondition CONDITIONS[] = {
+    //  name          qrMin qrMax tilt  rot  blur noise contr glare curve
+    { "baseline",     200,  260,  0,    5,   0,   2,    1.00, 0.0,  0.0 },
+    { "small",        140,  160,  0,    5,   0,   2,    1.00, 0.0,  0.0 },
+    { "tiny",          90,  110,  0,    5,   0,   2,    1.00, 0.0,  0.0 },
+    { "rotate",       200,  260,  0,    180, 0,   2,    1.00, 0.0,  0.0 },
+    { "tilt30",       200,  260,  30,   10,  0,   2,    1.00, 0.0,  0.0 },
+    { "tilt50",       200,  260,  50,   10,  0,   2,    1.00, 0.0,  0.0 },
+    { "blur5",        200,  260,  0,    5,   5,   2,    1.00, 0.0,  0.0 },
+    { "blur11",       200,  260,  0,    5,   11,  2,    1.00, 0.0,  0.0 },
+    { "noise12",      200,  260,  0,    5,   0,   12,   1.00, 0.0,  0.0 },
+    { "noise25",      200,  260,  0,    5,   0,   25,   1.00, 0.0,  0.0 },
+    { "lowcontrast",  200,  260,  0,    5,   0,   3,    0.30, 0.0,  0.0 },
+    { "glare",        200,  260,  10,   5,   0,   3,    1.00, 0.8,  0.0 },
+    { "curved",       200,  260,  0,    5,   0,   2,    1.00, 0.0,  0.45 },
+    { "mixed",        130,  240,  30,   30,  5,   8,    0.60, 0.4,  0.20 },
+};
+
+static const BenchCondition* FindCondition(const string& name)
+{
+    for (const BenchCondition& c : CONDITIONS)
+        if (name == c.name) return &c;
+    return nullptr;
+}
+
+// 콤마로 나눈 조건 이름들 (빈 문자열이면 전부)
+static bool SelectConditions(const string& list, vector<const BenchCondition*>& out)
+{
+    out.clear();
+    if (list.empty()) {
+        for (const BenchCondition& c : CONDITIONS) out.push_back(&c);
+        return true;
+    }
+    stringstream ss(list);
+    string name;
+    while (getline(ss, name, ',')) {
+        const BenchCondition* c = FindCondition(name);
+        if (!c) {
+            cerr << "[ERR] unknown condition: " << name << " (QRBench list)\n";
+            return false;
+        }
+        out.push_back(c);
+    }
+    return !out.empty();
+}
+
+// =====================
+// 합성
+// =====================
+struct BenchSample {
+    string cond;
+    string payload;
+    vector<Point2f> quad; // 정답 코너 (CAP 좌표, QR 바깥 모서리 TL/TR/BR/BL)
+    Mat frame;            // CAP 크기 BGR
+};
+
+// 컨베이어 배경: 어두운 벨트 + 결 노이즈 + 위/아래 레일 + 잡동사니 사각형
+static void RenderBackground(RNG& rng, Mat& bg)
+{
+    Mat tex(CAP_H, CAP_W, CV_32F);
+    rng.fill(tex, RNG::NORMAL, 0.0, 1.0);
+    GaussianBlur(tex, tex, Size(0, 0), 3.0, 0.8); // 벨트 진행 방향으로 늘어진 결
+
+    double belt = rng.uniform(55.0, 95.0);
+    Mat g;
+    tex.convertTo(g, CV_8U, 10.0, belt);
+    cvtColor(g, bg, COLOR_GRAY2BGR);
+
+    int rail = rng.uniform(30, 70);
+    Scalar metal(150, 150, 145);
+    rectangle(bg, Rect(0, 0, CAP_W, rail), metal, FILLED);
+    rectangle(bg, Rect(0, CAP_H - rail, CAP_W, rail), metal, FILLED);
+    for (int x = rng.uniform(0, 80); x < CAP_W; x += 160) // 레일 볼트
+        circle(bg, Point(x, rail / 2), 6, Scalar(90, 90, 90), FILLED);
+
+    int clutter = rng.uniform(1, 4);
+    for (int i = 0; i < clutter; i++) {
+        Rect r(rng.uniform(0, CAP_W - 120), rng.uniform(rail, CAP_H - rail - 80), rng.uniform(40, 120), rng.uniform(30, 80));
+        rectangle(bg, r, Scalar(rng.uniform(0, 255), rng.uniform(0, 255), rng.uniform(0, 255)), FILLED);
+    }
+}
+
+// QR 모듈 이미지(1px = 1모듈)에서 검은 모듈 bounding box (= QR 바깥 모서리)
+static Rect CodeBounds(const Mat& code)
+{
+    int x0 = code.cols, y0 = code.rows, x1 = -1, y1 = -1;
+    for (int y = 0; y < code.rows; y++) {
+        const uchar* p = code.ptr<uchar>(y);
+        for (int x = 0; x < code.cols; x++) {
+            if (p[x] >= 128) continue;
+            x0 = min(x0, x); x1 = max(x1, x);
+            y0 = min(y0, y); y1 = max(y1, y);
+        }
+    }
+    if (x1 < 0) return Rect();
+    return Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+/*
+    BendCylinder:
+    - 세로축 원통에 감긴 라벨을 정면에서 본 모양: 가운데는 그대로, 가장자리로 갈수록 가로로 압축
+    - 라벨 반폭 W 를 호(arc)로 두고 가장자리 각도 thetaMax = curve * 90도, 반지름 R = W / thetaMax
+      화면 x = R sin(s / R)  (s = 라벨 위 가로 위치)
+    - pts(라벨 좌표)도 같은 식으로 옮긴다
+*/
+static void BendCylinder(const Mat& label, double curve, Mat& out, vector<Point2f>& pts)
+{
+    double W = label.cols * 0.5;
+    double thetaMax = curve * CV_PI * 0.5;
+    double R = W / thetaMax;
+    double Pw = R * sin(thetaMax);
+    int outW = max(1, (int)ceil(2 * Pw));
+
+    Mat mapX(label.rows, outW, CV_32F), mapY(label.rows, outW, CV_32F);
+    for (int y = 0; y < label.rows; y++) {
+        float* mx = mapX.ptr<float>(y);
+        float* my = mapY.ptr<float>(y);
+        for (int x = 0; x < outW; x++) {
+            double p = max(-R, min(R, x + 0.5 - Pw));
+            mx[x] = (float)(R * asin(p / R) + W - 0.5);
+            my[x] = (float)y;
+        }
+    }
+    remap(label, out, mapX, mapY, INTER_LINEAR, BORDER_REPLICATE);
+
+    for (Point2f& q : pts) q.x = (float)(R * sin((q.x - W) / R) + Pw);
+}
+
+// 평면 밖 기울기 + 평면 안 회전 + 투시 투영: 라벨 모서리 → 화면 좌표
+static vector<Point2f> ProjectLabel(RNG& rng, Size labelSize, Point2f center, double tiltDeg, double rotDeg)
+{
+    const double f = 1000.0; // 초점거리(px). 라벨 중심까지 거리 = f 라서 중심 배율 1
+    double ax = rng.uniform(-tiltDeg, tiltDeg) * CV_PI / 180.0;
+    double ay = rng.uniform(-tiltDeg, tiltDeg) * CV_PI / 180.0;
+    double az = rng.uniform(-rotDeg, rotDeg) * CV_PI / 180.0;
+
+    Matx33d Rx(1, 0, 0, 0, cos(ax), -sin(ax), 0, sin(ax), cos(ax));
+    Matx33d Ry(cos(ay), 0, sin(ay), 0, 1, 0, -sin(ay), 0, cos(ay));
+    Matx33d Rz(cos(az), -sin(az), 0, sin(az), cos(az), 0, 0, 0, 1);
+    Matx33d Rm = Rx * Ry * Rz;
+
+    double hw = labelSize.width * 0.5, hh = labelSize.height * 0.5;
+    const double corners[4][2] = { { -hw, -hh }, { hw, -hh }, { hw, hh }, { -hw, hh } };
+    vector<Point2f> out(4);
+    for (int i = 0; i < 4; i++) {
+        Vec3d P = Rm * Vec3d(corners[i][0], corners[i][1], 0.0);
+        double z = P[2] + f;
+        out[i] = Point2f((float)(f * P[0] / z + center.x), (float)(f * P[1] / z + center.y));
+    }
+    return out;
+}
+
+static bool RenderSample(RNG& rng, const BenchCondition& c, const Ptr<QRCodeEncoder>& enc, BenchSample& s)
+{
+    s.cond = c.name;
+    s.payload = to_string(rng.uniform(0, 1000)) + "," + to_string(rng.uniform(0, 1000));
+
+    Mat code;
+    enc->encode(s.payload, code);
+    if (code.empty()) return false;
+    if (code.channels() != 1) cvtColor(code, code, COLOR_BGR2GRAY);
+
+    // 조용한 영역(흰 여백)은 인코더가 주는 것과 상관없이 4모듈로 맞춘다
+    Rect cb = CodeBounds(code);
+    if (cb.empty()) return false;
+    const int quiet = 4;
+    Mat modules(cb.height + 2 * quiet, cb.width + 2 * quiet, CV_8U, Scalar(255));
+    code(cb).copyTo(modules(Rect(quiet, quiet, cb.width, cb.height)));
+
+    // 모듈 → 픽셀 (nearest 로 키운 뒤 목표 크기로 area)
+    int qrPx = rng.uniform(c.qrMin, c.qrMax + 1);
+    double modPx = (double)qrPx / cb.width;
+    int labelPx = (int)lround(modPx * modules.cols);
+    int up = max(1, (int)ceil(modPx)) * 4;
+    Mat big, label;
+    resize(modules, big, Size(modules.cols * up, modules.rows * up), 0, 0, INTER_NEAREST);
+    resize(big, label, Size(labelPx, labelPx), 0, 0, INTER_AREA);
+
+    // 인쇄 대비: 잉크 40 / 종이 225 기준, contrast 만큼 중간값(130) 쪽으로
+    label.convertTo(label, CV_8U, (225.0 - 40.0) / 255.0 * c.contrast, 130.0 - 90.0 * c.contrast);
+    cvtColor(label, label, COLOR_GRAY2BGR);
+
+    float q0 = (float)(quiet * modPx), q1 = (float)((quiet + cb.width) * modPx);
+    vector<Point2f> codePts = { Point2f(q0, q0), Point2f(q1, q0), Point2f(q1, q1), Point2f(q0, q1) };
+
+    if (c.curve > 0.0) {
+        Mat bent;
+        BendCylinder(label, c.curve, bent, codePts);
+        label = bent;
+    }
+
+    // 배치: gate 안, 레일에 걸리지 않게
+    RenderBackground(rng, s.frame);
+    float margin = labelPx * 0.75f;
+    Point2f center((float)rng.uniform(GATE_LX * CAP_W + margin, GATE_RX * CAP_W - margin),
+        (float)rng.uniform(CAP_H * 0.5 - 60.0, CAP_H * 0.5 + 60.0));
+    vector<Point2f> dst = ProjectLabel(rng, label.size(), center, c.tiltDeg, c.rotDeg);
+
+    vector<Point2f> src = {
+        Point2f(0, 0), Point2f((float)label.cols, 0),
+        Point2f((float)label.cols, (float)label.rows), Point2f(0, (float)label.rows)
+    };
+    Mat H = getPerspectiveTransform(src, dst);
+
+    Mat warped, mask;
+    warpPerspective(label, warped, H, s.frame.size(), INTER_LINEAR, BORDER_CONSTANT);
+    warpPerspective(Mat(label.size(), CV_8U, Scalar(255)), mask, H, s.frame.size(), INTER_LINEAR, BORDER_CONSTANT);
+    warped.copyTo(s.frame, mask > 127);
+
+    perspectiveTransform(codePts, s.quad, H);
+
+    // 반사광 / 모션 블러 / 노이즈는 합성 후 프레임 전체에
+    Mat f;
+    s.frame.convertTo(f, CV_32FC3);
+    if (c.glare > 0.0) {
+        Point2f gc = center + Point2f((float)rng.uniform(-0.3, 0.3) * qrPx, (float)rng.uniform(-0.3, 0.3) * qrPx);
+        double sigma = qrPx * rng.uniform(0.25, 0.45);
+        Mat spot(f.size(), CV_32F);
+        for (int y = 0; y < spot.rows; y++) {
+            float* p = spot.ptr<float>(y);
+            for (int x = 0; x < spot.cols; x++) {
+                double d2 = (x - gc.x) * (x - gc.x) + (y - gc.y) * (y - gc.y);
+                p[x] = (float)(255.0 * c.glare * exp(-d2 / (2.0 * sigma * sigma)));
+            }
+        }
+        Mat spot3;
+        cvtColor(spot, spot3, COLOR_GRAY2BGR);
+        f += spot3;
+    }
+    if (c.blurPx > 1) {
+        Mat k = Mat::ones(1, c.blurPx, CV_32F) / (float)c.blurPx;
+        filter2D(f, f, -1, k);
+    }
+    if (c.noiseSigma > 0.0) {
+        Mat n(f.size(), CV_32FC3);
+        rng.fill(n, RNG::NORMAL, Scalar::all(0.0), Scalar::all(c.noiseSigma));
+        f += n;
+    }
+    f.convertTo(s.frame, CV_8UC3);
+    return true;
+}
+
+// =====================
+// 하니스
+// =====================
+struct SampleResult {
+    bool detected = false;
+    bool ok = false;
+    bool wrong = false;
+    bool gtOk = false;
+    double totalMs = 0.0;
+    double decodeMs = 0.0;
+};
+
+static double MsSince(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+/*
+    RunPipeline:
+    - QRWorker 메인 루프(반전 없음, 단일 QR 모드)와 같은 순서
+    - 정답 코너로 한 번 더 디코드 (gt): detect 실패와 디코드 실패를 나눠 보기 위함
+*/
+static SampleResult RunPipeline(QRCodeDetector& qrd, QrPrep& prep, const BenchSample& s)
+{
+    SampleResult r;
+    const Matx33d viewFromRaw = FlipMatrix(false, 0, s.frame.size());
+
+    auto t0 = chrono::steady_clock::now();
+    Mat frameDet, grayDet;
+    resize(s.frame, frameDet, Size(DET_W, DET_H), 0, 0, INTER_LINEAR);
+    cvtColor(frameDet, grayDet, COLOR_BGR2GRAY);
+
+    int xL = clampi((int)round(GATE_LX * DET_W), 0, DET_W - 2);
+    int xR = clampi((int)round(GATE_RX * DET_W), xL + 1, DET_W - 1);
+    Rect gateRect(xL, 0, xR - xL, DET_H);
+
+    vector<Point2f> quadDet;
+    r.detected = DetectQuadInGate(qrd, grayDet, gateRect, quadDet);
+    if (r.detected) {
+        float sx = (float)s.frame.cols / (float)DET_W;
+        float sy = (float)s.frame.rows / (float)DET_H;
+        vector<Point2f> quadCap(4);
+        for (int i = 0; i < 4; i++) quadCap[i] = Point2f(quadDet[i].x * sx, quadDet[i].y * sy);
+
+        auto t1 = chrono::steady_clock::now();
+        string d = DecodeQuad(qrd, prep, s.frame, quadCap, viewFromRaw);
+        r.decodeMs = MsSince(t1);
+        r.ok = (d == s.payload);
+        r.wrong = !d.empty() && !r.ok;
+    }
+    r.totalMs = MsSince(t0);
+
+    r.gtOk = (DecodeQuad(qrd, prep, s.frame, s.quad, viewFromRaw) == s.payload);
+    return r;
+}
+
+static double Percentile(vector<double> v, double p)
+{
+    if (v.empty()) return 0.0;
+    sort(v.begin(), v.end());
+    size_t k = (size_t)ceil(p / 100.0 * v.size());
+    return v[min(v.size() - 1, k > 0 ? k - 1 : 0)];
+}
+
+// 조건별 집계 + 출력
+struct CondReport {
+    string cond;
+    vector<SampleResult> results;
+};
+
+static void PrintReport(const vector<CondReport>& reports, const string& csvPath)
+{
+    cout << left << setw(12) << "cond" << right
+        << setw(5) << "n" << setw(7) << "det%" << setw(7) << "ok%" << setw(7) << "gt%" << setw(7) << "wrong"
+        << setw(9) << "p50ms" << setw(9) << "p90ms" << setw(9) << "p99ms"
+        << setw(10) << "dec50ms" << setw(10) << "dec99ms" << "\n";
+
+    ofstream csv;
+    if (!csvPath.empty()) {
+        csv.open(csvPath, ios::trunc);
+        if (!csv.is_open()) cerr << "[ERR] cannot write " << csvPath << "\n";
+        else csv << "cond,n,det_pct,ok_pct,gt_pct,wrong,total_p50_ms,total_p90_ms,total_p99_ms,decode_p50_ms,decode_p99_ms\n";
+    }
+
+    size_t allN = 0, allOk = 0;
+    for (const CondReport& cr : reports) {
+        size_t n = cr.results.size(), det = 0, ok = 0, gt = 0, wrong = 0;
+        vector<double> total, dec;
+        for (const SampleResult& r : cr.results) {
+            det += r.detected; ok += r.ok; gt += r.gtOk; wrong += r.wrong;
+            total.push_back(r.totalMs);
+            if (r.detected) dec.push_back(r.decodeMs);
+        }
+        allN += n;
+        allOk += ok;
+
+        auto pct = [n](size_t k) { return n ? 100.0 * k / n : 0.0; };
+        double t50 = Percentile(total, 50), t90 = Percentile(total, 90), t99 = Percentile(total, 99);
+        double d50 = Percentile(dec, 50), d99 = Percentile(dec, 99);
+
+        cout << left << setw(12) << cr.cond << right << fixed
+            << setw(5) << n << setprecision(1)
+            << setw(7) << pct(det) << setw(7) << pct(ok) << setw(7) << pct(gt) << setw(7) << wrong
+            << setprecision(2)
+            << setw(9) << t50 << setw(9) << t90 << setw(9) << t99
+            << setw(10) << d50 << setw(10) << d99 << "\n";
+
+        if (csv.is_open()) {
+            csv << cr.cond << "," << n << "," << setprecision(1) << pct(det) << "," << pct(ok) << "," << pct(gt)
+                << "," << wrong << "," << setprecision(3) << t50 << "," << t90 << "," << t99
+                << "," << d50 << "," << d99 << "\n";
+        }
+    }
+    cout << "overall ok " << setprecision(1) << (allN ? 100.0 * allOk / allN : 0.0) << "% (" << allOk << "/" << allN << ")\n";
+}
+
+// =====================
+// 코퍼스 파일 (png + manifest.csv)
+// manifest: file,cond,x,y,x0,y0,x1,y1,x2,y2,x3,y3   (payload = "x,y", 코너 = CAP 좌표 TL/TR/BR/BL)
+// =====================
+static bool SaveCorpusSample(const string& dir, size_t idx, const BenchSample& s, ofstream& manifest)
+{
+    ostringstream name;
+    name << s.cond << "_" << setw(4) << setfill('0') << idx << ".png";
+    if (!imwrite((filesystem::path(dir) / name.str()).string(), s.frame)) return false;
+
+    manifest << name.str() << "," << s.cond << "," << s.payload;
+    for (const Point2f& p : s.quad) manifest << "," << fixed << setprecision(2) << p.x << "," << p.y;
+    manifest << "\n";
+    return true;
+}
+
+static bool LoadCorpus(const string& dir, vector<BenchSample>& out)
+{
+    ifstream ifs((filesystem::path(dir) / "manifest.csv").string());
+    if (!ifs.is_open()) {
+        cerr << "[ERR] cannot open " << dir << "/manifest.csv\n";
+        return false;
+    }
+
+    string line;
+    getline(ifs, line); // header
+    while (getline(ifs, line)) {
+        vector<string> f;
+        stringstream ss(line);
+        string tok;
+        while (getline(ss, tok, ',')) f.push_back(tok);
+        if (f.size() != 12) continue;
+
+        BenchSample s;
+        s.cond = f[1];
+        s.payload = f[2] + "," + f[3];
+        s.quad.resize(4);
+        for (int i = 0; i < 4; i++) s.quad[i] = Point2f(stof(f[4 + 2 * i]), stof(f[5 + 2 * i]));
+        s.frame = imread((filesystem::path(dir) / f[0]).string(), IMREAD_COLOR);
+        if (s.frame.empty()) {
+            cerr << "[ERR] cannot read " << f[0] << "\n";
+            continue;
+        }
+        out.push_back(std::move(s));
+    }
+    return true;
+}
+
+// =====================
+// Commands
+// =====================
+static void PrintUsage()
+{
+    cerr << "usage:\n"
+        << "  QRBench run [--n 40] [--seed 1] [--cond a,b,...] [--csv out.csv]\n"
+        << "  QRBench gen <outDir> [--n 40] [--seed 1] [--cond a,b,...]\n"
+        << "  QRBench eval <corpusDir> [--csv out.csv]\n"
+        << "  QRBench list\n";
+}
+
+static Ptr<QRCodeEncoder> MakeEncoder()
+{
+    // 실물 라벨과 같은 설정: 자동 버전, 오류 정정 M
+    QRCodeEncoder::Params p;
+    p.correction_level = QRCodeEncoder::CORRECT_LEVEL_M;
+    return QRCodeEncoder::create(p);
+}
+
+static int CmdList()
+{
+    cout << left << setw(12) << "cond" << right << setw(10) << "qr px" << setw(7) << "tilt" << setw(6) << "rot"
+        << setw(6) << "blur" << setw(7) << "noise" << setw(7) << "contr" << setw(7) << "glare" << setw(7) << "curve" << "\n";
+    for (const BenchCondition& c : CONDITIONS) {
+        cout << left << setw(12) << c.name << right
+            << setw(6) << c.qrMin << "~" << setw(3) << c.qrMax
+            << setw(7) << c.tiltDeg << setw(6) << c.rotDeg << setw(6) << c.blurPx << setw(7) << c.noiseSigma
+            << setw(7) << c.contrast << setw(7) << c.glare << setw(7) << c.curve << "\n";
+    }
+    return 0;
+}
+
+static int CmdRun(int n, uint64_t seed, const vector<const BenchCondition*>& conds, const string& csvPath)
+{
+    Ptr<QRCodeEncoder> enc = MakeEncoder();
+    QRCodeDetector qrd;
+    QrPrep prep;
+
+    vector<CondReport> reports;
+    for (const BenchCondition* c : conds) {
+        // 조건마다 시드를 나눠서, 조건을 골라 돌려도 같은 조건은 같은 이미지
+        RNG rng(seed * 1000003ULL + (uint64_t)(c - CONDITIONS));
+        CondReport cr;
+        cr.cond = c->name;
+        for (int i = 0; i < n; i++) {
+            BenchSample s;
+            if (!RenderSample(rng, *c, enc, s)) {
+                cerr << "[ERR] render failed: " << c->name << " #" << i << "\n";
+                continue;
+            }
+            cr.results.push_back(RunPipeline(qrd, prep, s));
+        }
+        reports.push_back(std::move(cr));
+    }
+    PrintReport(reports, csvPath);
+    return 0;
+}
+
+static int CmdGen(const string& dir, int n, uint64_t seed, const vector<const BenchCondition*>& conds)
+{
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    ofstream manifest((filesystem::path(dir) / "manifest.csv").string(), ios::trunc);
+    if (!manifest.is_open()) {
+        cerr << "[ERR] cannot write " << dir << "/manifest.csv\n";
+        return 1;
+    }
+    manifest << "file,cond,x,y,x0,y0,x1,y1,x2,y2,x3,y3\n";
+
+    Ptr<QRCodeEncoder> enc = MakeEncoder();
+    size_t written = 0;
+    for (const BenchCondition* c : conds) {
+        RNG rng(seed * 1000003ULL + (uint64_t)(c - CONDITIONS));
+        for (int i = 0; i < n; i++) {
+            BenchSample s;
+            if (!RenderSample(rng, *c, enc, s) || !SaveCorpusSample(dir, (size_t)i, s, manifest)) {
+                cerr << "[ERR] " << c->name << " #" << i << "\n";
+                continue;
+            }
+            written++;
+        }
+    }
+    cout << "wrote " << written << " images to " << dir << "\n";
+    return 0;
+}
+
+static int CmdEval(const string& dir, const string& csvPath)
+{
+    vector<BenchSample> samples;
+    if (!LoadCorpus(dir, samples)) return 1;
+    if (samples.empty()) {
+        cerr << "[ERR] empty corpus\n";
+        return 1;
+    }
+
+    QRCodeDetector qrd;
+    QrPrep prep;
+
+    // manifest 에 나온 조건 순서대로 묶기
+    vector<CondReport> reports;
+    for (const BenchSample& s : samples) {
+        auto it = find_if(reports.begin(), reports.end(), [&](const CondReport& r) { return r.cond == s.cond; });
+        if (it == reports.end()) {
+            reports.push_back(CondReport{ s.cond, {} });
+            it = reports.end() - 1;
+        }
+        it->results.push_back(RunPipeline(qrd, prep, s));
+    }
+    PrintReport(reports, csvPath);
+    return 0;
+}
+
+// =====================
+// MAIN
+// =====================
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        PrintUsage();
+        return 2;
+    }
+
+    string cmd = argv[1];
+    int firstOpt = (cmd == "gen" || cmd == "eval") ? 3 : 2;
+
+    // 옵션 (--n / --seed / --cond / --csv)
+    auto opt = [&](const char* name, const string& def) {
+        for (int i = firstOpt; i + 1 < argc; i++)
+            if (string(argv[i]) == name) return string(argv[i + 1]);
+        return def;
+    };
+
+    int n = max(1, atoi(opt("--n", "40").c_str()));
+    uint64_t seed = strtoull(opt("--seed", "1").c_str(), nullptr, 10);
+    string csvPath = opt("--csv", "");
+    vector<const BenchCondition*> conds;
+    if (!SelectConditions(opt("--cond", ""), conds)) return 2;
+
+    if (cmd == "list") return CmdList();
+    if (cmd == "run") return CmdRun(n, seed, conds, csvPath);
+    if (cmd == "gen" && argc >= 3) return CmdGen(argv[2], n, seed, conds);
+    if (cmd == "eval" && argc >= 3) return CmdEval(argv[2], csvPath);
+
+    PrintUsage();
+    return 2;
+}
@@ -22,9 +22,27 @@
         * USB 카메라(V4L2) 경로: --v4l2 옵션으로 전환
     - flip(좌우/상하 반전) 설정 가능
     - 게이트(탐지 영역 제한) 범위 조절 가능
+    - QR 추적: 한 번 찾은 QR은 다음 프레임부터 예측 위치 주변만 확인 (--no-track 으로 끄기,
+      --redetect N 으로 전체 detect 주기, --stats 로 fps/detect/추적 횟수 출력)
+    - 디코드 캐시: 같은 QR이 이어지는 동안은 마지막 디코드 결과를 재사용 (--no-cache 로 끄기)
+    - 디코드 스레드: 워핑/보정/디코드는 워커 풀에서 (--decode-threads N, 0이면 메인 루프에서 직접)
+    - 디코드 스케줄러: QR 크기/움직임/선명도/최근 성공률로 프레임마다 디코드 여부 결정
+      (새로 나타난 선명한 QR은 바로, 흐리거나 변화 없으면 뒤로 미룸. --fixed-schedule 은 기존 N프레임마다)
+    - 다중 QR(--multi): gate 안의 QR 여러 개를 한 프레임에서 모두 탐지/디코드해서 각각 한 줄씩 전송
+      (왼쪽 → 오른쪽 순서, 같은 payload는 MULTI_FORGET_MS 동안 한 번만. 이 모드에선 추적/캐시 끔)
+    - gray 직접 캡처(--gray-capture, QR_GST_APPSINK 빌드): GStreamer tee로 원본(NV12의 Y plane)과
+      탐지용 640x360 GRAY8을 appsink 두 개로 받아 복사 없이 Mat으로 씀 (BGR 변환/리사이즈 없음)
+      --test-src 로 libcamerasrc 대신 videotestsrc, --capture-test N 으로 캡처만 N프레임 측정
+    - 시리얼 송신은 전용 스레드(큐)에서. --serial-proto frame 이면 "x,y\n" 대신
+      순번/캡처 시각/CRC가 붙은 이진 프레임(형식은 4-1 참고). 기본은 기존과 같은 ascii
+      --selftest-pty [N] : 가상 터미널 쌍으로 송신/프레임 파서 자체 시험 후 종료
 
     ✅ 빌드 예시
-    g++ A_qr_to_serial_commented.cpp -o A_qr_to_serial `pkg-config --cflags --libs opencv4`
+    g++ A_qr_to_serial_commented.cpp qr_pipeline.cpp -o A_qr_to_serial -pthread `pkg-config --cflags --libs opencv4`
+
+    (gray 직접 캡처(--gray-capture)까지 쓰려면 GStreamer appsink 포함 빌드)
+    g++ A_qr_to_serial_commented.cpp qr_pipeline.cpp -o A_qr_to_serial -pthread -DQR_GST_APPSINK \
+        `pkg-config --cflags --libs opencv4 gstreamer-app-1.0 gstreamer-video-1.0`
 
     ✅ 실행 예시
     ./A_qr_to_serial --serial /dev/serial0 --baud 115200
@@ -53,9 +71,21 @@
 #include <opencv2/objdetect.hpp>
 #include <opencv2/core/utils/logger.hpp>
 
+#include "qr_pipeline.h"
+
+#ifdef QR_GST_APPSINK
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#endif
+
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <cstdlib>
 
 #include <iostream>
 #include <vector>
@@ -66,7 +96,14 @@
 #include <climits>
 #include <thread>
 #include <chrono>
-/*
+#include <iomanip>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 using namespace std;
 using namespace cv;
 
@@ -95,8 +132,7 @@ static const double DEFAULT_GATE_RX = 0.98;
 // ============================================================
 // 3) QR 디코드 튜닝 파라미터
 // ============================================================
-// QR_PAD_PX : 워핑 시 주변 여백을 주어 디코드 안정성을 올림
-static const int QR_PAD_PX = 40;
+// (워핑 여백 QR_PAD_PX, 확대 기준 UPSCALE_TO 는 디코드 체인과 함께 qr_pipeline.h)
 
 // QR_DECODE_EVERY_N : 매 프레임 디코드하면 느리므로 N프레임마다 디코드
 static const int QR_DECODE_EVERY_N = 2;
@@ -104,11 +140,79 @@ static const int QR_DECODE_EVERY_N = 2;
 // QR_MIN_SIZE_DET : DET 프레임에서 QR이 너무 작으면 디코드 시도 자체를 하지 않음
 static const int QR_MIN_SIZE_DET = 70;
 
-// UPSCALE_TO : 워핑된 QR 이미지가 너무 작으면 확대해서 디코드 안정성 향상
-static const int UPSCALE_TO = 500;
+// ============================================================
+// 3-1) QR 추적(tracking) 파라미터
+// ============================================================
+// 같은 QR이 컨베이어를 따라 부드럽게 움직이는 동안은 매 프레임 gate 전체 detect를 하지 않고,
+// 등속 모델로 위치를 예측한 뒤 예측 위치 주변 작은 창에서 템플릿 매칭으로만 확인한다.
+// 놓치면 같은 프레임에서 바로 전체 detect로 돌아간다.
 
-// clamp helper: 범위를 벗어난 값을 강제로 끼워 넣기
-static inline int clampi(int v, int lo, int hi) { return max(lo, min(hi, v)); }
+// QR_REDETECT_EVERY_N : 추적 중이어도 N프레임마다 전체 detect (코너 갱신/누적 오차 보정)
+static const int QR_REDETECT_EVERY_N = 10;
+
+// TRACK_PAD_PX : 예측 위치 주변 탐색 여유(DET px). 여기에 현재 속도의 절반을 더한다.
+static const int TRACK_PAD_PX = 12;
+
+// TRACK_MIN_SCORE : 템플릿 매칭(TM_CCOEFF_NORMED) 점수가 이보다 낮으면 추적 실패로 본다.
+static const double TRACK_MIN_SCORE = 0.6;
+
+// ============================================================
+// 3-2) 디코드 결과 캐시 파라미터
+// ============================================================
+// 같은 QR이 화면에 머무는 동안 워핑/CLAHE/샤픈/디코드를 반복하지 않도록
+// 마지막 디코드 결과를 quad + 외형 서명(64bit dHash)과 함께 기억해 두고,
+// quad가 연속적으로 움직이고 서명이 비슷하면 디코드 없이 그 결과를 쓴다.
+
+// CACHE_MAX_SHIFT_PX : 프레임 간 quad 중심 이동이 이보다 크면(DET px) 다른 QR로 본다.
+static const float CACHE_MAX_SHIFT_PX = 30.0f;
+
+// CACHE_MAX_SHAPE_RATIO : 중심 기준 코너 위치 변화가 QR 크기의 이 비율을 넘으면 무효
+static const float CACHE_MAX_SHAPE_RATIO = 0.20f;
+
+// CACHE_MAX_HASH_BITS : 서명 해밍 거리가 이보다 크면 무효 (64bit 중)
+static const int CACHE_MAX_HASH_BITS = 12;
+
+// CACHE_MAX_HITS : 연속 캐시 사용이 이만큼 쌓이면 한 번은 실제로 디코드해서 확인
+static const int CACHE_MAX_HITS = 150;
+
+// ============================================================
+// 3-3) 디코드 워커 풀 파라미터
+// ============================================================
+// 메인 스레드는 캡처 + detect/추적만 하고, 워핑~디코드는 워커가 한다.
+// (curved fallback 한 번이 느려도 캡처가 멈추지 않음. 라즈베리파이 4코어 = 메인 1 + 워커 3)
+static const int DEFAULT_DECODE_THREADS = 3;
+
+// ============================================================
+// 3-4) 다중 QR 모드 파라미터
+// ============================================================
+// MULTI_FORGET_MS : 같은 payload가 이 시간 동안 안 보이면 잊는다(다시 보이면 다시 전송).
+//                   다중 모드에선 lastX/lastY 하나로 중복 억제가 안 되므로 payload별로 기억한다.
+static const int MULTI_FORGET_MS = 2000;
+
+// MULTI_MAX_PENDING : 다중 모드 워커 풀 대기 큐 크기. 한 프레임의 QR들이 서로를 밀어내지 않도록
+//                     gate 안에 동시에 들어올 수 있는 QR 수보다 크게 잡는다.
+static const int MULTI_MAX_PENDING = 8;
+
+// ============================================================
+// 3-5) 적응형 디코드 스케줄러 파라미터
+// ============================================================
+// 고정 QR_DECODE_EVERY_N 대신 프레임마다 "지금 디코드할 가치가 있나"를 판단한다.
+// - 새 QR(직전 quad와 안 이어짐)이 선명하면 바로 디코드
+// - 흐리면(라플라시안 분산이 임계값 미만) 기다림. 임계값은 최근 성공/실패 때의 선명도로 학습
+// - 같은 QR에서 실패하면 간격을 2배씩 늘림(최대 SCHED_MAX_INTERVAL). 크기/선명도가 좋아지면 바로 재시도
+// - 너무 오래 못 했으면(SCHED_MAX_INTERVAL) 조건 무시하고 한 번은 시도
+
+// SCHED_MIN_SHARPNESS : 선명도(DET gray에서 QR 영역 라플라시안 분산) 기본 하한
+static const double SCHED_MIN_SHARPNESS = 150.0;
+
+// SCHED_MAX_MOTION_PX : 프레임 간 QR 중심 이동(DET px)이 이보다 크고 아직 못 읽었으면 모션 블러 의심
+static const float SCHED_MAX_MOTION_PX = 14.0f;
+
+// SCHED_MAX_INTERVAL : 실패 후 재시도 간격 상한(프레임) = 강제 시도 주기
+static const int SCHED_MAX_INTERVAL = 8;
+
+// SCHED_EWMA_ALPHA : 성공률/선명도 이동평균 가중치
+static const double SCHED_EWMA_ALPHA = 0.1;
 
 // ============================================================
 // 4) 시리얼 통신(POSIX) 유틸 함수들
@@ -118,7 +222,6 @@ static inline int clampi(int v, int lo, int hi) { return max(lo, min(hi, v)); }
     BaudToSpeed:
     - 사람이 쓰는 baud 숫자를 termios 상수(B115200 등)로 변환한다.
 */
-/*
 static speed_t BaudToSpeed(int baud)
 {
     switch (baud) {
@@ -132,24 +235,13 @@ static speed_t BaudToSpeed(int baud)
 }
 
 /*
-    SerialOpen:
-    - dev: "/dev/serial0" 또는 "/dev/ttyUSB0" 등
-    - baud: 115200 등
-    - 반환: 성공 시 fd(파일 디스크립터), 실패 시 -1
-
-    세팅 내용(중요):
-    - Raw 모드: cfmakeraw
-    - 8N1 (8bit, No parity, 1 stop bit)
-    - HW/SW flow control OFF (CRTSCTS, IXON/IXOFF off)
+    SerialConfigure:
+    - 이미 열린 fd에 아래 SerialOpen 세팅(raw, 8N1, flow control off, baud)을 적용
 */
-
-static int SerialOpen(const string& dev, int baud)
+static bool SerialConfigure(int fd, int baud)
 {
-    int fd = open(dev.c_str(), O_RDWR | O_NOCTTY | O_SYNC);
-    if (fd < 0) { perror("open(serial)"); return -1; }
-
     termios tty{};
-    if (tcgetattr(fd, &tty) != 0) { perror("tcgetattr"); close(fd); return -1; }
+    if (tcgetattr(fd, &tty) != 0) { perror("tcgetattr"); return false; }
 
     // raw 모드(캐노니컬/에코/특수키 처리 등 제거)
     cfmakeraw(&tty);
@@ -174,206 +266,979 @@ static int SerialOpen(const string& dev, int baud)
     cfsetispeed(&tty, spd);
     cfsetospeed(&tty, spd);
 
-    if (tcsetattr(fd, TCSANOW, &tty) != 0) { perror("tcsetattr"); close(fd); return -1; }
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) { perror("tcsetattr"); return false; }
 
     tcflush(fd, TCIOFLUSH);
-    return fd;
+    return true;
 }
 
 /*
-    SerialWriteLine:
-    - line을 시리얼로 보낸다.
-    - 반드시 개행('\n')으로 끝나게 해서 B가 "줄 단위"로 파싱하기 쉽게 만든다.
+    SerialOpen:
+    - dev: "/dev/serial0" 또는 "/dev/ttyUSB0" 등
+    - baud: 115200 등
+    - 반환: 성공 시 fd(파일 디스크립터), 실패 시 -1
+
+    세팅 내용(중요):
+    - Raw 모드: cfmakeraw
+    - 8N1 (8bit, No parity, 1 stop bit)
+    - HW/SW flow control OFF (CRTSCTS, IXON/IXOFF off)
+    - O_SYNC 없음: 쓰기는 SerialWriter 전용 스레드가 하므로 카메라 루프가 UART를 기다리지 않는다.
 */
 
-static bool SerialWriteLine(int fd, const string& line)
+static int SerialOpen(const string& dev, int baud)
 {
-    if (fd < 0) return false;
+    int fd = open(dev.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0) { perror("open(serial)"); return -1; }
 
-    // line이 '\n'으로 끝나지 않으면 붙여준다.
-    const string out = (!line.empty() && line.back() == '\n') ? line : (line + "\n");
+    if (!SerialConfigure(fd, baud)) { close(fd); return -1; }
+    return fd;
+}
 
-    ssize_t n = write(fd, out.data(), out.size());
-    if (n < 0) {
-        perror("write(serial)");
-        return false;
+/*
+    SerialWriteAll:
+    - data를 끝까지 쓴다(부분 쓰기/EINTR/EAGAIN 처리).
+    - poll로 최대 timeoutMs씩 기다리며, stop이 켜진 뒤 더 못 쓰면 포기한다.
+*/
+static bool SerialWriteAll(int fd, const uint8_t* data, size_t len, const atomic<bool>& stop, int timeoutMs = 200)
+{
+    size_t off = 0;
+    while (off < len) {
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        int pr = poll(&pfd, 1, timeoutMs);
+        if (pr < 0) {
+            if (errno == EINTR) continue;
+            perror("poll(serial)");
+            return false;
+        }
+        if (pr == 0) {
+            if (stop) return false; // 종료 중인데 UART가 안 빠짐
+            continue;
+        }
+
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            perror("write(serial)");
+            return false;
+        }
+        off += (size_t)n;
     }
-    return (size_t)n == out.size();
+    return true;
 }
 
 // ============================================================
-// 5) QR 탐지/디코드 안정성용 보조 함수들
+// 4-1) 시리얼 프레임 프로토콜 + 비동기 송신
 // ============================================================
+// ASCII 모드(기본, 기존 B 호환): "x,y\n"
+// FRAME 모드(--serial-proto frame): B가 누락/지연을 알 수 있게 순번/캡처 시각/CRC를 붙인다.
+//
+//   +------+------+--------+----------+-----+-----------+--------+
+//   | 0xA5 | 0x5A | seq u16| ts_ms u32| len |  payload  | crc16  |
+//   +------+------+--------+----------+-----+-----------+--------+
+//   - 정수는 little-endian
+//   - seq: 보낼 때마다 +1 (큐가 넘쳐 버린 것도 번호는 소비 → B에서 빈 번호 = 누락)
+//   - ts_ms: 프레임 캡처 시각(epoch ms의 하위 32bit). B는 자기 시계(같은 NTP)와 비교해서 지연 측정
+//   - len: payload 바이트 수 (최대 SERIAL_MAX_PAYLOAD)
+//   - crc16: CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), seq부터 payload 끝까지
+
+static const uint8_t SERIAL_SOF0 = 0xA5;
+static const uint8_t SERIAL_SOF1 = 0x5A;
+static const size_t SERIAL_HEADER_BYTES = 9;   // SOF(2) + seq(2) + ts(4) + len(1)
+static const size_t SERIAL_MAX_PAYLOAD = 64;
+
+// SERIAL_QUEUE_CAP : 송신 큐 크기. 가득 차면 가장 오래된 메시지를 버린다(최신 좌표 우선)
+static const size_t SERIAL_QUEUE_CAP = 64;
+
+enum SerialProto {
+    SERIAL_ASCII = 0,
+    SERIAL_FRAME = 1,
+};
 
 /*
-    ValidateCorners:
-    - QRCodeDetector::detect()가 주는 corners(4점)가 유효한지 점검한다.
-    - 너무 작은 면적/점 겹침/비정상 좌표이면 false로 처리하여 오탐 방지.
+    Crc16Ccitt:
+    - CRC-16/CCITT-FALSE ("123456789" → 0x29B1)
 */
-static bool ValidateCorners(const Mat& corners4)
+static uint16_t Crc16Ccitt(const uint8_t* p, size_t n, uint16_t crc = 0xFFFF)
 {
-    if (corners4.empty() || corners4.total() != 4) return false;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)p[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
 
-    vector<Point2f> pts(4);
-    for (int i = 0; i < 4; i++) pts[i] = corners4.at<Point2f>(i);
+/*
+    BuildSerialFrame:
+    - 위 형식으로 한 메시지를 만든다. payload가 너무 길면 빈 벡터
+*/
+static vector<uint8_t> BuildSerialFrame(uint16_t seq, uint32_t tsMs, const string& payload)
+{
+    vector<uint8_t> f;
+    if (payload.size() > SERIAL_MAX_PAYLOAD) return f;
+
+    f.reserve(SERIAL_HEADER_BYTES + payload.size() + 2);
+    f.push_back(SERIAL_SOF0);
+    f.push_back(SERIAL_SOF1);
+    f.push_back((uint8_t)(seq & 0xFF));
+    f.push_back((uint8_t)(seq >> 8));
+    for (int i = 0; i < 4; i++) f.push_back((uint8_t)(tsMs >> (8 * i)));
+    f.push_back((uint8_t)payload.size());
+    f.insert(f.end(), payload.begin(), payload.end());
+
+    uint16_t crc = Crc16Ccitt(f.data() + 2, f.size() - 2);
+    f.push_back((uint8_t)(crc & 0xFF));
+    f.push_back((uint8_t)(crc >> 8));
+    return f;
+}
 
-    // 좌표 유효성(무한대/NaN) + 점 간 거리 체크
-    for (int i = 0; i < 4; i++) {
-        if (!isfinite(pts[i].x) || !isfinite(pts[i].y)) return false;
-        for (int j = i + 1; j < 4; j++) {
-            if (norm(pts[i] - pts[j]) < 1.0) return false; // 거의 같은 점이면 invalid
+/*
+    SerialFrameParser:
+    - 수신 측(B/셀프테스트) 파서. 바이트를 아무렇게나 잘라 넣어도 되고,
+      SOF를 찾아 맞추다가 CRC가 틀리면 1바이트 밀어서 다시 찾는다.
+*/
+struct SerialFrame {
+    uint16_t seq = 0;
+    uint32_t tsMs = 0;
+    string payload;
+};
+
+class SerialFrameParser {
+public:
+    void Feed(const uint8_t* data, size_t len, vector<SerialFrame>& out)
+    {
+        buf_.insert(buf_.end(), data, data + len);
+
+        size_t i = 0;
+        while (buf_.size() - i >= SERIAL_HEADER_BYTES + 2) {
+            if (buf_[i] != SERIAL_SOF0 || buf_[i + 1] != SERIAL_SOF1) { i++; skipped_++; continue; }
+
+            size_t plen = buf_[i + 8];
+            if (plen > SERIAL_MAX_PAYLOAD) { i++; skipped_++; continue; }
+
+            size_t total = SERIAL_HEADER_BYTES + plen + 2;
+            if (buf_.size() - i < total) break; // 나머지는 다음 Feed에서
+
+            const uint8_t* f = buf_.data() + i;
+            uint16_t crc = (uint16_t)(f[total - 2] | (f[total - 1] << 8));
+            if (Crc16Ccitt(f + 2, total - 4) != crc) { crcErrors_++; i++; continue; }
+
+            SerialFrame m;
+            m.seq = (uint16_t)(f[2] | (f[3] << 8));
+            m.tsMs = (uint32_t)f[4] | ((uint32_t)f[5] << 8) | ((uint32_t)f[6] << 16) | ((uint32_t)f[7] << 24);
+            m.payload.assign((const char*)f + SERIAL_HEADER_BYTES, plen);
+            out.push_back(std::move(m));
+            i += total;
+        }
+        buf_.erase(buf_.begin(), buf_.begin() + i);
+    }
+
+    uint64_t CrcErrors() const { return crcErrors_; }
+    uint64_t SkippedBytes() const { return skipped_; }
+
+private:
+    vector<uint8_t> buf_;
+    uint64_t crcErrors_ = 0;
+    uint64_t skipped_ = 0;
+};
+
+/*
+    SerialWriter:
+    - 카메라 루프는 Send로 큐에 넣기만 하고, 실제 write는 전용 스레드가 한다(UART가 막혀도 루프는 안 멈춤).
+    - 큐는 SERIAL_QUEUE_CAP개. 가득 차면 가장 오래된 것을 버린다.
+    - FRAME 모드는 Send 시점에 seq를 매기므로 버린 메시지는 B에서 빈 번호로 보인다.
+*/
+class SerialWriter {
+public:
+    SerialWriter(int fd, SerialProto proto)
+        : fd_(fd), proto_(proto)
+    {
+        th_ = thread(&SerialWriter::Run, this);
+    }
+
+    ~SerialWriter() { Stop(); }
+
+    SerialWriter(const SerialWriter&) = delete;
+    SerialWriter& operator=(const SerialWriter&) = delete;
+
+    // payload: "x,y" (개행 없이), tsMs: 캡처 시각(epoch ms). 큐가 넘쳐 오래된 것을 버렸으면 false
+    bool Send(const string& payload, uint32_t tsMs)
+    {
+        vector<uint8_t> bytes;
+        if (proto_ == SERIAL_FRAME) {
+            bytes = BuildSerialFrame(nextSeq_++, tsMs, payload);
+        }
+        else {
+            bytes.assign(payload.begin(), payload.end());
+            if (bytes.empty() || bytes.back() != '\n') bytes.push_back('\n');
+        }
+        if (bytes.empty()) return false; // payload 너무 김
+
+        bool overflow = false;
+        {
+            lock_guard<mutex> lk(mtx_);
+            if (q_.size() >= SERIAL_QUEUE_CAP) {
+                q_.pop_front();
+                dropped_++;
+                overflow = true;
+            }
+            q_.push_back(std::move(bytes));
+        }
+        cv_.notify_one();
+        return !overflow;
+    }
+
+    // 큐에 남은 것을 내보내고 종료 (UART가 막혀 있으면 poll 타임아웃 후 포기)
+    void Stop()
+    {
+        {
+            lock_guard<mutex> lk(mtx_);
+            if (stop_) return;
+            stop_ = true;
         }
+        stopFlag_ = true;
+        cv_.notify_all();
+        if (th_.joinable()) th_.join();
     }
 
-    // 면적 너무 작으면 QR로 보기 어려움
-    double a = fabs(contourArea(pts));
-    if (a <= 200.0) return false;
+    uint64_t Written() const { lock_guard<mutex> lk(mtx_); return written_; }
+    uint64_t Dropped() const { lock_guard<mutex> lk(mtx_); return dropped_; }
+    uint64_t Failed() const { lock_guard<mutex> lk(mtx_); return failed_; }
+
+private:
+    void Run()
+    {
+        while (true) {
+            vector<uint8_t> bytes;
+            {
+                unique_lock<mutex> lk(mtx_);
+                cv_.wait(lk, [&] { return stop_ || !q_.empty(); });
+                if (q_.empty()) return; // stop_ && 다 보냄
+                bytes = std::move(q_.front());
+                q_.pop_front();
+            }
 
-    // convex 여부 체크
-    vector<Point> ip(4);
-    for (int i = 0; i < 4; i++) ip[i] = Point((int)round(pts[i].x), (int)round(pts[i].y));
-    if (!isContourConvex(ip)) return false;
+            bool ok = SerialWriteAll(fd_, bytes.data(), bytes.size(), stopFlag_);
 
+            lock_guard<mutex> lk(mtx_);
+            if (ok) written_++;
+            else {
+                failed_++;
+                if (stop_) q_.clear(); // 종료 중 UART 막힘 → 나머지 포기
+            }
+        }
+    }
+
+    const int fd_;
+    const SerialProto proto_;
+    uint16_t nextSeq_ = 0; // Send는 메인 스레드에서만 호출
+
+    mutable mutex mtx_;
+    condition_variable cv_;
+    deque<vector<uint8_t>> q_;
+    bool stop_ = false;
+    atomic<bool> stopFlag_{ false };
+    uint64_t written_ = 0, dropped_ = 0, failed_ = 0;
+    thread th_;
+};
+
+/*
+    SerialSelfTestPty:
+    - 가상 터미널(pty) 한 쌍을 열어 slave 쪽을 실제 UART처럼 SerialConfigure → SerialWriter로 보내고
+      master 쪽에서 읽어 확인한다. (하드웨어/B 없이 프로토콜과 송신 스레드 검증)
+    - FRAME: count개 전송 → 순번 연속, CRC, payload, ts 확인
+             + 깨진 바이트/쓰레기를 섞은 스트림에서 파서가 다시 맞추는지 확인
+    - ASCII: 같은 count개를 "x,y\n" 줄로 확인
+    - 반환: 0 = PASS, 1 = FAIL
+*/
+static bool PtyReadSome(int fd, vector<uint8_t>& buf, int timeoutMs)
+{
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+
+    uint8_t tmp[4096];
+    ssize_t n = read(fd, tmp, sizeof(tmp));
+    if (n <= 0) return false;
+    buf.insert(buf.end(), tmp, tmp + n);
     return true;
 }
 
+static int SerialSelfTestPty(int count)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        if (master >= 0) close(master);
+        return 1;
+    }
+    const char* slaveName = ptsname(master);
+    if (!slaveName) { perror("ptsname"); close(master); return 1; }
+    cerr << "[SELFTEST] pty " << slaveName << "\n";
+
+    // slave 쪽 열기: 경로(/dev/pts/N) 대신 TIOCGPTPEER로 master의 짝을 직접 연다.
+    // (컨테이너 등에서 devpts가 겹쳐 마운트되면 같은 경로가 다른 pty를 가리킬 수 있음)
+    auto openSlave = [&]() -> int {
+        int fd = -1;
+#ifdef TIOCGPTPEER
+        fd = ioctl(master, TIOCGPTPEER, O_RDWR | O_NOCTTY);
+#endif
+        if (fd < 0) fd = open(slaveName, O_RDWR | O_NOCTTY);
+        if (fd < 0) { perror("open(pty slave)"); return -1; }
+        if (!SerialConfigure(fd, 115200)) { close(fd); return -1; }
+        return fd;
+    };
+
+    bool pass = true;
+    auto check = [&](bool ok, const string& what) {
+        cerr << (ok ? "  [PASS] " : "  [FAIL] ") << what << "\n";
+        if (!ok) pass = false;
+    };
+
+    // 받은 바이트를 모드에 맞게 센다 (FRAME: 파싱된 프레임 수, ASCII: 줄 수)
+    auto receive = [&](SerialProto proto, vector<uint8_t>& rx, SerialFrameParser& parser,
+        vector<SerialFrame>& frames, size_t want) {
+        auto counted = [&]() {
+            return (proto == SERIAL_FRAME) ? frames.size() : (size_t)std::count(rx.begin(), rx.end(), (uint8_t)'\n');
+        };
+        while (counted() < want) {
+            size_t before = rx.size();
+            if (!PtyReadSome(master, rx, 500)) break;
+            if (proto == SERIAL_FRAME) parser.Feed(rx.data() + before, rx.size() - before, frames);
+        }
+        return counted();
+    };
+
+    for (int mode = 0; mode < 2; mode++) {
+        SerialProto proto = (mode == 0) ? SERIAL_FRAME : SERIAL_ASCII;
+        const string tag = (proto == SERIAL_FRAME) ? "frame: " : "ascii: ";
+        int fd = openSlave();
+        if (fd < 0) { close(master); return 1; }
+
+        // (1) 큐 용량 안에서 나눠 보내기: 전부 순서대로 도착해야 함
+        {
+            SerialWriter wr(fd, proto);
+            vector<string> sent;
+            vector<uint8_t> rx;
+            SerialFrameParser parser;
+            vector<SerialFrame> frames;
+            double maxSendUs = 0.0;
+
+            for (int i = 0; i < count; i++) {
+                sent.push_back(to_string(i) + "," + to_string(count - i));
+                auto t0 = chrono::steady_clock::now();
+                wr.Send(sent.back(), 1000u + (uint32_t)i);
+                maxSendUs = max(maxSendUs, chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+
+                if ((i + 1) % (int)(SERIAL_QUEUE_CAP / 2) == 0) receive(proto, rx, parser, frames, (size_t)(i + 1));
+            }
+            size_t got = receive(proto, rx, parser, frames, (size_t)count);
+            wr.Stop();
+
+            bool ok = (got == (size_t)count);
+            if (proto == SERIAL_FRAME) {
+                ok = ok && parser.CrcErrors() == 0;
+                for (size_t i = 0; ok && i < frames.size(); i++) {
+                    ok = frames[i].seq == (uint16_t)i && frames[i].payload == sent[i] && frames[i].tsMs == 1000u + i;
+                }
+            }
+            else {
+                string expect;
+                for (const string& p : sent) expect += p + "\n";
+                ok = ok && string(rx.begin(), rx.end()) == expect;
+            }
+            check(ok, tag + to_string(got) + "/" + to_string(count) + " in order (max Send "
+                + to_string((int)maxSendUs) + " us)");
+        }
+
+        // (2) 한 번에 몰아 넣기: 넘친 만큼 버려지고(Send는 안 막힘), FRAME이면 버린 만큼 seq가 빈다
+        if (proto == SERIAL_FRAME) {
+            const int burst = (int)SERIAL_QUEUE_CAP * 4;
+            SerialWriter wr(fd, proto);
+            for (int i = 0; i < burst; i++) wr.Send(to_string(i) + ",0", (uint32_t)i);
+
+            vector<uint8_t> rx;
+            SerialFrameParser parser;
+            vector<SerialFrame> frames;
+            receive(proto, rx, parser, frames, (size_t)burst);
+            wr.Stop();
+
+            bool increasing = true;
+            for (size_t i = 1; i < frames.size(); i++) increasing = increasing && frames[i].seq > frames[i - 1].seq;
+            size_t gaps = frames.empty() ? 0 : (size_t)frames.back().seq + 1 - frames.size();
+            check(increasing && frames.size() + wr.Dropped() == (size_t)burst && gaps == wr.Dropped()
+                && !frames.empty() && frames.back().seq == burst - 1,
+                tag + "burst " + to_string(burst) + ": received " + to_string(frames.size())
+                + ", dropped " + to_string(wr.Dropped()) + ", seq gaps " + to_string(gaps));
+        }
+        close(fd);
+    }
+
+    // 파서 재동기: 쓰레기 + CRC 깨진 프레임 + 정상 프레임, 1바이트씩 나눠 넣기
+    {
+        vector<uint8_t> stream = { 0x00, 0xA5, 0x13, 0x5A };
+        vector<uint8_t> bad = BuildSerialFrame(7, 123, "9,9");
+        bad[bad.size() - 3] ^= 0x01; // payload 1bit 뒤집기
+        vector<uint8_t> good = BuildSerialFrame(8, 456, "10,20");
+        stream.insert(stream.end(), bad.begin(), bad.end());
+        stream.insert(stream.end(), good.begin(), good.end());
+
+        SerialFrameParser parser;
+        vector<SerialFrame> frames;
+        for (uint8_t b : stream) parser.Feed(&b, 1, frames);
+        check(frames.size() == 1 && frames[0].seq == 8 && frames[0].payload == "10,20" && parser.CrcErrors() == 1,
+            "parser: resync after garbage + corrupted frame");
+
+        uint8_t v[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+        check(Crc16Ccitt(v, sizeof(v)) == 0x29B1, "crc16 check value");
+    }
+
+    close(master);
+    cerr << (pass ? "[SELFTEST] PASS\n" : "[SELFTEST] FAIL\n");
+    return pass ? 0 : 1;
+}
+
+// ============================================================
+// 5) QR 탐지/디코드 안정성용 보조 함수들
+// ============================================================
+// 코너 검증/워핑/디코드 체인(ValidateCorners, WarpWithPadding, DecodeQuad ...)은 qr_pipeline.h/.cpp
+// (QRBench가 같은 코드로 합성 코퍼스를 돌린다)
+
 /*
-    OrderQuadTLTRBRBL:
-    - QR 4개 코너를 (TL, TR, BR, BL) 순서로 정렬한다.
-    - perspective warp가 안정적으로 동작하게 하기 위함.
+    DrawQuad:
+    - 디버그 시각화용(사각형/코너 점 표시)
 */
-static vector<Point2f> OrderQuadTLTRBRBL(const vector<Point2f>& p)
+static void DrawQuad(Mat& img, const vector<Point2f>& pts, const Scalar& color)
 {
-    vector<Point2f> out(4);
-    float minSum = 1e9f, maxSum = -1e9f, minDiff = 1e9f, maxDiff = -1e9f;
-    int tl = 0, tr = 0, br = 0, bl = 0;
-
+    if (pts.size() != 4) return;
     for (int i = 0; i < 4; i++) {
-        float s = p[i].x + p[i].y;
-        float d = p[i].x - p[i].y;
-        if (s < minSum) { minSum = s; tl = i; }
-        if (s > maxSum) { maxSum = s; br = i; }
-        if (d > maxDiff) { maxDiff = d; tr = i; }
-        if (d < minDiff) { minDiff = d; bl = i; }
-    }
-    out[0] = p[tl]; out[1] = p[tr]; out[2] = p[br]; out[3] = p[bl];
-    return out;
+        line(img, pts[i], pts[(i + 1) % 4], color, 2);
+        circle(img, pts[i], 4, color, FILLED);
+    }
 }
 
+// ============================================================
+// 5-1) QR 추적(등속 예측 + 국부 템플릿 매칭)
+// ============================================================
+
+/*
+    QrTrack:
+    - 마지막 detect 때의 QR 패치(템플릿)와 위치/속도(DET 좌표)
+    - 코너는 템플릿 좌상단 기준 상대좌표로 들고 다니며, 추적 중에는 평행이동만 반영한다.
+      (회전/크기 변화는 QR_REDETECT_EVERY_N 마다 전체 detect로 보정)
+*/
+struct QrTrack {
+    bool valid = false;
+    Mat tmpl;                   // detect 시점 grayDet의 QR bounding box 패치
+    Point2f pos;                // 템플릿 좌상단(DET)
+    Point2f vel;                // 프레임당 이동량(DET px)
+    vector<Point2f> quadRel;    // 코너 - pos
+    int sinceDetect = 0;        // 마지막 전체 detect 이후 추적한 프레임 수
+};
+
 /*
-    PointsToRect:
-    - 4점 bounding box를 Rect로 변환한다.
-    - 이미지 범위를 넘어가지 않도록 clamp 한다.
+    TrackInit:
+    - detect 성공 시 템플릿/코너를 새로 잡는다.
+    - 직전 프레임까지 추적 중이었다면 위치 변화로 속도도 갱신(처음이면 0).
 */
-static Rect PointsToRect(const vector<Point2f>& pts, int maxW, int maxH)
+static void TrackInit(QrTrack& tr, const Mat& grayDet, const vector<Point2f>& quadDet)
 {
-    float minx = 1e9f, miny = 1e9f, maxx = -1e9f, maxy = -1e9f;
-    for (auto& p : pts) {
-        minx = min(minx, p.x); miny = min(miny, p.y);
-        maxx = max(maxx, p.x); maxy = max(maxy, p.y);
-    }
-    int x = clampi((int)floor(minx), 0, maxW - 1);
-    int y = clampi((int)floor(miny), 0, maxH - 1);
-    int x2 = clampi((int)ceil(maxx), 0, maxW);
-    int y2 = clampi((int)ceil(maxy), 0, maxH);
-    return Rect(x, y, max(1, x2 - x), max(1, y2 - y));
+    Rect r = PointsToRect(quadDet, grayDet.cols, grayDet.rows);
+    Point2f newPos((float)r.x, (float)r.y);
+
+    tr.vel = tr.valid ? (tr.vel * 0.5f + (newPos - tr.pos) * 0.5f) : Point2f(0.f, 0.f);
+    tr.pos = newPos;
+    tr.tmpl = grayDet(r).clone();
+    tr.quadRel.resize(4);
+    for (int i = 0; i < 4; i++) tr.quadRel[i] = quadDet[i] - newPos;
+    tr.sinceDetect = 0;
+    tr.valid = true;
 }
 
 /*
-    CLAHE_Gray:
-    - 조명 변화가 심할 때 대비 향상(국부 히스토그램 평활화)
+    TrackQuad:
+    - pos + vel 위치를 예측하고, 그 주변(템플릿 + TRACK_PAD_PX + |vel|/2)에서만 matchTemplate.
+    - 점수가 TRACK_MIN_SCORE 이상이면 위치/속도를 갱신하고 quadDet(DET 좌표)을 돌려준다.
+    - 탐색 창이 gate 밖으로 나가 템플릿이 안 들어가면(QR이 gate를 벗어남) 실패.
 */
-static Mat CLAHE_Gray(const Mat& g)
+static bool TrackQuad(QrTrack& tr, const Mat& grayDet, const Rect& gateRect, vector<Point2f>& quadDet)
 {
-    Ptr<CLAHE> c = createCLAHE(2.0, Size(8, 8));
-    Mat out; c->apply(g, out);
-    return out;
+    if (!tr.valid || tr.tmpl.empty()) return false;
+
+    Point2f pred = tr.pos + tr.vel;
+    int pad = TRACK_PAD_PX + (int)ceil(norm(tr.vel) * 0.5);
+
+    Rect win((int)floor(pred.x) - pad, (int)floor(pred.y) - pad,
+        tr.tmpl.cols + 2 * pad, tr.tmpl.rows + 2 * pad);
+    win &= gateRect;
+    if (win.width < tr.tmpl.cols || win.height < tr.tmpl.rows) return false;
+
+    Mat score;
+    matchTemplate(grayDet(win), tr.tmpl, score, TM_CCOEFF_NORMED);
+
+    double maxV = 0.0;
+    Point maxL;
+    minMaxLoc(score, nullptr, &maxV, nullptr, &maxL);
+    if (!(maxV >= TRACK_MIN_SCORE)) return false; // NaN(평탄한 패치)도 실패
+
+    Point2f newPos((float)(win.x + maxL.x), (float)(win.y + maxL.y));
+    tr.vel = tr.vel * 0.5f + (newPos - tr.pos) * 0.5f;
+    tr.pos = newPos;
+
+    quadDet.resize(4);
+    for (int i = 0; i < 4; i++) quadDet[i] = tr.quadRel[i] + newPos;
+    return true;
 }
 
+// ============================================================
+// 5-2) 디코드 결과 캐시
+// ============================================================
+
+/*
+    QrDecodeCache:
+    - 마지막으로 디코드에 성공한 payload와 그때(그리고 이후 캐시 적중 때마다 갱신되는) quad/서명
+*/
+struct QrDecodeCache {
+    bool valid = false;
+    string payload;
+    vector<Point2f> quadDet;  // 마지막으로 확인한 quad (DET)
+    uint64_t sig = 0;         // 마지막으로 확인한 서명
+    int hits = 0;             // 마지막 실제 디코드 이후 캐시 사용 횟수
+};
+
 /*
-    Sharpen:
-    - 살짝 샤프닝해서 QR 모서리/패턴이 선명해지도록 함
+    QuadSignature:
+    - quad bounding box를 9x8로 줄여서 가로 방향 밝기 차이 부호로 64bit dHash를 만든다.
+    - 노출이 조금 변해도 유지되고, 다른 QR/물체가 들어오면 크게 달라진다.
 */
-static Mat Sharpen(const Mat& g)
+static uint64_t QuadSignature(const Mat& grayDet, const vector<Point2f>& quadDet)
 {
-    Mat blur, out;
-    GaussianBlur(g, blur, Size(0, 0), 1.0);
-    addWeighted(g, 1.30, blur, -0.30, 0, out);
-    return out;
+    Rect r = PointsToRect(quadDet, grayDet.cols, grayDet.rows);
+    Mat small;
+    resize(grayDet(r), small, Size(9, 8), 0, 0, INTER_AREA);
+
+    uint64_t h = 0;
+    for (int y = 0; y < 8; y++) {
+        const uchar* row = small.ptr<uchar>(y);
+        for (int x = 0; x < 8; x++) {
+            h = (h << 1) | (row[x] < row[x + 1] ? 1u : 0u);
+        }
+    }
+    return h;
+}
+
+static int HammingDistance64(uint64_t a, uint64_t b)
+{
+    uint64_t v = a ^ b;
+    int n = 0;
+    while (v) { v &= v - 1; n++; }
+    return n;
 }
 
 /*
-    WarpWithPadding:
-    - 원본(grayFull)에서 QR 사각형 영역을 정면으로 펴(upright) 디코드 안정성 개선
-    - QR_PAD_PX 만큼 여백을 주어 코드 경계가 잘리지 않게 함
+    QuadConsistent:
+    - 이전 quad → 현재 quad가 "같은 QR이 조금 움직인 것"인지 판단
+    - 중심 이동량, 그리고 중심 기준 코너 상대위치 변화(크기 대비)를 본다.
 */
-static bool WarpWithPadding(const Mat& grayFull, const vector<Point2f>& quadFull, Mat& uprightOut)
+static bool QuadConsistent(const vector<Point2f>& prev, const vector<Point2f>& cur)
 {
-    vector<Point2f> q = OrderQuadTLTRBRBL(quadFull);
+    if (prev.size() != 4 || cur.size() != 4) return false;
 
-    Rect r = PointsToRect(q, grayFull.cols, grayFull.rows);
-    int side = max(r.width, r.height);
-    side = clampi(side, 200, 900);
+    Point2f cp(0.f, 0.f), cc(0.f, 0.f);
+    for (int i = 0; i < 4; i++) { cp += prev[i] * 0.25f; cc += cur[i] * 0.25f; }
+    if (norm(cc - cp) > CACHE_MAX_SHIFT_PX) return false;
 
-    int outSide = side + 2 * QR_PAD_PX;
+    double size = max(norm(prev[0] - prev[2]), norm(prev[1] - prev[3]));
+    for (int i = 0; i < 4; i++) {
+        if (norm((cur[i] - cc) - (prev[i] - cp)) > CACHE_MAX_SHAPE_RATIO * size) return false;
+    }
+    return true;
+}
 
-    // 목적지 사각형(정면) 좌표
-    vector<Point2f> dst = {
-        Point2f((float)QR_PAD_PX, (float)QR_PAD_PX),
-        Point2f((float)(QR_PAD_PX + side - 1), (float)QR_PAD_PX),
-        Point2f((float)(QR_PAD_PX + side - 1), (float)(QR_PAD_PX + side - 1)),
-        Point2f((float)QR_PAD_PX, (float)(QR_PAD_PX + side - 1))
-    };
+/*
+    CacheLookup:
+    - 캐시가 유효하고 quad/서명이 이어지면 payload를 돌려주고 quad/서명을 현재 값으로 갱신(true)
+    - 어긋나면 캐시를 비운다(false → 호출측에서 실제 디코드)
+*/
+static bool CacheLookup(QrDecodeCache& c, const vector<Point2f>& quadDet, uint64_t sig, string& payload)
+{
+    if (!c.valid) return false;
+
+    if (c.hits >= CACHE_MAX_HITS
+        || !QuadConsistent(c.quadDet, quadDet)
+        || HammingDistance64(c.sig, sig) > CACHE_MAX_HASH_BITS) {
+        c.valid = false;
+        return false;
+    }
 
-    Mat Hm = getPerspectiveTransform(q, dst);
-    if (Hm.empty()) return false;
+    c.quadDet = quadDet;
+    c.sig = sig;
+    c.hits++;
+    payload = c.payload;
+    return true;
+}
 
-    warpPerspective(grayFull, uprightOut, Hm, Size(outSide, outSide), INTER_LINEAR, BORDER_REPLICATE);
-    return !uprightOut.empty();
+static void CacheStore(QrDecodeCache& c, const vector<Point2f>& quadDet, uint64_t sig, const string& payload)
+{
+    c.valid = true;
+    c.payload = payload;
+    c.quadDet = quadDet;
+    c.sig = sig;
+    c.hits = 0;
 }
 
+// ============================================================
+// 5-3) 디코드 워커 풀
+// ============================================================
+
 /*
-    DrawQuad:
-    - 디버그 시각화용(사각형/코너 점 표시)
+    QrDecodeResult:
+    - seq: 제출 순서 번호(결과는 항상 이 순서대로 꺼낸다)
+    - skipped: 더 새로운 후보에 밀려 디코드하지 않고 버려진 작업
+    - quadDet/sig: 제출 당시 값 (캐시 저장용)
+    - captureMs: 이 후보가 나온 프레임의 캡처 시각(epoch ms, 시리얼 프레임 ts로 보냄)
 */
-static void DrawQuad(Mat& img, const vector<Point2f>& pts, const Scalar& color)
+struct QrDecodeResult {
+    uint64_t seq = 0;
+    int64_t captureMs = 0;
+    bool skipped = false;
+    string payload;
+    vector<Point2f> quadDet;
+    uint64_t sig = 0;
+};
+
+/*
+    QrDecodePool:
+    - 워커마다 자기 QRCodeDetector/QrPrep을 가지고 DecodeQuad를 돌린다.
+    - 대기 큐는 capacity개까지만. 꽉 차면 가장 오래된 대기 작업을 버린다(latest-wins).
+      버린 작업도 skipped 결과로 남겨서 순서 재정렬이 막히지 않게 한다.
+    - PopReady: 다음 순번 결과가 준비됐을 때만 꺼냄(시리얼 전송 순서 = 제출 순서)
+*/
+class QrDecodePool {
+public:
+    QrDecodePool(int workers, size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1)
+    {
+        if (workers < 1) workers = 1;
+        for (int i = 0; i < workers; i++) workers_.emplace_back(&QrDecodePool::Run, this);
+    }
+
+    ~QrDecodePool() { Stop(); }
+
+    QrDecodePool(const QrDecodePool&) = delete;
+    QrDecodePool& operator=(const QrDecodePool&) = delete;
+
+    // frameCap은 참조만 한다(메인 루프는 매 프레임 새 Mat을 읽으므로 복사 불필요)
+    // quadCap은 화면(반전 후) 좌표, viewFromRaw는 원본 → 화면 반전 행렬
+    // hold: frameCap이 캡처 버퍼를 직접 가리킬 때(gray 직접 캡처) 그 버퍼 수명. 디코드 끝까지 잡아 둔다
+    void Submit(const Mat& frameCap, const vector<Point2f>& quadCap, const Matx33d& viewFromRaw,
+        const vector<Point2f>& quadDet, uint64_t sig, int64_t captureMs, const shared_ptr<void>& hold = nullptr)
+    {
+        {
+            lock_guard<mutex> lk(mtx_);
+            if (stop_) return;
+
+            Job job;
+            job.seq = nextSeq_++;
+            job.frameCap = frameCap;
+            job.hold = hold;
+            job.quadCap = quadCap;
+            job.viewFromRaw = viewFromRaw;
+            job.quadDet = quadDet;
+            job.sig = sig;
+            job.captureMs = captureMs;
+
+            if (q_.size() >= capacity_) {
+                QrDecodeResult r;
+                r.seq = q_.front().seq;
+                r.skipped = true;
+                done_[r.seq] = std::move(r);
+                q_.pop_front();
+                dropped_++;
+            }
+            q_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    bool PopReady(QrDecodeResult& out)
+    {
+        lock_guard<mutex> lk(mtx_);
+        auto it = done_.find(nextOut_);
+        if (it == done_.end()) return false;
+        out = std::move(it->second);
+        done_.erase(it);
+        nextOut_++;
+        return true;
+    }
+
+    void Stop()
+    {
+        {
+            lock_guard<mutex> lk(mtx_);
+            stop_ = true;
+            q_.clear(); // 종료 시 대기 작업은 버림
+        }
+        cv_.notify_all();
+        for (thread& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+        workers_.clear();
+    }
+
+    uint64_t Dropped() const
+    {
+        lock_guard<mutex> lk(mtx_);
+        return dropped_;
+    }
+
+private:
+    struct Job {
+        uint64_t seq = 0;
+        Mat frameCap;
+        shared_ptr<void> hold;
+        vector<Point2f> quadCap;
+        Matx33d viewFromRaw;
+        vector<Point2f> quadDet;
+        uint64_t sig = 0;
+        int64_t captureMs = 0;
+    };
+
+    void Run()
+    {
+        QRCodeDetector qrd; // 워커 전용
+        QrPrep prep;        // 워커 전용 (버퍼 재사용)
+
+        while (true) {
+            Job job;
+            {
+                unique_lock<mutex> lk(mtx_);
+                cv_.wait(lk, [&] { return stop_ || !q_.empty(); });
+                if (stop_) return;
+                job = std::move(q_.front());
+                q_.pop_front();
+            }
+
+            QrDecodeResult r;
+            r.seq = job.seq;
+            r.quadDet = std::move(job.quadDet);
+            r.sig = job.sig;
+            r.captureMs = job.captureMs;
+            try {
+                r.payload = DecodeQuad(qrd, prep, job.frameCap, job.quadCap, job.viewFromRaw);
+            }
+            catch (const cv::Exception&) {
+                // 실패와 같게 처리 (빈 payload)
+            }
+
+            lock_guard<mutex> lk(mtx_);
+            done_[r.seq] = std::move(r);
+        }
+    }
+
+    const size_t capacity_;
+    mutable mutex mtx_;
+    condition_variable cv_;
+    deque<Job> q_;
+    map<uint64_t, QrDecodeResult> done_; // 순서 재정렬 버퍼
+    uint64_t nextSeq_ = 1;
+    uint64_t nextOut_ = 1;
+    uint64_t dropped_ = 0;
+    bool stop_ = false;
+    vector<thread> workers_;
+};
+
+// ============================================================
+// 5-4) 다중 QR 탐지
+// ============================================================
+
+/*
+    DetectQuadsMulti:
+    - gateGray에서 detectMulti로 QR 여러 개를 찾고, ValidateCorners를 통과한 것만 DET 좌표로 돌려준다.
+    - 전송 순서를 고정하기 위해 중심 x(같으면 y) 기준 왼쪽 → 오른쪽으로 정렬한다.
+*/
+static vector<vector<Point2f>> DetectQuadsMulti(QRCodeDetector& qrd, const Mat& gateGray, const Rect& gateRect)
 {
-    if (pts.size() != 4) return;
-    for (int i = 0; i < 4; i++) {
-        line(img, pts[i], pts[(i + 1) % 4], color, 2);
-        circle(img, pts[i], 4, color, FILLED);
+    vector<vector<Point2f>> out;
+
+    vector<Point2f> pts;
+    if (!qrd.detectMulti(gateGray, pts)) return out;
+
+    for (size_t k = 0; k + 3 < pts.size(); k += 4) {
+        Mat corners(4, 1, CV_32FC2, &pts[k]);
+        if (!ValidateCorners(corners)) continue;
+
+        vector<Point2f> q(4);
+        for (int i = 0; i < 4; i++) q[i] = pts[k + i] + Point2f((float)gateRect.x, (float)gateRect.y);
+        out.push_back(q);
     }
+
+    sort(out.begin(), out.end(), [](const vector<Point2f>& a, const vector<Point2f>& b) {
+        Point2f ca = (a[0] + a[1] + a[2] + a[3]) * 0.25f;
+        Point2f cb = (b[0] + b[1] + b[2] + b[3]) * 0.25f;
+        return (ca.x != cb.x) ? (ca.x < cb.x) : (ca.y < cb.y);
+    });
+    return out;
 }
 
 /*
-    ParseXY_CSV:
-    - QR 디코드 결과 문자열이 "x,y"인지 확인하고 숫자로 파싱
-    - 예: "100,2" / " 2,133 " 가능
-    - 실패하면 false (즉, QR 내용이 원하는 포맷이 아니면 전송하지 않음)
+    MultiSeenCheck:
+    - 다중 모드 중복 억제. payload를 처음 보거나(또는 잊혀진 뒤 다시 보면) true(전송)
+    - 볼 때마다 시각을 갱신하므로 QR이 화면에 머무는 동안은 한 번만 전송된다.
 */
-static bool ParseXY_CSV(const string& s, int& x, int& y)
+static bool MultiSeenCheck(map<string, chrono::steady_clock::time_point>& seen, const string& payload,
+    chrono::steady_clock::time_point now)
 {
-    // 공백 제거
-    string t;
-    t.reserve(s.size());
-    for (char c : s) if (!isspace((unsigned char)c)) t.push_back(c);
+    auto it = seen.find(payload);
+    bool fresh = (it == seen.end()) || (now - it->second > chrono::milliseconds(MULTI_FORGET_MS));
+    seen[payload] = now;
+    return fresh;
+}
 
-    size_t comma = t.find(',');
-    if (comma == string::npos) return false;
+// ============================================================
+// 5-5) 적응형 디코드 스케줄러
+// ============================================================
+
+/*
+    QuadSharpness:
+    - DET gray에서 quad bounding box의 라플라시안 분산 (클수록 선명)
+*/
+static double QuadSharpness(const Mat& grayDet, const vector<Point2f>& quadDet)
+{
+    Rect r = PointsToRect(quadDet, grayDet.cols, grayDet.rows);
+    Mat lap;
+    Laplacian(grayDet(r), lap, CV_16S, 3);
+    Scalar m, sd;
+    meanStdDev(lap, m, sd);
+    return sd[0] * sd[0];
+}
 
-    string sx = t.substr(0, comma);
-    string sy = t.substr(comma + 1);
-    if (sx.empty() || sy.empty()) return false;
+/*
+    QrDecodeScheduler:
+    - Decide: 이번 프레임 QR(quadDet)을 디코드할지. 거절 사유는 skipReason에
+    - OnSubmit/OnResult: 시도한 것과 그 결과(성공 여부)를 알려 준다.
+      워커 풀이면 결과가 몇 프레임 뒤에 오므로, 시도 순서대로 pending에 쌓아 두고 결과도 그 순서로 맞춘다.
+    - Reset: QR이 안 보이면 호출 (다음 QR은 새 QR로 취급)
+*/
+class QrDecodeScheduler {
+public:
+    enum Skip { SKIP_NONE = 0, SKIP_SMALL, SKIP_BLUR, SKIP_MOTION, SKIP_BACKOFF, SKIP_INFLIGHT, SKIP_COUNT };
+
+    bool Decide(const Mat& grayDet, const vector<Point2f>& quadDet, Skip& skipReason)
+    {
+        Rect r = PointsToRect(quadDet, grayDet.cols, grayDet.rows);
+        int size = min(r.width, r.height);
+
+        // 같은 QR이 이어지는지 (아니면 새 QR: 간격/시도 기록 초기화)
+        Point2f c = (quadDet[0] + quadDet[1] + quadDet[2] + quadDet[3]) * 0.25f;
+        bool same = hasPrev_ && QuadConsistent(prevQuad_, quadDet);
+        float motion = same ? (float)norm(c - prevCenter_) : 0.f;
+        if (!same) NewCode();
+        prevQuad_ = quadDet;
+        prevCenter_ = c;
+        hasPrev_ = true;
+        sinceAttempt_++;
+
+        skipReason = SKIP_NONE;
+        if (size < QR_MIN_SIZE_DET) { skipReason = SKIP_SMALL; return false; }
+
+        double sharp = QuadSharpness(grayDet, quadDet);
+        bool forced = sinceAttempt_ >= SCHED_MAX_INTERVAL;
+
+        if (!forced) {
+            // 워커가 아직 디코드 중이면 겹쳐 내지 않음. codeId 와 상관없이 pending 전체를 본다
+            // (빠르게 움직이면 QuadConsistent 가 빗나가 같은 QR이 새 codeId 가 되므로)
+            if (!pending_.empty()) { skipReason = SKIP_INFLIGHT; return false; }
+            if (sharp < SharpThreshold()) { skipReason = SKIP_BLUR; return false; }
+            if (motion > SCHED_MAX_MOTION_PX && attempts_ > 0) { skipReason = SKIP_MOTION; return false; }
+
+            // 실패 후 백오프: 단, 크기나 선명도가 눈에 띄게 좋아졌으면(새 정보) 바로 재시도
+            bool improved = attempts_ > 0 && (size > lastSize_ * 1.1 || sharp > lastSharp_ * 1.2);
+            if (sinceAttempt_ < interval_ && !improved) { skipReason = SKIP_BACKOFF; return false; }
+        }
 
-    try {
-        x = stoi(sx);
-        y = stoi(sy);
+        sinceAttempt_ = 0;
+        attempts_++;
+        lastSize_ = size;
+        lastSharp_ = sharp;
+        lastAttemptSharp_ = sharp;
         return true;
     }
-    catch (...) {
-        return false;
+
+    // Decide가 true를 준 뒤 실제로 디코드를 시작할 때
+    void OnSubmit()
+    {
+        pending_.push_back({ codeId_, lastAttemptSharp_ });
+    }
+
+    // 시도 결과 (OnSubmit 순서대로). decided=false면 버려진 작업(결과 없음)
+    void OnResult(bool decided, bool ok)
+    {
+        if (pending_.empty()) return;
+        Pending p = pending_.front();
+        pending_.pop_front();
+        if (!decided) return;
+
+        successEwma_ += SCHED_EWMA_ALPHA * ((ok ? 1.0 : 0.0) - successEwma_);
+        double& e = ok ? sharpOkEwma_ : sharpFailEwma_;
+        e = (e <= 0.0) ? p.sharp : e + SCHED_EWMA_ALPHA * (p.sharp - e);
+
+        if (p.codeId != codeId_) return; // 그 사이 다른 QR로 바뀜
+        // 성공하면 이 QR은 더 볼 필요가 거의 없음(캐시가 처리) → 최대 간격, 실패하면 2배
+        interval_ = ok ? SCHED_MAX_INTERVAL : min(SCHED_MAX_INTERVAL, interval_ * 2);
+    }
+
+    void Reset()
+    {
+        hasPrev_ = false;
+        NewCode();
+    }
+
+    // 선명도 임계값: 기본 하한과 "성공/실패 때 선명도의 중간" 중 큰 값
+    double SharpThreshold() const
+    {
+        double th = SCHED_MIN_SHARPNESS;
+        if (sharpOkEwma_ > 0.0 && sharpFailEwma_ > 0.0 && sharpOkEwma_ > sharpFailEwma_)
+            th = max(th, 0.5 * (sharpOkEwma_ + sharpFailEwma_));
+        return th;
     }
-}
+
+    double SuccessRate() const { return successEwma_; }
+
+private:
+    struct Pending { uint64_t codeId; double sharp; };
+
+    void NewCode()
+    {
+        codeId_++;
+        attempts_ = 0;
+        interval_ = 1;
+        // 새 QR도 첫 프레임부터 선명도/모션 검사를 거침 (interval_ = 1 이라 선명하면 바로 시도)
+        // 흐리면 기다리다가 SCHED_MAX_INTERVAL 프레임째에 강제 시도
+        sinceAttempt_ = 0;
+        lastSize_ = 0;
+        lastSharp_ = 0.0;
+    }
+
+    bool hasPrev_ = false;
+    vector<Point2f> prevQuad_;
+    Point2f prevCenter_;
+
+    uint64_t codeId_ = 0;
+    int attempts_ = 0;
+    int interval_ = 1;
+    int sinceAttempt_ = 0;
+    int lastSize_ = 0;
+    double lastSharp_ = 0.0;
+    double lastAttemptSharp_ = 0.0;
+    deque<Pending> pending_; // 제출했지만 결과가 아직 안 온 디코드 (= 진행 중)
+
+    double successEwma_ = 0.5;
+    double sharpOkEwma_ = 0.0;
+    double sharpFailEwma_ = 0.0;
+};
 
 // ============================================================
 // 6) 카메라 오픈 (CSI/libcamera vs USB/V4L2)
@@ -443,6 +1308,192 @@ static bool OpenCamera(VideoCapture& cap, const string& devPath, bool preferLibc
     return true;
 }
 
+// ============================================================
+// 6-1) gray 직접 캡처 (GStreamer tee + appsink 2개)
+// ============================================================
+// OpenCV VideoCapture(GStreamer)는 appsink를 하나만 받고 BGR로 변환된 프레임을 복사해서 준다.
+// QR 탐지/디코드는 gray만 쓰므로 파이프라인에서
+//   - 원본 크기: NV12 그대로 → Y plane을 gray로 (변환 없음)
+//   - 탐지 크기: videoscale → GRAY8 (작은 프레임만 변환)
+// 두 갈래로 받아 버퍼를 map한 채로 Mat을 씌운다(복사 없음).
+
+/*
+    BuildGrayDualPipeline:
+    - testSrc=true면 libcamerasrc 대신 videotestsrc (카메라 없는 리눅스에서 확인용)
+    - 큐/appsink 모두 1장만 유지하고 오래된 것은 버림(지연 최소화)
+*/
+static string BuildGrayDualPipeline(bool testSrc, int capW, int capH, int detW, int detH, int fps)
+{
+    string src = testSrc ? "videotestsrc is-live=true pattern=ball" : "libcamerasrc";
+    return src + " ! "
+        + "video/x-raw,format=NV12,width=" + to_string(capW)
+        + ",height=" + to_string(capH)
+        + ",framerate=" + to_string(fps) + "/1 ! "
+        + "tee name=t "
+        + "t. ! queue leaky=downstream max-size-buffers=1 ! "
+        + "appsink name=full drop=true max-buffers=1 sync=false "
+        + "t. ! queue leaky=downstream max-size-buffers=1 ! "
+        + "videoscale ! video/x-raw,width=" + to_string(detW) + ",height=" + to_string(detH) + " ! "
+        + "videoconvert ! video/x-raw,format=GRAY8 ! "
+        + "appsink name=det drop=true max-buffers=1 sync=false";
+}
+
+/*
+    GstDualCapture:
+    - Open: 파이프라인 실행, appsink "full"/"det" 연결
+    - Read: 두 appsink에서 같은 PTS의 프레임을 한 장씩 꺼내 Mat(gray)로 돌려준다.
+      Mat은 GStreamer 버퍼를 직접 가리키므로 hold가 살아 있는 동안만 유효하다.
+    - QR_GST_APPSINK 없이 빌드하면 Open이 항상 실패(안내 메시지)
+*/
+class GstDualCapture {
+public:
+    GstDualCapture() = default;
+    ~GstDualCapture() { Close(); }
+    GstDualCapture(const GstDualCapture&) = delete;
+    GstDualCapture& operator=(const GstDualCapture&) = delete;
+
+    bool Open(const string& pipeline, string& err);
+    void Close();
+    bool Read(Mat& full, Mat& det, shared_ptr<void>& hold, int timeoutMs = 1000);
+
+    // 두 갈래 PTS가 어긋나서 한쪽을 다시 받은 횟수
+    uint64_t Resyncs() const { return resyncs_; }
+
+private:
+#ifdef QR_GST_APPSINK
+    GstElement* pipe_ = nullptr;
+    GstAppSink* full_ = nullptr;
+    GstAppSink* det_ = nullptr;
+#endif
+    uint64_t resyncs_ = 0;
+};
+
+#ifdef QR_GST_APPSINK
+
+/*
+    GstMappedFrame:
+    - appsink에서 꺼낸 샘플 + 읽기 map. 소멸 시 unmap/unref (Mat이 가리키는 메모리의 주인)
+*/
+struct GstMappedFrame {
+    GstSample* sample = nullptr;
+    GstBuffer* buffer = nullptr;
+    GstMapInfo map{};
+    bool mapped = false;
+
+    ~GstMappedFrame()
+    {
+        if (mapped) gst_buffer_unmap(buffer, &map);
+        if (sample) gst_sample_unref(sample);
+    }
+};
+
+/*
+    PullGray:
+    - appsink에서 샘플 하나를 꺼내 plane 0(GRAY8이면 전체, NV12/I420이면 Y)을 복사 없이 Mat으로
+    - 실패/타임아웃이면 nullptr
+*/
+static shared_ptr<GstMappedFrame> PullGray(GstAppSink* sink, int timeoutMs, Mat& out, GstClockTime& pts)
+{
+    GstSample* sample = gst_app_sink_try_pull_sample(sink, (GstClockTime)timeoutMs * GST_MSECOND);
+    if (!sample) return nullptr;
+
+    auto f = make_shared<GstMappedFrame>();
+    f->sample = sample;
+    f->buffer = gst_sample_get_buffer(sample);
+
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstVideoInfo info;
+    if (!f->buffer || !caps || !gst_video_info_from_caps(&info, caps)) return nullptr;
+
+    GstVideoFormat fmt = GST_VIDEO_INFO_FORMAT(&info);
+    if (fmt != GST_VIDEO_FORMAT_GRAY8 && fmt != GST_VIDEO_FORMAT_NV12 && fmt != GST_VIDEO_FORMAT_NV21
+        && fmt != GST_VIDEO_FORMAT_I420 && fmt != GST_VIDEO_FORMAT_YV12) return nullptr;
+
+    if (!gst_buffer_map(f->buffer, &f->map, GST_MAP_READ)) return nullptr;
+    f->mapped = true;
+
+    out = Mat(GST_VIDEO_INFO_HEIGHT(&info), GST_VIDEO_INFO_WIDTH(&info), CV_8UC1,
+        f->map.data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0),
+        (size_t)GST_VIDEO_INFO_PLANE_STRIDE(&info, 0));
+    pts = GST_BUFFER_PTS(f->buffer);
+    return f;
+}
+
+bool GstDualCapture::Open(const string& pipeline, string& err)
+{
+    Close();
+    gst_init(nullptr, nullptr);
+
+    GError* gerr = nullptr;
+    pipe_ = gst_parse_launch(pipeline.c_str(), &gerr);
+    if (gerr) {
+        err = gerr->message;
+        g_error_free(gerr);
+        Close();
+        return false;
+    }
+    if (!pipe_) { err = "gst_parse_launch failed"; return false; }
+
+    full_ = GST_APP_SINK(gst_bin_get_by_name(GST_BIN(pipe_), "full"));
+    det_ = GST_APP_SINK(gst_bin_get_by_name(GST_BIN(pipe_), "det"));
+    if (!full_ || !det_) { err = "appsink full/det not found"; Close(); return false; }
+
+    if (gst_element_set_state(pipe_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        err = "pipeline PLAYING failed";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void GstDualCapture::Close()
+{
+    if (pipe_) gst_element_set_state(pipe_, GST_STATE_NULL);
+    if (full_) { gst_object_unref(full_); full_ = nullptr; }
+    if (det_) { gst_object_unref(det_); det_ = nullptr; }
+    if (pipe_) { gst_object_unref(pipe_); pipe_ = nullptr; }
+}
+
+bool GstDualCapture::Read(Mat& full, Mat& det, shared_ptr<void>& hold, int timeoutMs)
+{
+    if (!pipe_) return false;
+
+    // 같은 원본 버퍼에서 갈라진 두 갈래는 PTS가 같다. 한쪽이 드롭돼서 어긋나면 뒤처진 쪽을 다시 받는다.
+    shared_ptr<GstMappedFrame> ff, df;
+    GstClockTime fpts = GST_CLOCK_TIME_NONE, dpts = GST_CLOCK_TIME_NONE;
+    for (int tries = 0; tries < 4; tries++) {
+        if (!df) df = PullGray(det_, timeoutMs, det, dpts);
+        if (!ff) ff = PullGray(full_, timeoutMs, full, fpts);
+        if (!df || !ff) return false;
+
+        if (fpts == dpts || !GST_CLOCK_TIME_IS_VALID(fpts) || !GST_CLOCK_TIME_IS_VALID(dpts)) break;
+        resyncs_++;
+        if (dpts < fpts) df.reset();
+        else ff.reset();
+    }
+    if (!df || !ff) return false;
+
+    hold = make_shared<pair<shared_ptr<GstMappedFrame>, shared_ptr<GstMappedFrame>>>(ff, df);
+    return true;
+}
+
+#else
+
+bool GstDualCapture::Open(const string&, string& err)
+{
+    err = "built without QR_GST_APPSINK (gstreamer-app-1.0 / gstreamer-video-1.0 필요)";
+    return false;
+}
+
+void GstDualCapture::Close() {}
+
+bool GstDualCapture::Read(Mat&, Mat&, shared_ptr<void>&, int)
+{
+    return false;
+}
+
+#endif
+
 // ============================================================
 // 7) main: 전체 실행 루프
 // ============================================================
@@ -475,6 +1526,32 @@ int main(int argc, char** argv)
     int serialBaud = 115200;
     int serialFd = -1;
 
+    // QR 추적: 끄면 매 프레임 gate 전체 detect (기존 동작)
+    bool useTrack = true;
+    int redetectN = QR_REDETECT_EVERY_N;
+    bool showStats = false;
+
+    // 디코드 결과 캐시: 끄면 같은 QR도 N프레임마다 다시 디코드 (기존 동작)
+    bool useCache = true;
+
+    // 디코드 워커 수 (0이면 메인 루프에서 직접 디코드 = 기존 동작)
+    int decodeThreads = DEFAULT_DECODE_THREADS;
+
+    // 다중 QR 모드
+    bool multiMode = false;
+
+    // 디코드 스케줄: 기본은 적응형, --fixed-schedule 이면 기존 N프레임마다 + 최소 크기
+    bool adaptiveSchedule = true;
+
+    // gray 직접 캡처 (GStreamer appsink 2개, QR_GST_APPSINK 빌드 필요)
+    bool grayCapture = false;
+    bool testSrc = false;      // libcamerasrc 대신 videotestsrc
+    int captureTestFrames = 0; // >0 이면 캡처만 N프레임 측정하고 종료
+
+    // 시리얼 프로토콜 (기본 ascii = 기존 B 호환)
+    SerialProto serialProto = SERIAL_ASCII;
+    int selftestPty = 0;       // >0 이면 pty 자체 시험만 하고 종료
+
     // ------------------------------------------------------------
     // [옵션 파싱]
     // ------------------------------------------------------------
@@ -487,6 +1564,18 @@ int main(int argc, char** argv)
     // --v4l2
     // --serial /dev/serial0
     // --baud 115200
+    // --no-track
+    // --redetect 10
+    // --stats
+    // --no-cache
+    // --decode-threads 3
+    // --multi
+    // --fixed-schedule
+    // --gray-capture
+    // --test-src
+    // --capture-test 300
+    // --serial-proto ascii|frame
+    // --selftest-pty 500
     for (int i = 1; i < argc; i++) {
         string a = argv[i];
         if (a == "--headless") headless = true;
@@ -497,6 +1586,35 @@ int main(int argc, char** argv)
         else if (a == "--v4l2") preferLibcamera = false; // USB/V4L2로 강제
         else if (a == "--serial" && i + 1 < argc) serialDev = argv[++i];
         else if (a == "--baud" && i + 1 < argc) serialBaud = stoi(argv[++i]);
+        else if (a == "--no-track") useTrack = false;
+        else if (a == "--redetect" && i + 1 < argc) redetectN = max(1, stoi(argv[++i]));
+        else if (a == "--stats") showStats = true;
+        else if (a == "--no-cache") useCache = false;
+        else if (a == "--decode-threads" && i + 1 < argc) decodeThreads = max(0, stoi(argv[++i]));
+        else if (a == "--multi") multiMode = true;
+        else if (a == "--fixed-schedule") adaptiveSchedule = false;
+        else if (a == "--gray-capture") grayCapture = true;
+        else if (a == "--test-src") testSrc = true;
+        else if (a == "--capture-test" && i + 1 < argc) captureTestFrames = max(1, stoi(argv[++i]));
+        else if (a == "--serial-proto" && i + 1 < argc) {
+            string v = argv[++i];
+            if (v == "frame") serialProto = SERIAL_FRAME;
+            else if (v == "ascii") serialProto = SERIAL_ASCII;
+            else { cerr << "Invalid --serial-proto (ascii|frame).\n"; return 1; }
+        }
+        else if (a == "--selftest-pty") {
+            selftestPty = 500;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) selftestPty = max(1, stoi(argv[++i]));
+        }
+    }
+
+    // 카메라 없이 시리얼 송신/프로토콜만 시험
+    if (selftestPty > 0) return SerialSelfTestPty(selftestPty);
+
+    // 추적/캐시는 QR 1개 기준이라 다중 모드에선 끈다
+    if (multiMode) {
+        useTrack = false;
+        useCache = false;
     }
 
     // gate 값 유효성 체크
@@ -509,10 +1627,21 @@ int main(int argc, char** argv)
     // [카메라 오픈: 실패 시 재시도]
     // ------------------------------------------------------------
     VideoCapture cap;
+    GstDualCapture gst;
     bool opened = false;
 
+    // gray 직접 캡처면 GstDualCapture, 아니면 기존 VideoCapture(BGR)
+    string gstPipeline = BuildGrayDualPipeline(testSrc, CAP_W, CAP_H, DET_W, DET_H, 30);
+    auto openCapture = [&]() -> bool {
+        if (!grayCapture) return OpenCamera(cap, devPath, preferLibcamera);
+        string err;
+        if (gst.Open(gstPipeline, err)) return true;
+        cerr << "[WARN] gray capture: " << err << "\n";
+        return false;
+    };
+
     for (int t = 0; t < 5; t++) {
-        if (OpenCamera(cap, devPath, preferLibcamera)) { opened = true; break; }
+        if (openCapture()) { opened = true; break; }
         cerr << "[WARN] camera open failed, retry " << (t + 1) << "/5\n";
         this_thread::sleep_for(chrono::milliseconds(300));
     }
@@ -524,6 +1653,37 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    // 프레임 읽기: full = CAP 크기(BGR 또는 gray), detGray = DET 크기 gray(직접 캡처일 때만, 반전 전)
+    auto readCapture = [&](Mat& full, Mat& detGray, shared_ptr<void>& hold) -> bool {
+        if (grayCapture) return gst.Read(full, detGray, hold);
+        return cap.read(full);
+    };
+
+    // ------------------------------------------------------------
+    // [--capture-test: 캡처만 N프레임 받아서 fps/크기 출력하고 종료 (시리얼 불필요)]
+    // ------------------------------------------------------------
+    if (captureTestFrames > 0) {
+        int got = 0, empty = 0;
+        Mat full, detGray;
+        auto t0 = chrono::steady_clock::now();
+        while (got + empty < captureTestFrames) {
+            shared_ptr<void> hold;
+            if (!readCapture(full, detGray, hold) || full.empty()) { empty++; continue; }
+            if (got == 0) {
+                cerr << "[CAPTURE] full " << full.cols << "x" << full.rows << " ch=" << full.channels()
+                    << " step=" << (size_t)full.step;
+                if (!detGray.empty()) cerr << ", det " << detGray.cols << "x" << detGray.rows;
+                cerr << "\n";
+            }
+            got++;
+        }
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cerr << "[CAPTURE] frames=" << got << " empty=" << empty
+            << " fps=" << fixed << setprecision(1) << (sec > 0 ? got / sec : 0.0)
+            << " resync=" << gst.Resyncs() << "\n";
+        return got > 0 ? 0 : 1;
+    }
+
     // ------------------------------------------------------------
     // [시리얼 오픈: 실패하면 프로그램 종료]
     // ------------------------------------------------------------
@@ -532,7 +1692,11 @@ int main(int argc, char** argv)
         cerr << "[ERR] Serial open failed: " << serialDev << "\n";
         return -1;
     }
-    cerr << "[OK] Serial opened: " << serialDev << " baud=" << serialBaud << "\n";
+    cerr << "[OK] Serial opened: " << serialDev << " baud=" << serialBaud
+        << " proto=" << (serialProto == SERIAL_FRAME ? "frame" : "ascii") << "\n";
+
+    // 송신 전용 스레드 (카메라 루프는 큐에 넣기만)
+    unique_ptr<SerialWriter> serialWriter(new SerialWriter(serialFd, serialProto));
 
     // ------------------------------------------------------------
     // [시각화 창 설정: headless가 아니면 창을 띄움]
@@ -543,8 +1707,17 @@ int main(int argc, char** argv)
         moveWindow("OPENCV_VIEW", 20, 20);
     }
 
-    // OpenCV QR detector 객체
+    // OpenCV QR detector 객체 (메인 스레드 전용: detect + 동기 디코드)
     QRCodeDetector qrd;
+    QrPrep prep; // 동기 디코드용 전처리 버퍼
+
+    // 디코드 워커 풀 (대기 큐는 워커 수만큼만: 오래된 후보는 새 후보로 대체. 다중 모드는 MULTI_MAX_PENDING)
+    unique_ptr<QrDecodePool> decodePool;
+    if (decodeThreads > 0) {
+        size_t pending = (size_t)(multiMode ? max(decodeThreads, MULTI_MAX_PENDING) : decodeThreads);
+        decodePool.reset(new QrDecodePool(decodeThreads, pending));
+        cerr << "[OK] decode threads: " << decodeThreads << "\n";
+    }
 
     // frameCount: 디코드를 매 프레임 하지 않고 N프레임마다 하기 위해 사용
     int frameCount = 0;
@@ -552,17 +1725,37 @@ int main(int argc, char** argv)
     // lastX,lastY: 같은 값이 계속 들어오면 시리얼 전송을 반복하지 않기 위함(중복 억제)
     int lastX = INT_MIN, lastY = INT_MIN;
 
+    // 다중 모드용 중복 억제: payload → 마지막으로 본 시각
+    map<string, chrono::steady_clock::time_point> multiSeen;
+
     // empty frame 처리(카메라 glitch 대비)
     int emptyStreak = 0;
 
+    // QR 추적 상태 (detect 성공 후 다음 프레임부터 사용)
+    QrTrack track;
+
+    // 디코드 결과 캐시 (quad가 이어지는 동안 디코드 생략)
+    QrDecodeCache cache;
+
+    // 적응형 디코드 스케줄러 (단일 QR 모드)
+    QrDecodeScheduler sched;
+    const bool useSched = adaptiveSchedule && !multiMode;
+
+    // --stats 용 카운터
+    long statFrames = 0, statDetect = 0, statTrack = 0, statLost = 0, statDecode = 0, statCacheHit = 0;
+    long statSkip[QrDecodeScheduler::SKIP_COUNT] = {};
+    auto statT0 = chrono::steady_clock::now();
+
     // ------------------------------------------------------------
     // [메인 루프]
     // ------------------------------------------------------------
     while (true) {
         Mat frameCap;
+        Mat detRaw;                // gray 직접 캡처일 때 DET 크기 gray (반전 전)
+        shared_ptr<void> frameHold; // gray 직접 캡처 버퍼 수명 (frameCap/detRaw가 가리킴)
 
         // 1) 프레임 읽기
-        if (!cap.read(frameCap) || frameCap.empty()) {
+        if (!readCapture(frameCap, detRaw, frameHold) || frameCap.empty()) {
             emptyStreak++;
 
             // 연속으로 빈 프레임이 많으면 카메라 재오픈 시도
@@ -570,7 +1763,7 @@ int main(int argc, char** argv)
                 cerr << "[WARN] too many empty frames. reopening camera...\n";
                 bool ok = false;
                 for (int t = 0; t < 5; t++) {
-                    if (OpenCamera(cap, devPath, preferLibcamera)) { ok = true; break; }
+                    if (openCapture()) { ok = true; break; }
                     this_thread::sleep_for(chrono::milliseconds(300));
                 }
                 emptyStreak = 0;
@@ -593,54 +1786,125 @@ int main(int argc, char** argv)
 
         emptyStreak = 0;
 
-        // 2) 필요시 반전 보정
-        if (doFlip) flip(frameCap, frameCap, flipCode);
+        // 캡처 시각 (시리얼 프레임 ts: B가 지연을 잴 수 있게 epoch ms)
+        int64_t captureMs = chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
 
-        // 3) 탐지용 프레임으로 다운스케일(속도)
+        // 2~4) 탐지용 gray 프레임(grayDet) + 화면 표시용 frameDet
+        //    반전은 작은 탐지 프레임만 뒤집는다.
+        //    원본(frameCap)은 그대로 두고 디코드 워핑 행렬(viewFromRaw)에 반전을 합친다.
         Mat frameDet;
-        resize(frameCap, frameDet, Size(DET_W, DET_H), 0, 0, INTER_LINEAR);
-
-        // 4) grayscale
         Mat grayDet;
-        cvtColor(frameDet, grayDet, COLOR_BGR2GRAY);
+        if (grayCapture) {
+            // 파이프라인이 이미 DET 크기 gray로 줌. 캡처 버퍼는 읽기 전용이라 반전은 새 Mat으로
+            if (doFlip) flip(detRaw, grayDet, flipCode);
+            else grayDet = detRaw;
+            if (!headless) cvtColor(grayDet, frameDet, COLOR_GRAY2BGR);
+        }
+        else {
+            // 2) 탐지용 프레임으로 다운스케일(속도)
+            resize(frameCap, frameDet, Size(DET_W, DET_H), 0, 0, INTER_LINEAR);
+
+            // 3) 필요시 반전 보정
+            if (doFlip) flip(frameDet, frameDet, flipCode);
+
+            // 4) grayscale
+            cvtColor(frameDet, grayDet, COLOR_BGR2GRAY);
+        }
+        Matx33d viewFromRaw = FlipMatrix(doFlip, flipCode, frameCap.size());
 
         // 5) gate 영역 계산 (DET 기준)
         int xL = clampi((int)round(gateLX * DET_W), 0, DET_W - 2);
         int xR = clampi((int)round(gateRX * DET_W), xL + 1, DET_W - 1);
 
         Rect gateRect(xL, 0, xR - xL, DET_H);
-        Mat gateGray = grayDet(gateRect).clone();
 
         // 6) QR 탐지/디코드 관련 변수
         bool qrFound = false;
+        bool tracked = false;     // true면 이번 프레임은 detect 대신 추적으로 찾음
         vector<Point2f> quadDet;
         vector<Point2f> quadCap;
-        string decodedRaw;
+        vector<vector<Point2f>> quadsDet;   // 다중 모드: 이번 프레임에 찾은 QR들 (왼쪽 → 오른쪽)
+        string decodedRaw;           // 화면 표시용(이번 프레임 마지막 결과)
+        vector<pair<string, int64_t>> decodedList;  // 이번 프레임에 나온 결과(전송 순서): payload, 캡처 시각
 
         // --------------------------------------------------------
-        // 7) QR detect (빠르게) → 필요 시 decode (느리게)
+        // 7) QR 추적(빠르게) 또는 detect → 필요 시 decode (느리게)
         // --------------------------------------------------------
         try {
-            Mat corners;
-            bool ok = qrd.detect(gateGray, corners);
+            // 7-1) 직전 프레임에서 찾은 QR이 있으면 예측 위치 주변만 확인
+            //      (redetectN 프레임마다는 추적 중이라도 전체 detect로 코너를 새로 잡는다)
+            if (useTrack && track.valid && track.sinceDetect < redetectN) {
+                if (TrackQuad(track, grayDet, gateRect, quadDet)) {
+                    tracked = true;
+                    qrFound = true;
+                    track.sinceDetect++;
+                    statTrack++;
+                }
+                else {
+                    track.valid = false;
+                    statLost++;
+                }
+            }
 
-            if (ok && ValidateCorners(corners)) {
-                qrFound = true;
-                quadDet.resize(4);
+            // 7-2) 추적이 없거나 놓쳤으면 같은 프레임에서 gate 전체 detect
+            if (!tracked && !multiMode) {
+                statDetect++;
+                if (DetectQuadInGate(qrd, grayDet, gateRect, quadDet)) {
+                    qrFound = true;
+                    if (useTrack) TrackInit(track, grayDet, quadDet);
+                }
+                else {
+                    track.valid = false;
+                }
+            }
 
-                // corners는 gateGray 기준 좌표이므로, 원래 DET 좌표로 되돌리기 위해 x offset을 더한다.
-                for (int i = 0; i < 4; i++) {
-                    Point2f p = corners.at<Point2f>(i);
-                    p.x += (float)gateRect.x;
-                    p.y += (float)gateRect.y;
-                    quadDet[i] = p;
+            // 7-2') 다중 모드: gate 안의 QR을 모두 찾아서 각각 디코드
+            //       (워커 풀이면 왼쪽 → 오른쪽 순서로 제출 → 결과도 그 순서로 나온다)
+            if (multiMode) {
+                Mat gateGray = grayDet(gateRect).clone();
+                quadsDet = DetectQuadsMulti(qrd, gateGray, gateRect);
+                statDetect++;
+                qrFound = !quadsDet.empty();
+
+                if (qrFound) {
+                    frameCount++;
+                    if (frameCount % QR_DECODE_EVERY_N == 0) {
+                        float sx = (float)frameCap.cols / (float)DET_W;
+                        float sy = (float)frameCap.rows / (float)DET_H;
+
+                        for (const vector<Point2f>& q : quadsDet) {
+                            Rect r = PointsToRect(q, DET_W, DET_H);
+                            if (min(r.width, r.height) < QR_MIN_SIZE_DET) continue;
+
+                            vector<Point2f> qc(4);
+                            for (int i = 0; i < 4; i++) qc[i] = Point2f(q[i].x * sx, q[i].y * sy);
+
+                            statDecode++;
+                            if (decodePool) {
+                                decodePool->Submit(frameCap, qc, viewFromRaw, q, 0, captureMs, frameHold);
+                            }
+                            else {
+                                string d = DecodeQuad(qrd, prep, frameCap, qc, viewFromRaw);
+                                if (!d.empty()) decodedList.push_back({ d, captureMs });
+                            }
+                        }
+                    }
                 }
+            }
+
+            // QR이 안 보이면 캐시도 버린다 (다음에 보이는 QR은 새로 디코드)
+            if (!qrFound) {
+                cache.valid = false;
+                sched.Reset();
+            }
 
+            if (qrFound && !multiMode) {
                 // QR 크기 체크(DET 기준)
                 Rect detRect = PointsToRect(quadDet, DET_W, DET_H);
                 int detSize = min(detRect.width, detRect.height);
 
-                // DET 좌표를 CAP(원본) 좌표로 스케일 변환
+                // DET 좌표를 CAP 크기로 스케일 변환 (반전 후 화면 좌표 그대로. 반전은 디코드 워핑에서 처리)
                 float sx = (float)frameCap.cols / (float)DET_W;
                 float sy = (float)frameCap.rows / (float)DET_H;
 
@@ -649,72 +1913,137 @@ int main(int argc, char** argv)
                     quadCap[i] = Point2f(quadDet[i].x * sx, quadDet[i].y * sy);
                 }
 
-                // N프레임마다 + 충분히 큰 QR일 때만 디코드 시도
-                frameCount++;
-                if (frameCount % QR_DECODE_EVERY_N == 0 && detSize >= QR_MIN_SIZE_DET) {
-                    // 원본 프레임을 gray로 만들고 워핑 후 디코드
-                    Mat grayCap;
-                    cvtColor(frameCap, grayCap, COLOR_BGR2GRAY);
-
-                    Mat upright;
-                    if (WarpWithPadding(grayCap, quadCap, upright)) {
-                        // 워핑 결과가 너무 작으면 확대
-                        if (upright.cols < UPSCALE_TO) {
-                            Mat up2;
-                            resize(upright, up2, Size(), 2.0, 2.0, INTER_LINEAR);
-                            upright = up2;
-                        }
+                // 같은 QR이 이어지고 있으면 캐시된 결과 사용 (디코드 생략)
+                bool cacheHit = false;
+                uint64_t sig = 0;
+                if (useCache) {
+                    sig = QuadSignature(grayDet, quadDet);
+                    string cached;
+                    if (CacheLookup(cache, quadDet, sig, cached)) {
+                        decodedList.push_back({ cached, captureMs });
+                        cacheHit = true;
+                        statCacheHit++;
+                    }
+                }
 
-                        // 대비/선명도 보정
-                        Mat u1 = CLAHE_Gray(upright);
-                        Mat u2 = Sharpen(u1);
+                // 디코드 여부: 적응형 스케줄러 또는 (기존) N프레임마다 + 충분히 큰 QR일 때만
+                frameCount++;
+                bool doDecode = false;
+                if (cacheHit) {
+                    doDecode = false;
+                }
+                else if (useSched) {
+                    QrDecodeScheduler::Skip why = QrDecodeScheduler::SKIP_NONE;
+                    doDecode = sched.Decide(grayDet, quadDet, why);
+                    statSkip[why]++;
+                }
+                else {
+                    doDecode = (frameCount % QR_DECODE_EVERY_N == 0 && detSize >= QR_MIN_SIZE_DET);
+                }
 
-                        // 일반 QR 디코드
-                        Mat dc, st;
-                        string d = qrd.detectAndDecode(u2, dc, st);
+                if (doDecode) {
+                    statDecode++;
+                    if (useSched) sched.OnSubmit();
 
-                        // curved(곡면) QR을 위한 fallback
-                        if (d.empty()) {
-                            Mat dc2, st2;
-                            d = qrd.detectAndDecodeCurved(u2, dc2, st2);
+                    if (decodePool) {
+                        // 워커로 넘기고 바로 다음 프레임으로 (결과는 아래 7-3에서 순서대로 수거)
+                        decodePool->Submit(frameCap, quadCap, viewFromRaw, quadDet, sig, captureMs, frameHold);
+                    }
+                    else {
+                        string d = DecodeQuad(qrd, prep, frameCap, quadCap, viewFromRaw);
+                        if (useSched) sched.OnResult(true, !d.empty());
+                        if (!d.empty()) {
+                            decodedList.push_back({ d, captureMs });
+                            if (useCache) CacheStore(cache, quadDet, sig, d);
                         }
-
-                        if (!d.empty()) decodedRaw = d;
                     }
                 }
             }
         }
         catch (const cv::Exception&) {
             // OpenCV 내부 예외는 프레임 단위로 무시하고 계속 진행
+            track.valid = false;
+            cache.valid = false;
+        }
+
+        // 7-3) 워커 디코드 결과 수거 (제출 순서대로, 준비된 것까지만)
+        if (decodePool) {
+            QrDecodeResult r;
+            while (decodePool->PopReady(r)) {
+                if (useSched) sched.OnResult(!r.skipped, !r.payload.empty());
+                if (r.skipped || r.payload.empty()) continue;
+                decodedList.push_back({ r.payload, r.captureMs });
+                // 그 사이 QR이 사라졌으면 캐시에 넣지 않음 (새 QR에 옛 결과가 붙지 않게)
+                if (useCache && qrFound) CacheStore(cache, r.quadDet, r.sig, r.payload);
+            }
+        }
+        if (!decodedList.empty()) decodedRaw = decodedList.back().first;
+
+        // 7-4) --stats: 5초마다 fps / detect / 추적 횟수 출력
+        statFrames++;
+        if (showStats) {
+            double sec = chrono::duration<double>(chrono::steady_clock::now() - statT0).count();
+            if (sec >= 5.0) {
+                cerr << "[STATS] fps=" << fixed << setprecision(1) << (statFrames / sec)
+                    << " detect=" << statDetect << " track=" << statTrack << " lost=" << statLost
+                    << " decode=" << statDecode << " cache=" << statCacheHit;
+                if (useSched) {
+                    cerr << " skip(small/blur/motion/backoff/busy)=" << statSkip[1] << "/" << statSkip[2] << "/"
+                        << statSkip[3] << "/" << statSkip[4] << "/" << statSkip[5]
+                        << " ok=" << setprecision(2) << sched.SuccessRate()
+                        << " sharp>=" << setprecision(0) << sched.SharpThreshold();
+                    cerr << setprecision(1);
+                }
+                if (decodePool) cerr << " dropped=" << decodePool->Dropped();
+                cerr << " serial=" << serialWriter->Written() << "/drop " << serialWriter->Dropped()
+                    << "/fail " << serialWriter->Failed();
+                cerr << "\n";
+                cerr.unsetf(ios::floatfield);
+                statFrames = statDetect = statTrack = statLost = statDecode = statCacheHit = 0;
+                for (long& v : statSkip) v = 0;
+                statT0 = chrono::steady_clock::now();
+            }
         }
 
         // --------------------------------------------------------
         // 8) 디코드 성공 시: "x,y" 형태인지 확인 후 시리얼 전송
         // --------------------------------------------------------
-        if (!decodedRaw.empty()) {
+        auto now = chrono::steady_clock::now();
+        if (multiMode) {
+            // 오래 안 보인 payload 정리
+            for (auto it = multiSeen.begin(); it != multiSeen.end();) {
+                if (now - it->second > chrono::milliseconds(MULTI_FORGET_MS)) it = multiSeen.erase(it);
+                else ++it;
+            }
+        }
+
+        for (const auto& item : decodedList) {
+            const string& decoded = item.first;
             int x = 0, y = 0;
 
             // QR 내부 문자열이 "x,y" 포맷이면 파싱 성공
-            if (ParseXY_CSV(decodedRaw, x, y)) {
+            if (ParseXY_CSV(decoded, x, y)) {
 
                 // 중복 억제:
                 // 같은 값이 반복되는 경우(같은 QR이 계속 화면에 있을 때),
                 // 매 프레임 전송하면 B에서 JSON이 계속 덮어써져 불필요 IO가 증가한다.
-                if (x != lastX || y != lastY) {
+                // (다중 모드는 payload별로 MULTI_FORGET_MS 동안 한 번만)
+                bool isNew = multiMode
+                    ? MultiSeenCheck(multiSeen, to_string(x) + "," + to_string(y), now)
+                    : (x != lastX || y != lastY);
+                if (isNew) {
 
                     // 시리얼로 보낼 payload는 반드시 "x,y" 문자열
                     string payload = to_string(x) + "," + to_string(y);
 
                     // 콘솔 로그(팀 디버깅용)
-                    cout << "QR: " << decodedRaw << " -> (" << x << ", " << y << ")\n" << flush;
+                    cout << "QR: " << decoded << " -> (" << x << ", " << y << ")\n" << flush;
 
-                    // 시리얼 전송: 반드시 payload + "\n"
-                    if (!SerialWriteLine(serialFd, payload)) {
-                        cerr << "[SERIAL] write failed\n";
-                    }
-                    else {
-                        cout << "[SERIAL] sent: " << payload << "\n" << flush;
+                    // 시리얼 전송: 큐에 넣기만 함 (ascii면 payload + "\n", frame이면 이진 프레임)
+                    if (!serialWriter->Send(payload, (uint32_t)item.second)) {
+                        cerr << "[SERIAL] queue full, oldest message dropped\n";
                     }
+                    cout << "[SERIAL] queued: " << payload << "\n" << flush;
 
                     // 마지막 전송값 업데이트
                     lastX = x;
@@ -725,7 +2054,7 @@ int main(int argc, char** argv)
                 // QR을 읽긴 했는데 "x,y" 포맷이 아닌 경우
                 // 요구사항상 이런 데이터는 B로 보내면 안 되므로 무시한다.
                 // 필요하면 아래 로그를 켜서 디버깅 가능:
-                // cerr << "[WARN] decoded but not x,y: " << decodedRaw << "\n";
+                // cerr << "[WARN] decoded but not x,y: " << decoded << "\n";
             }
         }
 
@@ -740,9 +2069,17 @@ int main(int argc, char** argv)
             line(vis, Point(xR, 0), Point(xR, DET_H - 1), Scalar(255, 0, 0), 2);
 
             // QR 탐지 사각형 표시
-            if (qrFound && quadDet.size() == 4) {
-                DrawQuad(vis, quadDet, Scalar(0, 255, 0));
-                putText(vis, "QR FOUND", Point(15, 35), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 0), 2);
+            if (multiMode && qrFound) {
+                for (const vector<Point2f>& q : quadsDet) DrawQuad(vis, q, Scalar(0, 255, 0));
+                putText(vis, "QR FOUND x" + to_string(quadsDet.size()), Point(15, 35),
+                    FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 0), 2);
+            }
+            else if (qrFound && quadDet.size() == 4) {
+                // 추적으로 찾은 프레임은 노란색
+                Scalar c = tracked ? Scalar(0, 255, 255) : Scalar(0, 255, 0);
+                DrawQuad(vis, quadDet, c);
+                putText(vis, tracked ? "QR FOUND (TRACK)" : "QR FOUND (DETECT)", Point(15, 35),
+                    FONT_HERSHEY_SIMPLEX, 1.0, c, 2);
             }
             else {
                 putText(vis, "QR NOT FOUND", Point(15, 35), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 0, 255), 2);
@@ -772,6 +2109,8 @@ int main(int argc, char** argv)
     // ------------------------------------------------------------
     // 10) 종료 처리
     // ------------------------------------------------------------
+    decodePool.reset();   // 워커 정리
+    serialWriter.reset(); // 남은 송신 내보낸 뒤 시리얼 닫기
     if (serialFd >= 0) close(serialFd);
     return 0;
 }
@@ -0,0 +1,243 @@
+﻿#include "qr_pipeline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+/*
+    ValidateCorners:
+    - QRCodeDetector::detect()가 주는 corners(4점)가 유효한지 점검한다.
+    - 너무 작은 면적/점 겹침/비정상 좌표이면 false로 처리하여 오탐 방지.
+*/
+bool ValidateCorners(const Mat& corners4)
+{
+    if (corners4.empty() || corners4.total() != 4) return false;
+
+    vector<Point2f> pts(4);
+    for (int i = 0; i < 4; i++) pts[i] = corners4.at<Point2f>(i);
+
+    // 좌표 유효성(무한대/NaN) + 점 간 거리 체크
+    for (int i = 0; i < 4; i++) {
+        if (!isfinite(pts[i].x) || !isfinite(pts[i].y)) return false;
+        for (int j = i + 1; j < 4; j++) {
+            if (norm(pts[i] - pts[j]) < 1.0) return false; // 거의 같은 점이면 invalid
+        }
+    }
+
+    // 면적 너무 작으면 QR로 보기 어려움
+    double a = fabs(contourArea(pts));
+    if (a <= 200.0) return false;
+
+    // convex 여부 체크
+    vector<Point> ip(4);
+    for (int i = 0; i < 4; i++) ip[i] = Point((int)round(pts[i].x), (int)round(pts[i].y));
+    if (!isContourConvex(ip)) return false;
+
+    return true;
+}
+
+/*
+    OrderQuadTLTRBRBL:
+    - QR 4개 코너를 (TL, TR, BR, BL) 순서로 정렬한다.
+    - perspective warp가 안정적으로 동작하게 하기 위함.
+*/
+static vector<Point2f> OrderQuadTLTRBRBL(const vector<Point2f>& p)
+{
+    vector<Point2f> out(4);
+    float minSum = 1e9f, maxSum = -1e9f, minDiff = 1e9f, maxDiff = -1e9f;
+    int tl = 0, tr = 0, br = 0, bl = 0;
+
+    for (int i = 0; i < 4; i++) {
+        float s = p[i].x + p[i].y;
+        float d = p[i].x - p[i].y;
+        if (s < minSum) { minSum = s; tl = i; }
+        if (s > maxSum) { maxSum = s; br = i; }
+        if (d > maxDiff) { maxDiff = d; tr = i; }
+        if (d < minDiff) { minDiff = d; bl = i; }
+    }
+    out[0] = p[tl]; out[1] = p[tr]; out[2] = p[br]; out[3] = p[bl];
+    return out;
+}
+
+/*
+    PointsToRect:
+    - 4점 bounding box를 Rect로 변환한다.
+    - 이미지 범위를 넘어가지 않도록 clamp 한다.
+*/
+Rect PointsToRect(const vector<Point2f>& pts, int maxW, int maxH)
+{
+    float minx = 1e9f, miny = 1e9f, maxx = -1e9f, maxy = -1e9f;
+    for (auto& p : pts) {
+        minx = min(minx, p.x); miny = min(miny, p.y);
+        maxx = max(maxx, p.x); maxy = max(maxy, p.y);
+    }
+    int x = clampi((int)floor(minx), 0, maxW - 1);
+    int y = clampi((int)floor(miny), 0, maxH - 1);
+    int x2 = clampi((int)ceil(maxx), 0, maxW);
+    int y2 = clampi((int)ceil(maxy), 0, maxH);
+    return Rect(x, y, max(1, x2 - x), max(1, y2 - y));
+}
+
+/*
+    FlipMatrix:
+    - flip(src, dst, flipCode)의 좌표 변환을 3x3 행렬로 (flipCode: 0=상하, 1=좌우, -1=둘다)
+    - 반전은 자기 자신이 역변환이라 원본→화면, 화면→원본 모두 이 행렬
+    - doFlip=false면 단위행렬
+*/
+Matx33d FlipMatrix(bool doFlip, int flipCode, Size sz)
+{
+    Matx33d F = Matx33d::eye();
+    if (!doFlip) return F;
+    if (flipCode != 0) { F(0, 0) = -1.0; F(0, 2) = sz.width - 1; }
+    if (flipCode <= 0) { F(1, 1) = -1.0; F(1, 2) = sz.height - 1; }
+    return F;
+}
+
+/*
+    CLAHE_Gray:
+    - 조명 변화가 심할 때 대비 향상(국부 히스토그램 평활화)
+    - CLAHE 객체/출력 버퍼는 호출측(QrPrep) 것을 재사용
+*/
+static void CLAHE_Gray(const Ptr<CLAHE>& c, const Mat& g, Mat& out)
+{
+    c->apply(g, out);
+}
+
+/*
+    Sharpen:
+    - 살짝 샤프닝해서 QR 모서리/패턴이 선명해지도록 함
+    - blur/out 버퍼는 호출측 것을 재사용
+*/
+static void Sharpen(const Mat& g, Mat& blur, Mat& out)
+{
+    GaussianBlur(g, blur, Size(0, 0), 1.0);
+    addWeighted(g, 1.30, blur, -0.30, 0, out);
+}
+
+/*
+    WarpWithPadding:
+    - 원본(frameRaw, BGR 또는 gray, 반전 전)에서 QR 사각형 영역만 정면으로 펴(upright) 디코드 안정성 개선
+    - quadView는 화면(반전 후) 좌표. 반전(viewFromRaw)과 확대(UPSCALE_TO보다 작으면 2배)를
+      투시변환 행렬 하나에 합쳐서, 전체 프레임 flip/gray 변환 없이 패치만 계산한다.
+    - QR_PAD_PX 만큼 여백을 주어 코드 경계가 잘리지 않게 함
+    - 결과: prep.patchBgr → prep.gray (패치만 gray 변환. frameRaw가 이미 gray면 변환 없음)
+*/
+bool WarpWithPadding(const Mat& frameRaw, const vector<Point2f>& quadView, const Matx33d& viewFromRaw,
+    QrPrep& prep)
+{
+    vector<Point2f> q = OrderQuadTLTRBRBL(quadView);
+
+    Rect r = PointsToRect(q, frameRaw.cols, frameRaw.rows);
+    int side = max(r.width, r.height);
+    side = clampi(side, 200, 900);
+
+    int outSide = side + 2 * QR_PAD_PX;
+
+    // 워핑 결과가 너무 작으면 확대 (워핑 후 resize 대신 행렬에 포함)
+    double scale = (outSide < UPSCALE_TO) ? 2.0 : 1.0;
+
+    // 목적지 사각형(정면) 좌표
+    vector<Point2f> dst = {
+        Point2f((float)QR_PAD_PX, (float)QR_PAD_PX),
+        Point2f((float)(QR_PAD_PX + side - 1), (float)QR_PAD_PX),
+        Point2f((float)(QR_PAD_PX + side - 1), (float)(QR_PAD_PX + side - 1)),
+        Point2f((float)QR_PAD_PX, (float)(QR_PAD_PX + side - 1))
+    };
+
+    Mat Hm = getPerspectiveTransform(q, dst);
+    if (Hm.empty()) return false;
+
+    // 원본 → 화면(반전) → 정면 → 확대
+    Matx33d S(scale, 0, 0, 0, scale, 0, 0, 0, 1);
+    Matx33d M = S * Matx33d(Hm.ptr<double>()) * viewFromRaw;
+
+    int outPx = (int)lround(outSide * scale);
+    warpPerspective(frameRaw, prep.patchBgr, M, Size(outPx, outPx), INTER_LINEAR, BORDER_REPLICATE);
+    if (prep.patchBgr.empty()) return false;
+
+    if (prep.patchBgr.channels() == 1) prep.gray = prep.patchBgr;
+    else cvtColor(prep.patchBgr, prep.gray, COLOR_BGR2GRAY);
+    return true;
+}
+
+/*
+    DetectQuadInGate:
+    - DET gray의 gate 영역에서 QR 1개를 detect → ValidateCorners 통과 시 DET 좌표 4점
+    - QRWorker 메인 루프의 전체 detect(7-2)와 QRBench가 같은 함수를 쓴다.
+*/
+bool DetectQuadInGate(QRCodeDetector& qrd, const Mat& grayDet, const Rect& gateRect, vector<Point2f>& quadDet)
+{
+    Mat gateGray = grayDet(gateRect).clone();
+    Mat corners;
+    if (!qrd.detect(gateGray, corners) || !ValidateCorners(corners)) return false;
+
+    quadDet.resize(4);
+
+    // corners는 gateGray 기준 좌표이므로, 원래 DET 좌표로 되돌리기 위해 offset을 더한다.
+    for (int i = 0; i < 4; i++) {
+        Point2f p = corners.at<Point2f>(i);
+        p.x += (float)gateRect.x;
+        p.y += (float)gateRect.y;
+        quadDet[i] = p;
+    }
+    return true;
+}
+
+/*
+    DecodeQuad:
+    - 원본(frameRaw, BGR, 반전 전)의 quadView(화면 좌표) 영역을 워핑(+확대) → CLAHE → 샤픈
+      → 디코드(+curved fallback)
+    - qrd/prep은 호출 스레드 전용이어야 한다(QRCodeDetector는 스레드 간 공유 불가).
+    - 실패하면 빈 문자열
+*/
+string DecodeQuad(QRCodeDetector& qrd, QrPrep& prep, const Mat& frameRaw,
+    const vector<Point2f>& quadView, const Matx33d& viewFromRaw)
+{
+    if (!WarpWithPadding(frameRaw, quadView, viewFromRaw, prep)) return string();
+
+    // 대비/선명도 보정
+    CLAHE_Gray(prep.clahe, prep.gray, prep.eq);
+    Sharpen(prep.eq, prep.blur, prep.sharp);
+
+    // 일반 QR 디코드
+    string d = qrd.detectAndDecode(prep.sharp, prep.points, prep.straight);
+
+    // curved(곡면) QR을 위한 fallback
+    if (d.empty()) {
+        d = qrd.detectAndDecodeCurved(prep.sharp, prep.points, prep.straight);
+    }
+    return d;
+}
+
+/*
+    ParseXY_CSV:
+    - QR 디코드 결과 문자열이 "x,y"인지 확인하고 숫자로 파싱
+    - 예: "100,2" / " 2,133 " 가능
+    - 실패하면 false (즉, QR 내용이 원하는 포맷이 아니면 전송하지 않음)
+*/
+bool ParseXY_CSV(const string& s, int& x, int& y)
+{
+    // 공백 제거
+    string t;
+    t.reserve(s.size());
+    for (char c : s) if (!isspace((unsigned char)c)) t.push_back(c);
+
+    size_t comma = t.find(',');
+    if (comma == string::npos) return false;
+
+    string sx = t.substr(0, comma);
+    string sy = t.substr(comma + 1);
+    if (sx.empty() || sy.empty()) return false;
+
+    try {
+        x = stoi(sx);
+        y = stoi(sy);
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
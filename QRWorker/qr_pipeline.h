@@ -0,0 +1,63 @@
+﻿#pragma once
+
+// qr_pipeline.h
+// - QR 탐지 결과 검증 + 디코드 체인 (QRWorker, QRBench 공용)
+// - 디코드 체인: 원본 프레임에서 QR 사각형만 정면으로 워핑(+확대) → CLAHE → 샤픈
+//   → detectAndDecode (+curved fallback)
+// - 좌표: DET = 탐지용 축소 프레임, 화면(view) = 반전 후 좌표, 원본(raw) = 캡처 그대로
+// - QRCodeDetector / QrPrep 은 스레드마다 따로 (스레드 간 공유 불가)
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// QR_PAD_PX : 워핑 시 주변 여백을 주어 디코드 안정성을 올림
+static const int QR_PAD_PX = 40;
+
+// UPSCALE_TO : 워핑된 QR 이미지가 너무 작으면 확대해서 디코드 안정성 향상
+static const int UPSCALE_TO = 500;
+
+// clamp helper: 범위를 벗어난 값을 강제로 끼워 넣기
+static inline int clampi(int v, int lo, int hi) { return std::max(lo, std::min(hi, v)); }
+
+/*
+    QrPrep:
+    - 디코드 전처리용 작업 버퍼. 디코드하는 스레드(워커/메인)마다 하나씩 두고 프레임 간 재사용한다.
+    - CLAHE 객체도 한 번만 만든다. (매 디코드마다 Mat/CLAHE를 새로 만들지 않게)
+*/
+struct QrPrep {
+    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
+    cv::Mat patchBgr;   // 워핑된 QR 패치 (BGR)
+    cv::Mat gray;       // 패치 gray
+    cv::Mat eq;         // CLAHE 결과
+    cv::Mat blur;       // 샤픈용 블러
+    cv::Mat sharp;      // 최종 디코드 입력
+    cv::Mat points, straight; // detectAndDecode 출력 (사용 안 함)
+};
+
+// detect()가 준 corners(4점) 유효성: 면적/점 겹침/NaN/convex
+bool ValidateCorners(const cv::Mat& corners4);
+
+// 4점 bounding box (이미지 범위로 clamp)
+cv::Rect PointsToRect(const std::vector<cv::Point2f>& pts, int maxW, int maxH);
+
+// flip(src, dst, flipCode)의 좌표 변환 3x3 (doFlip=false면 단위행렬)
+cv::Matx33d FlipMatrix(bool doFlip, int flipCode, cv::Size sz);
+
+// 원본(frameRaw)의 quadView 영역을 정면으로 워핑 → prep.patchBgr, prep.gray
+bool WarpWithPadding(const cv::Mat& frameRaw, const std::vector<cv::Point2f>& quadView, const cv::Matx33d& viewFromRaw,
+    QrPrep& prep);
+
+// DET gray의 gate 안에서 QR 1개 detect → DET 좌표 4점
+bool DetectQuadInGate(cv::QRCodeDetector& qrd, const cv::Mat& grayDet, const cv::Rect& gateRect,
+    std::vector<cv::Point2f>& quadDet);
+
+// 디코드 체인 전체. 실패하면 빈 문자열
+std::string DecodeQuad(cv::QRCodeDetector& qrd, QrPrep& prep, const cv::Mat& frameRaw,
+    const std::vector<cv::Point2f>& quadView, const cv::Matx33d& viewFromRaw);
+
+// "x,y" 문자열 → 정수 (공백 허용)
+bool ParseXY_CSV(const std::string& s, int& x, int& y);
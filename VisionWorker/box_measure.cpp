@@ -1,26 +1,19 @@
 #include "box_measure.h"
 
+#include "../Common/rle_mask.h"
+
 BoxMeasure MeasureLargestBoxFromMask(const Mat& mask, double minArea)
 {
     BoxMeasure out;
 
-    vector<vector<Point>> contours;
-    findContours(mask, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-    if (contours.empty()) return out;
-
-    int best = -1;
-    double bestA = 0.0;
+    // run 라벨링으로 성분별 면적(구멍 포함)만 구하고, minAreaRect 는 최대 성분에만
+    RleLabeler labeler;
+    labeler.Run(mask);
 
-    for (int i = 0; i < (int)contours.size(); i++) {
-        double a = contourArea(contours[i]);
-        if (a >= minArea && a > bestA) {
-            bestA = a;
-            best = i;
-        }
-    }
+    int best = labeler.Largest(minArea);
     if (best < 0) return out;
 
-    RotatedRect rr = minAreaRect(contours[best]);
+    RotatedRect rr = labeler.MinAreaRect(best);
     double w = rr.size.width;
     double h = rr.size.height;
     if (w < h) swap(w, h);
@@ -29,7 +22,7 @@ BoxMeasure MeasureLargestBoxFromMask(const Mat& mask, double minArea)
     out.rr = rr;
     out.wPx = w;
     out.hPx = h;
-    out.area = bestA;
+    out.area = (double)labeler.Components()[best].filled;
     return out;
 }
 
@@ -4,8 +4,17 @@
 // - 측정 시 total.json에서 label 찾아 x/y/ms/type "덮어쓰기" 저장
 // - 결과 코일 전송: TOP=201, BASE=202, NONE(or defect)=203 (펄스)
 // - total.json 없으면 자동 생성: [] 로 생성
+// - 트리거별 구간 trace 링버퍼 기록, VIEW 창에서 't' -> trace_<시각>.json (Chrome/Perfetto)
+// - HSV 임계값/면적 컷은 color_config.yaml (실행 중 수정 -> 다음 프레임부터 반영)
+// - 카메라 MJPEG 패킷을 직접 받아 측정 중에는 ROI 만 디코드 (RAW_MJPEG)
+// - 단계별 스레드: capture -> segment -> decide -> persist -> signal (SPSC 큐 연결, PIPELINE 참고)
+//   미리보기/키 입력은 메인 스레드. 5초마다(또는 'p') [PIPE] 단계별 처리율/큐 깊이 출력
+// - 측정마다 색/타입별 온라인 통계(평균/분산/EWMA/Cpk, 분당 개수) 갱신 -> 10초마다(또는 's') spc_vision.json
+//   TOP 계열(TOP + defect) x EWMA 가 불량 기준(57mm) 쪽으로 밀리면 바로 [SPC] ALARM
+//     VisionWorker --mjpeg-record out.mjpeg [frames]      카메라 패킷 녹화
+//     VisionWorker --mjpeg-replay <file.mjpeg|dir> [x y w h]  ROI 디코드 vs 전체 디코드 (속도/픽셀 비교)
 //
-// 빌드: OpenCV + libmodbus 필요
+// 빌드: OpenCV + libmodbus + libjpeg-turbo 필요 (libjpeg-turbo 경로는 환경 변수 LIBJPEG_TURBO_DIR)
 // 주의: ADDR_OFFSET 필요하면 0 -> -1 등 조절
 
 #include <opencv2/opencv.hpp>
@@ -23,9 +32,22 @@
 #include <chrono>
 #include <thread>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <memory>
 
 #include <modbus/modbus.h>
 
+#include "../Common/color_classify.h"
+#include "../Common/color_config.h"
+#include "../Common/measure_archive.h"
+#include "../Common/mjpeg_roi_decoder.h"
+#include "../Common/rle_mask.h"
+#include "../Common/spc_stats.h"
+#include "../Common/spsc_queue.h"
+#include "../Common/trace_ring.h"
+
 using namespace cv;
 using namespace std;
 
@@ -57,21 +79,49 @@ static const int TRIG_POLL_MS = 20;
 // 측정 루틴 타임아웃
 static const int MEASURE_TIMEOUT_MS = 1500;
 
+// =====================
+// CAMERA
+// =====================
+static const int CAMERA_INDEX = 2;
+// MJPEG 패킷을 직접 받아 측정 때 ROI 만 디코드 (백엔드가 raw 를 안 주면 자동으로 OpenCV 디코드)
+static const bool RAW_MJPEG = true;
+
+// =====================
+// TRACE (엣지 감지 -> 결과 코일 ON 응답)
+// =====================
+static const bool TRACE_ENABLED = true;
+// 엣지 -> 코일 응답이 이 시간 이상이면 구간별 내역을 콘솔에 출력
+static const int TRACE_SLOW_MS = 800;
+
 // =====================
 // JSON (오직 total.json만)
 // =====================
 static const string TOTAL_JSON = "./total.json";
 
+// 측정 이력 (열 단위 세그먼트 + WAL, HistoryTool 로 조회/내보내기). total.json 은 그대로 유지
+// 폴더당 writer 하나라서 ColorWorker(./history/color) 와 나눔. HistoryTool 에 ./history 를 주면 둘 다 조회
+static const string HISTORY_DIR = "./history/vision";
+static const int HISTORY_KEEP_SEGMENTS = 24 * 90; // 1시간 구간 x 90일
+
+// 온라인 공정 통계 (10초마다 바뀐 게 있으면, 또는 VIEW 창에서 's')
+static const string SPC_JSON = "./spc_vision.json"; // ColorWorker 는 spc_color.json
+static const string SPC_X_GROUP = "type:TOP|defect";   // x 규격을 거는 그룹 (타입 판정으로 잘리기 전 TOP 계열)
+static const int SPC_PUBLISH_EVERY_MS = 10000;
+static const double SPC_X_GUARD_MM = 0.75; // x EWMA 가 TOP 구간 끝에서 이만큼 안쪽이면 NEAR_LSL/NEAR_USL
+
+// 색상/측정 임계값 (감시 중, 저장하면 자동 반영)
+static const string COLOR_CONFIG = "./color_config.yaml";
+
 // =====================
 // 판정 조건 (x만 보고 BASE/TOP/defect)
 // =====================
-static inline string DecideTypeByX(double xMm) {
-    const double baseCenter = 60.0;
-    const double tol = 3.0;
-    const double defectCut = baseCenter - tol; // 57
+static const double TYPE_BASE_CENTER_MM = 60.0;
+static const double TYPE_TOL_MM = 3.0;
+static const double TYPE_DEFECT_CUT_MM = TYPE_BASE_CENTER_MM - TYPE_TOL_MM; // 57 (SPC x 규격 LSL 로도 사용)
 
-    if (xMm >= baseCenter - tol && xMm <= baseCenter + tol) return "TOP";
-    else if (xMm < defectCut) return "defect";
+static inline string DecideTypeByX(double xMm) {
+    if (xMm >= TYPE_BASE_CENTER_MM - TYPE_TOL_MM && xMm <= TYPE_BASE_CENTER_MM + TYPE_TOL_MM) return "TOP";
+    else if (xMm < TYPE_DEFECT_CUT_MM) return "defect";
     else return "BASE";
 }
 
@@ -138,64 +188,27 @@ static string MakeLabel(const string& color, int count) {
 }
 
 // =====================
-// HSV thresholds (색상 판별)
+// HSV thresholds (기본값, color_config.yaml 이 있으면 덮어씀)
 // =====================
-struct HsvRange { Scalar L; Scalar U; };
-struct ColorThresholds {
-    HsvRange R1{ Scalar(0,   60,  60), Scalar(15,  255, 255) };
-    HsvRange R2{ Scalar(165, 60,  60), Scalar(179, 255, 255) };
-    HsvRange G{ Scalar(40,  60,  60), Scalar(80,  255, 255) };
-    HsvRange B{ Scalar(95,  60,  60), Scalar(125, 255, 255) };
-};
-
-static int MIN_COLOR_PIXELS = 100;
-static double MIN_COLOR_RATIO = 0.01;
-
-static void BuildMasksRGB(const Mat& hsv, Mat& maskR, Mat& maskG, Mat& maskB, const ColorThresholds& th) {
-    Mat rA, rB;
-    inRange(hsv, th.R1.L, th.R1.U, rA);
-    inRange(hsv, th.R2.L, th.R2.U, rB);
-    maskR = rA | rB;
-
-    inRange(hsv, th.G.L, th.G.U, maskG);
-    inRange(hsv, th.B.L, th.B.U, maskB);
-
-    Mat k = getStructuringElement(MORPH_RECT, Size(5, 5));
-    morphologyEx(maskR, maskR, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskR, maskR, MORPH_CLOSE, k, Point(-1, -1), 2);
-    morphologyEx(maskG, maskG, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskG, maskG, MORPH_CLOSE, k, Point(-1, -1), 2);
-    morphologyEx(maskB, maskB, MORPH_OPEN, k, Point(-1, -1), 1);
-    morphologyEx(maskB, maskB, MORPH_CLOSE, k, Point(-1, -1), 2);
-}
-
-static string ClassifyColorROI(const Mat& roiBgr, const ColorThresholds& th, int& outRpix, int& outGpix, int& outBpix) {
-    Mat hsv;
-    cvtColor(roiBgr, hsv, COLOR_BGR2HSV);
-    GaussianBlur(hsv, hsv, Size(3, 3), 0);
-
-    Mat maskR, maskG, maskB;
-    BuildMasksRGB(hsv, maskR, maskG, maskB, th);
-
-    int rPix = countNonZero(maskR);
-    int gPix = countNonZero(maskG);
-    int bPix = countNonZero(maskB);
-
-    outRpix = rPix;
-    outGpix = gPix;
-    outBpix = bPix;
-
-    int bestPix = 0;
-    string color = "NONE";
-    if (rPix > bestPix && rPix > gPix && rPix > bPix) { bestPix = rPix; color = "RED"; }
-    else if (gPix > bestPix && gPix > rPix && gPix > bPix) { bestPix = gPix; color = "GREEN"; }
-    else if (bPix > bestPix && bPix > rPix && bPix > gPix) { bestPix = bPix; color = "BLUE"; }
-
-    int roiPixels = roiBgr.rows * roiBgr.cols;
-    double ratio = (roiPixels > 0) ? (double)bestPix / (double)roiPixels : 0.0;
-
-    if (bestPix < MIN_COLOR_PIXELS || ratio < MIN_COLOR_RATIO) return "NONE";
-    return color;
+static ColorConfig DefaultColorConfig() {
+    ColorConfig c;
+    // 색상 판별
+    c.th.R1 = { Scalar(0,   60,  60), Scalar(15,  255, 255) };
+    c.th.R2 = { Scalar(165, 60,  60), Scalar(179, 255, 255) };
+    c.th.G = { Scalar(40,  60,  60), Scalar(80,  255, 255) };
+    c.th.B = { Scalar(95,  60,  60), Scalar(125, 255, 255) };
+    c.minColorPixels = 100;
+    c.minColorRatio = 0.01;
+    c.morphSize = 5;
+
+    // 측정 탐지 (빨강 H: 0~20, 160~179 / 초록 H: 40~85 / 파랑 H: 95~125)
+    c.measureTh.R1 = { Scalar(0,   60, 60), Scalar(20,  255, 255) };
+    c.measureTh.R2 = { Scalar(160, 60, 60), Scalar(179, 255, 255) };
+    c.measureTh.G = { Scalar(40,  60, 60), Scalar(85,  255, 255) };
+    c.measureTh.B = { Scalar(95,  60, 60), Scalar(125, 255, 255) };
+    c.measureMorphSize = 3;
+    c.minBoxArea = 2000.0;
+    return c;
 }
 
 // =====================
@@ -349,24 +362,92 @@ static void MarkDisconnected(modbus_t*& ctx) {
     }
 }
 
-static bool PulseCoil(modbus_t* ctx, int coilAddr, int pulseMs) {
+// 코일 쓰기 1회 = trace 구간 1개 (응답 수신까지)
+static bool WriteCoilTraced(modbus_t* ctx, int addr, bool val, const char* spanName, uint32_t trigId) {
+    TraceScope span(spanName, trigId);
+    return WriteCoil(ctx, addr, val);
+}
+
+static bool PulseCoil(modbus_t* ctx, int coilAddr, int pulseMs, uint32_t trigId) {
     // 안전하게 3개 코일 OFF 후 target만 ON
-    if (!WriteCoil(ctx, COIL_TOP, false)) return false;
-    if (!WriteCoil(ctx, COIL_BASE, false)) return false;
-    if (!WriteCoil(ctx, COIL_NONE, false)) return false;
+    if (!WriteCoilTraced(ctx, COIL_TOP, false, "coil_off_top", trigId)) return false;
+    if (!WriteCoilTraced(ctx, COIL_BASE, false, "coil_off_base", trigId)) return false;
+    if (!WriteCoilTraced(ctx, COIL_NONE, false, "coil_off_none", trigId)) return false;
 
-    if (!WriteCoil(ctx, coilAddr, true)) return false;
-    this_thread::sleep_for(chrono::milliseconds(pulseMs));
-    if (!WriteCoil(ctx, coilAddr, false)) return false;
+    if (!WriteCoilTraced(ctx, coilAddr, true, "coil_on", trigId)) return false;
+    {
+        TraceScope span("pulse_hold", trigId);
+        this_thread::sleep_for(chrono::milliseconds(pulseMs));
+    }
+    if (!WriteCoilTraced(ctx, coilAddr, false, "coil_release", trigId)) return false;
     return true;
 }
 
-static bool SendResultPulse(modbus_t* ctx, const string& type) {
+static bool SendResultPulse(modbus_t* ctx, const string& type, uint32_t trigId) {
     int target = COIL_NONE;
     if (type == "TOP") target = COIL_TOP;
     else if (type == "BASE") target = COIL_BASE;
     else target = COIL_NONE; // defect도 NONE로 보냄(요구사항)
-    return PulseCoil(ctx, target, PULSE_MS);
+    return PulseCoil(ctx, target, PULSE_MS, trigId);
+}
+
+// =====================
+// TRACE 요약: 트리거 구간("trigger") 기록 + 느린 박스는 구간별 합계 출력
+// - trigger = 엣지 감지 START 읽기 시작 ~ 결과 코일 ON 응답 (코일 없으면 마지막 구간 끝)
+// =====================
+static void FinishTriggerTrace(uint32_t trigId, int64_t edgeUs) {
+    TraceRing& tr = GlobalTrace();
+    if (!tr.Enabled() || trigId == 0) return;
+
+    vector<TraceSpan> spans;
+    tr.SnapshotTrigger(trigId, spans);
+
+    int64_t endUs = edgeUs;
+    int64_t ackUs = 0;
+    for (const TraceSpan& s : spans) {
+        endUs = max(endUs, s.beginUs + s.durUs);
+        if (strcmp(s.name, "coil_on") == 0) ackUs = s.beginUs + s.durUs;
+    }
+    if (ackUs > 0) endUs = ackUs;
+
+    tr.Record("trigger", trigId, edgeUs, endUs);
+
+    double totalMs = (endUs - edgeUs) / 1000.0;
+    if (totalMs < TRACE_SLOW_MS) return;
+
+    // 이름별 합계 (프레임 단위 구간은 여러 번 나옴)
+    vector<pair<const char*, pair<int64_t, int>>> agg;
+    for (const TraceSpan& s : spans) {
+        if (s.beginUs >= endUs) continue; // 코일 응답 이후(pulse_hold 등)는 제외
+        bool found = false;
+        for (auto& a : agg) {
+            if (strcmp(a.first, s.name) == 0) { a.second.first += s.durUs; a.second.second++; found = true; break; }
+        }
+        if (!found) agg.push_back({ s.name, { s.durUs, 1 } });
+    }
+
+    cout << "[TRACE] slow trigger #" << trigId << " total=" << fixed << setprecision(1) << totalMs << "ms";
+    if (ackUs == 0) cout << " (no coil)";
+    cout << "\n";
+    for (const auto& a : agg) {
+        cout << "[TRACE]   " << a.first << " x" << a.second.second
+            << " = " << fixed << setprecision(1) << (a.second.first / 1000.0) << "ms\n";
+    }
+}
+
+static void ExportTraceNow() {
+    ostringstream fn;
+    time_t t = time(nullptr);
+    tm lt{};
+#ifdef _WIN32
+    localtime_s(&lt, &t);
+#else
+    lt = *localtime(&t);
+#endif
+    fn << "trace_" << put_time(&lt, "%Y%m%d_%H%M%S") << ".json";
+
+    if (GlobalTrace().ExportChromeJson(fn.str())) cout << "[TRACE] saved " << fn.str() << "\n";
+    else cerr << "[TRACE] save failed: " << fn.str() << "\n";
 }
 
 // =====================
@@ -408,6 +489,7 @@ static void KeepTopK(vector<Cand>& v, int K) {
 static void DrawRoiAndLargestContourBox(
     const Mat& fullFrame,
     const Rect& roi,
+    const ColorTables& tb,
     Mat& outVisFrame,
     Mat& outMaskVis
 ) {
@@ -424,50 +506,27 @@ static void DrawRoiAndLargestContourBox(
 
     Mat roiFrame = fullFrame(r).clone();
 
-    Mat hsv;
-    cvtColor(roiFrame, hsv, COLOR_BGR2HSV);
-
-    Mat maskR1, maskR2, maskR, maskG, maskB, mask;
-
-    inRange(hsv, Scalar(0, 60, 60), Scalar(20, 255, 255), maskR1);
-    inRange(hsv, Scalar(160, 60, 60), Scalar(179, 255, 255), maskR2);
-    maskR = maskR1 | maskR2;
-
-    inRange(hsv, Scalar(40, 60, 60), Scalar(85, 255, 255), maskG);
-    inRange(hsv, Scalar(95, 60, 60), Scalar(125, 255, 255), maskB);
-
-    mask = maskR | maskG | maskB;
-
     Mat blurred;
-    GaussianBlur(mask, blurred, Size(3, 3), 0);
-    threshold(blurred, blurred, 150, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
-    morphologyEx(blurred, blurred, MORPH_OPEN, kernel, Point(-1, -1), 1);
-    morphologyEx(blurred, blurred, MORPH_CLOSE, kernel, Point(-1, -1), 1);
+    BuildMeasureMask(roiFrame, tb, blurred);
 
     outMaskVis = blurred.clone();
 
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(blurred, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-    int best = -1;
-    double bestArea = 0.0;
-    for (int i = 0; i < (int)contours.size(); i++) {
-        double a = contourArea(contours[i]);
-        if (a < 2000) continue;
-        if (a > bestArea) { bestArea = a; best = i; }
-    }
+    // 미리보기는 메인 스레드에서만 -> 버퍼 재사용
+    static RleLabeler labeler;
+    labeler.Run(blurred);
+    int best = labeler.Largest(tb.cfg.minBoxArea);
 
     Point2f offset((float)r.x, (float)r.y);
 
     if (best >= 0) {
-        Rect br = boundingRect(contours[best]);
+        const ComponentStats& cs = labeler.Components()[best];
+        double bestArea = (double)cs.filled;
+
+        Rect br = cs.bbox;
         Rect brFull(br.x + r.x, br.y + r.y, br.width, br.height);
         rectangle(outVisFrame, brFull, Scalar(0, 255, 0), 2);
 
-        RotatedRect rr = minAreaRect(contours[best]);
+        RotatedRect rr = labeler.MinAreaRect(best);
         Point2f pts[4];
         rr.points(pts);
 
@@ -483,208 +542,740 @@ static void DrawRoiAndLargestContourBox(
             FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 255, 255), 2);
     }
     else {
-        putText(outVisFrame, "no contour (area>=2000)", Point(r.x + 10, r.y + 30),
+        ostringstream ss;
+        ss << "no blob (area>=" << fixed << setprecision(0) << tb.cfg.minBoxArea << ")";
+        putText(outVisFrame, ss.str(), Point(r.x + 10, r.y + 30),
             FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 0, 255), 2);
     }
 }
 
 // =====================
-// 측정 루틴: 트리거 들어오면 측정 + 색상판별 + label 카운트
+// 카메라 프레임 디코드
+// - raw: 카메라가 준 MJPEG 패킷을 그대로 받고, 필요한 만큼만 디코드
+//        (측정 = ROI 를 덮는 MCU 만, 미리보기 = 전체)
+// - raw 가 아니면 OpenCV 가 디코드한 BGR 프레임 (기존 방식)
+// - MjpegRoiDecoder 는 crop 계획을 들고 있으므로 디코드하는 스레드(단계)마다 하나씩
 // =====================
-static bool DoMeasureNow(
-    VideoCapture& cap,
-    const Rect& roi,
-    double mmPerPx,
-    const ColorThresholds& colorTh,
-    int& rCount,
-    int& gCount,
-    int& bCount,
-    int& nCount,
-    string& outLabel,
-    string& outType
-) {
-    const int TOP_K = 1;
-    vector<Cand> buf;
+static bool IsMjpegPacket(const Mat& m)
+{
+    return !m.empty() && m.type() == CV_8UC1 && (m.rows == 1 || m.cols == 1) && m.isContinuous()
+        && m.total() >= 4 && m.data[0] == 0xFF && m.data[1] == 0xD8;
+}
 
-    const int presentNeed = 2;
-    const int absentNeed = 1;
+struct FrameDecoder {
+    bool raw = false;
+    MjpegRoiDecoder dec;
 
-    bool inCooldown = false;
-    int presentStreak = 0;
-    int absentStreak = 0;
+    bool Roi(const Mat& packet, const Rect& roi, Mat& roiBgr, Rect& outRoi)
+    {
+        if (raw && IsMjpegPacket(packet))
+            return dec.DecodeRoi(packet.data, packet.total(), roi, roiBgr, &outRoi) != MJPEG_DECODE_FAIL;
 
-    long long tStart = NowMillis();
-    double freq = getTickFrequency();
+        outRoi = roi & Rect(0, 0, packet.cols, packet.rows);
+        if (outRoi.width <= 0 || outRoi.height <= 0) return false;
+        roiBgr = packet(outRoi).clone();
+        return true;
+    }
 
-    while (true) {
-        long long now = NowMillis();
-        if (now - tStart > MEASURE_TIMEOUT_MS) {
-            cout << "[MEASURE] TIMEOUT (no stable detection)\n";
-            return false;
+    bool Full(const Mat& packet, Mat& frame)
+    {
+        if (raw && IsMjpegPacket(packet)) return dec.DecodeFull(packet.data, packet.total(), frame);
+        frame = packet;
+        return !frame.empty();
+    }
+};
+
+// 1920x1080 MJPG. wantRaw 면 디코드 전 패킷을 요청 (DSHOW: CONVERT_RGB=0, MSMF/V4L2: FORMAT=-1)
+// 첫 프레임이 JPEG 이면 raw=true, 아니면 설정을 되돌리고 raw=false
+static bool OpenCamera(VideoCapture& cap, bool wantRaw, bool& raw)
+{
+    raw = false;
+    cap.open(CAMERA_INDEX, CAP_DSHOW);
+    if (!cap.isOpened()) return false;
+
+    cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('M', 'J', 'P', 'G'));
+    cap.set(CAP_PROP_FRAME_WIDTH, 1920);
+    cap.set(CAP_PROP_FRAME_HEIGHT, 1080);
+
+    if (wantRaw) {
+        cap.set(CAP_PROP_CONVERT_RGB, 0);
+        cap.set(CAP_PROP_FORMAT, -1);
+
+        Mat probe;
+        for (int i = 0; i < 10 && probe.empty(); i++) cap >> probe;
+        raw = IsMjpegPacket(probe);
+        if (!raw) {
+            cap.set(CAP_PROP_CONVERT_RGB, 1);
+            cap.set(CAP_PROP_FORMAT, CV_8UC3);
         }
+        cout << "[CAMERA] raw MJPEG " << (raw ? "on (ROI decode)" : "not supported by backend -> OpenCV decode") << "\n";
+    }
+    return true;
+}
+
+// =====================
+// PIPELINE: 단계별 스레드 + SPSC 큐
+//   capture -> segment -> decide -> persist -> signal
+//   capture : 카메라 패킷 읽기만 (VideoCapture 는 이 스레드 전용). segment 와 미리보기(main)로 같은 패킷을 넘김
+//   segment : 트리거 대기 중일 때만 ROI 디코드 + 측정 마스크 + 최대 성분 minAreaRect
+//   decide  : 트리거마다 안정화(presentNeed) + 선명도 top-K + 색 판별 + label/type, 타임아웃
+//   persist : total.json 갱신
+//   signal  : Modbus (START 폴링 -> decide 에 트리거 전달, 결과 받으면 코일 펄스). ctx 는 이 스레드 전용
+//   main    : 미리보기 전체 디코드 + imshow/waitKey (HighGUI 는 메인 스레드), 큐 상태 출력
+// - 단계마다 스레드 하나라 처리량은 가장 느린 단계가 정하고, 각 단계 지연이 더해지지 않음
+// - 큐 정책: 프레임은 최신 것만(LATEST 한 칸 덮어쓰기, 밀린 프레임은 skip), 측정 결과/판정/트리거는 BLOCK (잃으면 안 됨)
+// =====================
+static const size_t SEG_QUEUE_CAP = 8;
+static const size_t RESULT_QUEUE_CAP = 4;
+static const int PIPE_STATS_EVERY_MS = 5000;
+
+struct FramePacket {
+    uint64_t seq = 0;
+    int64_t grabUs = 0;
+    Mat packet; // raw: JPEG 바이트 / 아니면 BGR 프레임 (capture 이후 읽기 전용)
+};
 
-        Mat frame;
-        cap >> frame;
-        if (frame.empty()) {
+struct SegResult {
+    uint64_t seq = 0;
+    int64_t grabUs = 0;
+    uint32_t trigId = 0;   // segment 시점에 대기 중이던 트리거
+    int64_t segBeginUs = 0;
+    double ms = 0.0;       // ROI 디코드 이후 마스크 + 라벨링 시간
+    bool detected = false;
+    double wMm = 0.0;
+    double hMm = 0.0;
+    RotatedRect rr;
+    Mat roiFrame;
+    shared_ptr<const ColorTables> tb; // 이 프레임에 쓴 설정 스냅샷 (색 판별도 같은 설정으로)
+};
+
+struct ArmCmd {
+    uint32_t trigId = 0;
+    int64_t armUs = 0; // 이 시각 이후에 읽은 프레임만 측정에 사용
+};
+
+struct Decision {
+    uint32_t trigId = 0;
+    bool ok = false;   // decide: 측정 성공 / persist 이후: total.json 저장까지 성공
+    string label;
+    string color;
+    string type;
+    int rPix = -1, gPix = -1, bPix = -1;
+    double xMm = 0.0;
+    double yMm = 0.0;
+    double ms = 0.0;
+};
+
+// 단계별 처리 개수 / 바쁜 시간 (느린 단계 찾기용)
+struct StageStat {
+    const char* name;
+    atomic<uint64_t> items{ 0 };
+    atomic<uint64_t> busyUs{ 0 };
+
+    explicit StageStat(const char* n) : name(n) {}
+    void Add(int64_t beginUs) { items.fetch_add(1, memory_order_relaxed); busyUs.fetch_add((uint64_t)(TraceRing::NowUs() - beginUs), memory_order_relaxed); }
+};
+
+struct VisionPipeline {
+    atomic<bool> stop{ false };
+
+    // 설정 (시작 후 읽기 전용)
+    VideoCapture* cap = nullptr;
+    bool raw = false;
+    Rect roi;
+    double mmPerPx = 0.0;
+    const ColorConfigWatcher* colorCfg = nullptr;
+    MeasureArchiveWriter* history = nullptr; // 열기 실패면 nullptr
+    SpcEngine* spc = nullptr;
+
+    // decide 가 트리거를 받으면 번호를 걸어 둠 -> segment 는 이때만 일하고 trace 에 이 번호를 붙임
+    atomic<uint32_t> armedTrig{ 0 };
+
+    SpscQueue<FramePacket> captureQ{ 1, QUEUE_LATEST }; // capture -> segment
+    SpscQueue<FramePacket> previewQ{ 1, QUEUE_LATEST }; // capture -> main
+    SpscQueue<SegResult> segQ{ SEG_QUEUE_CAP, QUEUE_BLOCK };          // segment -> decide
+    SpscQueue<ArmCmd> armQ{ RESULT_QUEUE_CAP, QUEUE_BLOCK };          // signal -> decide
+    SpscQueue<Decision> decideQ{ RESULT_QUEUE_CAP, QUEUE_BLOCK };     // decide -> persist
+    SpscQueue<Decision> resultQ{ RESULT_QUEUE_CAP, QUEUE_BLOCK };     // persist -> signal
+
+    StageStat capture{ "capture" }, segment{ "segment" }, decide{ "decide" }, persist{ "persist" }, signal{ "signal" };
+};
+
+static void SleepUnlessStop(const atomic<bool>& stop, int ms)
+{
+    for (int t = 0; t < ms && !stop.load(); t += 20) this_thread::sleep_for(chrono::milliseconds(min(20, ms - t)));
+}
+
+// ---------------------
+// capture
+// ---------------------
+static void CaptureStage(VisionPipeline& p)
+{
+    uint64_t seq = 0;
+    while (!p.stop.load()) {
+        FramePacket f;
+        int64_t t0 = TraceRing::NowUs();
+        *p.cap >> f.packet; // 매번 새 Mat -> 뒤 단계가 들고 있는 버퍼를 덮어쓰지 않음
+        if (f.packet.empty()) {
             this_thread::sleep_for(chrono::milliseconds(1));
             continue;
         }
+        f.seq = ++seq;
+        f.grabUs = TraceRing::NowUs();
+        p.capture.Add(t0);
+
+        // 미리보기와 측정은 같은 패킷을 공유 (Mat 참조만, 둘 다 읽기만 함)
+        FramePacket view = f;
+        p.previewQ.Push(std::move(view), p.stop);
+        if (p.armedTrig.load() != 0) p.captureQ.Push(std::move(f), p.stop);
+    }
+}
 
-        Rect r = roi & Rect(0, 0, frame.cols, frame.rows);
-        if (r.width <= 0 || r.height <= 0) {
-            this_thread::sleep_for(chrono::milliseconds(1));
-            continue;
+// ---------------------
+// segment: ROI 디코드 + 측정 탐지 (기존 측정 탐지 파이프라인, 3색 통합 마스크)
+// ---------------------
+static void SegmentStage(VisionPipeline& p)
+{
+    FrameDecoder dec;
+    dec.raw = p.raw;
+    RleLabeler labeler; // 프레임마다 run/성분 버퍼 재사용
+    double freq = getTickFrequency();
+
+    while (!p.stop.load()) {
+        FramePacket f;
+        if (!p.captureQ.PopLatest(f, p.stop, 50)) continue;
+
+        uint32_t trigId = p.armedTrig.load();
+        if (trigId == 0) continue; // 트리거 끝난 뒤 남은 프레임
+
+        SegResult s;
+        s.seq = f.seq;
+        s.grabUs = f.grabUs;
+        s.trigId = trigId;
+        s.segBeginUs = TraceRing::NowUs();
+
+        // 프레임마다 현재 설정 스냅샷 (재로딩은 감시 스레드에서, 여기서는 대기 없음)
+        s.tb = p.colorCfg->Current();
+
+        // 측정에는 ROI 만 필요 -> raw MJPEG 면 ROI 를 덮는 MCU 만 디코드
+        Rect r;
+        bool decoded = false;
+        {
+            TraceScope span("decode", trigId);
+            decoded = dec.Roi(f.packet, p.roi, s.roiFrame, r);
         }
+        if (!decoded || r.width <= 0 || r.height <= 0) continue;
 
         int64 t0 = getTickCount();
-        Mat roiFrame = frame(r).clone();
+        Mat blurred;
+        BuildMeasureMask(s.roiFrame, *s.tb, blurred);
+
+        // run 라벨링 -> 성분별 면적(구멍 포함)만 비교, minAreaRect 는 최대 성분 하나에만
+        labeler.Run(blurred);
+        int best = labeler.Largest(s.tb->cfg.minBoxArea);
+        if (best >= 0) {
+            s.rr = labeler.MinAreaRect(best);
+            float longSidePx = s.rr.size.width;
+            float shortSidePx = s.rr.size.height;
+            if (longSidePx < shortSidePx) swap(longSidePx, shortSidePx);
+
+            s.detected = true;
+            if (p.mmPerPx > 0.0) {
+                s.wMm = (double)longSidePx * p.mmPerPx;
+                s.hMm = (double)shortSidePx * p.mmPerPx;
+            }
+        }
+        s.ms = (getTickCount() - t0) * 1000.0 / freq;
+        GlobalTrace().Record("segment", trigId, s.segBeginUs, TraceRing::NowUs());
+        p.segment.Add(s.segBeginUs);
 
-        // ===== 기존 측정 탐지 파이프라인 (유지) =====
-        Mat hsv;
-        cvtColor(roiFrame, hsv, COLOR_BGR2HSV);
+        p.segQ.Push(std::move(s), p.stop);
+    }
+}
+
+// ---------------------
+// decide: 트리거 하나 = ArmCmd 하나 -> Decision 하나 (성공/타임아웃)
+// ---------------------
+static void DecideStage(VisionPipeline& p)
+{
+    const int TOP_K = 1;
+    const int presentNeed = 2;
+    const int absentNeed = 1;
 
-        Mat maskR1, maskR2, maskR, maskG, maskB, mask;
+    // 런타임 색상 카운터(측정쪽)
+    int rCount = 0, gCount = 0, bCount = 0, nCount = 0;
 
-        // 빨강 (H: 0~20, 160~179)
-        inRange(hsv, Scalar(0, 60, 60), Scalar(20, 255, 255), maskR1);
-        inRange(hsv, Scalar(160, 60, 60), Scalar(179, 255, 255), maskR2);
-        maskR = maskR1 | maskR2;
+    bool armed = false;
+    ArmCmd arm;
+    long long deadlineMs = 0;
+    vector<Cand> buf;
+    bool inCooldown = false;
+    int presentStreak = 0, absentStreak = 0;
+    int64_t streakBeginUs = 0; // presentNeed 안정화 구간 시작 (trace)
+
+    auto finish = [&](Decision d) {
+        armed = false;
+        p.armedTrig.store(0);
+        GlobalTrace().Record("measure", arm.trigId, arm.armUs, TraceRing::NowUs());
+        p.decideQ.Push(std::move(d), p.stop);
+    };
+
+    while (!p.stop.load()) {
+        if (!armed && p.armQ.TryPop(arm)) {
+            armed = true;
+            deadlineMs = NowMillis() + MEASURE_TIMEOUT_MS;
+            buf.clear();
+            inCooldown = false;
+            presentStreak = absentStreak = 0;
+            p.armedTrig.store(arm.trigId);
+        }
 
-        // 초록 (H: 40~85)
-        inRange(hsv, Scalar(40, 60, 60), Scalar(85, 255, 255), maskG);
+        SegResult s;
+        bool got = p.segQ.Pop(s, p.stop, armed ? 5 : 20);
 
-        // 파랑 (H: 95~125)
-        inRange(hsv, Scalar(95, 60, 60), Scalar(125, 255, 255), maskB);
+        if (armed && NowMillis() > deadlineMs) {
+            cout << "[MEASURE] TIMEOUT (no stable detection)\n";
+            Decision d;
+            d.trigId = arm.trigId;
+            finish(std::move(d));
+            continue;
+        }
+        // 트리거 전에 읽은 프레임 / 이전 트리거 것은 버림
+        if (!got || !armed || s.trigId != arm.trigId || s.grabUs < arm.armUs) continue;
 
-        // 3색 통합
-        mask = maskR | maskG | maskB;
+        int64_t t0 = TraceRing::NowUs();
+        uint32_t trigId = arm.trigId;
 
+        if (s.detected) {
+            if (presentStreak == 0) streakBeginUs = s.segBeginUs;
+            presentStreak++; absentStreak = 0;
+        }
+        else { absentStreak++; presentStreak = 0; }
 
-        Mat blurred;
-        GaussianBlur(mask, blurred, Size(3, 3), 0);
-        threshold(blurred, blurred, 150, 255, THRESH_BINARY);
+        if (p.mmPerPx <= 0.0) { p.decide.Add(t0); continue; }
+        if (inCooldown) {
+            if (absentStreak >= absentNeed) { inCooldown = false; buf.clear(); }
+            p.decide.Add(t0);
+            continue;
+        }
+        if (presentStreak < presentNeed || !s.detected) { p.decide.Add(t0); continue; }
 
-        Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
-        morphologyEx(blurred, blurred, MORPH_OPEN, kernel, Point(-1, -1), 1);
-        morphologyEx(blurred, blurred, MORPH_CLOSE, kernel, Point(-1, -1), 1);
+        GlobalTrace().Record("stability_window", trigId, streakBeginUs, TraceRing::NowUs());
 
-        vector<vector<Point>> contours;
-        vector<Vec4i> hierarchy;
-        findContours(blurred, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        double score = 0.0;
+        {
+            TraceScope span("sharpness", trigId);
+            score = SharpnessScore(s.roiFrame);
+        }
 
-        bool detected = false;
-        double wOut = 0.0, hOut = 0.0;
+        Cand c;
+        c.score = score;
+        c.wMm = s.wMm;
+        c.hMm = s.hMm;
+        c.ms = s.ms;
+        c.rr = s.rr;
+        c.detected = s.detected;
+        c.roiImg = s.roiFrame; // segment 가 프레임마다 새로 만든 버퍼라 복사 불필요
+
+        buf.push_back(c);
+        KeepTopK(buf, TOP_K);
+        if ((int)buf.size() < TOP_K) { p.decide.Add(t0); continue; }
+
+        int rp = 0, gp = 0, bp = 0;
+        string color;
+        {
+            TraceScope span("classify_color", trigId);
+            color = ClassifyColorROI(buf[0].roiImg, *s.tb, rp, gp, bp);
+        }
 
-        int best = -1;
-        double bestArea = 0.0;
+        int curCount = 0;
+        if (color == "RED") { rCount++; curCount = rCount; }
+        else if (color == "GREEN") { gCount++; curCount = gCount; }
+        else if (color == "BLUE") { bCount++; curCount = bCount; }
+        else { nCount++; curCount = nCount; }
+
+        Decision d;
+        d.trigId = trigId;
+        d.ok = true;
+        d.xMm = buf[0].wMm;
+        d.yMm = buf[0].hMm;
+        d.ms = buf[0].ms;
+        d.label = MakeLabel(color, curCount);
+        d.color = color;
+        d.type = DecideTypeByX(d.xMm);
+        d.rPix = rp; d.gPix = gp; d.bPix = bp;
+
+        cout << "[MEASURE] detected=1"
+            << " color=" << color
+            << " label=" << d.label
+            << " (rPix/gPix/bPix=" << rp << "/" << gp << "/" << bp << ")"
+            << " x=" << fixed << setprecision(3) << d.xMm
+            << " y=" << fixed << setprecision(3) << d.yMm
+            << " ms=" << fixed << setprecision(3) << d.ms
+            << " type=" << d.type
+            << "\n";
+
+        p.decide.Add(t0);
+        finish(std::move(d));
+    }
+}
 
-        RotatedRect rr;
-        float longSidePx = 0.0f, shortSidePx = 0.0f;
+// ---------------------
+// persist: total.json (label 찾아 x/y/ms/type 덮어쓰기)
+// ---------------------
+static void PersistStage(VisionPipeline& p)
+{
+    while (!p.stop.load()) {
+        Decision d;
+        if (!p.decideQ.Pop(d, p.stop, 50)) continue;
 
-        if (!contours.empty()) {
-            for (int i = 0; i < (int)contours.size(); i++) {
-                double a = contourArea(contours[i]);
-                if (a < 2000) continue;
-                if (a > bestArea) { bestArea = a; best = i; }
+        int64_t t0 = TraceRing::NowUs();
+        if (d.ok) {
+            string reason;
+            {
+                TraceScope span("update_total_json", d.trigId);
+                d.ok = UpdateTotalJson_OverwriteMeasure(TOTAL_JSON, d.label, d.xMm, d.yMm, d.ms, d.type, reason);
             }
+            if (!d.ok) cout << "[MEASURE] SAVE FAIL: " << reason << " (label=" << d.label << ")\n";
+            else cout << "[MEASURE] SAVE OK -> total.json updated (label=" << d.label << ")\n";
+
+            // 이력은 total.json 저장 결과와 상관없이 측정값 그대로
+            if (p.history) {
+                TraceScope span("history_append", d.trigId);
+                MeasureRecord h;
+                h.tsMs = NowMillis();
+                h.label = d.label;
+                h.color = MeasureColorFromName(d.color);
+                h.type = MeasureTypeFromName(d.type);
+                h.x = d.xMm; h.y = d.yMm; h.ms = d.ms;
+                h.pixR = d.rPix; h.pixG = d.gPix; h.pixB = d.bPix;
+                if (!p.history->Append(h)) cerr << "[HIST] append failed (label=" << d.label << ")\n";
+            }
+            if (p.spc) {
+                TraceScope span("spc_update", d.trigId);
+                vector<SpcAlarm> alarms;
+                vector<string> groups = { "ALL", "color:" + d.color, "type:" + d.type };
+                if (d.type == "TOP" || d.type == "defect") groups.push_back(SPC_X_GROUP);
+                p.spc->Add(NowMillis(), groups, { { "x", d.xMm }, { "y", d.yMm }, { "ms", d.ms } }, &alarms);
+                for (const SpcAlarm& a : alarms) cerr << "[SPC] " << SpcEngine::FormatAlarm(a) << "\n";
+            }
+        }
+        p.persist.Add(t0);
+        p.resultQ.Push(std::move(d), p.stop);
+    }
+}
+
+// ---------------------
+// signal: Modbus. START 엣지 -> decide 에 전달 -> 결과 오면 코일 펄스
+// (트리거 하나가 끝날 때까지 START 를 다시 읽지 않음: 기존과 같은 1트리거 1결과)
+// ---------------------
+static void ModbusSafeOff(modbus_t* ctx)
+{
+    WriteCoil(ctx, COIL_TOP, false);
+    WriteCoil(ctx, COIL_BASE, false);
+    WriteCoil(ctx, COIL_NONE, false);
+}
+
+static modbus_t* ConnectUntilStop(const atomic<bool>& stop, const char* what)
+{
+    modbus_t* ctx = nullptr;
+    while (!ctx && !stop.load()) {
+        ctx = ConnectModbus(PLC_IP, PLC_PORT);
+        if (!ctx) {
+            cerr << "[MODBUS] " << what << " failed: " << modbus_strerror(errno)
+                << " -> retry in " << RECONNECT_EVERY_MS << "ms\n";
+            SleepUnlessStop(stop, RECONNECT_EVERY_MS);
+        }
+    }
+    return ctx;
+}
 
-            if (best >= 0) {
-                rr = minAreaRect(contours[best]);
-                float rawW = rr.size.width;
-                float rawH = rr.size.height;
+static void SignalStage(VisionPipeline& p)
+{
+    modbus_t* ctx = ConnectUntilStop(p.stop, "connect");
+    if (!ctx) return;
+    cout << "[MODBUS] connected\n";
 
-                longSidePx = rawW;
-                shortSidePx = rawH;
-                if (longSidePx < shortSidePx) swap(longSidePx, shortSidePx);
+    // 초기 안전 OFF
+    ModbusSafeOff(ctx);
+    cout << "[RUN] waiting START=1 ...\n";
 
-                detected = true;
+    bool busyWaitStartLow = false;
 
-                if (mmPerPx > 0.0) {
-                    wOut = (double)longSidePx * mmPerPx;
-                    hOut = (double)shortSidePx * mmPerPx;
-                }
+    while (!p.stop.load()) {
+        // reconnect if needed
+        if (!ctx) {
+            ctx = ConnectUntilStop(p.stop, "reconnect");
+            if (!ctx) break;
+            cout << "[MODBUS] reconnected\n";
+            ModbusSafeOff(ctx);
+            busyWaitStartLow = false;
+        }
+
+        bool start = false;
+        int64_t pollBeginUs = TraceRing::NowUs();
+        if (!ReadCoil(ctx, START_COIL, start)) {
+            cerr << "[MODBUS] read START failed: " << modbus_strerror(errno) << " -> reconnect\n";
+            MarkDisconnected(ctx);
+            continue;
+        }
+
+        // START=1 유지 동안 중복측정 방지
+        if (busyWaitStartLow) {
+            if (!start) {
+                busyWaitStartLow = false;
+                cout << "[TRIG] START back to 0 -> ready next\n";
             }
+            this_thread::sleep_for(chrono::milliseconds(TRIG_POLL_MS));
+            continue;
         }
 
-        int64 t1 = getTickCount();
-        double elapsedMs = (t1 - t0) * 1000.0 / freq;
+        if (start) {
+            uint32_t trigId = GlobalTrace().NextTriggerId();
+            GlobalTrace().Record("poll_start", trigId, pollBeginUs, TraceRing::NowUs());
+            cout << "[TRIG] START=1 -> MEASURE NOW (trig #" << trigId << ")\n";
+
+            ArmCmd cmd;
+            cmd.trigId = trigId;
+            cmd.armUs = pollBeginUs;
+            p.armQ.Push(cmd, p.stop);
+
+            // decide 타임아웃 + 저장 여유. 이전 트리거의 늦은 결과는 버림
+            Decision d;
+            bool got = false;
+            long long waitEnd = NowMillis() + MEASURE_TIMEOUT_MS + 2000;
+            while (!p.stop.load() && NowMillis() < waitEnd) {
+                if (!p.resultQ.Pop(d, p.stop, 50)) continue;
+                if (d.trigId == trigId) { got = true; break; }
+            }
+            int64_t t0 = TraceRing::NowUs();
 
-        if (detected) { presentStreak++; absentStreak = 0; }
-        else { absentStreak++; presentStreak = 0; }
+            busyWaitStartLow = true;
 
-        if (mmPerPx > 0.0) {
-            if (inCooldown) {
-                if (absentStreak >= absentNeed) { inCooldown = false; buf.clear(); }
+            if (!got || !d.ok) {
+                cout << "[MEASURE] FAIL (no update to total.json)\n";
+                // 실패면 NONE 펄스 보내고 싶으면 아래 주석 해제
+                // if (!SendResultPulse(ctx, "NONE", trigId)) { cerr << "[MODBUS] send pulse failed\n"; MarkDisconnected(ctx); }
             }
             else {
-                if (presentStreak >= presentNeed && detected) {
-                    double score = SharpnessScore(roiFrame);
-
-                    Cand c;
-                    c.score = score;
-                    c.wMm = wOut;
-                    c.hMm = hOut;
-                    c.ms = elapsedMs;
-                    c.rr = rr;
-                    c.detected = detected;
-                    c.roiImg = roiFrame.clone();
-
-                    buf.push_back(c);
-                    KeepTopK(buf, TOP_K);
-
-                    if ((int)buf.size() >= TOP_K) {
-                        double xMm = buf[0].wMm;
-                        double yMm = buf[0].hMm;
-                        double ms = buf[0].ms;
-
-                        int rp = 0, gp = 0, bp = 0;
-                        string color = ClassifyColorROI(buf[0].roiImg, colorTh, rp, gp, bp);
-
-                        int curCount = 0;
-                        if (color == "RED") { rCount++; curCount = rCount; }
-                        else if (color == "GREEN") { gCount++; curCount = gCount; }
-                        else if (color == "BLUE") { bCount++; curCount = bCount; }
-                        else { nCount++; curCount = nCount; }
-
-                        string label = MakeLabel(color, curCount);
-                        string type = DecideTypeByX(xMm);
-
-                        cout << "[MEASURE] detected=1"
-                            << " color=" << color
-                            << " label=" << label
-                            << " (rPix/gPix/bPix=" << rp << "/" << gp << "/" << bp << ")"
-                            << " x=" << fixed << setprecision(3) << xMm
-                            << " y=" << fixed << setprecision(3) << yMm
-                            << " ms=" << fixed << setprecision(3) << ms
-                            << " type=" << type
-                            << "\n";
-
-                        string reason;
-                        bool ok = UpdateTotalJson_OverwriteMeasure(TOTAL_JSON, label, xMm, yMm, ms, type, reason);
-
-                        if (!ok) {
-                            cout << "[MEASURE] SAVE FAIL: " << reason << " (label=" << label << ")\n";
-                        }
-                        else {
-                            cout << "[MEASURE] SAVE OK -> total.json updated (label=" << label << ")\n";
-                        }
-
-                        outLabel = label;
-                        outType = type;
-                        return ok;
-                    }
+                cout << "[SEND] type=" << d.type << " -> coil pulse\n";
+                if (!SendResultPulse(ctx, d.type, trigId)) {
+                    cerr << "[MODBUS] send pulse failed: " << modbus_strerror(errno) << " -> reconnect\n";
+                    MarkDisconnected(ctx);
                 }
             }
+
+            FinishTriggerTrace(trigId, pollBeginUs);
+            p.signal.Add(t0);
         }
 
-        this_thread::sleep_for(chrono::milliseconds(1));
+        this_thread::sleep_for(chrono::milliseconds(TRIG_POLL_MS));
+    }
+
+    // cleanup
+    if (ctx) {
+        ModbusSafeOff(ctx);
+        MarkDisconnected(ctx);
     }
 }
 
+// ---------------------
+// 단계/큐 상태: [PIPE] 한 줄 (처리율, 평균 처리 시간, 큐 깊이/최대/버림)
+// ---------------------
+struct PipeSnapshot {
+    uint64_t items[5] = {};
+    uint64_t busyUs[5] = {};
+    int64_t atUs = 0;
+};
+
+static string FormatPipelineStats(VisionPipeline& p, PipeSnapshot& prev)
+{
+    StageStat* st[5] = { &p.capture, &p.segment, &p.decide, &p.persist, &p.signal };
+    PipeSnapshot cur;
+    cur.atUs = TraceRing::NowUs();
+    double sec = prev.atUs > 0 ? (cur.atUs - prev.atUs) / 1e6 : 0.0;
+
+    ostringstream os;
+    os << fixed << setprecision(1);
+    for (int i = 0; i < 5; i++) {
+        cur.items[i] = st[i]->items.load();
+        cur.busyUs[i] = st[i]->busyUs.load();
+        uint64_t n = cur.items[i] - prev.items[i];
+        uint64_t us = cur.busyUs[i] - prev.busyUs[i];
+        os << st[i]->name << " " << (sec > 0.0 ? n / sec : 0.0) << "/s";
+        if (n) os << " " << (us / 1000.0 / n) << "ms";
+        os << "  ";
+    }
+
+    auto q = [&](const char* name, const QueueStats& s) {
+        os << "| " << name << " " << s.depth << "/" << s.capacity << " max " << s.maxDepth;
+        if (s.dropped) os << " drop " << s.dropped;
+        if (s.skipped) os << " skip " << s.skipped;
+        os << " ";
+    };
+    q("cap>seg", p.captureQ.Stats());
+    q("cap>view", p.previewQ.Stats());
+    q("seg>dec", p.segQ.Stats());
+    q("dec>save", p.decideQ.Stats());
+    q("save>sig", p.resultQ.Stats());
+
+    prev = cur;
+    return os.str();
+}
+
+// =====================
+// MJPEG 녹화/재생 (카메라 없이 ROI 디코드 확인)
+// =====================
+static bool LoadMjpegFrames(const string& path, vector<vector<uint8_t>>& frames)
+{
+    auto readAll = [](const filesystem::path& p, vector<uint8_t>& out) {
+        ifstream ifs(p, ios::binary);
+        if (!ifs.is_open()) return false;
+        out.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        return true;
+    };
+
+    frames.clear();
+    if (filesystem::is_directory(path)) {
+        // 폴더: *.jpg 한 장 = 한 프레임 (이름순)
+        vector<filesystem::path> files;
+        for (const auto& e : filesystem::directory_iterator(path)) {
+            string ext = e.path().extension().string();
+            transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+            if (ext == ".jpg" || ext == ".jpeg") files.push_back(e.path());
+        }
+        sort(files.begin(), files.end());
+        for (const auto& f : files) {
+            vector<uint8_t> b;
+            if (readAll(f, b) && !b.empty()) frames.push_back(std::move(b));
+        }
+    }
+    else {
+        // 파일: JPEG 이 연달아 붙은 .mjpeg (--mjpeg-record 결과)
+        vector<uint8_t> all;
+        if (!readAll(path, all)) return false;
+        for (const auto& fr : SplitMjpegStream(all.data(), all.size()))
+            frames.emplace_back(all.begin() + fr.first, all.begin() + fr.first + fr.second);
+    }
+    return !frames.empty();
+}
+
+static int RunMjpegRecord(const string& outPath, int count)
+{
+    VideoCapture cap;
+    bool raw = false;
+    if (!OpenCamera(cap, true, raw)) {
+        cerr << "[FATAL] camera open failed\n";
+        return -1;
+    }
+    if (!raw) {
+        cerr << "[FATAL] backend does not deliver raw MJPEG\n";
+        return -1;
+    }
+
+    ofstream ofs(outPath, ios::binary | ios::trunc);
+    if (!ofs.is_open()) {
+        cerr << "[FATAL] cannot write " << outPath << "\n";
+        return -1;
+    }
+
+    int written = 0;
+    uint64_t bytes = 0;
+    Mat packet;
+    while (written < count) {
+        cap >> packet;
+        if (!IsMjpegPacket(packet)) continue;
+        ofs.write((const char*)packet.data, (streamsize)packet.total());
+        bytes += packet.total();
+        if (++written % 30 == 0) cout << "[REC] " << written << "/" << count << " frames\n";
+    }
+    cout << "[REC] " << written << " frames, " << bytes << " B -> " << outPath << "\n";
+    return 0;
+}
+
+// 같은 프레임을 전체 디코드 후 자른 것과 ROI 디코드한 것을 비교 (픽셀이 같아야 함)
+// 절반 지점에서 ROI 를 한 번 옮겨서 재계획(전체 디코드 1회) 경로도 확인
+static int RunMjpegReplay(const string& path, const Rect& roiA)
+{
+    vector<vector<uint8_t>> frames;
+    if (!LoadMjpegFrames(path, frames)) {
+        cerr << "[FATAL] no JPEG frames in " << path << "\n";
+        return -1;
+    }
+
+    Rect roiB(roiA.x + 37, roiA.y + 21, roiA.width, roiA.height);
+    MjpegRoiDecoder fullDec, roiDec;
+    double freq = getTickFrequency();
+    double fullMs = 0.0, roiMs = 0.0;
+    int roiFrames = 0, mismatched = 0, failed = 0;
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        const vector<uint8_t>& jpg = frames[i];
+        const Rect& roi = (i < frames.size() / 2) ? roiA : roiB;
+
+        Mat full;
+        int64 t0 = getTickCount();
+        bool okFull = fullDec.DecodeFull(jpg.data(), jpg.size(), full);
+        int64 t1 = getTickCount();
+
+        Mat roiBgr;
+        Rect r;
+        MjpegDecodeKind kind = roiDec.DecodeRoi(jpg.data(), jpg.size(), roi, roiBgr, &r);
+        int64 t2 = getTickCount();
+
+        if (!okFull || kind == MJPEG_DECODE_FAIL) {
+            cerr << "[REPLAY] frame " << i << " decode failed: " << roiDec.LastError() << "\n";
+            failed++;
+            continue;
+        }
+
+        // 비교는 ROI 디코드가 실제로 쓰인 프레임만 (전체 디코드 프레임은 같을 수밖에 없음)
+        if (kind == MJPEG_DECODE_ROI) {
+            fullMs += (t1 - t0) * 1000.0 / freq;
+            roiMs += (t2 - t1) * 1000.0 / freq;
+            roiFrames++;
+
+            Mat diff;
+            absdiff(full(r), roiBgr, diff);
+            double maxDiff = 0.0;
+            minMaxLoc(diff.reshape(1), nullptr, &maxDiff);
+            if (maxDiff > 0.0) {
+                mismatched++;
+                cerr << "[REPLAY] frame " << i << " max diff " << maxDiff << "\n";
+            }
+        }
+        else {
+            cout << "[REPLAY] frame " << i << " full decode (roi " << roi.x << "," << roi.y << " " << roi.width << "x" << roi.height
+                << ") -> plan " << roiDec.PlannedRect().x << "," << roiDec.PlannedRect().y << " "
+                << roiDec.PlannedRect().width << "x" << roiDec.PlannedRect().height << "\n";
+        }
+    }
+
+    const MjpegDecodeStats& st = roiDec.Stats();
+    cout << fixed << setprecision(2);
+    cout << "[REPLAY] frames=" << frames.size() << " roi=" << st.roiDecodes << " full=" << st.fullDecodes
+        << " fail=" << failed << " mismatch=" << mismatched << "\n";
+    if (st.framePixels > 0)
+        cout << "[REPLAY] decoded pixels " << (100.0 * st.decodedPixels / st.framePixels) << "%\n";
+    if (roiFrames > 0) {
+        cout << "[REPLAY] full decode " << fullMs / roiFrames << " ms/frame, roi decode " << roiMs / roiFrames
+            << " ms/frame (x" << (roiMs > 0.0 ? fullMs / roiMs : 0.0) << ")\n";
+    }
+    return (mismatched == 0 && failed == 0) ? 0 : 1;
+}
+
 // =====================
 // MAIN
 // =====================
-int main() {
+int main(int argc, char** argv) {
+    if (argc >= 3 && string(argv[1]) == "--mjpeg-replay") {
+        Rect r(710, 50, 550, 1000);
+        if (argc >= 7) r = Rect(atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+        return RunMjpegReplay(argv[2], r);
+    }
+    if (argc >= 3 && string(argv[1]) == "--mjpeg-record")
+        return RunMjpegRecord(argv[2], argc >= 4 ? atoi(argv[3]) : 300);
+
     cout << "[CWD] " << filesystem::current_path().string() << "\n";
     cout << "[MODBUS] " << PLC_IP << ":" << PLC_PORT
         << " START=" << START_COIL << " (read)\n";
@@ -693,14 +1284,15 @@ int main() {
     cout << "[JSON] only " << TOTAL_JSON << "\n";
     cout << "[SEND] TOP=" << COIL_TOP << " BASE=" << COIL_BASE << " NONE=" << COIL_NONE << " pulse=" << PULSE_MS << "ms\n";
 
+    GlobalTrace().SetEnabled(TRACE_ENABLED);
+    cout << "[TRACE] " << (TRACE_ENABLED ? "on" : "off") << " slow>=" << TRACE_SLOW_MS << "ms (key 't' -> trace_*.json)\n";
+
     // ✅ total.json 없으면 새로 생성
     if (!EnsureJsonArrayFile(TOTAL_JSON)) {
         cerr << "[FATAL] failed to create " << TOTAL_JSON << "\n";
         return -1;
     }
 
-    int deviceIndex = 2;
-
     // scale.yaml
     double mmPerPx = 0.0;
     if (ifstream("scale.yaml").good()) {
@@ -712,16 +1304,13 @@ int main() {
     }
     cout << "[SCALE] mmPerPx=" << fixed << setprecision(6) << mmPerPx << "\n";
 
-    VideoCapture cap(deviceIndex, CAP_DSHOW);
-    if (!cap.isOpened()) {
+    VisionPipeline pipe;
+    VideoCapture cap;
+    if (!OpenCamera(cap, RAW_MJPEG, pipe.raw)) {
         cerr << "[FATAL] camera open failed\n";
         return -1;
     }
 
-    cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('M', 'J', 'P', 'G'));
-    cap.set(CAP_PROP_FRAME_WIDTH, 1920);
-    cap.set(CAP_PROP_FRAME_HEIGHT, 1080);
-
     int actualWidth = (int)cap.get(CAP_PROP_FRAME_WIDTH);
     int actualHeight = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
     cout << "[CAMERA] Actual resolution: " << actualWidth << "x" << actualHeight << "\n";
@@ -733,123 +1322,108 @@ int main() {
     cout << "[ROI] x=" << roi.x << " y=" << roi.y
         << " w=" << roi.width << " h=" << roi.height << "\n";
 
-    // modbus connect (until success)
-    modbus_t* ctx = nullptr;
-    while (!ctx) {
-        ctx = ConnectModbus(PLC_IP, PLC_PORT);
-        if (!ctx) {
-            cerr << "[MODBUS] connect failed: " << modbus_strerror(errno)
-                << " -> retry in " << RECONNECT_EVERY_MS << "ms\n";
-            this_thread::sleep_for(chrono::milliseconds(RECONNECT_EVERY_MS));
-        }
-    }
-    cout << "[MODBUS] connected\n";
+    ColorConfigWatcher colorCfg(COLOR_CONFIG, DefaultColorConfig());
+    colorCfg.Start();
 
-    // 초기 안전 OFF
-    WriteCoil(ctx, COIL_TOP, false);
-    WriteCoil(ctx, COIL_BASE, false);
-    WriteCoil(ctx, COIL_NONE, false);
+    pipe.cap = &cap;
+    pipe.roi = roi;
+    pipe.mmPerPx = mmPerPx;
+    pipe.colorCfg = &colorCfg;
 
-    cout << "[RUN] waiting START=1 ...\n";
-
-    ColorThresholds th;
-
-    // 런타임 색상 카운터(측정쪽)
-    int rCount = 0, gCount = 0, bCount = 0, nCount = 0;
-
-    bool busyWaitStartLow = false;
+    MeasureArchiveOptions histOpt;
+    histOpt.dir = HISTORY_DIR;
+    histOpt.maxSegments = HISTORY_KEEP_SEGMENTS;
+    MeasureArchiveWriter history(histOpt);
+    {
+        string err;
+        if (history.Open(err)) {
+            pipe.history = &history;
+            cout << "[HIST] " << HISTORY_DIR << " (pending " << history.PendingRows() << " rows)\n";
+        }
+        else cerr << "[HIST] disabled: " << err << "\n";
+    }
 
-    // ✅ 시각화 창
+    // x 규격 = DecideTypeByX 의 TOP 구간 (57~63, 중심 60). TOP + defect 를 합친 그룹에 건다
+    // type:TOP 만 쓰면 57 미만은 defect 로 빠져서 분포가 규격에서 잘림 -> Cpk 가 부풀고 57 을 넘는 드리프트를 못 봄
+    // (63 초과는 BASE 와 구별할 수 없어서 위쪽은 여전히 잘림, 불량 쪽인 LSL 쪽을 보는 용도)
+    // type:TOP/BASE/defect, ALL/color 는 통계만
+    SpcEngine spc;
+    {
+        SpcMetricConfig xCfg;
+        xCfg.hasSpec = true;
+        xCfg.lsl = TYPE_DEFECT_CUT_MM;
+        xCfg.usl = TYPE_BASE_CENTER_MM + TYPE_TOL_MM;
+        xCfg.target = TYPE_BASE_CENTER_MM;
+        xCfg.guard = SPC_X_GUARD_MM;
+        xCfg.alarm = true;
+        spc.SetMetric(SPC_X_GROUP, "x", xCfg);
+    }
+    pipe.spc = &spc;
+    cout << "[SPC] " << SPC_X_GROUP << " x spec " << TYPE_DEFECT_CUT_MM << "~" << (TYPE_BASE_CENTER_MM + TYPE_TOL_MM)
+        << " -> " << SPC_JSON << " (key 's')\n";
+
+    // 단계별 스레드 시작 (Modbus 연결은 signal 스레드에서, 그동안에도 미리보기는 돈다)
+    vector<thread> stages;
+    stages.emplace_back(CaptureStage, ref(pipe));
+    stages.emplace_back(SegmentStage, ref(pipe));
+    stages.emplace_back(DecideStage, ref(pipe));
+    stages.emplace_back(PersistStage, ref(pipe));
+    stages.emplace_back(SignalStage, ref(pipe));
+    cout << "[PIPE] capture -> segment -> decide -> persist -> signal (key 'p' -> queue stats)\n";
+
+    // ✅ 시각화 창 (HighGUI 는 메인 스레드에서만)
     namedWindow("VIEW", WINDOW_NORMAL);
     namedWindow("MASK(ROI)", WINDOW_NORMAL);
 
+    FrameDecoder viewDec;
+    viewDec.raw = pipe.raw;
+    PipeSnapshot pipeSnap;
+    string pipeLine = FormatPipelineStats(pipe, pipeSnap);
+    long long nextStatsMs = NowMillis() + PIPE_STATS_EVERY_MS;
+    long long nextSpcMs = NowMillis() + SPC_PUBLISH_EVERY_MS;
+    uint64_t spcPublished = 0;
+
     while (true) {
-        // 평상시에도 프레임 읽어서 ROI/컨투어 박스 시각화
+        // 평상시에도 프레임 읽어서 ROI/컨투어 박스 시각화 (미리보기는 전체 디코드, 밀린 프레임은 건너뜀)
+        FramePacket f;
         Mat live;
-        cap >> live;
+        if (pipe.previewQ.PopLatest(f, pipe.stop, 30)) viewDec.Full(f.packet, live);
         if (!live.empty()) {
             Mat vis, maskVis;
-            DrawRoiAndLargestContourBox(live, roi, vis, maskVis);
+            DrawRoiAndLargestContourBox(live, roi, *colorCfg.Current(), vis, maskVis);
 
             imshow("VIEW", vis);
             if (!maskVis.empty()) imshow("MASK(ROI)", maskVis);
-
-            int key = waitKey(1);
-            if (key == 27) {
-                cout << "[EXIT] ESC pressed\n";
-                break;
-            }
         }
 
-        // reconnect if needed
-        if (!ctx) {
-            while (!ctx) {
-                ctx = ConnectModbus(PLC_IP, PLC_PORT);
-                if (!ctx) {
-                    cerr << "[MODBUS] reconnect failed: " << modbus_strerror(errno)
-                        << " -> retry in " << RECONNECT_EVERY_MS << "ms\n";
-                    this_thread::sleep_for(chrono::milliseconds(RECONNECT_EVERY_MS));
-                }
-            }
-            cout << "[MODBUS] reconnected\n";
-            // 안전 OFF
-            WriteCoil(ctx, COIL_TOP, false);
-            WriteCoil(ctx, COIL_BASE, false);
-            WriteCoil(ctx, COIL_NONE, false);
-            busyWaitStartLow = false;
+        int key = waitKey(1);
+        if (key == 27) {
+            cout << "[EXIT] ESC pressed\n";
+            break;
         }
+        if (key == 't' || key == 'T') ExportTraceNow();
 
-        bool start = false;
-        if (!ReadCoil(ctx, START_COIL, start)) {
-            cerr << "[MODBUS] read START failed: " << modbus_strerror(errno) << " -> reconnect\n";
-            MarkDisconnected(ctx);
-            continue;
+        if (NowMillis() >= nextStatsMs || key == 'p' || key == 'P') {
+            pipeLine = FormatPipelineStats(pipe, pipeSnap);
+            cout << "[PIPE] " << pipeLine << "\n";
+            nextStatsMs = NowMillis() + PIPE_STATS_EVERY_MS;
         }
 
-        // START=1 유지 동안 중복측정 방지
-        if (busyWaitStartLow) {
-            if (!start) {
-                busyWaitStartLow = false;
-                cout << "[TRIG] START back to 0 -> ready next\n";
-            }
-            this_thread::sleep_for(chrono::milliseconds(TRIG_POLL_MS));
-            continue;
+        bool spcKey = (key == 's' || key == 'S');
+        if (spcKey || (NowMillis() >= nextSpcMs && spc.Version() != spcPublished)) {
+            spcPublished = spc.Version();
+            if (!spc.WriteJson(SPC_JSON, NowMillis())) cerr << "[SPC] write failed: " << SPC_JSON << "\n";
+            if (spcKey) cout << "[SPC] " << spc.Summary(NowMillis()) << "\n";
         }
-
-        if (start) {
-            cout << "[TRIG] START=1 -> MEASURE NOW\n";
-
-            string label, type;
-            bool ok = DoMeasureNow(cap, roi, mmPerPx, th, rCount, gCount, bCount, nCount, label, type);
-
-            busyWaitStartLow = true;
-
-            if (!ok) {
-                cout << "[MEASURE] FAIL (no update to total.json)\n";
-                // 실패면 NONE 펄스 보내고 싶으면 아래 주석 해제
-                // if (!SendResultPulse(ctx, "NONE")) { cerr << "[MODBUS] send pulse failed\n"; MarkDisconnected(ctx); }
-            }
-            else {
-                cout << "[SEND] type=" << type << " -> coil pulse\n";
-                if (!SendResultPulse(ctx, type)) {
-                    cerr << "[MODBUS] send pulse failed: " << modbus_strerror(errno) << " -> reconnect\n";
-                    MarkDisconnected(ctx);
-                }
-            }
-        }
-
-        this_thread::sleep_for(chrono::milliseconds(TRIG_POLL_MS));
+        if (NowMillis() >= nextSpcMs) nextSpcMs = NowMillis() + SPC_PUBLISH_EVERY_MS;
     }
 
-    // cleanup
-    if (ctx) {
-        WriteCoil(ctx, COIL_TOP, false);
-        WriteCoil(ctx, COIL_BASE, false);
-        WriteCoil(ctx, COIL_NONE, false);
-        modbus_close(ctx);
-        modbus_free(ctx);
-        ctx = nullptr;
-    }
+    // cleanup: 단계 종료 (signal 스레드가 코일 OFF + 연결 해제)
+    pipe.stop.store(true);
+    for (thread& t : stages) t.join();
+    spc.WriteJson(SPC_JSON, NowMillis());
+
+    colorCfg.Stop();
     cap.release();
     destroyAllWindows();
     return 0;